@@ -0,0 +1,98 @@
+#ifndef AFINA_BENCH_HISTOGRAM_H
+#define AFINA_BENCH_HISTOGRAM_H
+
+#include <array>
+#include <cstdint>
+
+namespace Afina {
+namespace Bench {
+
+/**
+ * # Latency histogram
+ * Log-linear buckets: each power of two range is split into 32 linear sub-buckets, so that
+ * any recorded value is reported with relative error below ~3% while whole histogram takes
+ * a few kilobytes regardless of number of samples.
+ *
+ * Not thread safe, each benchmark thread records into its own histogram which are merged at the end
+ */
+class Histogram {
+public:
+    Histogram() : _count(0), _max(0) { _buckets.fill(0); }
+
+    void Record(uint64_t value) {
+        _buckets[index(value)]++;
+        _count++;
+        if (value > _max) {
+            _max = value;
+        }
+    }
+
+    void Merge(const Histogram &other) {
+        for (std::size_t i = 0; i < _buckets.size(); i++) {
+            _buckets[i] += other._buckets[i];
+        }
+        _count += other._count;
+        if (other._max > _max) {
+            _max = other._max;
+        }
+    }
+
+    inline uint64_t Count() const { return _count; }
+    inline uint64_t Max() const { return _max; }
+
+    /**
+     * Value at the given quantile (0..1), reported as the upper bound of the bucket it falls into
+     */
+    uint64_t Quantile(double q) const {
+        if (_count == 0) {
+            return 0;
+        }
+
+        uint64_t rank = uint64_t(q * double(_count));
+        if (rank >= _count) {
+            rank = _count - 1;
+        }
+
+        uint64_t seen = 0;
+        for (std::size_t i = 0; i < _buckets.size(); i++) {
+            seen += _buckets[i];
+            if (seen > rank) {
+                uint64_t bound = upper_bound(i);
+                return bound < _max ? bound : _max;
+            }
+        }
+        return _max;
+    }
+
+private:
+    static constexpr unsigned SubBits = 5;
+    static constexpr uint64_t SubCount = 1 << SubBits;
+
+    // Values below SubCount get exact buckets, then each power of two gets SubCount buckets
+    static std::size_t index(uint64_t value) {
+        if (value < SubCount) {
+            return std::size_t(value);
+        }
+        unsigned exp = 63 - __builtin_clzll(value);
+        unsigned shift = exp - SubBits;
+        return std::size_t((shift + 1) * SubCount + ((value >> shift) - SubCount));
+    }
+
+    static uint64_t upper_bound(std::size_t index) {
+        if (index < SubCount) {
+            return index;
+        }
+        unsigned shift = unsigned(index / SubCount) - 1;
+        uint64_t sub = index % SubCount;
+        return ((SubCount + sub + 1) << shift) - 1;
+    }
+
+    std::array<uint64_t, (64 - SubBits + 1) * SubCount> _buckets;
+    uint64_t _count;
+    uint64_t _max;
+};
+
+} // namespace Bench
+} // namespace Afina
+
+#endif // AFINA_BENCH_HISTOGRAM_H
@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <cxxopts.hpp>
+#include <spdlog/sinks/stdout_sinks.h>
+
+#include <afina/Hash.h>
+#include <afina/execute/Add.h>
+#include <afina/execute/Append.h>
+#include <afina/execute/Command.h>
+#include <afina/execute/Get.h>
+#include <afina/execute/Replace.h>
+#include <afina/execute/Set.h>
+#include <afina/logging/Trace.h>
+
+#include "storage/ThreadSafeSimpleLRU.h"
+
+using namespace Afina;
+
+namespace {
+
+struct Config {
+    std::size_t commands;
+    std::size_t keys;
+    std::size_t value_size;
+    std::size_t rounds;
+    uint32_t every;
+    std::string mode;
+};
+
+enum class Kind { Get, Set, Add, Append, Replace };
+
+struct Operation {
+    Kind kind;
+    std::string key;
+    uint64_t hash;
+};
+
+/**
+ * Mostly gets, the rest are sets and a few add/append/replace, over the fixed set of keys
+ */
+std::vector<Operation> Generate(const Config &cfg) {
+    std::mt19937_64 rnd(42);
+    std::vector<Operation> ops;
+    for (std::size_t i = 0; i < cfg.commands; i++) {
+        std::string key = "key:" + std::to_string(rnd() % cfg.keys);
+        uint64_t hash = KeyHash(key);
+        uint64_t dice = rnd() % 100;
+        Kind kind = dice < 70 ? Kind::Get
+                              : dice < 90 ? Kind::Set : dice < 94 ? Kind::Add : dice < 97 ? Kind::Append : Kind::Replace;
+        ops.push_back(Operation{kind, std::move(key), hash});
+    }
+    return ops;
+}
+
+/**
+ * What commands used to print on every call, before trace macros: a line to stdout flushed by std::endl
+ */
+void PrintLikeBefore(const Operation &op, const std::string &value) {
+    switch (op.kind) {
+    case Kind::Get: {
+        std::stringstream keyStream;
+        std::vector<std::string> keys = {op.key};
+        copy(keys.begin(), keys.end(), std::ostream_iterator<std::string>(keyStream, " "));
+        std::cout << "Get(" << keyStream.str() << ")" << std::endl;
+        break;
+    }
+    case Kind::Set:
+        std::cout << "Set(" << op.key << "): " << value << std::endl;
+        break;
+    case Kind::Add:
+        std::cout << "Add(" << op.key << ")" << value << std::endl;
+        break;
+    case Kind::Append:
+        std::cout << "Append(" << op.key << ")" << value << std::endl;
+        break;
+    case Kind::Replace:
+        std::cout << "Replace(" << op.key << "): " << value << std::endl;
+        break;
+    }
+}
+
+// Runs all the operations, returns time taken
+std::chrono::nanoseconds Run(const Config &cfg, const std::vector<Operation> &ops, Storage &storage) {
+    bool print = cfg.mode == "stdout";
+    std::string value(cfg.value_size, 'v');
+    std::string out;
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto &op : ops) {
+        if (print) {
+            PrintLikeBefore(op, value);
+        }
+        switch (op.kind) {
+        case Kind::Get:
+            Execute::Get({op.key}, {op.hash}).Execute(storage, "", out);
+            break;
+        case Kind::Set:
+            Execute::Set(op.key, 0, 0, op.hash).Execute(storage, value, out);
+            break;
+        case Kind::Add:
+            Execute::Add(op.key, 0, 0, op.hash).Execute(storage, value, out);
+            break;
+        case Kind::Append:
+            Execute::Append(op.key, 0, 0, op.hash).Execute(storage, "a", out);
+            break;
+        case Kind::Replace:
+            Execute::Replace(op.key, 0, 0, op.hash).Execute(storage, value, out);
+            break;
+        }
+    }
+    return std::chrono::steady_clock::now() - start;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    cxxopts::Options options("runExecuteBench", "Afina command execution benchmark");
+    Config cfg;
+    try {
+        // clang-format off
+        options.add_options()
+            ("n,commands", "Number of commands to execute", cxxopts::value<std::size_t>()->default_value("200000"))
+            ("keys", "Number of distinct keys", cxxopts::value<std::size_t>()->default_value("10000"))
+            ("value-size", "Value size in bytes", cxxopts::value<std::size_t>()->default_value("32"))
+            ("rounds", "Number of runs, the best one is reported", cxxopts::value<std::size_t>()->default_value("5"))
+            ("mode", "stdout: print a line per command as it used to be, off: trace is compiled in but not "
+                     "installed, sampled: trace to stdout every Nth command, all: each of them",
+                     cxxopts::value<std::string>()->default_value("all"))
+            ("every", "Trace every Nth command in sampled mode", cxxopts::value<uint32_t>()->default_value("1000"))
+            ("h,help", "Print usage info");
+        // clang-format on
+        options.parse(argc, argv);
+
+        if (options.count("help") > 0) {
+            std::cerr << options.help() << std::endl;
+            return 0;
+        }
+
+        cfg.commands = options["commands"].as<std::size_t>();
+        cfg.keys = options["keys"].as<std::size_t>();
+        cfg.value_size = options["value-size"].as<std::size_t>();
+        cfg.rounds = options["rounds"].as<std::size_t>();
+        cfg.every = options["every"].as<uint32_t>();
+        cfg.mode = options["mode"].as<std::string>();
+        if (cfg.commands < 1 || cfg.keys < 1 || cfg.rounds < 1 || cfg.every < 1) {
+            throw std::runtime_error("Commands, keys, rounds and sampling must be positive");
+        }
+    } catch (std::exception &ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
+    }
+
+    try {
+        std::vector<std::string> modes = {cfg.mode};
+        if (cfg.mode == "all") {
+            modes = {"stdout", "off", "sampled"};
+        }
+
+        // Traced lines go to stdout, results to stderr, so that the former could be redirected
+        auto logger = std::make_shared<spdlog::logger>("trace", spdlog::sinks::stdout_sink_mt::instance());
+        logger->set_level(spdlog::level::debug);
+
+        std::vector<Operation> ops = Generate(cfg);
+        for (auto &mode : modes) {
+            if (mode != "stdout" && mode != "off" && mode != "sampled") {
+                throw std::runtime_error("Unknown mode: " + mode);
+            }
+            cfg.mode = mode;
+            Logging::Trace::Install(mode == "sampled" ? logger : nullptr, cfg.every);
+
+            std::chrono::nanoseconds best = std::chrono::nanoseconds::max();
+            for (std::size_t i = 0; i <= cfg.rounds; i++) {
+                Backend::ThreadSafeSimplLRU storage(64 * 1024 * 1024);
+                auto elapsed = Run(cfg, ops, storage);
+                // The first one warms up
+                if (i > 0) {
+                    best = std::min(best, elapsed);
+                }
+            }
+            Logging::Trace::Install(nullptr);
+
+            std::cerr << std::left << std::setw(8) << mode << std::fixed << std::setprecision(0)
+                      << ops.size() * 1e9 / best.count() << " ops/s, " << std::setprecision(1)
+                      << double(best.count()) / ops.size() << " ns/op" << std::endl;
+        }
+    } catch (std::exception &ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <cxxopts.hpp>
+
+#include <afina/execute/Command.h>
+
+#include "protocol/Parser.h"
+#include "protocol/Scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define AFINA_BENCH_TSC 1
+#endif
+
+using namespace Afina;
+
+namespace {
+
+struct Config {
+    std::size_t commands;
+    double read_ratio;
+    double multiget_ratio;
+    std::size_t multiget_keys;
+    std::size_t key_size;
+    std::size_t value_size;
+    std::size_t read_size;
+    std::size_t rounds;
+    bool build;
+    bool sweep;
+    std::string scan;
+};
+
+/**
+ * Command stream as it comes from the network, along with the body size of each command so that bodies
+ * could be skipped without building commands
+ */
+struct Workload {
+    std::string stream;
+    std::vector<std::size_t> bodies;
+};
+
+// Key of the given size, starts with the index so that keys differ early as real ones usually do
+std::string MakeKey(const Config &cfg, uint64_t index) {
+    std::string key = "key:" + std::to_string(index) + ":";
+    key.resize(std::max(key.size(), cfg.key_size), 'k');
+    return key;
+}
+
+/**
+ * Mix of single key gets, multi key gets and sets with values of random size up to value_size
+ */
+Workload Generate(const Config &cfg) {
+    std::mt19937_64 rnd(42);
+    std::uniform_real_distribution<double> coin(0, 1);
+    Workload w;
+    for (std::size_t i = 0; i < cfg.commands; i++) {
+        if (coin(rnd) < cfg.read_ratio) {
+            std::size_t keys = coin(rnd) < cfg.multiget_ratio ? cfg.multiget_keys : 1;
+            w.stream += "get";
+            for (std::size_t k = 0; k < keys; k++) {
+                w.stream += " " + MakeKey(cfg, rnd() % 100000);
+            }
+            w.stream += "\r\n";
+            w.bodies.push_back(0);
+        } else {
+            std::size_t size = 1 + rnd() % cfg.value_size;
+            w.stream += "set " + MakeKey(cfg, rnd() % 100000) + " " + std::to_string(rnd() % 65536) + " 0 " +
+                        std::to_string(size) + "\r\n";
+            w.stream.append(size, 'v');
+            w.stream += "\r\n";
+            w.bodies.push_back(size);
+        }
+    }
+    return w;
+}
+
+// Time stamp in CPU cycles where available, nanoseconds otherwise
+inline uint64_t Now() {
+#ifdef AFINA_BENCH_TSC
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+/**
+ * Parses the whole stream fed in pieces of read_size bytes, the way server reads it from the socket.
+ * Returns number of cycles taken
+ */
+uint64_t Run(const Config &cfg, const Workload &w) {
+    Protocol::Parser parser;
+    const char *data = w.stream.data();
+    std::size_t size = w.stream.size();
+    std::size_t pos = 0, command = 0;
+
+    uint64_t start = Now();
+    while (pos < size) {
+        std::size_t end = std::min(size, (pos / cfg.read_size + 1) * cfg.read_size);
+        std::size_t parsed = 0;
+        bool complete = parser.Parse(data + pos, end - pos, parsed);
+        pos += parsed;
+        if (!complete) {
+            continue;
+        }
+
+        std::size_t body = w.bodies[command++];
+        if (cfg.build) {
+            // Commands go back to the parser once done, the way network layer does it
+            parser.Recycle(parser.Build(body));
+        }
+        if (body > 0) {
+            pos += body + 2;
+        }
+        parser.Reset();
+    }
+    uint64_t cycles = Now() - start;
+
+    if (command != w.bodies.size()) {
+        throw std::runtime_error("Parsed " + std::to_string(command) + " commands out of " +
+                                 std::to_string(w.bodies.size()));
+    }
+    return cycles;
+}
+
+// Best of the configured number of runs, after a warm up one
+uint64_t Measure(const Config &cfg, const Workload &w) {
+    Run(cfg, w);
+    uint64_t best = UINT64_MAX;
+    for (std::size_t i = 0; i < cfg.rounds; i++) {
+        best = std::min(best, Run(cfg, w));
+    }
+    return best;
+}
+
+#ifdef AFINA_BENCH_TSC
+const char *Unit = "cycle";
+#else
+const char *Unit = "ns";
+#endif
+
+/**
+ * Throughput over the matrix of command mixes and keys per get, with scanning in use. Every get of the mix is
+ * a multi-get of the given number of keys
+ */
+void Sweep(Config cfg) {
+    static const std::pair<const char *, double> mixes[] = {{"get", 1.0}, {"90/10", 0.9}, {"50/50", 0.5}};
+    static const std::size_t keys[] = {1, 4, 16, 64};
+
+    std::cout << std::left << std::setw(8) << "mix" << std::setw(6) << "keys" << std::setw(16)
+              << (std::string("bytes/") + Unit) << Unit << "s/command" << std::endl;
+    auto row = [&cfg](const char *mix, const std::string &keys) {
+        Workload w = Generate(cfg);
+        uint64_t best = Measure(cfg, w);
+        std::cout << std::left << std::setw(8) << mix << std::setw(6) << keys << std::fixed << std::setw(16)
+                  << std::setprecision(3) << double(w.stream.size()) / best << std::setprecision(1)
+                  << double(best) / w.bodies.size() << std::endl;
+    };
+
+    cfg.multiget_ratio = 1.0;
+    for (auto &mix : mixes) {
+        cfg.read_ratio = mix.second;
+        for (std::size_t k : keys) {
+            cfg.multiget_keys = k;
+            row(mix.first, std::to_string(k));
+        }
+    }
+    cfg.read_ratio = 0;
+    row("set", "-");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    cxxopts::Options options("runParserBench", "Afina memcached parser benchmark");
+    Config cfg;
+    try {
+        // clang-format off
+        options.add_options()
+            ("n,commands", "Number of commands in the stream", cxxopts::value<std::size_t>()->default_value("200000"))
+            ("r,read-ratio", "Share of get commands", cxxopts::value<double>()->default_value("0.9"))
+            ("multiget-ratio", "Share of multi key gets among gets", cxxopts::value<double>()->default_value("0.1"))
+            ("multiget-keys", "Number of keys in multi key get", cxxopts::value<std::size_t>()->default_value("20"))
+            ("key-size", "Key size in bytes", cxxopts::value<std::size_t>()->default_value("32"))
+            ("value-size", "Maximum value size in bytes", cxxopts::value<std::size_t>()->default_value("200"))
+            ("read-size", "Bytes fed to the parser at once, as read from socket", cxxopts::value<std::size_t>()->default_value("4096"))
+            ("rounds", "Number of runs, the best one is reported", cxxopts::value<std::size_t>()->default_value("5"))
+            ("build", "Build commands, not only parse them")
+            ("sweep", "Measure all command mixes and key counts, rather than the given ones")
+            ("scan", "Delimiter scanning: scalar, sse2, avx2 or all supported", cxxopts::value<std::string>()->default_value("all"))
+            ("h,help", "Print usage info");
+        // clang-format on
+        options.parse(argc, argv);
+
+        if (options.count("help") > 0) {
+            std::cerr << options.help() << std::endl;
+            return 0;
+        }
+
+        cfg.commands = options["commands"].as<std::size_t>();
+        cfg.read_ratio = options["read-ratio"].as<double>();
+        cfg.multiget_ratio = options["multiget-ratio"].as<double>();
+        cfg.multiget_keys = options["multiget-keys"].as<std::size_t>();
+        cfg.key_size = options["key-size"].as<std::size_t>();
+        cfg.value_size = options["value-size"].as<std::size_t>();
+        cfg.read_size = options["read-size"].as<std::size_t>();
+        cfg.rounds = options["rounds"].as<std::size_t>();
+        cfg.build = options.count("build") > 0;
+        cfg.sweep = options.count("sweep") > 0;
+        cfg.scan = options["scan"].as<std::string>();
+        if (cfg.commands < 1 || cfg.read_size < 1 || cfg.rounds < 1 || cfg.value_size < 1) {
+            throw std::runtime_error("Commands, read size, rounds and value size must be positive");
+        }
+    } catch (std::exception &ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
+    }
+
+    try {
+        std::vector<Protocol::ScanLevel> levels;
+        for (auto level : {Protocol::ScanLevel::Scalar, Protocol::ScanLevel::Sse2, Protocol::ScanLevel::Avx2}) {
+            if (cfg.scan == Protocol::ScanName(level) || (cfg.scan == "all" && level <= Protocol::ScanSupported())) {
+                levels.push_back(level);
+            }
+        }
+        if (levels.empty()) {
+            throw std::runtime_error("Unknown scanning: " + cfg.scan);
+        }
+
+        if (cfg.sweep) {
+            // The best of the requested implementations
+            Protocol::ScanForce(levels.back());
+            std::cout << "Scanning: " << Protocol::ScanName(levels.back()) << std::endl;
+            Sweep(cfg);
+            return 0;
+        }
+
+        Workload w = Generate(cfg);
+        std::cout << "Stream: " << w.bodies.size() << " commands, " << w.stream.size() << " bytes" << std::endl;
+        for (auto level : levels) {
+            Protocol::ScanForce(level);
+            uint64_t best = Measure(cfg, w);
+            std::cout << std::left << std::setw(8) << Protocol::ScanName(level) << std::fixed << std::setprecision(3)
+                      << double(w.stream.size()) / best << " bytes/" << Unit << ", " << std::setprecision(1)
+                      << double(best) / w.bodies.size() << " " << Unit << "s/command" << std::endl;
+        }
+    } catch (std::exception &ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,447 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cxxopts.hpp>
+
+#include <afina/Hash.h>
+#include <afina/Storage.h>
+
+#include "Histogram.h"
+#include "storage/RssMonitor.h"
+#include "storage/SimpleLRU.h"
+#include "storage/SizeClassLRU.h"
+#include "storage/StripedLRU.h"
+#include "storage/ThreadSafeSimpleLRU.h"
+
+using namespace Afina;
+using namespace Afina::Bench;
+
+namespace {
+
+/**
+ * Size distribution given on the command line, either fixed "N" or uniform "MIN-MAX"
+ */
+struct SizeDistribution {
+    explicit SizeDistribution(const std::string &spec) {
+        auto dash = spec.find('-');
+        if (dash == std::string::npos) {
+            min = max = std::stoul(spec);
+        } else {
+            min = std::stoul(spec.substr(0, dash));
+            max = std::stoul(spec.substr(dash + 1));
+        }
+        if (min > max) {
+            throw std::runtime_error("Invalid size distribution: " + spec);
+        }
+    }
+
+    // Size picked by the given random number, so that same number always gives the same size
+    std::size_t pick(uint64_t random) const { return min + random % (max - min + 1); }
+
+    std::size_t min;
+    std::size_t max;
+};
+
+/**
+ * Zipfian distribution over [0, n) as in "Quickly generating billion-record synthetic databases",
+ * Gray et al, SIGMOD 1994 (same one YCSB uses). Requires theta in [0, 1), 0 gives uniform distribution
+ */
+class Zipf {
+public:
+    Zipf(uint64_t n, double theta) : _n(n), _theta(theta) {
+        if (theta < 0 || theta >= 1) {
+            throw std::runtime_error("Zipf skew must be in [0, 1)");
+        }
+
+        double zeta2 = 1 + std::pow(0.5, theta);
+        _zetan = 0;
+        for (uint64_t i = 1; i <= n; i++) {
+            _zetan += 1 / std::pow(double(i), theta);
+        }
+        _alpha = 1 / (1 - theta);
+        _eta = (1 - std::pow(2.0 / n, 1 - theta)) / (1 - zeta2 / _zetan);
+        _half_pow_theta = 1 + std::pow(0.5, theta);
+    }
+
+    template <typename Rng> uint64_t operator()(Rng &rng) const {
+        if (_theta == 0) {
+            return std::uniform_int_distribution<uint64_t>(0, _n - 1)(rng);
+        }
+
+        double u = std::uniform_real_distribution<double>(0, 1)(rng);
+        double uz = u * _zetan;
+        if (uz < 1) {
+            return 0;
+        }
+        if (uz < _half_pow_theta) {
+            return 1;
+        }
+        uint64_t result = uint64_t(_n * std::pow(_eta * u - _eta + 1, _alpha));
+        return result < _n ? result : _n - 1;
+    }
+
+private:
+    uint64_t _n;
+    double _theta;
+    double _zetan;
+    double _alpha;
+    double _eta;
+    double _half_pow_theta;
+};
+
+// Single operation from the recorded trace
+struct TraceOp {
+    enum Type { GET, SET, DELETE };
+
+    Type type;
+    std::string key;
+    std::size_t size;
+};
+
+/**
+ * Reads trace file, each line is one of:
+ * - get <key>
+ * - set <key> <bytes>
+ * - delete <key>
+ * - <key>: lookup of the key, on miss the key is set (cache-aside client)
+ */
+std::vector<TraceOp> ReadTrace(const std::string &path, const SizeDistribution &value_size) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Failed to open trace: " + path);
+    }
+
+    std::vector<TraceOp> result;
+    std::string line;
+    uint64_t line_no = 0;
+    while (std::getline(in, line)) {
+        line_no++;
+        std::istringstream tokens(line);
+        std::string first, second;
+        std::size_t size = 0;
+        if (!(tokens >> first)) {
+            continue;
+        }
+
+        TraceOp op;
+        if (first == "get" && (tokens >> second)) {
+            op.type = TraceOp::GET;
+            op.key = second;
+            op.size = value_size.pick(KeyHash(second));
+        } else if (first == "set" && (tokens >> second >> size)) {
+            op.type = TraceOp::SET;
+            op.key = second;
+            op.size = size;
+        } else if (first == "delete" && (tokens >> second)) {
+            op.type = TraceOp::DELETE;
+            op.key = second;
+        } else if (!(tokens >> second)) {
+            op.type = TraceOp::GET;
+            op.key = first;
+            op.size = value_size.pick(KeyHash(first));
+        } else {
+            throw std::runtime_error("Invalid trace record at line " + std::to_string(line_no));
+        }
+        result.push_back(std::move(op));
+    }
+    return result;
+}
+
+// Results of a single benchmark thread
+struct ThreadResult {
+    ThreadResult() : ops(0), gets(0), hits(0) {}
+
+    Histogram latency;
+    uint64_t ops;
+    uint64_t gets;
+    uint64_t hits;
+};
+
+/**
+ * Benchmark configuration
+ */
+struct Config {
+    Config() : key_size("16"), value_size("100") {}
+
+    std::string storage_type;
+    std::size_t memory;
+    std::string accounting;
+    std::string eviction;
+    std::size_t stripes;
+
+    int threads;
+    uint64_t ops;
+    uint64_t keys;
+    SizeDistribution key_size;
+    SizeDistribution value_size;
+    double read_ratio;
+    double zipf;
+    bool prefill;
+    bool miss_set;
+    std::string trace;
+};
+
+std::shared_ptr<Afina::Storage> BuildStorage(const Config &cfg, std::shared_ptr<Backend::RssMonitor> &rss_monitor) {
+    using Afina::Backend::SimpleLRU;
+    auto accounting = SimpleLRU::Accounting::Payload;
+    if (cfg.accounting == "footprint") {
+        accounting = SimpleLRU::Accounting::Footprint;
+    } else if (cfg.accounting == "rss") {
+        accounting = SimpleLRU::Accounting::Rss;
+        rss_monitor = std::make_shared<Backend::RssMonitor>(cfg.memory);
+    } else if (cfg.accounting != "payload") {
+        throw std::runtime_error("Unknown accounting type: " + cfg.accounting);
+    }
+
+    auto policy = SimpleLRU::Policy::Lru;
+    if (cfg.eviction == "gdsf") {
+        policy = SimpleLRU::Policy::Gdsf;
+    } else if (cfg.eviction != "lru") {
+        throw std::runtime_error("Unknown eviction policy: " + cfg.eviction);
+    }
+
+    if (cfg.storage_type == "st_lru") {
+        if (cfg.threads > 1) {
+            throw std::runtime_error("st_lru is not thread safe, use single thread");
+        }
+        return std::make_shared<SimpleLRU>(cfg.memory, accounting, rss_monitor, policy);
+    } else if (cfg.storage_type == "mt_lru") {
+        return std::make_shared<Afina::Backend::ThreadSafeSimplLRU>(cfg.memory, accounting, rss_monitor, policy);
+    } else if (cfg.storage_type == "mt_slru") {
+        return std::shared_ptr<Afina::Storage>(
+            Afina::Backend::buildStripeStorage(cfg.stripes, cfg.memory, accounting, rss_monitor, policy));
+    } else if (cfg.storage_type == "mt_sclru") {
+        return std::make_shared<Afina::Backend::SizeClassLRU>(cfg.memory, accounting, rss_monitor);
+    }
+    throw std::runtime_error("Unknown storage type: " + cfg.storage_type);
+}
+
+// Key number i, padded up to the size picked by key size distribution
+std::string MakeKey(const Config &cfg, uint64_t i) {
+    std::string key = "key:" + std::to_string(i);
+    std::size_t size = cfg.key_size.pick(i * 0x9E3779B97F4A7C15ull >> 7);
+    if (key.size() < size) {
+        key.resize(size, '.');
+    }
+    return key;
+}
+
+using Clock = std::chrono::steady_clock;
+
+inline uint64_t ElapsedNs(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+// Synthetic workload: keys are picked by zipf distribution, operation by read ratio
+void RunSynthetic(const Config &cfg, Afina::Storage &storage, const Zipf &zipf, int thread_id, ThreadResult &result) {
+    std::mt19937_64 rng(thread_id * 7919 + 1);
+    std::uniform_real_distribution<double> coin(0, 1);
+
+    std::string value, out;
+    for (uint64_t i = 0; i < cfg.ops; i++) {
+        std::string key = MakeKey(cfg, zipf(rng));
+        bool is_read = coin(rng) < cfg.read_ratio;
+        if (!is_read) {
+            value.assign(cfg.value_size.pick(rng()), 'v');
+        }
+
+        auto start = Clock::now();
+        uint64_t hash = KeyHash(key);
+        if (is_read) {
+            bool hit = storage.Get(key, hash, out);
+            if (!hit && cfg.miss_set) {
+                value.assign(cfg.value_size.pick(hash), 'v');
+                storage.Put(key, hash, value);
+            }
+            result.gets++;
+            result.hits += hit;
+        } else {
+            storage.Put(key, hash, value);
+        }
+        result.latency.Record(ElapsedNs(start));
+        result.ops++;
+    }
+}
+
+// Trace replay: each thread takes every n-th record of the trace
+void RunTrace(const Config &cfg, Afina::Storage &storage, const std::vector<TraceOp> &trace, int thread_id,
+              ThreadResult &result) {
+    std::string value, out;
+    for (std::size_t i = thread_id; i < trace.size(); i += cfg.threads) {
+        const TraceOp &op = trace[i];
+        if (op.type != TraceOp::DELETE) {
+            value.assign(op.size, 'v');
+        }
+
+        auto start = Clock::now();
+        uint64_t hash = KeyHash(op.key);
+        switch (op.type) {
+        case TraceOp::GET: {
+            bool hit = storage.Get(op.key, hash, out);
+            if (!hit && cfg.miss_set) {
+                storage.Put(op.key, hash, value);
+            }
+            result.gets++;
+            result.hits += hit;
+            break;
+        }
+        case TraceOp::SET:
+            storage.Put(op.key, hash, value);
+            break;
+        case TraceOp::DELETE:
+            storage.Delete(op.key, hash);
+            break;
+        }
+        result.latency.Record(ElapsedNs(start));
+        result.ops++;
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    cxxopts::Options options("runStorageBench", "Afina storage benchmark");
+    Config cfg;
+    try {
+        // clang-format off
+        options.add_options()
+            ("s,storage", "Storage to benchmark: st_lru, mt_lru, mt_slru, mt_sclru", cxxopts::value<std::string>()->default_value("mt_slru"))
+            ("m,memory", "Storage size limit in bytes", cxxopts::value<std::size_t>()->default_value("67108864"))
+            ("accounting", "Memory accounting: payload, footprint, rss", cxxopts::value<std::string>()->default_value("payload"))
+            ("eviction", "Eviction policy: lru, gdsf", cxxopts::value<std::string>()->default_value("lru"))
+            ("stripes", "Number of stripes for mt_slru", cxxopts::value<std::size_t>()->default_value("4"))
+            ("t,threads", "Number of threads", cxxopts::value<int>()->default_value("1"))
+            ("o,ops", "Number of operations per thread", cxxopts::value<uint64_t>()->default_value("1000000"))
+            ("k,keys", "Number of distinct keys", cxxopts::value<uint64_t>()->default_value("100000"))
+            ("key-size", "Key size in bytes: N or MIN-MAX", cxxopts::value<std::string>()->default_value("16"))
+            ("value-size", "Value size in bytes: N or MIN-MAX", cxxopts::value<std::string>()->default_value("100"))
+            ("r,read-ratio", "Share of get operations", cxxopts::value<double>()->default_value("0.9"))
+            ("z,zipf", "Zipfian skew of key popularity in [0, 1), 0 is uniform", cxxopts::value<double>()->default_value("0.99"))
+            ("no-prefill", "Do not load all keys before measurement")
+            ("miss-set", "Set key after get miss, as cache-aside client does")
+            ("trace", "Replay keys from the trace file instead of synthetic workload", cxxopts::value<std::string>())
+            ("h,help", "Print usage info");
+        // clang-format on
+        options.parse(argc, argv);
+
+        if (options.count("help") > 0) {
+            std::cerr << options.help() << std::endl;
+            return 0;
+        }
+
+        cfg.storage_type = options["storage"].as<std::string>();
+        cfg.memory = options["memory"].as<std::size_t>();
+        cfg.accounting = options["accounting"].as<std::string>();
+        cfg.eviction = options["eviction"].as<std::string>();
+        cfg.stripes = options["stripes"].as<std::size_t>();
+        cfg.threads = options["threads"].as<int>();
+        cfg.ops = options["ops"].as<uint64_t>();
+        cfg.keys = options["keys"].as<uint64_t>();
+        cfg.key_size = SizeDistribution(options["key-size"].as<std::string>());
+        cfg.value_size = SizeDistribution(options["value-size"].as<std::string>());
+        cfg.read_ratio = options["read-ratio"].as<double>();
+        cfg.zipf = options["zipf"].as<double>();
+        cfg.prefill = options.count("no-prefill") == 0;
+        cfg.miss_set = options.count("miss-set") > 0;
+        if (options.count("trace") > 0) {
+            cfg.trace = options["trace"].as<std::string>();
+        }
+        if (cfg.threads < 1 || cfg.keys < 1) {
+            throw std::runtime_error("Threads and keys must be positive");
+        }
+    } catch (std::exception &ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
+    }
+
+    try {
+        std::shared_ptr<Backend::RssMonitor> rss_monitor;
+        std::shared_ptr<Afina::Storage> storage = BuildStorage(cfg, rss_monitor);
+        if (rss_monitor) {
+            rss_monitor->Start();
+        }
+        storage->Start();
+
+        std::vector<TraceOp> trace;
+        std::unique_ptr<Zipf> zipf;
+        if (!cfg.trace.empty()) {
+            trace = ReadTrace(cfg.trace, cfg.value_size);
+            std::cout << "Trace: " << trace.size() << " records" << std::endl;
+        } else {
+            zipf.reset(new Zipf(cfg.keys, cfg.zipf));
+            if (cfg.prefill) {
+                std::string value;
+                for (uint64_t i = 0; i < cfg.keys; i++) {
+                    std::string key = MakeKey(cfg, i);
+                    uint64_t hash = KeyHash(key);
+                    value.assign(cfg.value_size.pick(hash), 'v');
+                    storage->Put(key, hash, value);
+                }
+            }
+        }
+
+        std::vector<ThreadResult> results(cfg.threads);
+        std::vector<std::thread> threads;
+        auto start = Clock::now();
+        for (int i = 0; i < cfg.threads; i++) {
+            if (trace.empty()) {
+                threads.emplace_back(RunSynthetic, std::cref(cfg), std::ref(*storage), std::cref(*zipf), i,
+                                     std::ref(results[i]));
+            } else {
+                threads.emplace_back(RunTrace, std::cref(cfg), std::ref(*storage), std::cref(trace), i,
+                                     std::ref(results[i]));
+            }
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+        double seconds = ElapsedNs(start) / 1e9;
+
+        ThreadResult total;
+        for (auto &r : results) {
+            total.latency.Merge(r.latency);
+            total.ops += r.ops;
+            total.gets += r.gets;
+            total.hits += r.hits;
+        }
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "storage:   " << cfg.storage_type << std::endl;
+        std::cout << "threads:   " << cfg.threads << std::endl;
+        std::cout << "ops:       " << total.ops << " in " << seconds << " s" << std::endl;
+        std::cout << "ops/s:     " << uint64_t(total.ops / seconds) << std::endl;
+        std::cout << "p50:       " << total.latency.Quantile(0.5) << " ns" << std::endl;
+        std::cout << "p99:       " << total.latency.Quantile(0.99) << " ns" << std::endl;
+        std::cout << "p999:      " << total.latency.Quantile(0.999) << " ns" << std::endl;
+        std::cout << "max:       " << total.latency.Max() << " ns" << std::endl;
+        if (total.gets > 0) {
+            std::cout << "hit ratio: " << double(total.hits) / total.gets << std::endl;
+        }
+
+        std::vector<std::pair<std::string, std::string>> stats;
+        storage->Stats(stats);
+        for (auto &stat : stats) {
+            std::cout << "stat " << stat.first << ": " << stat.second << std::endl;
+        }
+
+        storage->Stop();
+        if (rss_monitor) {
+            rss_monitor->Stop();
+        }
+    } catch (std::exception &ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,144 @@
+#ifndef AFINA_CHANGE_STREAM_H
+#define AFINA_CHANGE_STREAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Afina {
+
+/**
+ * # Stream of storage changes
+ * Storage reports every put, delete and eviction here, so that downstream consumers (secondary indexes,
+ * CDN purgers) could follow the cache instead of polling it.
+ *
+ * Each storage shard gets its own ring buffer of fixed capacity. Ring has exactly one writer at a time,
+ * the shard under its own lock, and any number of readers each with its own cursor. All events of the
+ * same key go into the same ring, so they are read in order they happened. Writers never wait
+ * for readers: once reader falls more than capacity events behind, oldest events are overwritten and
+ * reader gets them reported as dropped. Slots are guarded by sequence numbers (seqlock), so neither
+ * side takes locks.
+ *
+ * Event carries key and value size, but not the value. Keys longer than KeyCapacity are truncated and
+ * flagged so.
+ */
+class ChangeStream {
+public:
+    enum class Type : uint8_t { Put, Delete, Evict };
+
+    /**
+     * Change read out of the stream
+     */
+    struct Event {
+        Type type;
+
+        // Shard that reported the change and position of the event in the shard ring
+        std::size_t shard;
+        uint64_t sequence;
+
+        std::string key;
+        bool truncated;
+
+        // Size of the value stored, zero for Delete
+        std::size_t value_size;
+    };
+
+    /**
+     * Reader with own position in each ring, starts with events published after its creation. Not thread
+     * safe, each consumer should create its own
+     */
+    class Subscriber {
+    public:
+        explicit Subscriber(std::shared_ptr<ChangeStream> stream);
+
+        /**
+         * Reads up to max events published since previous call, shards are visited in turn so that busy one
+         * doesn't starve others
+         *
+         * @param events output parameter to append events to
+         * @param max number of events to read
+         * @return number of events read
+         */
+        std::size_t Poll(std::vector<Event> &events, std::size_t max);
+
+        /**
+         * Number of events overwritten before subscriber has read them, since previous call
+         */
+        uint64_t TakeDropped();
+
+    private:
+        std::shared_ptr<ChangeStream> _stream;
+        std::vector<uint64_t> _cursors;
+        std::size_t _next_shard;
+        uint64_t _dropped;
+    };
+
+    // Longest key reported as is
+    static constexpr std::size_t KeyCapacity = 248;
+
+    /**
+     * @param capacity number of events each shard ring keeps, rounded up to the power of two
+     */
+    explicit ChangeStream(std::size_t capacity = 4096);
+    ~ChangeStream();
+
+    /**
+     * Adds ring for one more storage shard and returns its number. Must be called before stream is used,
+     * while storage gets configured
+     */
+    std::size_t AddShard();
+
+    /**
+     * Publishes event into the ring of the given shard. Only one thread at a time may publish into the same
+     * shard
+     */
+    void Publish(std::size_t shard, Type type, const std::string &key, std::size_t value_size);
+
+    inline std::size_t Shards() const { return _rings.size(); }
+    inline std::size_t Capacity() const { return _capacity; }
+
+    // Events published into all shards so far
+    uint64_t Published() const;
+
+    static const char *TypeName(Type type);
+
+private:
+    ChangeStream(const ChangeStream &) = delete;
+    ChangeStream &operator=(const ChangeStream &) = delete;
+
+    static constexpr std::size_t KeyWords = KeyCapacity / sizeof(uint64_t);
+
+    // Event slot. Fields are atomics so that reader racing with writer sees torn value at worst, and
+    // detects it by the sequence number
+    struct slot {
+        // 2 * (position + 1) once event at position is published, odd while it is being written
+        std::atomic<uint64_t> sequence;
+
+        // Type, key size and value size packed together
+        std::atomic<uint64_t> meta;
+        std::atomic<uint64_t> key[KeyWords];
+    };
+
+    struct ring {
+        explicit ring(std::size_t capacity);
+
+        std::unique_ptr<slot[]> slots;
+
+        // Position of the next event to be published
+        std::atomic<uint64_t> head;
+    };
+
+    // Reads event at position, returns false if it isn't published yet. If event was overwritten, moves
+    // position to the oldest available one and counts skipped events in dropped
+    bool _read(std::size_t shard, uint64_t &position, uint64_t &dropped, Event &event) const;
+
+    const std::size_t _capacity;
+    std::vector<std::unique_ptr<ring>> _rings;
+};
+
+} // namespace Afina
+
+#endif // AFINA_CHANGE_STREAM_H
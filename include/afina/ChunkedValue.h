@@ -0,0 +1,167 @@
+#ifndef AFINA_CHUNKED_VALUE_H
+#define AFINA_CHUNKED_VALUE_H
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <string>
+
+namespace Afina {
+
+/**
+ * # Large value
+ * Value split into a linked chain of fixed-size chunks, only the last chunk could be shorter. Storage keeps
+ * big values this way so that multi-megabyte item never needs one giant contiguous allocation, and could be
+ * streamed out chunk by chunk.
+ *
+ * Value is immutable once built. Storage hands it out by shared pointer, so that reader keeps chunks alive
+ * and could send them after storage lock is released, even if the item gets replaced or evicted meanwhile.
+ */
+class ChunkedValue {
+public:
+    // Size of each chunk
+    static constexpr std::size_t ChunkSize = 64 * 1024;
+
+    /**
+     * Copies given data into chunks
+     */
+    ChunkedValue(const char *data, std::size_t size) : ChunkedValue(size) {
+        while (!Full()) {
+            std::size_t len = Fill(data, size);
+            data += len;
+            size -= len;
+        }
+    }
+
+    /**
+     * Value of the given size which is not filled yet. Data is written in place chunk by chunk (see Room and
+     * Filled), i.e read right from the socket. Chunks are allocated as filling goes, so that announced size
+     * costs nothing until data actually arrives. Value must not be read or handed out until it is Full
+     */
+    explicit ChunkedValue(std::size_t size) : _size(size), _unfilled(size), _filled(0) {}
+
+    explicit ChunkedValue(const std::string &value) : ChunkedValue(value.data(), value.size()) {}
+
+    // Total number of bytes in the value
+    inline std::size_t size() const { return _size; }
+
+    // Number of chunks in the chain
+    inline std::size_t chunks() const { return _chain.count; }
+
+    // All the bytes are written, see ChunkedValue(size)
+    inline bool Full() const { return _unfilled == 0; }
+
+    // Unfilled part of the current chunk, empty once value is Full. Room allocates the next chunk if the
+    // current one is full, RoomSize doesn't
+    inline char *Room() {
+        if (_unfilled == 0) {
+            return nullptr;
+        }
+        if (_chain.tail == nullptr || _filled == _chain.tail->size) {
+            _chain.append(_unfilled < ChunkSize ? _unfilled : ChunkSize);
+            _filled = 0;
+        }
+        return _chain.tail->data + _filled;
+    }
+    inline std::size_t RoomSize() const {
+        if (_chain.tail == nullptr || _filled == _chain.tail->size) {
+            return _unfilled < ChunkSize ? _unfilled : ChunkSize;
+        }
+        return _chain.tail->size - _filled;
+    }
+
+    // Marks the first size bytes of Room as written
+    inline void Filled(std::size_t size) {
+        _filled += size;
+        _unfilled -= size;
+    }
+
+    /**
+     * Copies data into Room
+     *
+     * @return number of bytes taken, less than size if chunk gets full or value is Full already
+     */
+    inline std::size_t Fill(const char *data, std::size_t size) {
+        std::size_t len = RoomSize();
+        if (len > size) {
+            len = size;
+        }
+        if (len > 0) {
+            std::memcpy(Room(), data, len);
+            Filled(len);
+        }
+        return len;
+    }
+
+    /**
+     * Calls f(const char *data, std::size_t size) for each chunk, in order
+     */
+    template <typename F> void ForEachChunk(F &&f) const {
+        for (const chunk *c = _chain.head; c != nullptr; c = c->next) {
+            f(static_cast<const char *>(c->data), c->size);
+        }
+    }
+
+    /**
+     * Makes contiguous copy of the value
+     */
+    void CopyTo(std::string &out) const {
+        out.clear();
+        out.reserve(_size);
+        ForEachChunk([&out](const char *data, std::size_t size) { out.append(data, size); });
+    }
+
+    /**
+     * Bytes requested from the allocator for a chunk holding len bytes of the value
+     */
+    static std::size_t ChunkAllocSize(std::size_t len) { return offsetof(chunk, data) + len; }
+
+private:
+    ChunkedValue(const ChunkedValue &) = delete;
+    ChunkedValue &operator=(const ChunkedValue &) = delete;
+
+    struct chunk {
+        chunk *next;
+        std::size_t size;
+        char data[1];
+    };
+
+    // Owns the chunks allocated so far, so that they are freed however construction or filling ends
+    struct chain {
+        chain() : head(nullptr), tail(nullptr), count(0) {}
+        ~chain() {
+            while (head != nullptr) {
+                chunk *next = head->next;
+                ::operator delete(head);
+                head = next;
+            }
+        }
+
+        // Adds chunk of len bytes at the end
+        void append(std::size_t len) {
+            chunk *c = static_cast<chunk *>(::operator new(ChunkAllocSize(len)));
+            c->next = nullptr;
+            c->size = len;
+            (tail == nullptr ? head : tail->next) = c;
+            tail = c;
+            count++;
+        }
+
+        chunk *head;
+        chunk *tail;
+        std::size_t count;
+    };
+
+    chain _chain;
+
+    // Total value size
+    std::size_t _size;
+
+    // Bytes not written yet and bytes written into the last chunk, see ChunkedValue(size)
+    std::size_t _unfilled;
+    std::size_t _filled;
+};
+
+} // namespace Afina
+
+#endif // AFINA_CHUNKED_VALUE_H
@@ -0,0 +1,128 @@
+#ifndef AFINA_HASH_H
+#define AFINA_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+
+namespace Afina {
+
+namespace detail {
+
+// wyhash (https://github.com/wangyi-fudan/wyhash, public domain) building blocks
+inline void wymum(uint64_t *a, uint64_t *b) {
+    __uint128_t r = *a;
+    r *= *b;
+    *a = uint64_t(r);
+    *b = uint64_t(r >> 64);
+}
+
+inline uint64_t wymix(uint64_t a, uint64_t b) {
+    wymum(&a, &b);
+    return a ^ b;
+}
+
+inline uint64_t wyr8(const uint8_t *p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+}
+
+inline uint64_t wyr4(const uint8_t *p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+inline uint64_t wyr3(const uint8_t *p, std::size_t k) {
+    return (uint64_t(p[0]) << 16) | (uint64_t(p[k >> 1]) << 8) | p[k - 1];
+}
+
+constexpr uint64_t wyp0 = 0xa0761d6478bd642full;
+constexpr uint64_t wyp1 = 0xe7037ed1a0b428dbull;
+constexpr uint64_t wyp2 = 0x8ebc6af09c88c6e3ull;
+constexpr uint64_t wyp3 = 0x589965cc75374cc3ull;
+
+/**
+ * Process wide random seed, makes hash values unpredictable for clients so that nobody could
+ * craft set of keys which all fall into the same shard or index bucket
+ */
+inline uint64_t KeyHashSeed() {
+    static const uint64_t seed = []() {
+        std::random_device rd;
+        return (uint64_t(rd()) << 32) ^ uint64_t(rd());
+    }();
+    return seed;
+}
+
+} // namespace detail
+
+/**
+ * # Key hash
+ * Fast non-cryptographic hash of the key (wyhash), randomized by the process wide seed.
+ *
+ * Hash gets computed once per request, while key is parsed out of the network stream, and then
+ * passed along with the key through Execute down to the Storage, so that all layers which need key
+ * hash (shard selection, index buckets) share the same value.
+ *
+ * Different parts of the hash are expected to be used by different layers: high 32 bits select
+ * storage shard, low bits are for index buckets.
+ */
+inline uint64_t KeyHash(const char *data, std::size_t len) {
+    using namespace detail;
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(data);
+    uint64_t seed = KeyHashSeed();
+    seed ^= wymix(seed ^ wyp0, wyp1);
+
+    uint64_t a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+            b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = wyr3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        std::size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wymix(wyr8(p) ^ wyp1, wyr8(p + 8) ^ seed);
+                see1 = wymix(wyr8(p + 16) ^ wyp2, wyr8(p + 24) ^ see1);
+                see2 = wymix(wyr8(p + 32) ^ wyp3, wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wymix(wyr8(p) ^ wyp1, wyr8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = wyr8(p + i - 16);
+        b = wyr8(p + i - 8);
+    }
+
+    a ^= wyp1;
+    b ^= seed;
+    wymum(&a, &b);
+    return wymix(a ^ wyp0 ^ len, b ^ wyp1);
+}
+
+inline uint64_t KeyHash(const std::string &key) { return KeyHash(key.data(), key.size()); }
+
+/**
+ * Maps hash onto range [0, n) using multiply-shift over the high 32 bits of the hash, which
+ * is much cheaper than % and doesn't require n to be a power of two
+ */
+inline std::size_t HashRange(uint64_t hash, std::size_t n) { return std::size_t(((hash >> 32) * uint64_t(n)) >> 32); }
+
+} // namespace Afina
+
+#endif // AFINA_HASH_H
@@ -1,10 +1,20 @@
 #ifndef AFINA_STORAGE_H
 #define AFINA_STORAGE_H
 
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include <afina/ChunkedValue.h>
 
 namespace Afina {
 
+class ChangeStream;
+
 /**
  *
  */
@@ -84,6 +94,306 @@ public:
      * @param value output parameter to copy value to
      */
     virtual bool Get(const std::string &key, std::string &value) = 0;
+
+    /**
+     * What is kept along with the value of the item besides its key
+     */
+    struct Attributes {
+        Attributes(uint32_t flags = 0, uint64_t deadline = 0) : flags(flags), deadline(deadline) {}
+
+        // Opaque to the server, clients keep serialization format or compression of the value there
+        // (memcached "flags")
+        uint32_t flags;
+
+        // Time item expires at, in milliseconds since the unix epoch (see Now), 0 if it never does. Expired item
+        // is never returned, storage drops it once it comes across it. Writes given KeepDeadline leave the
+        // deadline item already has
+        uint64_t deadline;
+        static constexpr uint64_t KeepDeadline = std::numeric_limits<uint64_t>::max();
+    };
+
+    /**
+     * Current time deadlines are compared against
+     */
+    static uint64_t Now() {
+        auto since_epoch = std::chrono::system_clock::now().time_since_epoch();
+        return uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(since_epoch).count());
+    }
+
+    /**
+     * Same methods as above, but take hash of the key which has been already computed by caller with
+     * Afina::KeyHash (see afina/Hash.h). Implementations that need the key hash, to select shard or index
+     * bucket, must override them and use given hash instead of computing it once again.
+     *
+     * Writes also take attributes of the item, which replace ones item had
+     *
+     * Default implementations just ignore the hash and attributes
+     *
+     * @param key to work with
+     * @param hash of the key, must be equal to Afina::KeyHash(key)
+     * @param attributes to store along with the value
+     */
+    virtual bool Put(const std::string &key, uint64_t hash, const std::string &value,
+                     const Attributes &attributes = Attributes()) {
+        return Put(key, value);
+    }
+    virtual bool PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value,
+                             const Attributes &attributes = Attributes()) {
+        return PutIfAbsent(key, value);
+    }
+    virtual bool Set(const std::string &key, uint64_t hash, const std::string &value,
+                     const Attributes &attributes = Attributes()) {
+        return Set(key, value);
+    }
+    virtual bool Delete(const std::string &key, uint64_t hash) { return Delete(key); }
+    virtual bool Get(const std::string &key, uint64_t hash, std::string &value) { return Get(key, value); }
+
+    /**
+     * Same as Get above, but doesn't copy large values: if storage keeps value as a chain of chunks (see
+     * afina/ChunkedValue.h) then chain is returned in `chunks` and `value` is left untouched. Otherwise value
+     * gets copied into `value` and `chunks` is reset.
+     *
+     * Chain stays valid as long as caller holds it, regardless of what happens with the item, so that it could
+     * be streamed out without any storage lock held.
+     *
+     * Default implementation always copies
+     */
+    virtual bool Get(const std::string &key, uint64_t hash, std::string &value,
+                     std::shared_ptr<const ChunkedValue> &chunks) {
+        chunks.reset();
+        return Get(key, hash, value);
+    }
+
+    /**
+     * Same as Put above, but value comes as a chain of chunks built by caller (i.e large data block read
+     * from the network right into the chain, see Execute::Command::Reserve). Storages which keep large
+     * values as chains adopt it as is, without copying. Item appears at once, when the whole value is there
+     *
+     * Default implementation copies the value and calls Put
+     */
+    virtual bool PutChunked(const std::string &key, uint64_t hash, std::shared_ptr<const ChunkedValue> value,
+                            const Attributes &attributes = Attributes()) {
+        std::string copy;
+        value->CopyTo(copy);
+        return Put(key, hash, copy, attributes);
+    }
+
+    /**
+     * Size of the largest value storage could ever keep, puts of anything bigger are sure to fail. Network
+     * layer skips such data blocks without reading them into memory, see Execute::Command::Oversized
+     *
+     * Default implementation has no limit
+     */
+    virtual std::size_t MaxItemSize() { return std::numeric_limits<std::size_t>::max(); }
+
+    /**
+     * Batched versioned Get for multi key commands and pipelined reads: i-th key goes into values[i],
+     * chunks[i], versions[i] and attributes[i], found[i] tells if it's there. Storages with locks take each of
+     * them once per batch rather than once per key
+     *
+     * Output vectors are reused between batches: found is resized to the number of keys, the rest only grow
+     * (see GrowResults), so that buffers of the values are not freed and allocated again
+     *
+     * Default implementation calls Get for each key
+     */
+    virtual void GetMany(const std::vector<std::string> &keys, const std::vector<uint64_t> &hashes,
+                         std::vector<std::string> &values, std::vector<std::shared_ptr<const ChunkedValue>> &chunks,
+                         std::vector<uint64_t> &versions, std::vector<Attributes> &attributes,
+                         std::vector<bool> &found) {
+        GrowResults(keys.size(), values, chunks, versions, attributes, found);
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            found[i] = Get(keys[i], hashes[i], values[i], chunks[i], versions[i], attributes[i]);
+        }
+    }
+
+    /**
+     * Prepares output vectors of GetMany for count keys
+     */
+    static void GrowResults(std::size_t count, std::vector<std::string> &values,
+                            std::vector<std::shared_ptr<const ChunkedValue>> &chunks, std::vector<uint64_t> &versions,
+                            std::vector<Attributes> &attributes, std::vector<bool> &found) {
+        if (values.size() < count) {
+            values.resize(count);
+            chunks.resize(count);
+            versions.resize(count);
+            attributes.resize(count);
+        }
+        found.assign(count, false);
+    }
+
+    /**
+     * Batched Put, pairs are stored in order, so that the last one wins for duplicate keys. See GetMany
+     *
+     * @return number of pairs stored
+     */
+    virtual std::size_t PutMany(const std::vector<std::string> &keys, const std::vector<uint64_t> &hashes,
+                                const std::vector<std::string> &values) {
+        std::size_t stored = 0;
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            stored += Put(keys[i], hashes[i], values[i]);
+        }
+        return stored;
+    }
+
+    /**
+     * Outcome of the GetLease
+     */
+    enum class Lease {
+        // Value found and copied out
+        Hit,
+
+        // Miss, caller got lease token and is expected to fill the value in with PutLeased
+        Granted,
+
+        // Miss, someone else holds the lease. Value recently deleted from the storage is copied out
+        Stale,
+
+        // Miss, someone else holds the lease and there is no stale value, caller should retry later
+        HotMiss
+    };
+
+    /**
+     * Get that prevents thundering herd on misses (see memcached leases). The first caller that misses the key
+     * gets a lease token, others get either the stale value or HotMiss until the lease holder stores value with
+     * PutLeased or lease expires.
+     *
+     * Default implementation has no lease table: every miss is granted with token 0
+     *
+     * @param key to retrive value for
+     * @param hash of the key
+     * @param value output parameter to copy value to, on Hit and Stale
+     * @param token output parameter, lease token on Granted
+     */
+    virtual Lease GetLease(const std::string &key, uint64_t hash, std::string &value, uint64_t &token) {
+        if (Get(key, hash, value)) {
+            return Lease::Hit;
+        }
+        token = 0;
+        return Lease::Granted;
+    }
+
+    /**
+     * Stores value only if given lease token is still valid, that is it was granted by GetLease for the key,
+     * hasn't expired yet and key wasn't updated or deleted since then. Lease is released either way
+     *
+     * Default implementation accepts any token
+     */
+    virtual bool PutLeased(const std::string &key, uint64_t hash, const std::string &value, uint64_t token,
+                           const Attributes &attributes = Attributes()) {
+        return Put(key, hash, value, attributes);
+    }
+
+    /**
+     * Same as chunked Get above, but also reports version of the item (memcached "cas unique") and its
+     * attributes. Every write of the item gives it a new version, never seen before in the process
+     *
+     * Default implementation doesn't track versions and attributes, reports 0 and defaults
+     *
+     * @param version output parameter, version of the item found
+     * @param attributes output parameter, attributes of the item found
+     */
+    virtual bool Get(const std::string &key, uint64_t hash, std::string &value,
+                     std::shared_ptr<const ChunkedValue> &chunks, uint64_t &version, Attributes &attributes) {
+        version = 0;
+        attributes = Attributes();
+        return Get(key, hash, value, chunks);
+    }
+
+    /**
+     * Outcome of the CompareAndSet
+     */
+    enum class CasResult {
+        // Value replaced
+        Stored,
+
+        // Versions matched, but value couldn't be stored, i.e it is too large
+        NotStored,
+
+        // Item has been modified since version was read
+        Exists,
+
+        // There is no such key
+        NotFound
+    };
+
+    /**
+     * Replaces value of the key only if its version is still the given one, atomically. Read-modify-write
+     * commands (incr, append) use it to retry instead of losing concurrent updates
+     *
+     * Default implementation expects version 0, as reported by default Get above, and is not atomic
+     *
+     * @param version of the item as reported by Get
+     * @param attributes to store along with the value
+     */
+    virtual CasResult CompareAndSet(const std::string &key, uint64_t hash, const std::string &value,
+                                    uint64_t version, const Attributes &attributes = Attributes()) {
+        std::string current;
+        if (!Get(key, hash, current)) {
+            return CasResult::NotFound;
+        }
+        if (version != 0) {
+            return CasResult::Exists;
+        }
+        return Set(key, hash, value, attributes) ? CasResult::Stored : CasResult::NotStored;
+    }
+
+    /**
+     * Sets new deadline of the item, see Attributes::deadline. Neither value nor version of the item change,
+     * but it counts as an access
+     *
+     * Default implementation has no expiration and only checks if the key is there
+     *
+     * @return false if there is no such key
+     */
+    virtual bool Touch(const std::string &key, uint64_t hash, uint64_t deadline) {
+        std::string value;
+        std::shared_ptr<const ChunkedValue> chunks;
+        return Get(key, hash, value, chunks);
+    }
+
+    /**
+     * Removes all items (memcached "flush_all")
+     *
+     * Default implementation can't do it
+     *
+     * @return false if storage doesn't support it
+     */
+    virtual bool Flush() { return false; }
+
+    /**
+     * Storage which works with the given namespace only, see Backend::NamespacedStorage. Network layer
+     * switches connection to it on "namespace <name>" command, so that all keys of the connection go to
+     * that namespace regardless of their prefix
+     *
+     * Default implementation has no namespaces and returns nullptr
+     *
+     * @param name of the namespace
+     */
+    virtual std::shared_ptr<Storage> Namespace(const std::string &name) { return nullptr; }
+
+    /**
+     * Starts reporting puts, deletes and evictions into the given stream (see afina/ChangeStream.h), each
+     * storage shard gets its own ring there. Must be called while storage gets configured, before it is used
+     *
+     * Default implementation doesn't report anything
+     *
+     * @return false if storage can't report changes
+     */
+    virtual bool Publish(std::shared_ptr<ChangeStream> changes) { return false; }
+
+    /**
+     * Stream storage reports changes into, nullptr if it doesn't
+     */
+    virtual std::shared_ptr<ChangeStream> Changes() { return nullptr; }
+
+    /**
+     * Reports implementation specific statistics, such as memory usage or lock contention.
+     * Each record is appended to the given list as name/value pair and gets reported back to
+     * client by "stats" command
+     *
+     * @param stats output parameter to append records to
+     */
+    virtual void Stats(std::vector<std::pair<std::string, std::string>> &stats) {}
 };
 
 } // namespace Afina
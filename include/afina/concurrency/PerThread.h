@@ -0,0 +1,85 @@
+#ifndef AFINA_CONCURRENCY_PER_THREAD_H
+#define AFINA_CONCURRENCY_PER_THREAD_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace Afina {
+namespace Concurrency {
+
+// Size of the cache line on all platforms we care about
+constexpr std::size_t CacheLineSize = 64;
+
+/**
+ * Returns small dense index of the calling thread. First thread that calls method gets 0, second 1
+ * and so on. Index never changes during thread life time
+ */
+inline std::size_t ThisThreadIndex() {
+    static std::atomic<std::size_t> next_index(0);
+    thread_local std::size_t index = next_index.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+/**
+ * # Per thread copies of some value
+ * Holds fixed number of cache line padded slots, each thread works with its own slot so that
+ * hot path updates never bounce cache lines between cores. If there are more threads than slots
+ * then several threads share one slot, so T must tolerate concurrent updates (i.e be made of relaxed atomics).
+ *
+ * Values from all slots could be aggregated on demand using for_each.
+ *
+ * Slots are allocated separately with the cache line alignment, so PerThread itself is not over-aligned and
+ * could be a member of anything created by plain new or std::make_shared, which ignore extended alignment
+ * before C++17
+ */
+template <typename T, std::size_t N = 64> class PerThread {
+public:
+    PerThread() : _slots(nullptr) {
+        void *memory = nullptr;
+        if (posix_memalign(&memory, CacheLineSize, sizeof(slot) * N) != 0) {
+            throw std::bad_alloc();
+        }
+        _slots = static_cast<slot *>(memory);
+        for (std::size_t i = 0; i < N; i++) {
+            new (&_slots[i]) slot();
+        }
+    }
+
+    ~PerThread() {
+        for (std::size_t i = 0; i < N; i++) {
+            _slots[i].~slot();
+        }
+        std::free(_slots);
+    }
+
+    /**
+     * Slot that belongs to the calling thread
+     */
+    inline T &local() { return _slots[ThisThreadIndex() % N].value; }
+
+    /**
+     * Calls given function for each slot
+     */
+    template <typename F> void for_each(F &&func) const {
+        for (std::size_t i = 0; i < N; i++) {
+            func(_slots[i].value);
+        }
+    }
+
+private:
+    PerThread(const PerThread &) = delete;
+    PerThread &operator=(const PerThread &) = delete;
+
+    struct alignas(CacheLineSize) slot {
+        T value;
+    };
+
+    slot *_slots;
+};
+
+} // namespace Concurrency
+} // namespace Afina
+
+#endif // AFINA_CONCURRENCY_PER_THREAD_H
@@ -0,0 +1,55 @@
+#ifndef AFINA_EXECUTE_ARITHMETIC_H
+#define AFINA_EXECUTE_ARITHMETIC_H
+
+#include <cstdint>
+#include <string>
+
+#include "Command.h"
+#include <afina/Hash.h>
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Increment or decrement numeric value
+ * Value must be a decimal representation of 64 bit unsigned integer:
+ *
+ * incr <key> <delta> [noreply]\r\n
+ * decr <key> <delta> [noreply]\r\n
+ *
+ * Increment wraps around on overflow, decrement stops at 0. Concurrent updates of the same key are never
+ * lost, see Command::Update
+ *
+ * Command must write result to the output, which could be:
+ * - new value of the item
+ * - "NOT_FOUND" to indicate that the item with this key was not found
+ * - "CLIENT_ERROR ..." if value is not a number
+ */
+class Arithmetic : public Command {
+public:
+    enum class Operation { Incr, Decr };
+
+    Arithmetic(Operation operation, const std::string &key, uint64_t delta)
+        : Arithmetic(operation, key, KeyHash(key), delta) {}
+    Arithmetic(Operation operation, const std::string &key, uint64_t hash, uint64_t delta)
+        : _operation(operation), _key(key), _hash(hash), _delta(delta) {}
+    ~Arithmetic() {}
+
+    inline Operation operation() const { return _operation; }
+    inline const std::string &key() const { return _key; }
+    inline uint64_t delta() const { return _delta; }
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+private:
+    const Operation _operation;
+    const std::string _key;
+    // Hash of the key, see afina/Hash.h
+    const uint64_t _hash;
+    const uint64_t _delta;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_ARITHMETIC_H
@@ -0,0 +1,45 @@
+#ifndef AFINA_EXECUTE_CAS_H
+#define AFINA_EXECUTE_CAS_H
+
+#include <cstdint>
+#include <string>
+
+#include "InsertCommand.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Check and set
+ * Store the data, but only if nobody has written the item since the client has read it:
+ *
+ * cas <key> <flags> <exptime> <bytes> <cas unique> [noreply]\r\n
+ *
+ * where <cas unique> is the version returned by "gets", see Storage::CompareAndSet
+ *
+ * Command must write result to the output, which could be:
+ * - "STORED", to indicate success.
+ * - "EXISTS" to indicate that the item has been modified since it was fetched
+ * - "NOT_FOUND" to indicate that the item does not exist or has been deleted
+ * - "NOT_STORED" if value doesn't fit into the storage
+ */
+class Cas : public InsertCommand {
+public:
+    Cas(const std::string &key, uint32_t flags, int32_t expire, uint64_t version)
+        : Cas(key, flags, expire, KeyHash(key), version) {}
+    Cas(const std::string &key, uint32_t flags, int32_t expire, uint64_t hash, uint64_t version)
+        : InsertCommand(key, flags, expire, hash), _version(version) {}
+    ~Cas() {}
+
+    inline uint64_t version() const { return _version; }
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+private:
+    const uint64_t _version;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_CAS_H
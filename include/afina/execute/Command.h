@@ -1,12 +1,18 @@
 #ifndef AFINA_EXECUTE_COMMAND_H
 #define AFINA_EXECUTE_COMMAND_H
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 
-namespace Afina {
+#include <afina/Storage.h>
 
-class Storage;
+#include "Response.h"
 
+namespace Afina {
 namespace Execute {
 
 /**
@@ -15,10 +21,123 @@ namespace Execute {
  */
 class Command {
 public:
-    Command() {}
+    Command() : _noreply(false), _oversized(false) {}
     virtual ~Command() {}
 
     virtual void Execute(Storage &storage, const std::string &args, std::string &out) = 0;
+
+    /**
+     * Same as above, but response is built in place of the network layer, see Response. Commands on the hot
+     * path override it to format headers right there and to reference values instead of copying them, i.e
+     * Get. Long running commands flush the response as they go, see Subscribe.
+     *
+     * Default implementation collects whole response in a string and appends it
+     */
+    virtual void Execute(Storage &storage, const std::string &args, Response &out) {
+        std::string response;
+        Execute(storage, args, response);
+        out.Append(response);
+    }
+
+    /**
+     * Storage connection should work with from now on, set by commands which switch namespace (see
+     * Storage::Namespace). Network layer checks it after each command
+     *
+     * Default implementation returns nullptr: connection stays with the same storage
+     */
+    virtual std::shared_ptr<Storage> Selected() const { return nullptr; }
+
+    /**
+     * Name the command is accounted under in stats (see Metrics), for command classes which do different
+     * things depending on the request. Must live as long as the process
+     *
+     * Default implementation returns nullptr: command is accounted by its class name
+     */
+    virtual const char *Metric() const { return nullptr; }
+
+    /**
+     * Client asked for no response ("noreply" argument), network layer sends nothing back so that bulk
+     * updates could be pipelined without waiting for each of them
+     */
+    inline bool NoReply() const { return _noreply; }
+    inline void NoReply(bool noreply) { _noreply = noreply; }
+
+    /**
+     * Commands which store the data block as is could take it in place: once the command line is parsed,
+     * network layer asks for the buffer for a large block and reads the block right into it instead of
+     * collecting it into args. Execute then gets empty args. See Set and Storage::PutChunked
+     *
+     * Default implementation returns nullptr: block is passed in args
+     */
+    virtual std::shared_ptr<ChunkedValue> Reserve(std::size_t size) { return nullptr; }
+
+    /**
+     * Data block is larger than the storage could ever keep (see Storage::MaxItemSize). Network layer doesn't
+     * Reserve it and skips the block as it arrives, Execute then reports the error instead of storing
+     */
+    inline bool Oversized() const { return _oversized; }
+    inline void Oversized(bool oversized) { _oversized = oversized; }
+
+    /**
+     * Keys of consecutive pipelined reads looked up at once, i-th key goes with i-th result as returned by
+     * Storage::GetMany
+     */
+    struct Prefetch {
+        // Drops keys of the previous batch, their strings are kept aside for the next one
+        void Clear();
+
+        // Appends the key, reusing string of a dropped one
+        void Add(const std::string &key, uint64_t hash);
+
+        std::vector<std::string> keys;
+        std::vector<uint64_t> hashes;
+        std::vector<std::string> values;
+        std::vector<std::shared_ptr<const ChunkedValue>> chunks;
+        std::vector<uint64_t> versions;
+        std::vector<Storage::Attributes> attributes;
+        std::vector<bool> found;
+
+        // Strings of the dropped keys, see Clear
+        std::vector<std::string> spare;
+    };
+
+    /**
+     * Commands which do nothing but read keys append them to the batch and return true. Network layer
+     * looks up keys of all consecutive reads it has got in one read from the socket with a single
+     * Storage::GetMany, so that each storage lock (stripe) is taken once per batch instead of once per key,
+     * and hands results back through Prefetched before Execute
+     *
+     * Default implementation reads nothing
+     */
+    virtual bool Reads(Prefetch &batch) const { return false; }
+
+    /**
+     * Results of the lookup, keys of the command start at offset. Command must answer from them without
+     * going to the storage
+     */
+    virtual void Prefetched(std::shared_ptr<const Prefetch> batch, std::size_t offset) {}
+
+    /**
+     * Deadline of the item (see Storage::Attributes) for memcached expiration time: 0 means never, up to
+     * 30 days it is an offset in seconds from now, anything bigger is unix time in seconds. Negative time
+     * expires the item at once
+     */
+    static uint64_t Deadline(int64_t exptime);
+
+protected:
+    /**
+     * Read-modify-write of the existing value: modify gets current value and changes it in place, or returns
+     * false to give up. Result is stored only if nobody has written the item meanwhile, otherwise everything
+     * is repeated with the fresh value (see Storage::CompareAndSet). Flags and deadline of the item are kept
+     *
+     * @return true if the new value has been stored, false if key is missing or modify gave up
+     */
+    static bool Update(Storage &storage, const std::string &key, uint64_t hash,
+                       const std::function<bool(std::string &value)> &modify);
+
+private:
+    bool _noreply;
+    bool _oversized;
 };
 
 } // namespace Execute
@@ -1,7 +1,11 @@
 #ifndef AFINA_EXECUTE_DELETE_H
 #define AFINA_EXECUTE_DELETE_H
 
+#include <cstdint>
+#include <string>
+
 #include "Command.h"
+#include <afina/Hash.h>
 
 namespace Afina {
 namespace Execute {
@@ -11,16 +15,26 @@ namespace Execute {
  * Delete existing key from the cache. If key not found then command does
  * nothing
  *
+ * delete <key> [noreply]\r\n
+ *
  * Command must write result to the output, which could be:
  * - "DELETED" to indicate success
  * - "NOT_FOUND" to indicate that the item with this key was not found
  */
 class Delete : public Command {
 public:
-    Delete();
-    ~Delete();
+    Delete(const std::string &key) : Delete(key, KeyHash(key)) {}
+    Delete(const std::string &key, uint64_t hash) : _key(key), _hash(hash) {}
+    ~Delete() {}
+
+    inline const std::string &key() const { return _key; }
 
     void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+private:
+    const std::string _key;
+    // Hash of the key, see afina/Hash.h
+    const uint64_t _hash;
 };
 
 } // namespace Execute
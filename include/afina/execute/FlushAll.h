@@ -0,0 +1,41 @@
+#ifndef AFINA_EXECUTE_FLUSH_ALL_H
+#define AFINA_EXECUTE_FLUSH_ALL_H
+
+#include <cstdint>
+#include <string>
+
+#include "Command.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Invalidate all items
+ * flush_all [delay] [noreply]\r\n
+ *
+ * Removes everything from the storage connection works with, that is only the current namespace after
+ * "namespace" command. Delayed flush would have to expire all the items present at the moment, but not the
+ * ones stored later, which storages can't do, so that only zero delay is accepted
+ *
+ * Command must write result to the output, which could be:
+ * - "OK" to indicate success
+ * - "CLIENT_ERROR ..." for nonzero delay
+ * - "SERVER_ERROR ..." if storage can't be flushed, see Storage::Flush
+ */
+class FlushAll : public Command {
+public:
+    FlushAll(uint32_t delay) : _delay(delay) {}
+    ~FlushAll() {}
+
+    inline uint32_t delay() const { return _delay; }
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+private:
+    const uint32_t _delay;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_FLUSH_ALL_H
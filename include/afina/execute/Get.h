@@ -1,10 +1,13 @@
 #ifndef AFINA_EXECUTE_GET_H
 #define AFINA_EXECUTE_GET_H
 
+#include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "Command.h"
+#include <afina/Hash.h>
 
 namespace Afina {
 namespace Execute {
@@ -34,15 +37,57 @@ namespace Execute {
  */
 class Get : public Command {
 public:
-    Get(const std::vector<std::string> &keys) : _keys(keys) {}
+    Get(const std::vector<std::string> &keys) : _keys(keys), _versions(false), _offset(0) {
+        _hashes.reserve(keys.size());
+        for (auto &key : keys) {
+            _hashes.push_back(KeyHash(key));
+        }
+    }
+    Get(std::vector<std::string> keys, std::vector<uint64_t> hashes, bool versions = false)
+        : _keys(std::move(keys)), _hashes(std::move(hashes)), _versions(versions), _offset(0) {}
     ~Get() {}
 
     inline const std::vector<std::string> &keys() const { return _keys; }
+    inline const std::vector<uint64_t> &hashes() const { return _hashes; }
+
+    /**
+     * Refill recycled command with keys of the next request, reusing memory of the previous one: Resize sets
+     * the number of keys and drops looked up values, then each key is set with Key
+     */
+    void Resize(std::size_t count);
+    inline void Key(std::size_t i, const char *key, std::size_t size, uint64_t hash) {
+        _keys[i].assign(key, size);
+        _hashes[i] = hash;
+    }
 
     void Execute(Storage &storage, const std::string &args, std::string &out) override;
 
+    // Formats headers in place, values are referenced rather than copied where possible, see Command.h
+    void Execute(Storage &storage, const std::string &args, Response &out) override;
+
+    // See Command.h
+    bool Reads(Prefetch &batch) const override;
+    void Prefetched(std::shared_ptr<const Prefetch> batch, std::size_t offset) override;
+
 private:
     std::vector<std::string> _keys;
+
+    // Hashes of the keys above, see afina/Hash.h
+    std::vector<uint64_t> _hashes;
+
+    // Buffers of the keys previous request had more of, see Resize
+    std::vector<std::string> _spare;
+
+    // Append version of each item to its header, see Gets
+    const bool _versions;
+
+    // Keys looked up already and position of the first one there, see Command::Reads
+    std::shared_ptr<const Prefetch> _prefetch;
+    std::size_t _offset;
+
+    // Buffers the command looks keys up into when nobody has done it beforehand, reused once responses which
+    // reference values there are gone
+    std::shared_ptr<Prefetch> _lookup;
 };
 
 } // namespace Execute
@@ -0,0 +1,31 @@
+#ifndef AFINA_EXECUTE_GETS_H
+#define AFINA_EXECUTE_GETS_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Get.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Retrive values along with their versions
+ * Same as Get, but each item carries its version, which client passes back to the "cas" command:
+ *
+ * VALUE <key> <flags> <bytes> <cas unique>\r\n
+ * <data>\r\n
+ */
+class Gets : public Get {
+public:
+    Gets(std::vector<std::string> keys, std::vector<uint64_t> hashes)
+        : Get(std::move(keys), std::move(hashes), true) {}
+    ~Gets() {}
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_GETS_H
@@ -5,6 +5,8 @@
 #include <string>
 
 #include "Command.h"
+#include <afina/Hash.h>
+#include <afina/Storage.h>
 
 namespace Afina {
 namespace Execute {
@@ -15,17 +17,46 @@ namespace Execute {
  */
 class InsertCommand : public Command {
 public:
-    InsertCommand(const std::string &key, uint32_t flags, int32_t expire) : _key(key), _flags(flags), _expire(expire) {}
+    InsertCommand(const std::string &key, uint32_t flags, int32_t expire)
+        : InsertCommand(key, flags, expire, KeyHash(key)) {}
+    InsertCommand(const std::string &key, uint32_t flags, int32_t expire, uint64_t hash)
+        : _key(key), _hash(hash), _flags(flags), _expire(expire) {}
     ~InsertCommand() {}
 
+    /**
+     * Reports oversized data block (see Command::Oversized) instead of executing
+     */
+    void Execute(Storage &storage, const std::string &args, Response &out) override {
+        if (Oversized()) {
+            out.Append("SERVER_ERROR object too large for cache");
+            return;
+        }
+        Command::Execute(storage, args, out);
+    }
+    using Command::Execute;
+
     inline const std::string &key() const { return _key; }
+    inline uint64_t hash() const { return _hash; }
     inline const uint32_t flags() const { return _flags; }
     inline const int32_t expire() const { return _expire; }
 
+    // Refills recycled command with the next request, key reuses memory of the previous one
+    inline void Assign(const char *key, std::size_t size, uint32_t flags, int32_t expire, uint64_t hash) {
+        _key.assign(key, size);
+        _hash = hash;
+        _flags = flags;
+        _expire = expire;
+    }
+
 protected:
-    const std::string _key;
-    const uint32_t _flags;
-    const int32_t _expire;
+    // What gets stored along with the value
+    inline Storage::Attributes _attributes() const { return Storage::Attributes(_flags, Deadline(_expire)); }
+
+    std::string _key;
+    // Hash of the key, see afina/Hash.h
+    uint64_t _hash;
+    uint32_t _flags;
+    int32_t _expire;
 };
 
 } // namespace Execute
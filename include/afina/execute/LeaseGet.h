@@ -0,0 +1,56 @@
+#ifndef AFINA_EXECUTE_LEASE_GET_H
+#define AFINA_EXECUTE_LEASE_GET_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Command.h"
+#include <afina/Hash.h>
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Retrive values with leases
+ * Same as get, but every miss is answered with a lease (see Storage::GetLease), so that only one client
+ * recomputes missing value while others wait or use the stale one:
+ *
+ * lget <key>*\r\n
+ *
+ * For each key server sends one of:
+ * VALUE <key> <flags> <bytes>\r\n
+ * <data>\r\n
+ *   - value found
+ * LEASE <key> <token>\r\n
+ *   - miss, client owns the lease and is expected to store value with "lset" passing the token
+ * STALE <key> <flags> <bytes>\r\n
+ * <data>\r\n
+ *   - miss, other client owns the lease, data is the value deleted recently
+ * HOT_MISS <key>\r\n
+ *   - miss, other client owns the lease, retry later
+ *
+ * and terminates list by END
+ */
+class LeaseGet : public Command {
+public:
+    LeaseGet(std::vector<std::string> keys, std::vector<uint64_t> hashes)
+        : _keys(std::move(keys)), _hashes(std::move(hashes)) {}
+    ~LeaseGet() {}
+
+    inline const std::vector<std::string> &keys() const { return _keys; }
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+private:
+    std::vector<std::string> _keys;
+
+    // Hashes of the keys above, see afina/Hash.h
+    std::vector<uint64_t> _hashes;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_LEASE_GET_H
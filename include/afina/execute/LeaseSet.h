@@ -0,0 +1,40 @@
+#ifndef AFINA_EXECUTE_LEASE_SET_H
+#define AFINA_EXECUTE_LEASE_SET_H
+
+#include <cstdint>
+#include <string>
+
+#include "InsertCommand.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Store value under the lease
+ * lset <key> <flags> <exptime> <bytes> <token>\r\n
+ *
+ * Stores value only if lease token, given out by "lget", is still valid. Lease becomes void once it
+ * expires or the key gets updated or deleted by anyone else.
+ *
+ * Command must write result to the output, which could be:
+ * - "STORED", to indicate success.
+ * - "NOT_STORED" lease is not valid anymore, value is dropped
+ */
+class LeaseSet : public InsertCommand {
+public:
+    LeaseSet(const std::string &key, uint32_t flags, int32_t expire, uint64_t hash, uint64_t token)
+        : InsertCommand(key, flags, expire, hash), _token(token) {}
+    ~LeaseSet() {}
+
+    inline uint64_t token() const { return _token; }
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+private:
+    const uint64_t _token;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_LEASE_SET_H
@@ -0,0 +1,145 @@
+#ifndef AFINA_EXECUTE_METRICS_H
+#define AFINA_EXECUTE_METRICS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include <afina/concurrency/PerThread.h>
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Server metrics
+ * Process wide counters and latency histogram of each command type, reported by the stats command. Each
+ * thread records into its own cache line padded slot (see Concurrency::PerThread) with relaxed atomics, so
+ * that the hot path takes no locks and never shares lines with other cores. Slots are summed up on demand.
+ *
+ * Command type is the class of the command: Get, Set and so on. Commands of one class which do different things,
+ * such as RESP commands and binary protocol opcodes, are recorded under their own names instead
+ */
+class Metrics {
+public:
+    enum class Counter : uint8_t {
+        // Keys found and not found by get commands of all protocols
+        GetHits,
+        GetMisses,
+
+        // Bytes received from and sent to clients
+        BytesRead,
+        BytesWritten,
+
+        // Connections opened and closed, the difference is currently open ones
+        ConnectionsOpened,
+        ConnectionsClosed,
+
+        Count
+    };
+
+    /**
+     * # Latency histogram, in nanoseconds
+     * Log-linear buckets as in HdrHistogram: values below 2^SubBits are counted exactly, each next power of
+     * two is split into 2^SubBits equal buckets, so that any value is known up to 1/2^SubBits of it. Values
+     * of 2^MaxBits ns (~4.3 s) and more go to the last bucket
+     */
+    struct Latency {
+        static constexpr unsigned SubBits = 3;
+        static constexpr unsigned MaxBits = 32;
+        static constexpr std::size_t Buckets = std::size_t(MaxBits - SubBits + 1) << SubBits;
+
+        // Bucket the value goes to
+        static std::size_t Bucket(uint64_t ns);
+
+        // The smallest and the largest value of the bucket
+        static uint64_t Lower(std::size_t bucket);
+        static uint64_t Upper(std::size_t bucket);
+
+        Latency() : count(0), sum_ns(0), max_ns(0), buckets(Buckets, 0) {}
+
+        /**
+         * Value that the given share of samples doesn't exceed, i.e 0.99 for p99: upper bound of the bucket,
+         * but never more than the maximum seen
+         */
+        uint64_t Percentile(double share) const;
+
+        uint64_t count;
+        uint64_t sum_ns;
+        uint64_t max_ns;
+        std::vector<uint64_t> buckets;
+    };
+
+    // Sum of all threads, see Collect
+    struct Snapshot {
+        uint64_t counters[std::size_t(Counter::Count)];
+
+        // Command types which have run at least once, by name
+        std::vector<std::pair<std::string, Latency>> commands;
+
+        inline uint64_t Get(Counter counter) const { return counters[std::size_t(counter)]; }
+    };
+
+    /**
+     * Accounts command of the given type which took ns nanoseconds to execute
+     */
+    static void Record(const std::type_info &command, uint64_t ns);
+
+    /**
+     * Same as above for the command recorded by name, see Execute::Command::Metric. Name must live as long
+     * as the process, i.e be a string literal
+     */
+    static void Record(const char *name, uint64_t ns);
+
+    static inline void Add(Counter counter, uint64_t value = 1) {
+        _slots().local().counters[std::size_t(counter)].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    /**
+     * Sums up slots of all threads. Result is not an atomic snapshot, but each value is exact
+     */
+    static void Collect(Snapshot &out);
+
+    // Class name of the command type, without namespaces
+    static std::string Name(const std::type_info &command);
+
+    // Command types tracked separately, the rest are summed up as "other"
+    static constexpr std::size_t MaxCommands = 64;
+
+private:
+    struct histogram {
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum_ns;
+        std::atomic<uint64_t> max_ns;
+        std::atomic<uint64_t> buckets[Latency::Buckets];
+    };
+
+    // Metrics of a single thread
+    struct slot {
+        slot();
+        std::atomic<uint64_t> counters[std::size_t(Counter::Count)];
+        histogram commands[MaxCommands];
+    };
+
+    static Concurrency::PerThread<slot, 16> &_slots();
+
+    static void _record(histogram &h, uint64_t ns);
+
+    /**
+     * Index of the command in slot::commands, either type or name is given. Commands get them in order they
+     * first run: the one which claims the index publishes its type or name there, the rest wait for that
+     */
+    static std::size_t _command(const std::type_info *type, const char *name);
+
+    static std::atomic<bool> _claimed[MaxCommands];
+    static std::atomic<const std::type_info *> _types[MaxCommands];
+    static std::atomic<const char *> _names[MaxCommands];
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_METRICS_H
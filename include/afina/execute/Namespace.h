@@ -0,0 +1,43 @@
+#ifndef AFINA_EXECUTE_NAMESPACE_H
+#define AFINA_EXECUTE_NAMESPACE_H
+
+#include <memory>
+#include <string>
+
+#include "Command.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Switch connection to namespace
+ * All subsequent commands of the connection work with the given namespace only, keys are taken as is
+ * regardless of their prefix:
+ *
+ * namespace <name>\r\n
+ *
+ * Server responds with OK, or NOT_FOUND if storage has no such namespace, then connection stays where it was
+ */
+class Namespace : public Command {
+public:
+    Namespace(const std::string &name) : _name(name) {}
+    ~Namespace() {}
+
+    inline const std::string &name() const { return _name; }
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+    // See Command.h
+    std::shared_ptr<Storage> Selected() const override { return _selected; }
+
+private:
+    std::string _name;
+
+    // Namespace found by Execute
+    std::shared_ptr<Storage> _selected;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_NAMESPACE_H
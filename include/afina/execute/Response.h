@@ -0,0 +1,130 @@
+#ifndef AFINA_EXECUTE_RESPONSE_H
+#define AFINA_EXECUTE_RESPONSE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Response being built
+ * Commands write their responses here piece by piece. Short pieces (headers, numbers, short values) are
+ * copied into the own buffer, consecutive ones join into a single piece. Values kept alive by somebody else
+ * (batch of looked up keys, chunks of a large value) are referenced as is along with their owner, which
+ * stays alive until the response is cleared.
+ *
+ * Network layer sends the pieces with a single gather write (see ForEachPiece), so that the value bytes are
+ * never copied on the way out.
+ *
+ * Not thread safe
+ */
+class Response {
+public:
+    /**
+     * Sends everything written so far, see Flush. Gets the response itself, must leave it empty
+     */
+    using Sink = std::function<void(Response &response)>;
+
+    Response() : _flushes(0), _size(0) {}
+    explicit Response(Sink sink) : _sink(std::move(sink)), _flushes(0), _size(0) {}
+    ~Response() {}
+
+    // Copies data into the response
+    void Append(const char *data, std::size_t size);
+    inline void Append(const std::string &data) { Append(data.data(), data.size()); }
+    inline void Append(const char *text) { Append(text, std::strlen(text)); }
+    inline void Append(char c) { Append(&c, 1); }
+
+    // Appends decimal representation of the number
+    void AppendDecimal(uint64_t value);
+
+    /**
+     * Appends data without copying: owner keeps it alive and unchanged as long as the response holds the owner.
+     * Pieces shorter than CopyLimit are copied anyway, separate piece costs more than a copy of such
+     */
+    void Reference(const char *data, std::size_t size, std::shared_ptr<const void> owner);
+
+    /**
+     * Asks to send everything written so far to the client right away. Throws std::runtime_error once
+     * connection is going to be closed, i.e server stops or client has gone, so that long running commands
+     * (see Subscribe) get interrupted. Without sink response is kept as is
+     */
+    void Flush();
+
+    // Number of bytes written
+    inline std::size_t size() const { return _size; }
+    inline bool empty() const { return _size == 0; }
+
+    // Number of pieces for the gather write
+    inline std::size_t Pieces() const { return _pieces.size(); }
+
+    /**
+     * Calls f(const char *data, std::size_t size) for each piece, in order
+     */
+    template <typename F> void ForEachPiece(F &&f) const {
+        for (auto &piece : _pieces) {
+            f(piece.data != nullptr ? piece.data : _buffer.data() + piece.offset, piece.size);
+        }
+    }
+
+    // Makes contiguous copy of the response
+    void CopyTo(std::string &out) const;
+
+    /**
+     * Position Truncate could go back to, i.e to drop response of the command which client doesn't wait for
+     */
+    struct Mark {
+        std::size_t pieces;
+        std::size_t buffer;
+        std::size_t size;
+        std::size_t flushes;
+    };
+    inline Mark Position() const { return Mark{_pieces.size(), _buffer.size(), _size, _flushes}; }
+
+    /**
+     * Drops everything written after the mark. If response has been flushed since, everything written is
+     * after the mark
+     */
+    void Truncate(const Mark &mark);
+
+    // Drops everything along with the owners, buffers are kept for the next response
+    void Clear();
+
+    // Referenced pieces shorter than this are copied
+    static constexpr std::size_t CopyLimit = 256;
+
+private:
+    struct piece {
+        // Referenced data or nullptr if piece is in the buffer
+        const char *data;
+        std::size_t offset;
+        std::size_t size;
+    };
+
+    Sink _sink;
+
+    // Copied pieces
+    std::string _buffer;
+
+    std::vector<piece> _pieces;
+
+    // Keep referenced pieces alive
+    std::vector<std::shared_ptr<const void>> _owners;
+
+    // Number of flushes so far, see Mark
+    std::size_t _flushes;
+
+    // Total number of bytes
+    std::size_t _size;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_RESPONSE_H
@@ -2,6 +2,7 @@
 #define AFINA_EXECUTE_SET_H
 
 #include <cstdint>
+#include <memory>
 #include <string>
 
 #include "InsertCommand.h"
@@ -18,13 +19,23 @@ namespace Execute {
  * - "STORED", to indicate success.
  * - "NOT_STORED" to indicate the data was not stored, but not because of an
  * error. This normally means that the condition for the command wasn't met.
+ * - "SERVER_ERROR object too large for cache" if item is larger than the storage could keep.
  */
 class Set : public InsertCommand {
 public:
     Set(const std::string &key, uint32_t flags, int32_t expire) : InsertCommand(key, flags, expire) {}
+    Set(const std::string &key, uint32_t flags, int32_t expire, uint64_t hash)
+        : InsertCommand(key, flags, expire, hash) {}
     ~Set() {}
 
     void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+    // Data block larger than a chunk goes to the storage as is, see Command.h
+    std::shared_ptr<ChunkedValue> Reserve(std::size_t size) override;
+
+private:
+    // Data block taken in place, see Reserve
+    std::shared_ptr<ChunkedValue> _body;
 };
 
 } // namespace Execute
@@ -2,17 +2,41 @@
 #define AFINA_EXECUTE_STATS_H
 
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "Command.h"
 
 namespace Afina {
 namespace Execute {
 
+/**
+ * # Report server statistic
+ * Writes out records of the requested group, each in format:
+ * STAT <name> <value>\r\n
+ *
+ * and terminates list by END. Groups are:
+ * - "": records provided by the storage, then server counters (see Metrics)
+ * - "commands": number of runs, total, mean and maximal execution time of each command type
+ * - "latency": percentiles of execution time of each command type
+ */
 class Stats : public Command {
 public:
-    Stats() {}
+    // Throws std::runtime_error for unknown group
+    explicit Stats(const std::string &group = std::string());
     ~Stats() {}
     void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+    inline const std::string &group() const { return _group; }
+
+    static bool Known(const std::string &group);
+
+    // Records of the group, the way they are reported
+    static void Collect(Storage &storage, const std::string &group,
+                        std::vector<std::pair<std::string, std::string>> &stats);
+
+private:
+    std::string _group;
 };
 
 } // namespace Execute
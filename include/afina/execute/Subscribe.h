@@ -0,0 +1,47 @@
+#ifndef AFINA_EXECUTE_SUBSCRIBE_H
+#define AFINA_EXECUTE_SUBSCRIBE_H
+
+#include <cstddef>
+#include <string>
+
+#include "Command.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Follow storage changes
+ * Turns connection into the stream of storage changes (see afina/ChangeStream.h), should be issued on a
+ * dedicated connection:
+ *
+ * subscribe\r\n
+ *
+ * Server responds with SUBSCRIBED and then sends a line per change as long as connection is alive:
+ * PUT <key> <bytes> <shard> <sequence>\r\n
+ * DELETE <key> 0 <shard> <sequence>\r\n
+ * EVICT <key> <bytes> <shard> <sequence>\r\n
+ *
+ * where sequence is the position of the event in the shard, keys longer than ChangeStream::KeyCapacity
+ * are truncated and such lines end with " TRUNCATED". If subscriber falls behind and events get
+ * overwritten, server reports how many of them were lost:
+ * DROPPED <count>\r\n
+ *
+ * If storage doesn't publish changes server responds with SERVER_ERROR
+ */
+class Subscribe : public Command {
+public:
+    Subscribe() {}
+    ~Subscribe() {}
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+    void Execute(Storage &storage, const std::string &args, Response &out) override;
+
+    // Max number of events sent at once
+    static constexpr std::size_t BatchSize = 256;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_SUBSCRIBE_H
@@ -0,0 +1,45 @@
+#ifndef AFINA_EXECUTE_TOUCH_H
+#define AFINA_EXECUTE_TOUCH_H
+
+#include <cstdint>
+#include <string>
+
+#include "Command.h"
+#include <afina/Hash.h>
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Update expiration time of the item
+ * touch <key> <exptime> [noreply]\r\n
+ *
+ * Sets the new deadline of the item (see Command::Deadline) without reading or copying its value. Touch counts
+ * as an access for the eviction policy
+ *
+ * Command must write result to the output, which could be:
+ * - "TOUCHED" to indicate success
+ * - "NOT_FOUND" to indicate that the item with this key was not found
+ */
+class Touch : public Command {
+public:
+    Touch(const std::string &key, int32_t expire) : Touch(key, KeyHash(key), expire) {}
+    Touch(const std::string &key, uint64_t hash, int32_t expire) : _key(key), _hash(hash), _expire(expire) {}
+    ~Touch() {}
+
+    inline const std::string &key() const { return _key; }
+    inline int32_t expire() const { return _expire; }
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+private:
+    const std::string _key;
+    // Hash of the key, see afina/Hash.h
+    const uint64_t _hash;
+    const int32_t _expire;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_TOUCH_H
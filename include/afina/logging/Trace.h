@@ -0,0 +1,117 @@
+#ifndef AFINA_LOGGING_TRACE_H
+#define AFINA_LOGGING_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <spdlog/logger.h>
+
+/**
+ * Minimum level of trace messages compiled in, same numbering as spdlog::level. Calls below it are removed by
+ * the preprocessor along with their arguments, see AFINA_TRACE_* macros. Set by the build, see AFINA_TRACE_LEVEL
+ * in CMakeLists.txt
+ */
+#define AFINA_TRACE_LEVEL_TRACE 0
+#define AFINA_TRACE_LEVEL_DEBUG 1
+#define AFINA_TRACE_LEVEL_INFO 2
+#define AFINA_TRACE_LEVEL_OFF 6
+
+#ifndef AFINA_TRACE_LEVEL
+#define AFINA_TRACE_LEVEL AFINA_TRACE_LEVEL_DEBUG
+#endif
+
+namespace Afina {
+namespace Logging {
+
+/**
+ * # Trace of the hot paths
+ * Process wide logger for per request messages, i.e commands being executed. Nothing is written until logger
+ * is installed, then logger level filters messages as usual and only every Nth message passing the level is
+ * written, so that a loaded server could be traced without writing a line per request.
+ *
+ * Messages are formatted and their arguments are evaluated only if the message is going to be written.
+ * Install is expected to be called before requests start to come and after they stop, the logger in use is
+ * kept alive until then.
+ */
+class Trace {
+public:
+    /**
+     * Writes every'th message to the given logger, nullptr stops tracing
+     */
+    static void Install(std::shared_ptr<spdlog::logger> logger, uint32_t every = 1);
+
+    /**
+     * Logger to write message of the given level to, nullptr if message should be skipped
+     */
+    static inline spdlog::logger *Sampled(spdlog::level::level_enum level) {
+        spdlog::logger *logger = _logger.load(std::memory_order_acquire);
+        if (logger == nullptr || !logger->should_log(level)) {
+            return nullptr;
+        }
+        uint32_t every = _every.load(std::memory_order_relaxed);
+        if (every > 1 && ++_skipped % every != 0) {
+            return nullptr;
+        }
+        return logger;
+    }
+
+    /**
+     * Items separated by spaces, i.e keys of the multi key command
+     */
+    template <typename C> static std::string Join(const C &items) {
+        std::string out;
+        for (auto &item : items) {
+            if (!out.empty()) {
+                out += ' ';
+            }
+            out += item;
+        }
+        return out;
+    }
+
+private:
+    static std::shared_ptr<spdlog::logger> _owner;
+    static std::atomic<spdlog::logger *> _logger;
+    static std::atomic<uint32_t> _every;
+
+    // Messages seen by the thread, counted per thread to keep cores from sharing the line
+    static thread_local uint32_t _skipped;
+};
+
+} // namespace Logging
+} // namespace Afina
+
+#define AFINA_TRACE_AT(level, ...)                                                                                     \
+    do {                                                                                                               \
+        if (spdlog::logger *afina_trace_logger = ::Afina::Logging::Trace::Sampled(level)) {                            \
+            afina_trace_logger->log(level, __VA_ARGS__);                                                               \
+        }                                                                                                              \
+    } while (0)
+
+#if AFINA_TRACE_LEVEL <= AFINA_TRACE_LEVEL_TRACE
+#define AFINA_TRACE_TRACE(...) AFINA_TRACE_AT(spdlog::level::trace, __VA_ARGS__)
+#else
+#define AFINA_TRACE_TRACE(...)                                                                                         \
+    do {                                                                                                               \
+    } while (0)
+#endif
+
+#if AFINA_TRACE_LEVEL <= AFINA_TRACE_LEVEL_DEBUG
+#define AFINA_TRACE_DEBUG(...) AFINA_TRACE_AT(spdlog::level::debug, __VA_ARGS__)
+#else
+#define AFINA_TRACE_DEBUG(...)                                                                                         \
+    do {                                                                                                               \
+    } while (0)
+#endif
+
+#if AFINA_TRACE_LEVEL <= AFINA_TRACE_LEVEL_INFO
+#define AFINA_TRACE_INFO(...) AFINA_TRACE_AT(spdlog::level::info, __VA_ARGS__)
+#else
+#define AFINA_TRACE_INFO(...)                                                                                          \
+    do {                                                                                                               \
+    } while (0)
+#endif
+
+#endif // AFINA_LOGGING_TRACE_H
@@ -1,21 +1,18 @@
 #include <afina/Storage.h>
 #include <afina/execute/Append.h>
-
-#include <iostream>
+#include <afina/logging/Trace.h>
 
 namespace Afina {
 namespace Execute {
 
 // memcached protocol: "append" means "add this data to an existing key after existing data".
 void Append::Execute(Storage &storage, const std::string &args, std::string &out) {
-    std::cout << "Append(" << _key << ")" << args << std::endl;
-    std::string value;
-    if (!storage.Get(_key, value)) {
-        out.assign("NOT_STORED");
-        return;
-    }
-    storage.Put(_key, value + args);
-    out.assign("STORED");
+    AFINA_TRACE_DEBUG("Append({}): {} bytes", _key, args.size());
+    bool stored = Update(storage, _key, _hash, [&args](std::string &value) {
+        value.append(args);
+        return true;
+    });
+    out.assign(stored ? "STORED" : "NOT_STORED");
 }
 
 } // namespace Execute
@@ -0,0 +1,59 @@
+#include <afina/Storage.h>
+#include <afina/execute/Arithmetic.h>
+#include <afina/logging/Trace.h>
+
+namespace Afina {
+namespace Execute {
+
+namespace {
+
+// Strict decimal form of 64 bit unsigned number
+bool ParseNumber(const std::string &value, uint64_t &number) {
+    if (value.empty() || value.size() > 20) {
+        return false;
+    }
+    number = 0;
+    for (char c : value) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        if (__builtin_mul_overflow(number, 10, &number) || __builtin_add_overflow(number, c - '0', &number)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+// memcached protocol: "incr" and "decr" change item which holds a number in place
+void Arithmetic::Execute(Storage &storage, const std::string &args, std::string &out) {
+    AFINA_TRACE_DEBUG("{}({}): {}", _operation == Operation::Incr ? "Incr" : "Decr", _key, _delta);
+    bool numeric = true;
+    uint64_t result = 0;
+    bool stored = Update(storage, _key, _hash, [this, &numeric, &result](std::string &value) {
+        uint64_t current;
+        if (!ParseNumber(value, current)) {
+            numeric = false;
+            return false;
+        }
+        if (_operation == Operation::Incr) {
+            result = current + _delta;
+        } else {
+            result = current > _delta ? current - _delta : 0;
+        }
+        value = std::to_string(result);
+        return true;
+    });
+
+    if (stored) {
+        out = std::to_string(result);
+    } else if (!numeric) {
+        out = "CLIENT_ERROR cannot increment or decrement non-numeric value";
+    } else {
+        out = "NOT_FOUND";
+    }
+}
+
+} // namespace Execute
+} // namespace Afina
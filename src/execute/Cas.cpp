@@ -0,0 +1,27 @@
+#include <afina/Storage.h>
+#include <afina/execute/Cas.h>
+#include <afina/logging/Trace.h>
+
+namespace Afina {
+namespace Execute {
+
+// memcached protocol: "cas" means "store this data but only if no one else has updated since I last fetched it"
+void Cas::Execute(Storage &storage, const std::string &args, std::string &out) {
+    AFINA_TRACE_DEBUG("Cas({}, {}): {} bytes", _key, _version, args.size());
+    switch (storage.CompareAndSet(_key, _hash, args, _version, _attributes())) {
+    case Storage::CasResult::Stored:
+        out = "STORED";
+        break;
+    case Storage::CasResult::Exists:
+        out = "EXISTS";
+        break;
+    case Storage::CasResult::NotFound:
+        out = "NOT_FOUND";
+        break;
+    default:
+        out = "NOT_STORED";
+    }
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -1 +1,78 @@
+#include <afina/ChunkedValue.h>
+#include <afina/Storage.h>
 #include <afina/execute/Command.h>
+
+namespace Afina {
+namespace Execute {
+
+namespace {
+
+// Larger expiration times are unix time rather than an offset
+const int64_t MaxRelativeExptime = 60 * 60 * 24 * 30;
+
+} // namespace
+
+// See Command.h
+bool Command::Update(Storage &storage, const std::string &key, uint64_t hash,
+                     const std::function<bool(std::string &value)> &modify) {
+    std::string value;
+    std::shared_ptr<const ChunkedValue> chunks;
+    uint64_t version;
+    Storage::Attributes attributes;
+    while (storage.Get(key, hash, value, chunks, version, attributes)) {
+        if (chunks) {
+            chunks->CopyTo(value);
+        }
+        if (!modify(value)) {
+            return false;
+        }
+
+        // Touch doesn't change version, so deadline is kept by the storage rather than written back
+        Storage::Attributes kept(attributes.flags, Storage::Attributes::KeepDeadline);
+        Storage::CasResult result = storage.CompareAndSet(key, hash, value, version, kept);
+        if (result != Storage::CasResult::Exists) {
+            return result == Storage::CasResult::Stored;
+        }
+        // Someone has written the item in between, start over with the new value
+    }
+    return false;
+}
+
+// See Command.h
+uint64_t Command::Deadline(int64_t exptime) {
+    if (exptime == 0) {
+        return 0;
+    }
+    if (exptime < 0) {
+        // Any moment in the past
+        return 1;
+    }
+    if (exptime <= MaxRelativeExptime) {
+        return Storage::Now() + uint64_t(exptime) * 1000;
+    }
+    return uint64_t(exptime) * 1000;
+}
+
+// See Command.h
+void Command::Prefetch::Clear() {
+    while (!keys.empty()) {
+        spare.push_back(std::move(keys.back()));
+        keys.pop_back();
+    }
+    hashes.clear();
+}
+
+// See Command.h
+void Command::Prefetch::Add(const std::string &key, uint64_t hash) {
+    if (spare.empty()) {
+        keys.push_back(key);
+    } else {
+        keys.push_back(std::move(spare.back()));
+        spare.pop_back();
+        keys.back().assign(key);
+    }
+    hashes.push_back(hash);
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -0,0 +1,15 @@
+#include <afina/Storage.h>
+#include <afina/execute/Delete.h>
+#include <afina/logging/Trace.h>
+
+namespace Afina {
+namespace Execute {
+
+// memcached protocol: "delete" removes the item, there is no data block
+void Delete::Execute(Storage &storage, const std::string &args, std::string &out) {
+    AFINA_TRACE_DEBUG("Delete({})", _key);
+    out = storage.Delete(_key, _hash) ? "DELETED" : "NOT_FOUND";
+}
+
+} // namespace Execute
+} // namespace Afina
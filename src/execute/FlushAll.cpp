@@ -0,0 +1,21 @@
+#include <afina/Storage.h>
+#include <afina/execute/FlushAll.h>
+#include <afina/logging/Trace.h>
+
+namespace Afina {
+namespace Execute {
+
+// memcached protocol: "flush_all" invalidates all existing items immediately or after the delay
+void FlushAll::Execute(Storage &storage, const std::string &args, std::string &out) {
+    AFINA_TRACE_DEBUG("FlushAll({})", _delay);
+    if (_delay != 0) {
+        out = "CLIENT_ERROR delayed flush is not supported";
+    } else if (storage.Flush()) {
+        out = "OK";
+    } else {
+        out = "SERVER_ERROR storage can't be flushed";
+    }
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -1,9 +1,8 @@
+#include <afina/ChunkedValue.h>
 #include <afina/Storage.h>
 #include <afina/execute/Get.h>
-
-#include <iostream>
-#include <iterator>
-#include <sstream>
+#include <afina/execute/Metrics.h>
+#include <afina/logging/Trace.h>
 
 namespace Afina {
 namespace Execute {
@@ -22,22 +21,100 @@ to indicate the end of response.
 */
 
 void Get::Execute(Storage &storage, const std::string &args, std::string &out) {
-    std::stringstream keyStream;
-    copy(_keys.begin(), _keys.end(), std::ostream_iterator<std::string>(keyStream, " "));
-    std::cout << "Get(" << keyStream.str() << ")" << std::endl;
+    Response response;
+    Execute(storage, args, response);
+    response.CopyTo(out);
+}
 
-    std::stringstream outStream;
+void Get::Execute(Storage &storage, const std::string &args, Response &out) {
+    AFINA_TRACE_DEBUG("Get({})", Logging::Trace::Join(_keys));
+
+    std::shared_ptr<const Prefetch> batch = _prefetch;
+    std::size_t offset = _offset;
+    if (!batch) {
+        // Nobody has looked the keys up, do it the same way into buffers of the command
+        if (!_lookup || _lookup.use_count() > 1) {
+            _lookup = std::make_shared<Prefetch>();
+        }
+        _lookup->Clear();
+        Reads(*_lookup);
+        storage.GetMany(_lookup->keys, _lookup->hashes, _lookup->values, _lookup->chunks, _lookup->versions,
+                        _lookup->attributes, _lookup->found);
+        batch = _lookup;
+        offset = 0;
+    }
 
-    std::string value;
-    for (auto &key : _keys) {
-        if (!storage.Get(key, value))
+    uint64_t hits = 0;
+    for (std::size_t i = 0; i < _keys.size(); i++) {
+        std::size_t at = offset + i;
+        if (!batch->found[at])
             continue;
-        outStream << "VALUE " << key << " 0 " << value.size() << "\r\n";
-        outStream << value << "\r\n";
+        hits++;
+
+        auto &key = _keys[i];
+        const std::string &value = batch->values[at];
+        const std::shared_ptr<const ChunkedValue> &chunks = batch->chunks[at];
+        out.Append("VALUE ", 6);
+        out.Append(key);
+        out.Append(' ');
+        out.AppendDecimal(batch->attributes[at].flags);
+        out.Append(' ');
+        out.AppendDecimal(chunks ? chunks->size() : value.size());
+        if (_versions) {
+            out.Append(' ');
+            out.AppendDecimal(batch->versions[at]);
+        }
+        out.Append("\r\n", 2);
+
+        // Values are referenced rather than copied, looked up batch or chunks of a large value keep them alive,
+        // storage lock is released already
+        if (chunks) {
+            chunks->ForEachChunk([&out, &chunks](const char *data, std::size_t size) {
+                out.Reference(data, size, chunks);
+            });
+        } else {
+            out.Reference(value.data(), value.size(), batch);
+        }
+        out.Append("\r\n", 2);
     }
-    outStream << "END"; // networking layer should add the last \r\n
+    out.Append("END", 3); // networking layer should add the last \r\n
+
+    Metrics::Add(Metrics::Counter::GetHits, hits);
+    Metrics::Add(Metrics::Counter::GetMisses, _keys.size() - hits);
+}
+
+// See Get.h
+void Get::Resize(std::size_t count) {
+    // Strings of the extra keys are kept aside, so that the next request with more keys reuses them too
+    while (_keys.size() > count) {
+        _spare.push_back(std::move(_keys.back()));
+        _keys.pop_back();
+    }
+    while (_keys.size() < count) {
+        if (_spare.empty()) {
+            _keys.emplace_back();
+        } else {
+            _keys.push_back(std::move(_spare.back()));
+            _spare.pop_back();
+        }
+    }
+    _hashes.resize(count);
+    _prefetch.reset();
+    _offset = 0;
+}
+
+// See Get.h
+bool Get::Reads(Prefetch &batch) const {
+    for (std::size_t i = 0; i < _keys.size(); i++) {
+        batch.Add(_keys[i], _hashes[i]);
+    }
+    return true;
+}
 
-    out = outStream.str();
+// See Get.h
+void Get::Prefetched(std::shared_ptr<const Prefetch> batch, std::size_t offset) {
+    _prefetch = std::move(batch);
+    _offset = offset;
 }
 
 } // namespace Execute
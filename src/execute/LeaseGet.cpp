@@ -0,0 +1,46 @@
+#include <afina/Storage.h>
+#include <afina/execute/LeaseGet.h>
+#include <afina/logging/Trace.h>
+
+#include <sstream>
+
+namespace Afina {
+namespace Execute {
+
+// See LeaseGet.h
+void LeaseGet::Execute(Storage &storage, const std::string &args, std::string &out) {
+    AFINA_TRACE_DEBUG("LeaseGet({})", Logging::Trace::Join(_keys));
+
+    std::stringstream outStream;
+
+    std::string value;
+    uint64_t token;
+    for (std::size_t i = 0; i < _keys.size(); i++) {
+        auto &key = _keys[i];
+        switch (storage.GetLease(key, _hashes[i], value, token)) {
+        case Storage::Lease::Hit:
+            outStream << "VALUE " << key << " 0 " << value.size() << "\r\n";
+            outStream << value << "\r\n";
+            break;
+
+        case Storage::Lease::Granted:
+            outStream << "LEASE " << key << " " << token << "\r\n";
+            break;
+
+        case Storage::Lease::Stale:
+            outStream << "STALE " << key << " 0 " << value.size() << "\r\n";
+            outStream << value << "\r\n";
+            break;
+
+        case Storage::Lease::HotMiss:
+            outStream << "HOT_MISS " << key << "\r\n";
+            break;
+        }
+    }
+    outStream << "END"; // networking layer should add the last \r\n
+
+    out = outStream.str();
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -0,0 +1,15 @@
+#include <afina/Storage.h>
+#include <afina/execute/LeaseSet.h>
+#include <afina/logging/Trace.h>
+
+namespace Afina {
+namespace Execute {
+
+// See LeaseSet.h
+void LeaseSet::Execute(Storage &storage, const std::string &args, std::string &out) {
+    AFINA_TRACE_DEBUG("LeaseSet({}, {}): {} bytes", _key, _token, args.size());
+    out = storage.PutLeased(_key, _hash, args, _token, _attributes()) ? "STORED" : "NOT_STORED";
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -0,0 +1,179 @@
+#include <afina/execute/Metrics.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#include <cxxabi.h>
+
+namespace Afina {
+namespace Execute {
+
+constexpr unsigned Metrics::Latency::SubBits;
+constexpr unsigned Metrics::Latency::MaxBits;
+constexpr std::size_t Metrics::Latency::Buckets;
+constexpr std::size_t Metrics::MaxCommands;
+
+std::atomic<bool> Metrics::_claimed[Metrics::MaxCommands];
+std::atomic<const std::type_info *> Metrics::_types[Metrics::MaxCommands];
+std::atomic<const char *> Metrics::_names[Metrics::MaxCommands];
+
+// See Metrics.h
+std::size_t Metrics::Latency::Bucket(uint64_t ns) {
+    if (ns < (uint64_t(1) << SubBits)) {
+        return std::size_t(ns);
+    }
+    if (ns >= (uint64_t(1) << MaxBits)) {
+        return Buckets - 1;
+    }
+    unsigned power = 63 - __builtin_clzll(ns);
+    uint64_t sub = (ns >> (power - SubBits)) & ((uint64_t(1) << SubBits) - 1);
+    return (std::size_t(power - SubBits + 1) << SubBits) + std::size_t(sub);
+}
+
+// See Metrics.h
+uint64_t Metrics::Latency::Lower(std::size_t bucket) {
+    if (bucket < (std::size_t(1) << SubBits)) {
+        return bucket;
+    }
+    unsigned power = unsigned(bucket >> SubBits) + SubBits - 1;
+    uint64_t sub = bucket & ((std::size_t(1) << SubBits) - 1);
+    return ((uint64_t(1) << SubBits) + sub) << (power - SubBits);
+}
+
+// See Metrics.h
+uint64_t Metrics::Latency::Upper(std::size_t bucket) {
+    return bucket + 1 < Buckets ? Lower(bucket + 1) - 1 : UINT64_MAX;
+}
+
+// See Metrics.h
+uint64_t Metrics::Latency::Percentile(double share) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = std::max<uint64_t>(1, uint64_t(share * count + 0.5));
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::min(Upper(i), max_ns);
+        }
+    }
+    return max_ns;
+}
+
+// See Metrics.h
+Metrics::slot::slot() {
+    for (auto &counter : counters) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    for (auto &command : commands) {
+        command.count.store(0, std::memory_order_relaxed);
+        command.sum_ns.store(0, std::memory_order_relaxed);
+        command.max_ns.store(0, std::memory_order_relaxed);
+        for (auto &bucket : command.buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+// See Metrics.h
+Concurrency::PerThread<Metrics::slot, 16> &Metrics::_slots() {
+    static Concurrency::PerThread<slot, 16> slots;
+    return slots;
+}
+
+// See Metrics.h
+std::size_t Metrics::_command(const std::type_info *type, const char *name) {
+    // The last one is for the commands which didn't fit
+    for (std::size_t i = 0; i + 1 < MaxCommands; i++) {
+        bool claimed = _claimed[i].load(std::memory_order_acquire);
+        if (!claimed && _claimed[i].compare_exchange_strong(claimed, true, std::memory_order_acq_rel)) {
+            _types[i].store(type, std::memory_order_release);
+            _names[i].store(name, std::memory_order_release);
+            return i;
+        }
+
+        const std::type_info *known_type;
+        const char *known_name;
+        do {
+            known_type = _types[i].load(std::memory_order_acquire);
+            known_name = _names[i].load(std::memory_order_acquire);
+        } while (known_type == nullptr && known_name == nullptr);
+
+        if (type != nullptr && known_type != nullptr && (known_type == type || *known_type == *type)) {
+            return i;
+        }
+        if (name != nullptr && known_name != nullptr && (known_name == name || std::strcmp(known_name, name) == 0)) {
+            return i;
+        }
+    }
+    return MaxCommands - 1;
+}
+
+// See Metrics.h
+void Metrics::Record(const std::type_info &command, uint64_t ns) {
+    _record(_slots().local().commands[_command(&command, nullptr)], ns);
+}
+
+// See Metrics.h
+void Metrics::Record(const char *name, uint64_t ns) {
+    _record(_slots().local().commands[_command(nullptr, name)], ns);
+}
+
+// See Metrics.h
+void Metrics::_record(histogram &h, uint64_t ns) {
+    h.count.fetch_add(1, std::memory_order_relaxed);
+    h.sum_ns.fetch_add(ns, std::memory_order_relaxed);
+    h.buckets[Latency::Bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t max = h.max_ns.load(std::memory_order_relaxed);
+    while (max < ns && !h.max_ns.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+    }
+}
+
+// See Metrics.h
+void Metrics::Collect(Snapshot &out) {
+    std::vector<Latency> commands(MaxCommands);
+    std::fill(std::begin(out.counters), std::end(out.counters), 0);
+    _slots().for_each([&out, &commands](const slot &s) {
+        for (std::size_t i = 0; i < std::size_t(Counter::Count); i++) {
+            out.counters[i] += s.counters[i].load(std::memory_order_relaxed);
+        }
+        for (std::size_t i = 0; i < MaxCommands; i++) {
+            const histogram &h = s.commands[i];
+            Latency &total = commands[i];
+            total.count += h.count.load(std::memory_order_relaxed);
+            total.sum_ns += h.sum_ns.load(std::memory_order_relaxed);
+            total.max_ns = std::max(total.max_ns, h.max_ns.load(std::memory_order_relaxed));
+            for (std::size_t b = 0; b < Latency::Buckets; b++) {
+                total.buckets[b] += h.buckets[b].load(std::memory_order_relaxed);
+            }
+        }
+    });
+
+    out.commands.clear();
+    for (std::size_t i = 0; i < MaxCommands; i++) {
+        if (commands[i].count == 0) {
+            continue;
+        }
+        const std::type_info *type = _types[i].load(std::memory_order_acquire);
+        const char *name = _names[i].load(std::memory_order_acquire);
+        std::string known = type != nullptr ? Name(*type) : name != nullptr ? name : "other";
+        out.commands.emplace_back(std::move(known), std::move(commands[i]));
+    }
+}
+
+// See Metrics.h
+std::string Metrics::Name(const std::type_info &command) {
+    int status = 0;
+    std::unique_ptr<char, void (*)(void *)> demangled(abi::__cxa_demangle(command.name(), nullptr, nullptr, &status),
+                                                      std::free);
+    std::string name = status == 0 ? demangled.get() : command.name();
+    std::size_t colon = name.rfind("::");
+    return colon == std::string::npos ? name : name.substr(colon + 2);
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -0,0 +1,14 @@
+#include <afina/Storage.h>
+#include <afina/execute/Namespace.h>
+
+namespace Afina {
+namespace Execute {
+
+// See Namespace.h
+void Namespace::Execute(Storage &storage, const std::string &args, std::string &out) {
+    _selected = storage.Namespace(_name);
+    out = _selected ? "OK" : "NOT_FOUND";
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -0,0 +1,19 @@
+#include <afina/Storage.h>
+#include <afina/execute/Prepend.h>
+#include <afina/logging/Trace.h>
+
+namespace Afina {
+namespace Execute {
+
+// memcached protocol: "prepend" means "add this data to an existing key before existing data".
+void Prepend::Execute(Storage &storage, const std::string &args, std::string &out) {
+    AFINA_TRACE_DEBUG("Prepend({}): {} bytes", _key, args.size());
+    bool stored = Update(storage, _key, _hash, [&args](std::string &value) {
+        value.insert(0, args);
+        return true;
+    });
+    out.assign(stored ? "STORED" : "NOT_STORED");
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -1,7 +1,6 @@
 #include <afina/Storage.h>
 #include <afina/execute/Replace.h>
-
-#include <iostream>
+#include <afina/logging/Trace.h>
 
 namespace Afina {
 namespace Execute {
@@ -10,14 +9,9 @@ namespace Execute {
 // already hold data for this key".
 
 void Replace::Execute(Storage &storage, const std::string &args, std::string &out) {
-    std::cout << "Replace(" << _key << "): " << args << std::endl;
-    std::string value;
-    if (storage.Get(_key, value)) {
-        storage.Set(_key, args);
-        out = "STORED";
-    } else {
-        out = "NOT_STORED";
-    }
+    AFINA_TRACE_DEBUG("Replace({}): {} bytes", _key, args.size());
+    // Storage::Set checks for the key and stores under the same lock, so that concurrent delete can't slip in
+    out = storage.Set(_key, _hash, args, _attributes()) ? "STORED" : "NOT_STORED";
 }
 
 } // namespace Execute
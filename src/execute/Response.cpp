@@ -0,0 +1,122 @@
+#include <afina/execute/Response.h>
+
+#include <cstring>
+
+namespace Afina {
+namespace Execute {
+
+namespace {
+
+// Pairs of digits "00" to "99", numbers are formatted two digits at a time
+const char DigitPairs[] = "00010203040506070809"
+                          "10111213141516171819"
+                          "20212223242526272829"
+                          "30313233343536373839"
+                          "40414243444546474849"
+                          "50515253545556575859"
+                          "60616263646566676869"
+                          "70717273747576777879"
+                          "80818283848586878889"
+                          "90919293949596979899";
+
+} // namespace
+
+constexpr std::size_t Response::CopyLimit;
+
+// See Response.h
+void Response::Append(const char *data, std::size_t size) {
+    if (size == 0) {
+        return;
+    }
+    std::size_t offset = _buffer.size();
+    _buffer.append(data, size);
+    _size += size;
+
+    // Joins the previous piece if that one ends the buffer
+    if (!_pieces.empty()) {
+        piece &last = _pieces.back();
+        if (last.data == nullptr && last.offset + last.size == offset) {
+            last.size += size;
+            return;
+        }
+    }
+    _pieces.push_back(piece{nullptr, offset, size});
+}
+
+// See Response.h
+void Response::AppendDecimal(uint64_t value) {
+    char digits[20];
+    char *end = digits + sizeof(digits);
+    char *p = end;
+    while (value >= 100) {
+        const char *pair = DigitPairs + (value % 100) * 2;
+        value /= 100;
+        *--p = pair[1];
+        *--p = pair[0];
+    }
+    if (value >= 10) {
+        const char *pair = DigitPairs + value * 2;
+        *--p = pair[1];
+        *--p = pair[0];
+    } else {
+        *--p = char('0' + value);
+    }
+    Append(p, end - p);
+}
+
+// See Response.h
+void Response::Reference(const char *data, std::size_t size, std::shared_ptr<const void> owner) {
+    if (size < CopyLimit || !owner) {
+        Append(data, size);
+        return;
+    }
+    if (_owners.empty() || _owners.back() != owner) {
+        _owners.push_back(std::move(owner));
+    }
+    _pieces.push_back(piece{data, 0, size});
+    _size += size;
+}
+
+// See Response.h
+void Response::Flush() {
+    if (_sink) {
+        _sink(*this);
+        _flushes++;
+    }
+}
+
+// See Response.h
+void Response::CopyTo(std::string &out) const {
+    out.clear();
+    out.reserve(_size);
+    ForEachPiece([&out](const char *data, std::size_t size) { out.append(data, size); });
+}
+
+// See Response.h
+void Response::Truncate(const Mark &mark) {
+    if (mark.flushes != _flushes) {
+        Clear();
+        return;
+    }
+    // Owners of the dropped pieces are released with the rest on Clear
+    _pieces.resize(mark.pieces);
+    _buffer.resize(mark.buffer);
+    _size = mark.size;
+    if (!_pieces.empty()) {
+        piece &last = _pieces.back();
+        if (last.data == nullptr && last.offset + last.size > mark.buffer) {
+            last.size = mark.buffer - last.offset;
+        }
+    }
+}
+
+// See Response.h
+void Response::Clear() {
+    _buffer.clear();
+    _pieces.clear();
+    _owners.clear();
+    _size = 0;
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -1,16 +1,33 @@
+#include <afina/ChunkedValue.h>
 #include <afina/Storage.h>
 #include <afina/execute/Set.h>
-
-#include <iostream>
+#include <afina/logging/Trace.h>
 
 namespace Afina {
 namespace Execute {
 
 // memcached protocol: "set" means "store this data".
 void Set::Execute(Storage &storage, const std::string &args, std::string &out) {
-    std::cout << "Set(" << _key << "): " << args << std::endl;
-    storage.Put(_key, args);
-    out = "STORED";
+    bool stored;
+    if (_body) {
+        AFINA_TRACE_DEBUG("Set({}): {} bytes", _key, _body->size());
+        stored = storage.PutChunked(_key, _hash, std::move(_body), _attributes());
+        _body.reset();
+    } else {
+        AFINA_TRACE_DEBUG("Set({}): {} bytes", _key, args.size());
+        stored = storage.Put(_key, _hash, args, _attributes());
+    }
+    // Unconditional put fails only if item doesn't fit into the storage at all
+    out = stored ? "STORED" : "SERVER_ERROR object too large for cache";
+}
+
+// See Set.h
+std::shared_ptr<ChunkedValue> Set::Reserve(std::size_t size) {
+    _body.reset();
+    if (size > ChunkedValue::ChunkSize) {
+        _body = std::make_shared<ChunkedValue>(size);
+    }
+    return _body;
 }
 
 } // namespace Execute
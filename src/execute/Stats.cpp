@@ -1,14 +1,88 @@
 #include <afina/Storage.h>
+#include <afina/execute/Metrics.h>
 #include <afina/execute/Stats.h>
 
-#include <iostream>
-#include <iterator>
-#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace Afina {
 namespace Execute {
 
-void Stats::Execute(Storage &storage, const std::string &args, std::string &out) { out.assign("END"); }
+// See Stats.h
+Stats::Stats(const std::string &group) : _group(group) {
+    if (!Known(group)) {
+        throw std::runtime_error("Unknown stats group: " + group);
+    }
+}
+
+/* memcached protocol:
+
+Upon receiving the "stats" command without arguments server sends a number of lines like
+
+STAT <name> <value>\r\n
+
+The server terminates this list with the line
+
+END\r\n
+
+"stats <args>" reports the given group of statistic the same way
+
+*/
+void Stats::Execute(Storage &storage, const std::string &args, std::string &out) {
+    std::vector<std::pair<std::string, std::string>> stats;
+    Collect(storage, _group, stats);
+
+    out.clear();
+    for (auto &stat : stats) {
+        out.append("STAT ").append(stat.first).append(" ").append(stat.second).append("\r\n");
+    }
+    out.append("END"); // networking layer should add the last \r\n
+}
+
+// See Stats.h
+bool Stats::Known(const std::string &group) { return group.empty() || group == "commands" || group == "latency"; }
+
+// See Stats.h
+void Stats::Collect(Storage &storage, const std::string &group,
+                    std::vector<std::pair<std::string, std::string>> &stats) {
+    Metrics::Snapshot metrics;
+    Metrics::Collect(metrics);
+    auto stat = [&stats](const std::string &name, uint64_t value) {
+        stats.emplace_back(name, std::to_string(value));
+    };
+
+    if (group.empty()) {
+        storage.Stats(stats);
+        uint64_t opened = metrics.Get(Metrics::Counter::ConnectionsOpened);
+        stat("curr_connections", opened - metrics.Get(Metrics::Counter::ConnectionsClosed));
+        stat("total_connections", opened);
+        stat("get_hits", metrics.Get(Metrics::Counter::GetHits));
+        stat("get_misses", metrics.Get(Metrics::Counter::GetMisses));
+        stat("bytes_read", metrics.Get(Metrics::Counter::BytesRead));
+        stat("bytes_written", metrics.Get(Metrics::Counter::BytesWritten));
+    } else if (group == "commands") {
+        for (auto &command : metrics.commands) {
+            const Metrics::Latency &latency = command.second;
+            stat(command.first + ":count", latency.count);
+            stat(command.first + ":total_ns", latency.sum_ns);
+            stat(command.first + ":mean_ns", latency.sum_ns / latency.count);
+            stat(command.first + ":max_ns", latency.max_ns);
+        }
+    } else if (group == "latency") {
+        static const std::pair<const char *, double> percentiles[] = {
+            {":p50_ns", 0.5}, {":p90_ns", 0.9}, {":p99_ns", 0.99}, {":p999_ns", 0.999}};
+        for (auto &command : metrics.commands) {
+            for (auto &percentile : percentiles) {
+                stat(command.first + percentile.first, command.second.Percentile(percentile.second));
+            }
+            stat(command.first + ":max_ns", command.second.max_ns);
+        }
+    } else {
+        throw std::runtime_error("Unknown stats group: " + group);
+    }
+}
 
 } // namespace Execute
 } // namespace Afina
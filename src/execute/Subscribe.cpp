@@ -0,0 +1,76 @@
+#include <afina/ChangeStream.h>
+#include <afina/Storage.h>
+#include <afina/execute/Subscribe.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace Afina {
+namespace Execute {
+
+constexpr std::size_t Subscribe::BatchSize;
+
+// See Subscribe.h
+void Subscribe::Execute(Storage &storage, const std::string &args, std::string &out) {
+    // Subscription never ends by itself, so that there is no response to collect
+    out = "SERVER_ERROR subscribe requires streaming connection";
+}
+
+// See Subscribe.h
+void Subscribe::Execute(Storage &storage, const std::string &args, Response &out) {
+    std::shared_ptr<ChangeStream> changes = storage.Changes();
+    if (!changes) {
+        out.Append("SERVER_ERROR storage doesn't publish changes");
+        return;
+    }
+
+    ChangeStream::Subscriber subscriber(changes);
+    out.Append("SUBSCRIBED\r\n");
+    out.Flush();
+
+    // Idle subscriber backs off, but still flushes often enough to notice that server stops or client has gone
+    const std::chrono::milliseconds min_idle(1), max_idle(100);
+    std::chrono::milliseconds idle = min_idle;
+    std::vector<ChangeStream::Event> events;
+    while (true) {
+        events.clear();
+        subscriber.Poll(events, BatchSize);
+        uint64_t dropped = subscriber.TakeDropped();
+
+        if (dropped > 0) {
+            out.Append("DROPPED ");
+            out.AppendDecimal(dropped);
+            out.Append("\r\n");
+        }
+        for (auto &event : events) {
+            out.Append(ChangeStream::TypeName(event.type));
+            out.Append(' ');
+            out.Append(event.key);
+            out.Append(' ');
+            out.AppendDecimal(event.value_size);
+            out.Append(' ');
+            out.AppendDecimal(event.shard);
+            out.Append(' ');
+            out.AppendDecimal(event.sequence);
+            if (event.truncated) {
+                out.Append(" TRUNCATED");
+            }
+            out.Append("\r\n");
+        }
+
+        bool quiet = out.empty();
+        out.Flush();
+
+        if (quiet) {
+            std::this_thread::sleep_for(idle);
+            idle = std::min(idle * 2, max_idle);
+        } else {
+            idle = min_idle;
+        }
+    }
+}
+
+} // namespace Execute
+} // namespace Afina
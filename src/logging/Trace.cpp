@@ -0,0 +1,19 @@
+#include <afina/logging/Trace.h>
+
+namespace Afina {
+namespace Logging {
+
+std::shared_ptr<spdlog::logger> Trace::_owner;
+std::atomic<spdlog::logger *> Trace::_logger(nullptr);
+std::atomic<uint32_t> Trace::_every(1);
+thread_local uint32_t Trace::_skipped = 0;
+
+// See Trace.h
+void Trace::Install(std::shared_ptr<spdlog::logger> logger, uint32_t every) {
+    _every.store(every > 0 ? every : 1, std::memory_order_relaxed);
+    _logger.store(logger.get(), std::memory_order_release);
+    _owner = std::move(logger);
+}
+
+} // namespace Logging
+} // namespace Afina
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <memory>
@@ -9,9 +10,11 @@
 
 #include <cxxopts.hpp>
 
+#include <afina/ChangeStream.h>
 #include <afina/Storage.h>
 #include <afina/Version.h>
 #include <afina/logging/Service.h>
+#include <afina/logging/Trace.h>
 #include <afina/network/Server.h>
 
 #include "logging/ServiceImpl.h"
@@ -21,7 +24,12 @@
 #include "network/st_coroutine/ServerImpl.h"
 #include "network/st_nonblocking/ServerImpl.h"
 
+#include "storage/DumpLoader.h"
+#include "storage/LeasedStorage.h"
+#include "storage/NamespacedStorage.h"
+#include "storage/RssMonitor.h"
 #include "storage/SimpleLRU.h"
+#include "storage/SizeClassLRU.h"
 #include "storage/StripedLRU.h"
 #include "storage/ThreadSafeSimpleLRU.h"
 
@@ -44,6 +52,28 @@ public:
         logger.level = Logging::Logger::Level::WARNING;
         logger.appenders.push_back("console");
         logger.format = "[%H:%M:%S %z] [thread %t] [%n] [%l] %v";
+
+        // Commands are traced by own logger, every N'th one: --trace debug:1000
+        if (options.count("trace") > 0) {
+            std::string trace = options["trace"].as<std::string>();
+            std::size_t colon = trace.find(':');
+            std::string level = trace.substr(0, colon);
+            traceEvery = colon == std::string::npos ? 1 : std::stoul(trace.substr(colon + 1));
+            if (traceEvery == 0) {
+                throw std::runtime_error("Trace sampling must be positive");
+            }
+
+            Logging::Logger &tracer = logConfig->loggers["trace"];
+            if (level == "debug") {
+                tracer.level = Logging::Logger::Level::DEBUG;
+            } else if (level == "trace") {
+                tracer.level = Logging::Logger::Level::TRACE;
+            } else {
+                throw std::runtime_error("Unknown trace level");
+            }
+            tracer.appenders.push_back("console");
+            tracer.format = logger.format;
+        }
         logService.reset(new Logging::ServiceImpl(logConfig));
 
         // Step 1: configure storage
@@ -52,16 +82,90 @@ public:
             storage_type = options["storage"].as<std::string>();
         }
 
+        std::size_t memory = 0;
+        if (options.count("memory") > 0) {
+            memory = options["memory"].as<std::size_t>();
+        }
+
+        auto accounting = Afina::Backend::SimpleLRU::Accounting::Payload;
+        if (options.count("memory-accounting") > 0) {
+            std::string accounting_type = options["memory-accounting"].as<std::string>();
+            if (accounting_type == "footprint") {
+                accounting = Afina::Backend::SimpleLRU::Accounting::Footprint;
+            } else if (accounting_type == "rss") {
+                if (memory == 0) {
+                    throw std::runtime_error("RSS accounting requires memory limit");
+                }
+                accounting = Afina::Backend::SimpleLRU::Accounting::Rss;
+                rssMonitor = std::make_shared<Afina::Backend::RssMonitor>(memory);
+            } else if (accounting_type != "payload") {
+                throw std::runtime_error("Unknown memory accounting type");
+            }
+        }
+
+        auto policy = Afina::Backend::SimpleLRU::Policy::Lru;
+        if (options.count("eviction") > 0) {
+            std::string eviction_type = options["eviction"].as<std::string>();
+            if (eviction_type == "gdsf") {
+                policy = Afina::Backend::SimpleLRU::Policy::Gdsf;
+            } else if (eviction_type != "lru") {
+                throw std::runtime_error("Unknown eviction policy");
+            }
+        }
+
         if (storage_type == "st_lru") {
-            storage = std::make_shared<Afina::Backend::SimpleLRU>();
+            storage =
+                std::make_shared<Afina::Backend::SimpleLRU>(memory ? memory : 1024, accounting, rssMonitor, policy);
         } else if (storage_type == "mt_lru") {
-            storage = std::make_shared<Afina::Backend::ThreadSafeSimplLRU>();
+            storage = std::make_shared<Afina::Backend::ThreadSafeSimplLRU>(memory ? memory : 1024, accounting,
+                                                                           rssMonitor, policy);
         } else if (storage_type == "mt_slru") {
-            storage.reset(Afina::Backend::buildStripeStorage(4, 8*2*1024*1024)); // shards_count
+            storage.reset(Afina::Backend::buildStripeStorage(4, memory ? memory : 8 * 2 * 1024 * 1024, accounting,
+                                                             rssMonitor, policy)); // shards_count
+        } else if (storage_type == "mt_sclru") {
+            if (policy != Afina::Backend::SimpleLRU::Policy::Lru) {
+                throw std::runtime_error("Size class storage supports lru eviction only");
+            }
+            storage = std::make_shared<Afina::Backend::SizeClassLRU>(memory ? memory : 8 * 2 * 1024 * 1024, accounting,
+                                                                     rssMonitor);
+        } else if (storage_type == "mt_nslru") {
+            std::vector<Afina::Backend::NamespacedStorage::Config> namespaces;
+            if (options.count("namespaces") > 0) {
+                namespaces = Afina::Backend::NamespacedStorage::ParseConfig(options["namespaces"].as<std::string>());
+            }
+            storage = std::make_shared<Afina::Backend::NamespacedStorage>(memory ? memory : 8 * 2 * 1024 * 1024,
+                                                                          namespaces, accounting, rssMonitor, policy);
         } else {
             throw std::runtime_error("Unknown storage type");
         }
 
+        // Leases are served by the table in front of any storage
+        if (options.count("lease-time") > 0) {
+            std::chrono::milliseconds lease_time(options["lease-time"].as<unsigned>());
+            storage = std::make_shared<Afina::Backend::LeasedStorage>(storage, lease_time);
+        }
+
+        // Change stream gets configured before storage is used by anyone
+        if (options.count("changes") > 0) {
+            auto changes = std::make_shared<Afina::ChangeStream>(options["changes"].as<std::size_t>());
+            if (!storage->Publish(changes)) {
+                throw std::runtime_error("Storage doesn't support change stream");
+            }
+        }
+
+        // Dump is loaded on start, before network accepts anything
+        if (options.count("load") > 0) {
+            dumpPath = options["load"].as<std::string>();
+            loadThreads = std::max(1u, std::thread::hardware_concurrency());
+            if (options.count("load-threads") > 0) {
+                loadThreads = options["load-threads"].as<unsigned>();
+            }
+            if (storage_type == "st_lru") {
+                // Storage has no synchronization at all
+                loadThreads = 1;
+            }
+        }
+
         // Step 2: Configure network
         std::string network_type = "st_block";
         if (options.count("network") > 0) {
@@ -90,8 +194,26 @@ public:
         log->warn("Start afina server {}", Afina::get_version());
 
         log->warn("Start storage");
+        if (rssMonitor) {
+            rssMonitor->Start();
+        }
         storage->Start();
 
+        if (!dumpPath.empty()) {
+            log->warn("Load {} with {} threads", dumpPath, loadThreads);
+            auto started = std::chrono::steady_clock::now();
+            auto loaded = Afina::Backend::DumpLoader(storage, loadThreads).Load(dumpPath);
+            auto elapsed =
+                std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+            log->warn("Loaded {} of {} records ({} bytes) in {} ms", loaded.stored, loaded.records, loaded.bytes,
+                      elapsed.count());
+        }
+
+        if (traceEvery > 0) {
+            log->warn("Trace every {} command", traceEvery);
+            Logging::Trace::Install(logService->select("trace"), traceEvery);
+        }
+
         // TODO: configure network service
         const uint16_t port = 8080;
         log->warn("Start network on {}", port);
@@ -106,6 +228,28 @@ public:
         server->Join();
 
         storage->Stop();
+        if (rssMonitor) {
+            rssMonitor->Stop();
+        }
+
+        // Let operator know if storage has an advice about its configuration, for example
+        // striped storage could suggest better stripes count based on observed lock contention
+        std::vector<std::pair<std::string, std::string>> stats;
+        storage->Stats(stats);
+
+        std::string stripe_count, stripe_recommended;
+        for (auto &stat : stats) {
+            if (stat.first == "stripe_count") {
+                stripe_count = stat.second;
+            } else if (stat.first == "stripe_recommended") {
+                stripe_recommended = stat.second;
+            }
+        }
+        if (stripe_count != stripe_recommended) {
+            log->warn("Storage lock contention suggests {} stripes instead of {}", stripe_recommended, stripe_count);
+        }
+
+        Logging::Trace::Install(nullptr);
         logService->Stop();
     }
 
@@ -113,8 +257,16 @@ private:
     std::shared_ptr<Logging::Config> logConfig;
     std::shared_ptr<Logging::Service> logService;
 
+    std::shared_ptr<Afina::Backend::RssMonitor> rssMonitor;
     std::shared_ptr<Afina::Storage> storage;
     std::shared_ptr<Network::Server> server;
+
+    // Dump to warm storage up with, see DumpLoader.h
+    std::string dumpPath;
+    unsigned loadThreads = 1;
+
+    // Trace every N'th command, 0 if commands aren't traced, see Trace.h
+    unsigned long traceEvery = 0;
 };
 
 // Signal set that to notify application about time to stop
@@ -134,6 +286,21 @@ int main(int argc, char **argv) {
         // TODO: use custom cxxopts::value to print options possible values in help message
         // and simplify validation below
         options.add_options()("s,storage", "Type of storage service to use", cxxopts::value<std::string>());
+        options.add_options()("m,memory", "Storage size limit in bytes", cxxopts::value<std::size_t>());
+        options.add_options()("memory-accounting", "What counts against the memory limit: payload, footprint, rss",
+                              cxxopts::value<std::string>());
+        options.add_options()("eviction", "Eviction policy: lru, gdsf", cxxopts::value<std::string>());
+        options.add_options()("lease-time", "Enable leases for lget/lset, lease lifetime in milliseconds",
+                              cxxopts::value<unsigned>());
+        options.add_options()("namespaces", "Namespaces of mt_nslru storage: name=quota[:hard],...",
+                              cxxopts::value<std::string>());
+        options.add_options()("changes", "Publish changes for subscribers, events kept per storage shard",
+                              cxxopts::value<std::size_t>());
+        options.add_options()("load", "Dump to load into storage on start: binary or memcached set commands",
+                              cxxopts::value<std::string>());
+        options.add_options()("load-threads", "Number of threads loading the dump", cxxopts::value<unsigned>());
+        options.add_options()("trace", "Trace commands: debug or trace level, optionally sampled as level:every",
+                              cxxopts::value<std::string>());
         options.add_options()("n,network", "Type of network service to use", cxxopts::value<std::string>());
         options.add_options()("h,help", "Print usage info");
         options.parse(argc, argv);
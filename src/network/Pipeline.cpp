@@ -0,0 +1,259 @@
+#include "Pipeline.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <typeinfo>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <spdlog/logger.h>
+
+#include <afina/ChunkedValue.h>
+#include <afina/Storage.h>
+#include <afina/execute/Metrics.h>
+
+namespace Afina {
+namespace Network {
+
+constexpr std::size_t Pipeline::MaxGathered;
+
+// See Pipeline.h
+Pipeline::Pipeline(int socket, std::shared_ptr<Afina::Storage> storage, std::shared_ptr<spdlog::logger> logger,
+                   const std::atomic<bool> &running)
+    : _socket(socket), _storage(std::move(storage)), _logger(std::move(logger)), _running(running),
+      _arg_remains(0), _response([this](Execute::Response &) {
+          // Flush by long running command
+          _flush();
+          if (!_running.load()) {
+              throw std::runtime_error("Server is stopping");
+          }
+          if (_hung_up()) {
+              throw std::runtime_error("Client has gone");
+          }
+      }) {
+    Execute::Metrics::Add(Execute::Metrics::Counter::ConnectionsOpened);
+}
+
+// See Pipeline.h
+Pipeline::~Pipeline() { Execute::Metrics::Add(Execute::Metrics::Counter::ConnectionsClosed); }
+
+// See Pipeline.h
+void Pipeline::Process(const char *data, std::size_t size) {
+    Execute::Metrics::Add(Execute::Metrics::Counter::BytesRead, size);
+
+    // Protocol is chosen by the very first byte of the connection
+    if (!_codec && size > 0) {
+        _codec = Protocol::Codec::Detect(data[0]);
+    }
+
+    // Single block of data readed from the socket could complete a number of commands, for example:
+    // - read#0: [<command1 start>]
+    // - read#1: [<command1 end> <argument> <command2> <argument for command 2> <command3> ... ]
+    while (size > 0) {
+        _logger->debug("Process {} bytes", size);
+        // There is no command yet
+        if (!_current.command) {
+            std::size_t parsed = 0;
+            if (_codec->Parse(data, size, parsed)) {
+                _logger->debug("Found new command: {} in {} bytes", _codec->Name(), parsed);
+                _current.command = _codec->Build(_arg_remains);
+                if (_arg_remains > 0) {
+                    // Small blocks are collected into argument anyway, storage rejects them itself
+                    bool oversized = _arg_remains > ChunkedValue::ChunkSize && _arg_remains > _storage->MaxItemSize();
+                    _current.command->Oversized(oversized);
+                    if (!oversized) {
+                        _current.body = _current.command->Reserve(_arg_remains);
+                    }
+                    _arg_remains += _codec->BodyTrailer();
+                }
+            }
+
+            // Parsed might fails to consume any bytes from input stream. In real life that could happens,
+            // for example, because we are working with UTF-16 chars and only 1 byte left in stream
+            if (parsed == 0) {
+                break;
+            }
+            data += parsed;
+            size -= parsed;
+        }
+
+        // There is command, but we still wait for argument to arrive...
+        if (_current.command && _arg_remains > 0) {
+            _logger->debug("Fill argument: {} bytes of {}", size, _arg_remains);
+            std::size_t to_read = std::min(_arg_remains, size);
+            ChunkedValue *body = _current.body.get();
+            if (_current.command->Oversized()) {
+                // Skipped as it arrives, command reports the error
+            } else if (body != nullptr && data == body->Room()) {
+                // Read right into the value, see ReadBuffer
+                body->Filled(to_read);
+            } else if (body != nullptr && !body->Full()) {
+                to_read = body->Fill(data, to_read);
+            } else {
+                _current.argument.append(data, to_read);
+            }
+            data += to_read;
+            size -= to_read;
+            _arg_remains -= to_read;
+        }
+
+        // There is command & argument, it joins the batch
+        if (_current.command && _arg_remains == 0) {
+            if (_current.argument.size()) {
+                _current.argument.resize(_current.argument.size() - _codec->BodyTrailer());
+            }
+            _batch.push_back(std::move(_current));
+            _current.command.reset();
+            _current.argument.clear();
+            _current.body.reset();
+            _codec->Reset();
+        }
+    }
+
+    _run();
+}
+
+// See Pipeline.h
+std::pair<char *, std::size_t> Pipeline::ReadBuffer(char *buffer, std::size_t size) const {
+    if (_current.body && !_current.body->Full()) {
+        return std::make_pair(_current.body->Room(), _current.body->RoomSize());
+    }
+    return std::make_pair(buffer, size);
+}
+
+// See Pipeline.h
+void Pipeline::_run() {
+    if (_batch.empty()) {
+        return;
+    }
+    _logger->debug("Run batch of {} commands", _batch.size());
+
+    std::size_t prefetched = 0;
+    for (std::size_t i = 0; i < _batch.size(); i++) {
+        if (i >= prefetched) {
+            prefetched = _prefetch(i);
+        }
+
+        Execute::Command &command = *_batch[i].command;
+        Execute::Response::Mark mark = _response.Position();
+        auto started = std::chrono::steady_clock::now();
+        command.Execute(*_storage, _batch[i].argument, _response);
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started);
+        if (const char *name = command.Metric()) {
+            Execute::Metrics::Record(name, elapsed.count());
+        } else {
+            Execute::Metrics::Record(typeid(command), elapsed.count());
+        }
+
+        // Respond, unless client asked not to
+        if (command.NoReply()) {
+            _response.Truncate(mark);
+        } else {
+            _codec->EndResponse(_response);
+        }
+        if (_response.size() >= MaxGathered) {
+            _flush();
+        }
+
+        // Command might switch connection to other namespace
+        if (auto selected = command.Selected()) {
+            _storage = selected;
+        }
+    }
+
+    // Codec might reuse commands for the next batch
+    for (auto &done : _batch) {
+        _codec->Recycle(std::move(done.command));
+    }
+    _batch.clear();
+    _flush();
+}
+
+// See Pipeline.h
+std::size_t Pipeline::_prefetch(std::size_t from) {
+    // Lookup of the previous batch is reused once commands which got it are gone
+    if (!_lookup || _lookup.use_count() > 1) {
+        _lookup = std::make_shared<Execute::Command::Prefetch>();
+    }
+    auto &lookup = *_lookup;
+    lookup.Clear();
+    _offsets.clear();
+
+    std::size_t end = from;
+    for (; end < _batch.size(); end++) {
+        std::size_t offset = lookup.keys.size();
+        if (!_batch[end].command->Reads(lookup)) {
+            break;
+        }
+        _offsets.push_back(offset);
+    }
+
+    // Single key is not worth a batch
+    if (lookup.keys.size() < 2) {
+        return end;
+    }
+    _storage->GetMany(lookup.keys, lookup.hashes, lookup.values, lookup.chunks, lookup.versions, lookup.attributes,
+                      lookup.found);
+    for (std::size_t i = from; i < end; i++) {
+        _batch[i].command->Prefetched(_lookup, _offsets[i - from]);
+    }
+    return end;
+}
+
+// See Pipeline.h
+bool Pipeline::_hung_up() const {
+    struct pollfd peer;
+    peer.fd = _socket;
+    peer.events = POLLRDHUP;
+    peer.revents = 0;
+    return poll(&peer, 1, 0) > 0 && (peer.revents & (POLLRDHUP | POLLHUP | POLLERR)) != 0;
+}
+
+// See Pipeline.h
+void Pipeline::_flush() {
+    _iov.clear();
+    _response.ForEachPiece([this](const char *data, std::size_t size) {
+        struct iovec piece;
+        piece.iov_base = const_cast<char *>(data);
+        piece.iov_len = size;
+        _iov.push_back(piece);
+    });
+
+    // Socket might accept large response in several calls, each call takes at most IOV_MAX pieces
+    std::size_t first = 0;
+    while (first < _iov.size()) {
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &_iov[first];
+        msg.msg_iovlen = std::min<std::size_t>(_iov.size() - first, IOV_MAX);
+
+        ssize_t sent = sendmsg(_socket, &msg, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            throw std::runtime_error("Failed to send response");
+        }
+        Execute::Metrics::Add(Execute::Metrics::Counter::BytesWritten, sent);
+        for (std::size_t left = sent; left > 0;) {
+            std::size_t taken = std::min(left, _iov[first].iov_len);
+            _iov[first].iov_base = static_cast<char *>(_iov[first].iov_base) + taken;
+            _iov[first].iov_len -= taken;
+            left -= taken;
+            if (_iov[first].iov_len == 0) {
+                first++;
+            }
+        }
+    }
+
+    _response.Clear();
+}
+
+} // namespace Network
+} // namespace Afina
@@ -0,0 +1,130 @@
+#ifndef AFINA_NETWORK_PIPELINE_H
+#define AFINA_NETWORK_PIPELINE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/uio.h>
+
+#include <afina/execute/Command.h>
+#include <afina/execute/Response.h>
+
+#include "protocol/Codec.h"
+
+namespace spdlog {
+class logger;
+}
+
+namespace Afina {
+
+class ChunkedValue;
+class Storage;
+
+namespace Network {
+
+/**
+ * # Pipelined commands of one connection
+ * Protocol side of the connection shared by the servers: turns data read from the socket into commands and
+ * sends responses back.
+ *
+ * Clients pipeline: one read often brings dozens of commands. All complete commands found in the block are
+ * parsed first and then run as a batch. Keys of consecutive reads are looked up with a single
+ * Storage::GetMany (see Execute::Command::Reads), so that each storage lock is taken once per batch rather
+ * than once per key; striped storages group keys by stripe. Commands still run in the order they came,
+ * anything but plain reads ends the group, so results are the same as if commands were run one by one.
+ *
+ * Responses of the whole batch are built in one Execute::Response and go out with a single gather write:
+ * headers are formatted in place, values are referenced as they are in the looked up batch or in the chunks
+ * of large values, so that value bytes are never copied on the way out. Commands which flush (see
+ * Execute::Response::Flush) get everything before them sent first.
+ *
+ * Execution time of each command, bytes and connections are accounted in Execute::Metrics.
+ *
+ * Not thread safe, belongs to the connection
+ */
+class Pipeline {
+public:
+    /**
+     * @param socket connection to answer to
+     * @param storage storage connection starts with, commands might switch it (see Storage::Namespace)
+     * @param running server flag, long running commands are interrupted once it gets reset
+     */
+    Pipeline(int socket, std::shared_ptr<Afina::Storage> storage, std::shared_ptr<spdlog::logger> logger,
+             const std::atomic<bool> &running);
+    ~Pipeline();
+
+    /**
+     * Handles block of data read from the socket: runs every complete command in it and sends their
+     * responses, incomplete tail is kept till the next block. Throws std::runtime_error if connection
+     * must be closed
+     */
+    void Process(const char *data, std::size_t size);
+
+    /**
+     * Where the next read from the socket should go: data block of a large value is read right into the
+     * buffer reserved for it (see Execute::Command::Reserve), anything else into the given buffer. Either
+     * way what is read is passed to Process
+     */
+    std::pair<char *, std::size_t> ReadBuffer(char *buffer, std::size_t size) const;
+
+    // Gathered response which is sent before the batch is over
+    static constexpr std::size_t MaxGathered = 256 * 1024;
+
+private:
+    struct pending {
+        std::unique_ptr<Execute::Command> command;
+        std::string argument;
+
+        // Data block taken in place, argument gets only its trailer then
+        std::shared_ptr<ChunkedValue> body;
+    };
+
+    // Runs commands parsed so far, in order
+    void _run();
+
+    // Looks up keys of consecutive reads starting from the given command, returns position after them
+    std::size_t _prefetch(std::size_t from);
+
+    // Sends gathered response
+    void _flush();
+
+    /**
+     * Client has closed the connection. Checked on flushes of long running commands (see Execute::Subscribe):
+     * idle ones send nothing, so that a failed send would never tell them
+     */
+    bool _hung_up() const;
+
+    const int _socket;
+    std::shared_ptr<Afina::Storage> _storage;
+    std::shared_ptr<spdlog::logger> _logger;
+    const std::atomic<bool> &_running;
+
+    // Protocol of the connection and parse state of the stream, chosen by the first byte
+    std::unique_ptr<Protocol::Codec> _codec;
+
+    // Command which body is being read and how many bytes of it are still to come
+    pending _current;
+    std::size_t _arg_remains;
+
+    // Complete commands of the block
+    std::vector<pending> _batch;
+
+    // Keys of consecutive reads and where keys of each command start there, see Execute::Command::Reads
+    std::shared_ptr<Execute::Command::Prefetch> _lookup;
+    std::vector<std::size_t> _offsets;
+
+    // Responses gathered so far
+    Execute::Response _response;
+
+    // Pieces of the response for the gather write
+    std::vector<struct iovec> _iov;
+};
+
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_PIPELINE_H
@@ -21,7 +21,7 @@
 #include <afina/Storage.h>
 #include <afina/logging/Service.h>
 
-#include "protocol/Parser.h"
+#include "network/Pipeline.h"
 
 namespace Afina {
 namespace Network {
@@ -101,11 +101,6 @@ void ServerImpl::Join() {
 
 // See Server.h
 void ServerImpl::OnRun() {
-    // Here is connection state
-    // - parser: parse state of the stream
-    // - command_to_execute: last command parsed out of stream
-    // - arg_remains: how many bytes to read from stream to get command argument
-    // - argument_for_command: buffer stores argument
     while (running.load()) {
         _logger->debug("waiting for connection...");
 
@@ -157,81 +152,19 @@ void ServerImpl::client_worker(int client_socket) {
 
     // Process new connection:
     // - read commands until socket alive
-    // - execute each command
-    // - send response
-    std::size_t arg_remains;
-    std::shared_ptr<Execute::Command> command_to_execute;
-    Protocol::Parser parser;
-    std::string argument_for_command;
+    // - execute all commands of each block read, see Pipeline
+    // - send their responses at once
     try {
+        Pipeline pipeline(client_socket, pStorage, _logger, running);
         int readed_bytes = -1;
         char client_buffer[4096];
-        while ((readed_bytes = read(client_socket, client_buffer, sizeof(client_buffer))) > 0) {
+        std::pair<char *, std::size_t> target(client_buffer, sizeof(client_buffer));
+        while ((readed_bytes = read(client_socket, target.first, target.second)) > 0) {
             _logger->debug("Got {} bytes from socket", readed_bytes);
+            pipeline.Process(target.first, readed_bytes);
 
-            // Single block of data readed from the socket could trigger inside actions a multiple times,
-            // for example:
-            // - read#0: [<command1 start>]
-            // - read#1: [<command1 end> <argument> <command2> <argument for command 2> <command3> ... ]
-            while (readed_bytes > 0) {
-                _logger->debug("Process {} bytes", readed_bytes);
-                // There is no command yet
-                if (!command_to_execute) {
-                    std::size_t parsed = 0;
-                    if (parser.Parse(client_buffer, readed_bytes, parsed)) {
-                        // There is no command to be launched, continue to parse input stream
-                        // Here we are, current chunk finished some command, process it
-                        _logger->debug("Found new command: {} in {} bytes", parser.Name(), parsed);
-                        command_to_execute = parser.Build(arg_remains);
-                        if (arg_remains > 0) {
-                            arg_remains += 2;
-                        }
-                    }
-
-                    // Parsed might fails to consume any bytes from input stream. In real life that could happens,
-                    // for example, because we are working with UTF-16 chars and only 1 byte left in stream
-                    if (parsed == 0) {
-                        break;
-                    } else {
-                        std::memmove(client_buffer, client_buffer + parsed, readed_bytes - parsed);
-                        readed_bytes -= parsed;
-                    }
-                }
-
-                // There is command, but we still wait for argument to arrive...
-                if (command_to_execute && arg_remains > 0) {
-                    _logger->debug("Fill argument: {} bytes of {}", readed_bytes, arg_remains);
-                    // There is some parsed command, and now we are reading argument
-                    std::size_t to_read = std::min(arg_remains, std::size_t(readed_bytes));
-                    argument_for_command.append(client_buffer, to_read);
-
-                    std::memmove(client_buffer, client_buffer + to_read, readed_bytes - to_read);
-                    arg_remains -= to_read;
-                    readed_bytes -= to_read;
-                }
-
-                // Thre is command & argument - RUN!
-                if (command_to_execute && arg_remains == 0) {
-                    _logger->debug("Start command execution");
-
-                    std::string result;
-                    if (argument_for_command.size()) {
-                        argument_for_command.resize(argument_for_command.size() - 2);
-                    }
-                    command_to_execute->Execute(*pStorage, argument_for_command, result);
-
-                    // Send response
-                    result += "\r\n";
-                    if (send(client_socket, result.data(), result.size(), 0) <= 0) {
-                        throw std::runtime_error("Failed to send response");
-                    }
-
-                    // Prepare for the next command
-                    command_to_execute.reset();
-                    argument_for_command.resize(0);
-                    parser.Reset();
-                }
-            } // while (readed_bytes)
+            // Data block of a large value is read right into its buffer
+            target = pipeline.ReadBuffer(client_buffer, sizeof(client_buffer));
         }
 
         if (readed_bytes == 0) {
@@ -239,7 +172,7 @@ void ServerImpl::client_worker(int client_socket) {
         } else {
             throw std::runtime_error(std::string(strerror(errno)));
         }
-    } catch (std::runtime_error &ex) {
+    } catch (std::exception &ex) {
         _logger->error("Failed to process connection on descriptor {}: {}", client_socket, ex.what());
     }
     close(client_socket);
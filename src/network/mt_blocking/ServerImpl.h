@@ -6,8 +6,6 @@
 #include <set>
 #include <thread>
 
-#include "protocol/Parser.h"
-#include <afina/execute/Command.h>
 #include <afina/network/Server.h>
 
 namespace spdlog {
@@ -1,25 +1,25 @@
 #include "Connection.h"
 
-#include <iostream>
+#include <afina/logging/Trace.h>
 
 namespace Afina {
 namespace Network {
 namespace MTnonblock {
 
 // See Connection.h
-void Connection::Start() { std::cout << "Start" << std::endl; }
+void Connection::Start() { AFINA_TRACE_TRACE("Start"); }
 
 // See Connection.h
-void Connection::OnError() { std::cout << "OnError" << std::endl; }
+void Connection::OnError() { AFINA_TRACE_TRACE("OnError"); }
 
 // See Connection.h
-void Connection::OnClose() { std::cout << "OnClose" << std::endl; }
+void Connection::OnClose() { AFINA_TRACE_TRACE("OnClose"); }
 
 // See Connection.h
-void Connection::DoRead() { std::cout << "DoRead" << std::endl; }
+void Connection::DoRead() { AFINA_TRACE_TRACE("DoRead"); }
 
 // See Connection.h
-void Connection::DoWrite() { std::cout << "DoWrite" << std::endl; }
+void Connection::DoWrite() { AFINA_TRACE_TRACE("DoWrite"); }
 
 } // namespace MTnonblock
 } // namespace Network
@@ -0,0 +1,493 @@
+#include "BinaryCommand.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <afina/ChunkedValue.h>
+#include <afina/Hash.h>
+#include <afina/Storage.h>
+#include <afina/execute/Metrics.h>
+#include <afina/execute/Stats.h>
+#include <afina/logging/Trace.h>
+
+namespace Afina {
+namespace Protocol {
+
+const uint8_t BinaryCommand::RequestMagic;
+const uint8_t BinaryCommand::ResponseMagic;
+const std::size_t BinaryCommand::HeaderSize;
+
+namespace {
+
+inline uint64_t ReadBig(const uint8_t *data, std::size_t size) {
+    uint64_t value = 0;
+    for (std::size_t i = 0; i < size; i++) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+inline void WriteBig(std::string &out, uint64_t value, std::size_t size) {
+    for (std::size_t i = size; i > 0; i--) {
+        out.push_back(char((value >> (8 * (i - 1))) & 0xff));
+    }
+}
+
+// Strict decimal form of 64 bit unsigned number, see Execute::Arithmetic
+bool ParseNumber(const std::string &value, uint64_t &number) {
+    if (value.empty() || value.size() > 20) {
+        return false;
+    }
+    number = 0;
+    for (char c : value) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        if (__builtin_mul_overflow(number, 10, &number) || __builtin_add_overflow(number, c - '0', &number)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const char *Description(BinaryCommand::Status status) {
+    switch (status) {
+    case BinaryCommand::Status::KeyNotFound:
+        return "Not found";
+    case BinaryCommand::Status::KeyExists:
+        return "Data exists for key";
+    case BinaryCommand::Status::ValueTooLarge:
+        return "Too large";
+    case BinaryCommand::Status::InvalidArguments:
+        return "Invalid arguments";
+    case BinaryCommand::Status::NotStored:
+        return "Not stored";
+    case BinaryCommand::Status::NonNumeric:
+        return "Non-numeric server-side value for incr or decr";
+    case BinaryCommand::Status::UnknownCommand:
+        return "Unknown command";
+    case BinaryCommand::Status::NotSupported:
+        return "Not supported";
+    default:
+        return "";
+    }
+}
+
+} // namespace
+
+// See BinaryCommand.h
+BinaryCommand::BinaryCommand(const uint8_t *header, std::string extras, std::string key)
+    : _opcode(Opcode(header[1])), _loud(Loud(Opcode(header[1]))), _opaque(uint32_t(ReadBig(header + 12, 4))),
+      _cas(ReadBig(header + 16, 8)), _extras(std::move(extras)), _key(std::move(key)), _hash(KeyHash(_key)),
+      _offset(0) {}
+
+// See BinaryCommand.h
+BinaryCommand::Opcode BinaryCommand::Loud(Opcode opcode) {
+    switch (opcode) {
+    case Opcode::GetQ:
+        return Opcode::Get;
+    case Opcode::GetKQ:
+        return Opcode::GetK;
+    case Opcode::SetQ:
+        return Opcode::Set;
+    case Opcode::AddQ:
+        return Opcode::Add;
+    case Opcode::ReplaceQ:
+        return Opcode::Replace;
+    case Opcode::DeleteQ:
+        return Opcode::Delete;
+    case Opcode::IncrementQ:
+        return Opcode::Increment;
+    case Opcode::DecrementQ:
+        return Opcode::Decrement;
+    case Opcode::QuitQ:
+        return Opcode::Quit;
+    case Opcode::FlushQ:
+        return Opcode::Flush;
+    case Opcode::AppendQ:
+        return Opcode::Append;
+    case Opcode::PrependQ:
+        return Opcode::Prepend;
+    default:
+        return opcode;
+    }
+}
+
+// See BinaryCommand.h
+const std::string &BinaryCommand::Name(Opcode opcode) {
+    // Indexed by opcode, gaps are unsupported ones
+    static const std::vector<std::string> names = {
+        "get",     "set",     "add",     "replace", "delete",  "incr",     "decr",    "quit",
+        "flush",   "getq",    "noop",    "version", "getk",    "getkq",    "append",  "prepend",
+        "stat",    "setq",    "addq",    "replaceq", "deleteq", "incrq",   "decrq",   "quitq",
+        "flushq",  "appendq", "prependq", "unknown", "touch"};
+    static const std::string unknown = "unknown";
+    std::size_t index = std::size_t(opcode);
+    return index < names.size() ? names[index] : unknown;
+}
+
+// See BinaryCommand.h
+void BinaryCommand::Execute(Storage &storage, const std::string &args, std::string &out) {
+    Execute::Response response;
+    Execute(storage, args, response);
+    response.CopyTo(out);
+}
+
+// See BinaryCommand.h
+void BinaryCommand::Execute(Storage &storage, const std::string &args, Execute::Response &response) {
+    AFINA_TRACE_DEBUG("Binary {}({})", Name(_opcode), _key);
+    if (Oversized()) {
+        // Value has been skipped, see Command::Oversized
+        _respond(response, Status::ValueTooLarge);
+        return;
+    }
+    bool quiet = _loud != _opcode;
+    Status status = Status::Success;
+    switch (_loud) {
+    case Opcode::Get:
+    case Opcode::GetK:
+        _get(storage, response);
+        return;
+
+    case Opcode::Set:
+    case Opcode::Add:
+    case Opcode::Replace:
+        _store(storage, args, response);
+        return;
+
+    case Opcode::Increment:
+    case Opcode::Decrement:
+        _arithmetic(storage, response);
+        return;
+
+    case Opcode::Stat:
+        _stat(storage, response);
+        return;
+
+    case Opcode::Append:
+    case Opcode::Prepend:
+        if (!_extras.empty() || _key.empty()) {
+            status = Status::InvalidArguments;
+        } else if (!Update(storage, _key, _hash, [this, &args](std::string &value) {
+                       if (_loud == Opcode::Append) {
+                           value.append(args);
+                       } else {
+                           value.insert(0, args);
+                       }
+                       return true;
+                   })) {
+            status = Status::NotStored;
+        }
+        break;
+
+    case Opcode::Delete:
+        if (!_extras.empty() || _key.empty()) {
+            status = Status::InvalidArguments;
+        } else if (!storage.Delete(_key, _hash)) {
+            status = Status::KeyNotFound;
+        }
+        break;
+
+    case Opcode::Touch:
+        // Extras are the new expiration
+        if (_extras.size() != 4 || _key.empty()) {
+            status = Status::InvalidArguments;
+        } else if (!storage.Touch(_key, _hash,
+                                  Deadline(ReadBig(reinterpret_cast<const uint8_t *>(_extras.data()), 4)))) {
+            status = Status::KeyNotFound;
+        }
+        break;
+
+    case Opcode::Flush:
+        if (!_extras.empty() &&
+            (_extras.size() != 4 || ReadBig(reinterpret_cast<const uint8_t *>(_extras.data()), 4) != 0)) {
+            // Delayed flush needs expiration, see Execute::FlushAll
+            status = Status::InvalidArguments;
+        } else if (!storage.Flush()) {
+            status = Status::NotSupported;
+        }
+        break;
+
+    case Opcode::Noop:
+        break;
+
+    default:
+        // Including quit: network layer can't close connection on behalf of the command, clients close it
+        // themselves anyway
+        quiet = false;
+        status = Status::UnknownCommand;
+    }
+
+    if (!quiet || status != Status::Success) {
+        _respond(response, status);
+    }
+}
+
+// See BinaryCommand.h
+void BinaryCommand::_get(Storage &storage, Execute::Response &response) const {
+    bool with_key = _loud == Opcode::GetK;
+    std::string own_value;
+    std::shared_ptr<const ChunkedValue> own_chunks;
+    uint64_t version = 0;
+    Storage::Attributes attributes;
+    if (!_extras.empty() || _key.empty()) {
+        _respond(response, Status::InvalidArguments);
+        return;
+    }
+
+    bool found;
+    if (_prefetch) {
+        found = _prefetch->found[_offset];
+        version = _prefetch->versions[_offset];
+        attributes = _prefetch->attributes[_offset];
+    } else {
+        found = storage.Get(_key, _hash, own_value, own_chunks, version, attributes);
+    }
+    const std::string &value = _prefetch ? _prefetch->values[_offset] : own_value;
+    const std::shared_ptr<const ChunkedValue> &chunks = _prefetch ? _prefetch->chunks[_offset] : own_chunks;
+    Execute::Metrics::Add(found ? Execute::Metrics::Counter::GetHits : Execute::Metrics::Counter::GetMisses);
+    if (!found) {
+        if (_loud == _opcode) {
+            _respond(response, Status::KeyNotFound, std::string(), with_key ? _key : std::string());
+        }
+        return;
+    }
+
+    // Extras are the flags of the item
+    std::size_t key_size = with_key ? _key.size() : 0;
+    std::size_t value_size = chunks ? chunks->size() : value.size();
+    std::string out;
+    out.reserve(HeaderSize + 4 + key_size + (chunks ? 0 : value_size));
+    _header(out, Status::Success, 4, uint16_t(key_size), uint32_t(4 + key_size + value_size), version);
+    WriteBig(out, attributes.flags, 4);
+    out.append(_key.data(), key_size);
+    if (!chunks) {
+        out.append(value);
+        response.Append(out);
+        return;
+    }
+
+    // Large value goes out as is, storage lock is released already
+    response.Append(out);
+    chunks->ForEachChunk([&response, &chunks](const char *data, std::size_t size) {
+        response.Reference(data, size, chunks);
+    });
+}
+
+// See BinaryCommand.h
+bool BinaryCommand::Reads(Prefetch &batch) const {
+    if ((_loud != Opcode::Get && _loud != Opcode::GetK) || !_extras.empty() || _key.empty()) {
+        return false;
+    }
+    batch.Add(_key, _hash);
+    return true;
+}
+
+// See BinaryCommand.h
+void BinaryCommand::Prefetched(std::shared_ptr<const Prefetch> batch, std::size_t offset) {
+    _prefetch = std::move(batch);
+    _offset = offset;
+}
+
+// See BinaryCommand.h
+const char *BinaryCommand::Metric() const {
+    switch (_loud) {
+    case Opcode::Get:
+        return "BinaryGet";
+    case Opcode::GetK:
+        return "BinaryGetK";
+    case Opcode::Set:
+        return "BinarySet";
+    case Opcode::Add:
+        return "BinaryAdd";
+    case Opcode::Replace:
+        return "BinaryReplace";
+    case Opcode::Append:
+        return "BinaryAppend";
+    case Opcode::Prepend:
+        return "BinaryPrepend";
+    case Opcode::Delete:
+        return "BinaryDelete";
+    case Opcode::Increment:
+        return "BinaryIncrement";
+    case Opcode::Decrement:
+        return "BinaryDecrement";
+    case Opcode::Touch:
+        return "BinaryTouch";
+    case Opcode::Flush:
+        return "BinaryFlush";
+    case Opcode::Noop:
+        return "BinaryNoop";
+    case Opcode::Stat:
+        return "BinaryStat";
+    default:
+        return nullptr;
+    }
+}
+
+// See BinaryCommand.h
+std::shared_ptr<ChunkedValue> BinaryCommand::Reserve(std::size_t size) {
+    if (_loud == Opcode::Set && _cas == 0 && _extras.size() == 8 && !_key.empty() && size > ChunkedValue::ChunkSize) {
+        _body = std::make_shared<ChunkedValue>(size);
+    }
+    return _body;
+}
+
+// See BinaryCommand.h
+void BinaryCommand::_store(Storage &storage, const std::string &value, Execute::Response &response) const {
+    Status status = Status::Success;
+    if (_extras.size() != 8 || _key.empty()) {
+        _respond(response, Status::InvalidArguments);
+        return;
+    }
+
+    // Extras are flags and expiration
+    const uint8_t *extras = reinterpret_cast<const uint8_t *>(_extras.data());
+    Storage::Attributes attributes(uint32_t(ReadBig(extras, 4)), Deadline(ReadBig(extras + 4, 4)));
+    if (_cas != 0) {
+        switch (_loud == Opcode::Add ? Storage::CasResult::Exists
+                                     : storage.CompareAndSet(_key, _hash, value, _cas, attributes)) {
+        case Storage::CasResult::Stored:
+            break;
+        case Storage::CasResult::Exists:
+            status = Status::KeyExists;
+            break;
+        case Storage::CasResult::NotFound:
+            status = Status::KeyNotFound;
+            break;
+        default:
+            status = Status::NotStored;
+        }
+    } else if (_loud == Opcode::Set) {
+        bool stored = _body ? storage.PutChunked(_key, _hash, _body, attributes)
+                            : storage.Put(_key, _hash, value, attributes);
+        if (!stored) {
+            status = Status::ValueTooLarge;
+        }
+    } else if (_loud == Opcode::Add) {
+        if (!storage.PutIfAbsent(_key, _hash, value, attributes)) {
+            status = Status::KeyExists;
+        }
+    } else if (!storage.Set(_key, _hash, value, attributes)) {
+        status = Status::KeyNotFound;
+    }
+
+    if (_loud == _opcode || status != Status::Success) {
+        _respond(response, status);
+    }
+}
+
+// See BinaryCommand.h
+void BinaryCommand::_arithmetic(Storage &storage, Execute::Response &response) const {
+    if (_extras.size() != 20 || _key.empty()) {
+        _respond(response, Status::InvalidArguments);
+        return;
+    }
+    const uint8_t *extras = reinterpret_cast<const uint8_t *>(_extras.data());
+    uint64_t delta = ReadBig(extras, 8);
+    uint64_t initial = ReadBig(extras + 8, 8);
+    uint32_t expiration = uint32_t(ReadBig(extras + 16, 4));
+
+    // Same rules as in the text protocol, see Execute::Arithmetic
+    bool numeric = true;
+    uint64_t result = 0;
+    auto modify = [this, delta, &numeric, &result](std::string &value) {
+        uint64_t current;
+        if (!ParseNumber(value, current)) {
+            numeric = false;
+            return false;
+        }
+        if (_loud == Opcode::Increment) {
+            result = current + delta;
+        } else {
+            result = current > delta ? current - delta : 0;
+        }
+        value = std::to_string(result);
+        return true;
+    };
+
+    // Missing item gets the initial value, unless expiration is all ones. Item created concurrently is updated
+    // on the second attempt
+    Status status = Status::NotStored;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (Update(storage, _key, _hash, modify)) {
+            status = Status::Success;
+            break;
+        }
+        if (!numeric) {
+            status = Status::NonNumeric;
+            break;
+        }
+        if (expiration == 0xffffffff) {
+            status = Status::KeyNotFound;
+            break;
+        }
+        if (storage.PutIfAbsent(_key, _hash, std::to_string(initial), Storage::Attributes(0, Deadline(expiration)))) {
+            result = initial;
+            status = Status::Success;
+            break;
+        }
+    }
+
+    if (status != Status::Success) {
+        _respond(response, status);
+    } else if (_loud == _opcode) {
+        std::string value;
+        WriteBig(value, result, 8);
+        _respond(response, status, std::string(), std::string(), value);
+    }
+}
+
+// See BinaryCommand.h
+void BinaryCommand::_stat(Storage &storage, Execute::Response &response) const {
+    // Key names the group, see Execute::Stats
+    if (!Execute::Stats::Known(_key)) {
+        _respond(response, Status::KeyNotFound);
+        return;
+    }
+
+    // One response per record, terminated by the empty one
+    std::vector<std::pair<std::string, std::string>> stats;
+    Execute::Stats::Collect(storage, _key, stats);
+    std::string out;
+    for (auto &stat : stats) {
+        _header(out, Status::Success, 0, uint16_t(stat.first.size()),
+                uint32_t(stat.first.size() + stat.second.size()), 0);
+        out.append(stat.first);
+        out.append(stat.second);
+    }
+    _header(out, Status::Success, 0, 0, 0, 0);
+    response.Append(out);
+}
+
+// See BinaryCommand.h
+void BinaryCommand::_header(std::string &out, Status status, uint8_t extras, uint16_t key, uint32_t body,
+                            uint64_t cas) const {
+    out.push_back(char(ResponseMagic));
+    out.push_back(char(_opcode));
+    WriteBig(out, key, 2);
+    out.push_back(char(extras));
+    out.push_back(0);
+    WriteBig(out, uint16_t(status), 2);
+    WriteBig(out, body, 4);
+    WriteBig(out, _opaque, 4);
+    WriteBig(out, cas, 8);
+}
+
+// See BinaryCommand.h
+void BinaryCommand::_respond(Execute::Response &response, Status status, const std::string &extras,
+                             const std::string &key, const std::string &value, uint64_t cas) const {
+    std::string body = status == Status::Success ? value : Description(status);
+    std::string out;
+    out.reserve(HeaderSize + extras.size() + key.size() + body.size());
+    _header(out, status, uint8_t(extras.size()), uint16_t(key.size()),
+            uint32_t(extras.size() + key.size() + body.size()), cas);
+    out.append(extras);
+    out.append(key);
+    out.append(body);
+    response.Append(out);
+}
+
+} // namespace Protocol
+} // namespace Afina
@@ -0,0 +1,156 @@
+#ifndef AFINA_PROTOCOL_BINARY_COMMAND_H
+#define AFINA_PROTOCOL_BINARY_COMMAND_H
+
+#include <cstdint>
+#include <string>
+
+#include <afina/execute/Command.h>
+
+namespace Afina {
+namespace Protocol {
+
+/**
+ * # Memcached binary protocol request
+ * Every request and response starts with 24 bytes header, all numbers are in network byte order:
+ *
+ * magic(1) opcode(1) key length(2) extras length(1) data type(1) vbucket or status(2) total body length(4)
+ * opaque(4) cas(8)
+ *
+ * followed by extras, key and value. Response echoes opcode and opaque of the request, so that client could
+ * match them when requests are pipelined.
+ *
+ * Quiet versions of commands (getq, setq, ...) respond only if there is something client can't guess:
+ * getq only on hit, the rest only on error. Client sends a bunch of them followed by noop, which always
+ * responds, so that multi get takes a single round trip.
+ *
+ * Flags and expiration are stored along with the value, flags come back in extras of get. Versions of items
+ * are sent as cas by get commands and checked by set, add and replace when request cas isn't 0, other commands
+ * report cas 0
+ */
+class BinaryCommand : public Execute::Command {
+public:
+    static const uint8_t RequestMagic = 0x80;
+    static const uint8_t ResponseMagic = 0x81;
+    static const std::size_t HeaderSize = 24;
+
+    enum class Opcode : uint8_t {
+        Get = 0x00,
+        Set = 0x01,
+        Add = 0x02,
+        Replace = 0x03,
+        Delete = 0x04,
+        Increment = 0x05,
+        Decrement = 0x06,
+        Quit = 0x07,
+        Flush = 0x08,
+        GetQ = 0x09,
+        Noop = 0x0a,
+        Version = 0x0b,
+        GetK = 0x0c,
+        GetKQ = 0x0d,
+        Append = 0x0e,
+        Prepend = 0x0f,
+        Stat = 0x10,
+        SetQ = 0x11,
+        AddQ = 0x12,
+        ReplaceQ = 0x13,
+        DeleteQ = 0x14,
+        IncrementQ = 0x15,
+        DecrementQ = 0x16,
+        QuitQ = 0x17,
+        FlushQ = 0x18,
+        AppendQ = 0x19,
+        PrependQ = 0x1a,
+        Touch = 0x1c
+    };
+
+    enum class Status : uint16_t {
+        Success = 0x0000,
+        KeyNotFound = 0x0001,
+        KeyExists = 0x0002,
+        ValueTooLarge = 0x0003,
+        InvalidArguments = 0x0004,
+        NotStored = 0x0005,
+        NonNumeric = 0x0006,
+        UnknownCommand = 0x0081,
+        NotSupported = 0x0083
+    };
+
+    /**
+     * @param header request header, HeaderSize bytes
+     * @param extras extras of the request
+     * @param key key of the request, hash is computed here
+     */
+    BinaryCommand(const uint8_t *header, std::string extras, std::string key);
+    ~BinaryCommand() {}
+
+    inline Opcode opcode() const { return _opcode; }
+    inline uint32_t opaque() const { return _opaque; }
+    inline uint64_t cas() const { return _cas; }
+    inline const std::string &key() const { return _key; }
+    inline const std::string &extras() const { return _extras; }
+
+    /**
+     * Non quiet version of the request opcode, the same opcode if there is no such
+     */
+    static Opcode Loud(Opcode opcode);
+
+    // Name of the opcode for logs, "unknown" if it isn't supported
+    static const std::string &Name(Opcode opcode);
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+    // Chunks of large values are referenced rather than copied, see Command.h
+    void Execute(Storage &storage, const std::string &args, Execute::Response &response) override;
+
+    // Value of plain set larger than a chunk goes to the storage as is, see Command.h
+    std::shared_ptr<ChunkedValue> Reserve(std::size_t size) override;
+
+    // Get family only, see Command.h
+    bool Reads(Prefetch &batch) const override;
+    void Prefetched(std::shared_ptr<const Prefetch> batch, std::size_t offset) override;
+
+    // Each supported opcode is accounted on its own, together with its quiet version (BinaryGet,
+    // BinarySet, ...), see Command.h
+    const char *Metric() const override;
+
+private:
+    // Writes response header
+    void _header(std::string &out, Status status, uint8_t extras, uint16_t key, uint32_t body, uint64_t cas) const;
+
+    // Writes the whole response, error ones get status description as the value
+    void _respond(Execute::Response &response, Status status, const std::string &extras = std::string(),
+                  const std::string &key = std::string(), const std::string &value = std::string(),
+                  uint64_t cas = 0) const;
+
+    void _get(Storage &storage, Execute::Response &response) const;
+    void _store(Storage &storage, const std::string &value, Execute::Response &response) const;
+    void _arithmetic(Storage &storage, Execute::Response &response) const;
+    void _stat(Storage &storage, Execute::Response &response) const;
+
+    // Opcode as it came in the request
+    const Opcode _opcode;
+
+    // Non quiet version of the opcode
+    const Opcode _loud;
+
+    const uint32_t _opaque;
+    const uint64_t _cas;
+    const std::string _extras;
+    const std::string _key;
+
+    // Hash of the key, see afina/Hash.h
+    const uint64_t _hash;
+
+    // Value taken in place, see Reserve
+    std::shared_ptr<ChunkedValue> _body;
+
+    // Key looked up already and its position there, see Command::Reads
+    std::shared_ptr<const Prefetch> _prefetch;
+    std::size_t _offset;
+};
+
+} // namespace Protocol
+} // namespace Afina
+
+#endif // AFINA_PROTOCOL_BINARY_COMMAND_H
@@ -0,0 +1,74 @@
+#include "BinaryParser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <afina/execute/Command.h>
+
+namespace Afina {
+namespace Protocol {
+
+// See BinaryParser.h
+bool BinaryParser::Parse(const char *input, const size_t size, size_t &parsed) {
+    size_t pos = 0;
+    parsed = 0;
+
+    if (!_complete && _header_size < BinaryCommand::HeaderSize) {
+        std::size_t take = std::min(size, BinaryCommand::HeaderSize - _header_size);
+        std::memcpy(_header + _header_size, input, take);
+        _header_size += take;
+        pos += take;
+        if (_header_size < BinaryCommand::HeaderSize) {
+            parsed = pos;
+            return false;
+        }
+
+        if (_header[0] != BinaryCommand::RequestMagic) {
+            throw std::runtime_error("Invalid magic of binary request: " + std::to_string(_header[0]));
+        }
+        _key_length = uint16_t((_header[2] << 8) | _header[3]);
+        _extras_length = _header[4];
+        _body_length = (uint32_t(_header[8]) << 24) | (uint32_t(_header[9]) << 16) | (uint32_t(_header[10]) << 8) |
+                       uint32_t(_header[11]);
+        if (std::size_t(_key_length) + _extras_length > _body_length) {
+            throw std::runtime_error("Key and extras don't fit into the body of binary request");
+        }
+        _extras_key.reserve(_key_length + _extras_length);
+    }
+
+    if (!_complete) {
+        std::size_t take = std::min(size - pos, _key_length + _extras_length - _extras_key.size());
+        _extras_key.append(input + pos, take);
+        pos += take;
+        _complete = _extras_key.size() == std::size_t(_key_length) + _extras_length;
+    }
+
+    parsed = pos;
+    return _complete;
+}
+
+// See BinaryParser.h
+std::unique_ptr<Execute::Command> BinaryParser::Build(size_t &body_size) const {
+    if (!_complete) {
+        return std::unique_ptr<Execute::Command>(nullptr);
+    }
+
+    body_size = _body_length - _key_length - _extras_length;
+    return std::unique_ptr<Execute::Command>(new BinaryCommand(
+        _header, _extras_key.substr(0, _extras_length), _extras_key.substr(_extras_length, _key_length)));
+}
+
+// See BinaryParser.h
+void BinaryParser::Reset() {
+    _header_size = 0;
+    _key_length = 0;
+    _extras_length = 0;
+    _body_length = 0;
+    _extras_key.clear();
+    _complete = false;
+    std::memset(_header, 0, sizeof(_header));
+}
+
+} // namespace Protocol
+} // namespace Afina
@@ -0,0 +1,64 @@
+#ifndef AFINA_PROTOCOL_BINARY_PARSER_H
+#define AFINA_PROTOCOL_BINARY_PARSER_H
+
+#include <memory>
+#include <string>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "BinaryCommand.h"
+#include "Codec.h"
+
+namespace Afina {
+namespace Protocol {
+
+/**
+ * # Memcached binary protocol parser
+ * Requests are framed by the lengths in their header, so that nothing is scanned for delimiters: parser
+ * collects the header, then extras and key. Value is left to the network layer as the command data block.
+ * See BinaryCommand for the protocol itself
+ */
+class BinaryParser : public Codec {
+public:
+    BinaryParser() { Reset(); }
+    ~BinaryParser() {}
+
+    // See Codec.h, throws std::runtime_error if request is malformed
+    bool Parse(const char *input, const size_t size, size_t &parsed) override;
+
+    // See Codec.h
+    std::unique_ptr<Execute::Command> Build(size_t &body_size) const override;
+
+    // See Codec.h
+    void Reset() override;
+
+    // See Codec.h
+    const std::string &Name() const override { return BinaryCommand::Name(BinaryCommand::Opcode(_header[1])); }
+
+    // Value is the last part of request, nothing follows it
+    std::size_t BodyTrailer() const override { return 0; }
+
+    // Commands write complete responses
+    void EndResponse(Execute::Response &out) const override {}
+
+private:
+    // Bytes of the header collected so far
+    uint8_t _header[BinaryCommand::HeaderSize];
+    std::size_t _header_size;
+
+    // Lengths from the header
+    uint16_t _key_length;
+    uint8_t _extras_length;
+    uint32_t _body_length;
+
+    // Extras followed by the key
+    std::string _extras_key;
+
+    bool _complete;
+};
+
+} // namespace Protocol
+} // namespace Afina
+
+#endif // AFINA_PROTOCOL_BINARY_PARSER_H
@@ -0,0 +1,28 @@
+#include "Codec.h"
+
+#include <afina/execute/Command.h>
+
+#include "BinaryCommand.h"
+#include "BinaryParser.h"
+#include "Parser.h"
+#include "RespParser.h"
+
+namespace Afina {
+namespace Protocol {
+
+// See Codec.h
+std::unique_ptr<Codec> Codec::Detect(char first) {
+    if (uint8_t(first) == BinaryCommand::RequestMagic) {
+        return std::unique_ptr<Codec>(new BinaryParser());
+    }
+    if (first == '*') {
+        return std::unique_ptr<Codec>(new RespParser());
+    }
+    return std::unique_ptr<Codec>(new Parser());
+}
+
+// See Codec.h
+void Codec::Recycle(std::unique_ptr<Execute::Command> command) {}
+
+} // namespace Protocol
+} // namespace Afina
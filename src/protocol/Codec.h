@@ -0,0 +1,78 @@
+#ifndef AFINA_PROTOCOL_CODEC_H
+#define AFINA_PROTOCOL_CODEC_H
+
+#include <memory>
+#include <string>
+
+#include <cstddef>
+
+namespace Afina {
+namespace Execute {
+class Command;
+class Response;
+} // namespace Execute
+namespace Protocol {
+
+/**
+ * # Wire protocol of a connection
+ * Splits client input into commands and frames their responses. Network layer picks implementation once per
+ * connection by the first byte client sends, see Detect
+ */
+class Codec {
+public:
+    virtual ~Codec() {}
+
+    /**
+     * Push given input into parser. Method returns true if it was a command parsed out from comulative
+     * input, in a such case method Build will return new command
+     *
+     * @param input string to be added to the parsed input
+     * @param size number of bytes in the input buffer that could be read
+     * @param parsed output parameter tells how many bytes was consumed from the input
+     * @return true if command has been parsed out
+     */
+    virtual bool Parse(const char *input, const size_t size, size_t &parsed) = 0;
+
+    /**
+     * Builds new command from parsed input, nullptr if command isn't complete yet
+     *
+     * @param body_size size of the data block which follows the command, without BodyTrailer
+     */
+    virtual std::unique_ptr<Execute::Command> Build(size_t &body_size) const = 0;
+
+    /**
+     * Reset parser so that it could be used to parse out new command
+     */
+    virtual void Reset() = 0;
+
+    /**
+     * Network layer gives commands back once they are executed, codec might reuse them for the next requests
+     * instead of allocating new ones
+     *
+     * Default implementation just releases the command
+     */
+    virtual void Recycle(std::unique_ptr<Execute::Command> command);
+
+    virtual const std::string &Name() const = 0;
+
+    /**
+     * Number of bytes which end the data block but are not part of it, network layer reads and drops them
+     */
+    virtual std::size_t BodyTrailer() const = 0;
+
+    /**
+     * Completes response written by the command. Not called for commands which asked for no reply
+     */
+    virtual void EndResponse(Execute::Response &out) const = 0;
+
+    /**
+     * Codec for the connection which input starts with the given byte: memcached binary requests start with
+     * the magic byte 0x80 and Redis ones with '*', neither starts memcached text command
+     */
+    static std::unique_ptr<Codec> Detect(char first);
+};
+
+} // namespace Protocol
+} // namespace Afina
+
+#endif // AFINA_PROTOCOL_CODEC_H
@@ -1,99 +1,196 @@
 #include "Parser.h"
 
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
+#include <typeinfo>
 
+#include <afina/Hash.h>
 #include <afina/execute/Add.h>
 #include <afina/execute/Append.h>
+#include <afina/execute/Arithmetic.h>
+#include <afina/execute/Cas.h>
 #include <afina/execute/Command.h>
 #include <afina/execute/Delete.h>
+#include <afina/execute/FlushAll.h>
 #include <afina/execute/Get.h>
+#include <afina/execute/Gets.h>
+#include <afina/execute/LeaseGet.h>
+#include <afina/execute/LeaseSet.h>
+#include <afina/execute/Namespace.h>
+#include <afina/execute/Prepend.h>
+#include <afina/execute/Replace.h>
 #include <afina/execute/Set.h>
 #include <afina/execute/Stats.h>
+#include <afina/execute/Subscribe.h>
+#include <afina/execute/Touch.h>
+
+#include "Scan.h"
 
 namespace Afina {
 namespace Protocol {
 
+namespace {
+
+/**
+ * Perfect hash of command names: two first characters, the last one and the length pick one of 32 slots.
+ * Each name is a case label in _lookup, so that compiler rejects the function should two names collide
+ */
+constexpr uint32_t NameHash(const char *name, std::size_t size) {
+    return (uint8_t(name[0]) + 6 * uint8_t(name[1]) + 11 * uint8_t(name[size - 1]) + size) & 31;
+}
+
+template <std::size_t N> constexpr uint32_t NameHash(const char (&name)[N]) { return NameHash(name, N - 1); }
+
+// Takes the command out of the pool if there is any
+template <typename T> std::unique_ptr<T> Take(std::vector<std::unique_ptr<T>> &pool) {
+    std::unique_ptr<T> result;
+    if (!pool.empty()) {
+        result = std::move(pool.back());
+        pool.pop_back();
+    }
+    return result;
+}
+
+// Puts the command into the pool unless it is full
+template <typename T> void Keep(std::vector<std::unique_ptr<T>> &pool, std::unique_ptr<Execute::Command> &command) {
+    if (pool.size() < Parser::PoolSize) {
+        pool.emplace_back(static_cast<T *>(command.release()));
+    }
+}
+
+} // namespace
+
+constexpr std::size_t Parser::PoolSize;
+
+// See Parse.h
+Parser::Parser() { Reset(); }
+
+// See Parse.h
+Parser::~Parser() {}
+
+// See Parse.h
+Parser::Kind Parser::_lookup(const std::string &name) {
+    if (name.size() >= 2) {
+#define AFINA_PARSER_NAME(text, result)                                                                               \
+    case NameHash(text):                                                                                               \
+        if (name.size() == sizeof(text) - 1 && std::memcmp(name.data(), text, sizeof(text) - 1) == 0) {                \
+            return result;                                                                                             \
+        }                                                                                                              \
+        break;
+
+        switch (NameHash(name.data(), name.size())) {
+            AFINA_PARSER_NAME("set", Kind::Set)
+            AFINA_PARSER_NAME("add", Kind::Add)
+            AFINA_PARSER_NAME("replace", Kind::Replace)
+            AFINA_PARSER_NAME("append", Kind::Append)
+            AFINA_PARSER_NAME("prepend", Kind::Prepend)
+            AFINA_PARSER_NAME("cas", Kind::Cas)
+            AFINA_PARSER_NAME("lset", Kind::LeaseSet)
+            AFINA_PARSER_NAME("get", Kind::Get)
+            AFINA_PARSER_NAME("gets", Kind::Gets)
+            AFINA_PARSER_NAME("lget", Kind::LeaseGet)
+            AFINA_PARSER_NAME("namespace", Kind::Namespace)
+            AFINA_PARSER_NAME("delete", Kind::Delete)
+            AFINA_PARSER_NAME("incr", Kind::Incr)
+            AFINA_PARSER_NAME("decr", Kind::Decr)
+            AFINA_PARSER_NAME("touch", Kind::Touch)
+            AFINA_PARSER_NAME("flush_all", Kind::FlushAll)
+            AFINA_PARSER_NAME("stats", Kind::Stats)
+            AFINA_PARSER_NAME("subscribe", Kind::Subscribe)
+        }
+#undef AFINA_PARSER_NAME
+    }
+    throw std::runtime_error("Unknown command name: " + name);
+}
+
 // See Parse.h
 bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
-    size_t pos;
+    size_t pos = 0;
     parsed = 0;
+    source = input;
 
-    for (pos = 0; pos < size && !parse_complete; pos++) {
-        char c = input[pos];
-        // std::cout << "[" << pos << "] '" << c << "': state=" << int(state) << std::endl;
-
+    while (pos < size && !parse_complete) {
         switch (state) {
         case State::sName: {
-            if (c == ' ' || c == '\r') {
-                // std::cout << "parser debug: name='" << name << "'" << std::endl;
-                if (name == "set" || name == "add" || name == "append" || name == "prepend") {
-                    state = State::spKey;
-                } else if (name == "get" || name == "gets") {
-                    state = State::sgKey;
-                } else if (name == "stats") {
-                    state = State::sLF;
-                    continue;
-                } else {
-                    throw std::runtime_error("Unknown command name: " + name);
-                }
-            } else {
-                name.push_back(c);
+            size_t end = FindDelimiter(input, pos, size, ' ', '\r');
+            name.append(input + pos, end - pos);
+            if (end == size) {
+                pos = size;
+                break;
+            }
+
+            pos = end + 1;
+            kind = _lookup(name);
+            switch (kind) {
+            case Kind::Set:
+            case Kind::Add:
+            case Kind::Replace:
+            case Kind::Append:
+            case Kind::Prepend:
+            case Kind::Cas:
+            case Kind::LeaseSet:
+                state = State::spKey;
+                break;
+            case Kind::Subscribe:
+                state = State::sLF;
+                break;
+            default:
+                // Arguments are checked by Build, flush_all and stats could go without them
+                state = input[end] == '\r' ? State::sLF : State::sgKey;
             }
             break;
         }
 
         case State::spKey: {
-            if (c == ' ') {
-                state = State::spFlags;
-                keys.push_back(curKey);
-                // std::cout << "parser debug: key[" << keys.size() - 1 << "]='" << curKey << "'" << std::endl;
-            } else {
-                curKey.push_back(c);
+            size_t end = FindDelimiter(input, pos, size, ' ', ' ');
+            _extend_key(pos, end);
+            if (end == size) {
+                pos = size;
+                break;
             }
+
+            _finish_key();
+            state = State::spFlags;
+            pos = end + 1;
+
+            // Usually the rest of the line is already here, so numbers could be parsed in one go
+            _parse_fields(input, pos, size);
             break;
         }
 
         case State::sgKey: {
-            if (c == '\r') {
-                keys.push_back(curKey);
-                // std::cout << "parser debug: total '" << keys.size() << " keys" << std::endl;
-
-                if (keys.size() == 0) {
-                    throw std::runtime_error("Client provides no key to retrive");
-                }
+            size_t end = FindDelimiter(input, pos, size, ' ', '\r');
+            _extend_key(pos, end);
+            if (end == size) {
+                pos = size;
+                break;
+            }
 
-                curKey.clear();
+            _finish_key();
+            if (input[end] == '\r') {
                 state = State::sLF;
-            } else if (c == ' ') {
-                // std::cout << "parser debug: key[" << keys.size() << "]='" << curKey << "'" << std::endl;
-                state = State::sgKey;
-                keys.push_back(curKey);
-                curKey.clear();
-            } else {
-                curKey.push_back(c);
             }
+            pos = end + 1;
             break;
         }
 
         case State::spFlags: {
+            char c = input[pos++];
             if (c == ' ') {
                 negative = false;
                 state = State::spExprTimeStart;
-                // std::cout << "parser debug: flags='" << flags << "'" << std::endl;
             } else if (c >= '0' && c <= '9') {
-                uint32_t f = (flags * 10) + (c - '0');
-                if (f < flags) {
-                    // Overflow
+                if (!_append_digit(flags, c, UINT32_MAX)) {
                     throw std::runtime_error("Flags field overflow");
                 }
-                flags = f;
             }
             break;
         }
 
         case State::spExprTimeStart: {
+            char c = input[pos++];
             if (c == '-') {
                 negative = true;
                 state = State::spExprTime;
@@ -105,48 +202,75 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
         }
 
         case State::spExprTime: {
+            char c = input[pos++];
             if (c == ' ') {
                 state = State::spBytes;
-                // std::cout << "parser debug: ExprTime='" << exprtime << "'" << std::endl;
             } else if (c >= '0' && c <= '9') {
-                int32_t et = exprtime;
-                if (negative) {
-                    et -= (c - '0');
-                    if (et > exprtime) {
-                        throw std::runtime_error("Expire time field overflow");
-                    }
-                } else {
-                    et += (c - '0');
-                    if (et < exprtime) {
-                        throw std::runtime_error("Expire time field overflow");
-                    }
+                int64_t et = int64_t(exprtime) * 10 + (negative ? -(c - '0') : (c - '0'));
+                if (et < INT32_MIN || et > INT32_MAX) {
+                    throw std::runtime_error("Expire time field overflow");
                 }
-                exprtime = et;
+                exprtime = int32_t(et);
             }
             break;
         }
 
         case State::spBytes: {
-            if (c == '\r') {
+            char c = input[pos++];
+            if (c == '\r' && _tokened()) {
+                throw std::runtime_error("Missing token of " + name + " command");
+            } else if (c == '\r') {
                 state = State::sLF;
-                // std::cout << "parser debug: bytes='" << bytes << "'" << std::endl;
+            } else if (c == ' ') {
+                state = _tokened() ? State::spTokenStart : State::spNoreply;
             } else if (c >= '0' && c <= '9') {
-                uint32_t b = (bytes * 10) + (c - '0');
-                if (b < bytes) {
-                    // Overflow
+                if (!_append_digit(bytes, c, UINT32_MAX)) {
                     throw std::runtime_error("Bytes field overflow");
                 }
-                bytes = b;
+            }
+            break;
+        }
+
+        case State::spTokenStart:
+        case State::spToken: {
+            char c = input[pos++];
+            if (c >= '0' && c <= '9') {
+                if (!_append_digit(token, c, UINT64_MAX)) {
+                    throw std::runtime_error("Token field overflow");
+                }
+                state = State::spToken;
+            } else if (state == State::spToken && c == '\r') {
+                state = State::sLF;
+            } else if (state == State::spToken && c == ' ') {
+                state = State::spNoreply;
+            } else {
+                throw std::runtime_error("Invalid token of " + name + " command");
+            }
+            break;
+        }
+
+        case State::spNoreply: {
+            static const char word[] = "noreply";
+            char c = input[pos++];
+            if (c == '\r' && (noreply_matched == 0 || noreply_matched == sizeof(word) - 1)) {
+                // Trailing space is tolerated
+                noreply = noreply_matched != 0;
+                state = State::sLF;
+            } else if (noreply_matched < sizeof(word) - 1 && c == word[noreply_matched]) {
+                noreply_matched++;
+            } else {
+                throw std::runtime_error("Unexpected argument of " + name + " command");
             }
             break;
         }
 
         case State::sLF: {
+            char c = input[pos++];
             if (c == '\n') {
                 parse_complete = true;
             } else {
                 std::stringstream err;
-                err << "Invalid char " << (int)c << " at position " << (parsed + pos) << ", \\n expected";
+                err << "Invalid char " << (int)c << " at position " << (pos - 1) << ", \\n expected";
                 throw std::runtime_error(err.str());
             }
             break;
@@ -157,10 +281,108 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
         }
     }
 
+    // Rest of the line comes with the next call, when this input could be gone already
+    if (!parse_complete) {
+        _spill_keys();
+    }
+
     parsed += pos;
     return parse_complete;
 }
 
+// See Parse.h
+bool Parser::_parse_fields(const char *input, std::size_t &pos, std::size_t size) {
+    std::size_t end = FindDelimiter(input, pos, size, '\r', '\r');
+    if (end == size) {
+        return false;
+    }
+
+    // flags, exptime, bytes, lease token or cas version for the commands which take it and optional noreply,
+    // all separated by single space
+    static const uint64_t limits[] = {UINT32_MAX, INT32_MAX, UINT32_MAX, UINT64_MAX};
+    uint64_t fields[4];
+    std::size_t expected = _tokened() ? 4 : 3;
+    std::size_t count = 0;
+    bool negative_time = false;
+    bool noreply_field = false;
+    std::size_t from = pos;
+    for (; from <= end; count++) {
+        std::size_t to = FindDelimiter(input, from, end, ' ', ' ');
+        const char *field = input + from;
+        std::size_t length = to - from;
+        if (count == expected && to == end && length == 7 && std::memcmp(field, "noreply", 7) == 0) {
+            noreply_field = true;
+            from = to + 1;
+            break;
+        }
+        if (count == expected) {
+            return false;
+        }
+
+        uint64_t limit = limits[count];
+        if (count == 1 && length > 0 && *field == '-') {
+            negative_time = true;
+            field++;
+            length--;
+            limit++;
+        }
+        if (!ParseDecimal(field, length, limit, fields[count])) {
+            return false;
+        }
+        from = to + 1;
+    }
+    if (count != expected || from <= end) {
+        return false;
+    }
+
+    flags = uint32_t(fields[0]);
+    exprtime = int32_t(negative_time ? -int64_t(fields[1]) : int64_t(fields[1]));
+    bytes = uint32_t(fields[2]);
+    token = count == 4 ? fields[3] : 0;
+    noreply = noreply_field;
+    state = State::sLF;
+    pos = end + 1;
+    return true;
+}
+
+// See Parse.h
+void Parser::_extend_key(std::size_t from, std::size_t to) {
+    if (!key_open) {
+        curKey = key_range{from, 0, false};
+        key_open = true;
+    }
+    if (curKey.spilled) {
+        spill.append(source + from, to - from);
+    }
+    curKey.size += to - from;
+}
+
+// See Parse.h
+void Parser::_finish_key() {
+    keys.push_back(curKey);
+    hashes.push_back(KeyHash(_data(curKey), curKey.size));
+    key_open = false;
+}
+
+// See Parse.h
+void Parser::_spill_keys() {
+    auto move = [this](key_range &t) {
+        if (!t.spilled) {
+            std::size_t offset = spill.size();
+            spill.append(source + t.offset, t.size);
+            t.offset = offset;
+            t.spilled = true;
+        }
+    };
+
+    for (auto &key : keys) {
+        move(key);
+    }
+    if (key_open) {
+        move(curKey);
+    }
+}
+
 // See Parse.h
 std::unique_ptr<Execute::Command> Parser::Build(size_t &body_size) const {
     if (state != State::sLF) {
@@ -168,19 +390,167 @@ std::unique_ptr<Execute::Command> Parser::Build(size_t &body_size) const {
     }
 
     body_size = bytes;
-    if (name == "set") {
-        return std::unique_ptr<Execute::Command>(new Execute::Set(keys[0], flags, exprtime));
-    } else if (name == "add") {
-        return std::unique_ptr<Execute::Command>(new Execute::Add(keys[0], flags, exprtime));
-    } else if (name == "append") {
-        return std::unique_ptr<Execute::Command>(new Execute::Append(keys[0], flags, exprtime));
-    } else if (name == "get") {
-        return std::unique_ptr<Execute::Command>(new Execute::Get(keys));
-    } else if (name == "stats") {
-        return std::unique_ptr<Execute::Command>(new Execute::Stats());
-    } else {
+    auto key = [this](std::size_t i) { return std::string(_data(keys[i]), keys[i].size); };
+
+    // Commands without data block take "noreply" as the last argument, but never in place of the key
+    std::size_t args = keys.size();
+    bool quiet = noreply;
+    bool keyed = kind == Kind::Delete || kind == Kind::Incr || kind == Kind::Decr || kind == Kind::Touch;
+    if ((keyed ? args > 1 : kind == Kind::FlushAll && args > 0) && keys[args - 1].size == 7 &&
+        std::memcmp(_data(keys[args - 1]), "noreply", 7) == 0) {
+        args--;
+        quiet = true;
+    }
+    auto expect_args = [this, args](std::size_t min, std::size_t max) {
+        if (args < min || args > max) {
+            throw std::runtime_error("Wrong number of arguments for " + name + " command");
+        }
+    };
+    auto number = [this, &key](std::size_t i, uint64_t max) {
+        uint64_t value;
+        if (!ParseDecimal(_data(keys[i]), keys[i].size, max, value)) {
+            throw std::runtime_error("Invalid numeric argument of " + name + " command: " + key(i));
+        }
+        return value;
+    };
+
+    auto all_keys = [this]() {
+        std::vector<std::string> result;
+        result.reserve(keys.size());
+        for (auto &t : keys) {
+            result.emplace_back(_data(t), t.size);
+        }
+        return result;
+    };
+
+    // Recycled get and gets are refilled in place
+    auto fill = [this](Execute::Get &get) {
+        get.Resize(keys.size());
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            get.Key(i, _data(keys[i]), keys[i].size, hashes[i]);
+        }
+    };
+
+    std::unique_ptr<Execute::Command> cmd;
+    switch (kind) {
+    case Kind::Set: {
+        std::unique_ptr<Execute::Set> set = Take(pool_set);
+        if (set) {
+            set->Assign(_data(keys[0]), keys[0].size, flags, exprtime, hashes[0]);
+            cmd = std::move(set);
+        } else {
+            cmd.reset(new Execute::Set(key(0), flags, exprtime, hashes[0]));
+        }
+        break;
+    }
+    case Kind::Add:
+        cmd.reset(new Execute::Add(key(0), flags, exprtime, hashes[0]));
+        break;
+    case Kind::Replace:
+        cmd.reset(new Execute::Replace(key(0), flags, exprtime, hashes[0]));
+        break;
+    case Kind::Append:
+        cmd.reset(new Execute::Append(key(0), flags, exprtime, hashes[0]));
+        break;
+    case Kind::Prepend:
+        cmd.reset(new Execute::Prepend(key(0), flags, exprtime, hashes[0]));
+        break;
+    case Kind::Cas:
+        cmd.reset(new Execute::Cas(key(0), flags, exprtime, hashes[0], token));
+        break;
+    case Kind::LeaseSet:
+        cmd.reset(new Execute::LeaseSet(key(0), flags, exprtime, hashes[0], token));
+        break;
+    case Kind::Get: {
+        expect_args(1, SIZE_MAX);
+        std::unique_ptr<Execute::Get> get = Take(pool_get);
+        if (get) {
+            fill(*get);
+            cmd = std::move(get);
+        } else {
+            cmd.reset(new Execute::Get(all_keys(), hashes));
+        }
+        break;
+    }
+    case Kind::Gets: {
+        expect_args(1, SIZE_MAX);
+        std::unique_ptr<Execute::Gets> gets = Take(pool_gets);
+        if (gets) {
+            fill(*gets);
+            cmd = std::move(gets);
+        } else {
+            cmd.reset(new Execute::Gets(all_keys(), hashes));
+        }
+        break;
+    }
+    case Kind::LeaseGet:
+        expect_args(1, SIZE_MAX);
+        cmd.reset(new Execute::LeaseGet(all_keys(), hashes));
+        break;
+    case Kind::Delete:
+        expect_args(1, 1);
+        cmd.reset(new Execute::Delete(key(0), hashes[0]));
+        break;
+    case Kind::Incr:
+    case Kind::Decr: {
+        expect_args(2, 2);
+        auto operation =
+            kind == Kind::Incr ? Execute::Arithmetic::Operation::Incr : Execute::Arithmetic::Operation::Decr;
+        cmd.reset(new Execute::Arithmetic(operation, key(0), hashes[0], number(1, UINT64_MAX)));
+        break;
+    }
+    case Kind::Touch: {
+        expect_args(2, 2);
+        bool negative_time = keys[1].size > 0 && *_data(keys[1]) == '-';
+        uint64_t time;
+        if (!ParseDecimal(_data(keys[1]) + negative_time, keys[1].size - negative_time,
+                          negative_time ? uint64_t(INT32_MAX) + 1 : INT32_MAX, time)) {
+            throw std::runtime_error("Invalid expiration time: " + key(1));
+        }
+        cmd.reset(new Execute::Touch(key(0), hashes[0], int32_t(negative_time ? -int64_t(time) : int64_t(time))));
+        break;
+    }
+    case Kind::FlushAll:
+        expect_args(0, 1);
+        cmd.reset(new Execute::FlushAll(args > 0 ? uint32_t(number(0, UINT32_MAX)) : 0));
+        break;
+    case Kind::Namespace:
+        if (keys.size() != 1) {
+            throw std::runtime_error("Namespace command takes exactly one name");
+        }
+        cmd.reset(new Execute::Namespace(key(0)));
+        break;
+    case Kind::Stats:
+        expect_args(0, 1);
+        cmd.reset(new Execute::Stats(args > 0 ? key(0) : std::string()));
+        break;
+    case Kind::Subscribe:
+        cmd.reset(new Execute::Subscribe());
+        break;
+    default:
         throw std::runtime_error("Unsupported command");
     }
+
+    cmd->NoReply(quiet);
+    return cmd;
+}
+
+// See Parse.h
+void Parser::Recycle(std::unique_ptr<Execute::Command> command) {
+    if (!command) {
+        return;
+    }
+    // Values looked up for the previous request are not needed anymore, see Execute::Command::Reads
+    command->Prefetched(nullptr, 0);
+
+    const std::type_info &type = typeid(*command);
+    if (type == typeid(Execute::Get)) {
+        Keep(pool_get, command);
+    } else if (type == typeid(Execute::Gets)) {
+        Keep(pool_gets, command);
+    } else if (type == typeid(Execute::Set)) {
+        Keep(pool_set, command);
+    }
 }
 
 // See Parse.h
@@ -188,11 +558,17 @@ void Parser::Reset() {
     state = State::sName;
     name.clear();
     keys.clear();
-    curKey.clear();
+    hashes.clear();
+    spill.clear();
+    key_open = false;
+    source = nullptr;
     parse_complete = false;
     flags = 0;
     bytes = 0;
     exprtime = 0;
+    token = 0;
+    noreply = false;
+    noreply_matched = 0;
 }
 
 } // namespace Protocol
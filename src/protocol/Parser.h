@@ -8,19 +8,27 @@
 #include <cstddef>
 #include <cstdint>
 
+#include <afina/execute/Response.h>
+
+#include "Codec.h"
+
 namespace Afina {
 namespace Execute {
-class Command;
+class Get;
+class Gets;
+class Set;
 } // namespace Execute
 namespace Protocol {
 
 /**
  * # Memcached protocol parser
- * Parser supports subset of memcached protocol
+ * Parser supports subset of memcached text protocol
  */
-class Parser {
+class Parser : public Codec {
 public:
-    Parser() { Reset(); }
+    Parser();
+    ~Parser();
+
     /**
      * Push given string into parser input. Method returns true if it was a command parsed out
      * from comulative input. In a such case method Build will return new command
@@ -31,6 +39,11 @@ public:
      */
     bool Parse(const std::string &input, size_t &parsed) { return Parse(&input[0], input.size(), parsed); }
 
+    // String literals are not going anywhere, unlike temporary strings: keys could point into the input
+    // until Build is called, see below
+    template <size_t N> bool Parse(const char (&input)[N], size_t &parsed) { return Parse(input, N - 1, parsed); }
+    bool Parse(std::string &&input, size_t &parsed) = delete;
+
     /**
      * Push given string into parser input. Method returns true if it was a command parsed out
      * from comulative input. In a such case method Build will return new command
@@ -40,20 +53,45 @@ public:
      * @param parsed output parameter tells how many bytes was consumed from the string
      * @return true if command has been parsed out
      */
-    bool Parse(const char *input, const size_t size, size_t &parsed);
+    bool Parse(const char *input, const size_t size, size_t &parsed) override;
 
     /**
      * Builds new command from parsed input. In case if it wasn't enough input to prse command out
      * method return nullptr
+     *
+     * Keys of the command line that came in a single Parse call are not copied by the parser, they are
+     * read right out of that call input. So Build must be called before the input buffer passed into the
+     * last Parse is changed or released
      */
-    std::unique_ptr<Execute::Command> Build(size_t &body_size) const;
+    std::unique_ptr<Execute::Command> Build(size_t &body_size) const override;
 
     /**
      * Reset parse so that it could be used to parse out new command
      */
-    void Reset();
+    void Reset() override;
+
+    /**
+     * Takes back get, gets and set commands once they are done: Build refills them with the next request in
+     * place, so that steady stream of such commands allocates nothing. Other commands are just released
+     */
+    void Recycle(std::unique_ptr<Execute::Command> command) override;
+
+    // Commands of each kind kept for reuse
+    static constexpr std::size_t PoolSize = 64;
 
-    inline const std::string &Name() const { return name; }
+    const std::string &Name() const override { return name; }
+
+    // Data block is followed by \r\n
+    std::size_t BodyTrailer() const override { return 2; }
+
+    // Every response ends with \r\n
+    void EndResponse(Execute::Response &out) const override { out.Append("\r\n", 2); }
+
+    /**
+     * Bytes of the current command line copied into the parser own buffer, because line was split
+     * across several Parse calls
+     */
+    inline std::size_t Spilled() const { return spill.size(); }
 
 private:
     /**
@@ -62,14 +100,107 @@ private:
      * - sp: for PUT commands only
      * - sg: for GET commands only
      */
-    enum State : uint16_t { sCR, sLF, sName, spKey, spFlags, spExprTimeStart, spExprTime, spBytes, sgKey };
+    enum State : uint16_t {
+        sCR,
+        sLF,
+        sName,
+        spKey,
+        spFlags,
+        spExprTimeStart,
+        spExprTime,
+        spBytes,
+        spTokenStart,
+        spToken,
+        spNoreply,
+        sgKey
+    };
 
     // Current parser state
     State state;
 
+    // Commands known to the parser
+    enum class Kind : uint8_t {
+        Set,
+        Add,
+        Replace,
+        Append,
+        Prepend,
+        Cas,
+        LeaseSet,
+        Get,
+        Gets,
+        LeaseGet,
+        Namespace,
+        Delete,
+        Incr,
+        Decr,
+        Touch,
+        FlushAll,
+        Stats,
+        Subscribe
+    };
+
+    // Kind of the command by its name, throws std::runtime_error for unknown one
+    static Kind _lookup(const std::string &name);
+
     // vrious fields of the command
     std::string name;
-    std::vector<std::string> keys;
+    Kind kind;
+
+    /**
+     * Key of the command line. While the whole line comes in a single Parse call, key is a range of that
+     * call input. If line is split across calls, keys parsed so far are moved into the spill buffer
+     * before Parse returns, the same happens with the key which is cut by the end of the input
+     */
+    struct key_range {
+        std::size_t offset;
+        std::size_t size;
+
+        // Range is in the spill buffer rather than in the input
+        bool spilled;
+    };
+    std::vector<key_range> keys;
+
+    // Key being parsed now, valid if key_open is set
+    key_range curKey;
+    bool key_open;
+
+    // Copy of keys split across Parse calls, see key_range
+    std::string spill;
+
+    // Input of the last Parse call
+    const char *source;
+
+    inline const char *_data(const key_range &t) const { return (t.spilled ? spill.data() : source) + t.offset; }
+
+    // Adds input[from, to) to the key being parsed
+    void _extend_key(std::size_t from, std::size_t to);
+
+    // Finishes key being parsed and computes its hash
+    void _finish_key();
+
+    // Moves keys that point into the current input into the spill buffer
+    void _spill_keys();
+
+    /**
+     * Fast path for the numeric fields of storage commands: if the whole rest of the line starting at pos
+     * is in the input and well formed, parses all fields, moves pos past \r and switches to sLF. Otherwise
+     * leaves everything as is for the byte by byte states, which also report errors
+     */
+    bool _parse_fields(const char *input, std::size_t &pos, std::size_t size);
+
+    // Appends decimal digit c to the field, false if result doesn't fit into max
+    template <typename T> static bool _append_digit(T &field, char c, uint64_t max) {
+        uint64_t digit = c - '0';
+        if (field > (max - digit) / 10) {
+            return false;
+        }
+        field = T(field * 10 + digit);
+        return true;
+    }
+
+    // Hash of each key in keys, computed once key is parsed out and then passed down to the storage
+    std::vector<uint64_t> hashes;
 
     // <flags> is an arbitrary 16-bit unsigned integer (written out in decimal) that the server stores along with
     // the data and sends back when the item is retrieved. Clients may use this as a bit field to store data-specific
@@ -88,9 +219,27 @@ private:
     // it's followed by an empty data block).
     uint32_t bytes;
 
+    // <token> is the lease token given out by "lget", follows <bytes> in "lset" command. Same for the version
+    // of "cas" command
+    uint64_t token;
+
+    // Command takes token, which is then required
+    inline bool _tokened() const { return kind == Kind::Cas || kind == Kind::LeaseSet; }
+
+    // Trailing "noreply" of storage commands, see Execute::Command::NoReply. Other commands take it as the
+    // last argument
+    bool noreply;
+
+    // Characters of "noreply" matched so far when it comes byte by byte
+    uint8_t noreply_matched;
+
     bool negative;
-    std::string curKey;
     bool parse_complete;
+
+    // Recycled commands, see Recycle
+    mutable std::vector<std::unique_ptr<Execute::Get>> pool_get;
+    mutable std::vector<std::unique_ptr<Execute::Gets>> pool_gets;
+    mutable std::vector<std::unique_ptr<Execute::Set>> pool_set;
 };
 
 } // namespace Protocol
@@ -0,0 +1,331 @@
+#include "RespCommand.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <utility>
+
+#include <afina/ChunkedValue.h>
+#include <afina/Hash.h>
+#include <afina/Storage.h>
+#include <afina/execute/Metrics.h>
+#include <afina/logging/Trace.h>
+
+#include "Scan.h"
+
+namespace Afina {
+namespace Protocol {
+
+namespace {
+
+inline void Reply(Execute::Response &response, const std::string &out) { response.Append(out); }
+
+inline std::string Error(const std::string &message) { return "-ERR " + message + "\r\n"; }
+
+inline std::string Integer(int64_t value) { return ":" + std::to_string(value) + "\r\n"; }
+
+const char Nil[] = "$-1\r\n";
+
+/**
+ * Appends value as bulk string. Chunks of large value are referenced by the response, everything collected
+ * in out so far goes first
+ */
+void Bulk(std::string &out, const std::string &value, const std::shared_ptr<const ChunkedValue> &chunks,
+          Execute::Response &response) {
+    out += "$" + std::to_string(chunks ? chunks->size() : value.size()) + "\r\n";
+    if (chunks) {
+        response.Append(out);
+        out.clear();
+        chunks->ForEachChunk([&response, &chunks](const char *data, std::size_t size) {
+            response.Reference(data, size, chunks);
+        });
+    } else {
+        out += value;
+    }
+    out += "\r\n";
+}
+
+// Redis integer: optional minus and decimal digits which fit into 64 bit signed number
+bool ParseInteger(const std::string &value, int64_t &number) {
+    bool negative = !value.empty() && value[0] == '-';
+    uint64_t magnitude;
+    if (!ParseDecimal(value.data() + negative, value.size() - negative,
+                      negative ? uint64_t(INT64_MAX) + 1 : uint64_t(INT64_MAX), magnitude)) {
+        return false;
+    }
+    number = negative ? -int64_t(magnitude - 1) - 1 : int64_t(magnitude);
+    return true;
+}
+
+bool Equals(const std::string &arg, const char *option) {
+    std::size_t i = 0;
+    for (; i < arg.size() && option[i] != '\0'; i++) {
+        if (std::tolower(arg[i]) != option[i]) {
+            return false;
+        }
+    }
+    return i == arg.size() && option[i] == '\0';
+}
+
+} // namespace
+
+// See RespCommand.h
+RespCommand::RespCommand(std::string name, std::vector<std::string> args)
+    : _name(std::move(name)), _args(std::move(args)), _offset(0) {}
+
+// See RespCommand.h
+void RespCommand::Execute(Storage &storage, const std::string &args, std::string &out) {
+    Execute::Response response;
+    Execute(storage, args, response);
+    response.CopyTo(out);
+}
+
+// See RespCommand.h
+void RespCommand::Execute(Storage &storage, const std::string &args, Execute::Response &response) {
+    AFINA_TRACE_DEBUG("Resp {}({})", _name, _args.size() > 1 ? _args[1] : "");
+    auto arity = [this](std::size_t min, std::size_t max) { return _args.size() >= min && _args.size() <= max; };
+    if (_name == "get" && arity(2, 2)) {
+        _get(storage, response);
+    } else if (_name == "set" && arity(3, SIZE_MAX)) {
+        _set(storage, response);
+    } else if (_name == "del" && arity(2, SIZE_MAX)) {
+        int64_t deleted = 0;
+        for (std::size_t i = 1; i < _args.size(); i++) {
+            deleted += storage.Delete(_args[i], KeyHash(_args[i]));
+        }
+        Reply(response, Integer(deleted));
+    } else if (_name == "mget" && arity(2, SIZE_MAX)) {
+        _mget(storage, response);
+    } else if (_name == "mset" && arity(3, SIZE_MAX) && _args.size() % 2 == 1) {
+        _mset(storage, response);
+    } else if (_name == "incr" && arity(2, 2)) {
+        _incr(storage, response);
+    } else if (_name == "append" && arity(3, 3)) {
+        _append(storage, response);
+    } else if (_name == "ping" && arity(1, 2)) {
+        std::string out = "+PONG\r\n";
+        if (_args.size() == 2) {
+            out.clear();
+            Bulk(out, _args[1], nullptr, response);
+        }
+        Reply(response, out);
+    } else if (_name == "get" || _name == "set" || _name == "del" || _name == "mget" || _name == "mset" ||
+               _name == "incr" || _name == "append" || _name == "ping") {
+        Reply(response, Error("wrong number of arguments for '" + _name + "' command"));
+    } else {
+        Reply(response, Error("unknown command '" + _args[0] + "'"));
+    }
+}
+
+// See RespCommand.h
+void RespCommand::_get(Storage &storage, Execute::Response &response) {
+    std::string value, out;
+    std::shared_ptr<const ChunkedValue> chunks;
+    bool found = _prefetch ? bool(_prefetch->found[_offset]) : storage.Get(_args[1], KeyHash(_args[1]), value, chunks);
+    Execute::Metrics::Add(found ? Execute::Metrics::Counter::GetHits : Execute::Metrics::Counter::GetMisses);
+    if (!found) {
+        Reply(response, Nil);
+        return;
+    }
+    if (_prefetch) {
+        Bulk(out, _prefetch->values[_offset], _prefetch->chunks[_offset], response);
+    } else {
+        Bulk(out, value, chunks, response);
+    }
+    Reply(response, out);
+}
+
+// See RespCommand.h
+bool RespCommand::Reads(Prefetch &batch) const {
+    if (_name != "get" || _args.size() != 2) {
+        return false;
+    }
+    batch.Add(_args[1], KeyHash(_args[1]));
+    return true;
+}
+
+// See RespCommand.h
+void RespCommand::Prefetched(std::shared_ptr<const Prefetch> batch, std::size_t offset) {
+    _prefetch = std::move(batch);
+    _offset = offset;
+}
+
+// See RespCommand.h
+const char *RespCommand::Metric() const {
+    static const std::pair<const char *, const char *> metrics[] = {
+        {"get", "RespGet"},   {"set", "RespSet"},   {"del", "RespDel"},       {"mget", "RespMget"},
+        {"mset", "RespMset"}, {"incr", "RespIncr"}, {"append", "RespAppend"}, {"ping", "RespPing"}};
+    for (auto &metric : metrics) {
+        if (_name == metric.first) {
+            return metric.second;
+        }
+    }
+    return nullptr;
+}
+
+// See RespCommand.h
+void RespCommand::_set(Storage &storage, Execute::Response &response) {
+    bool nx = false, xx = false, expire = false;
+    Storage::Attributes attributes;
+    for (std::size_t i = 3; i < _args.size(); i++) {
+        if (Equals(_args[i], "nx") && !xx) {
+            nx = true;
+        } else if (Equals(_args[i], "xx") && !nx) {
+            xx = true;
+        } else if ((Equals(_args[i], "ex") || Equals(_args[i], "px")) && !expire && i + 1 < _args.size()) {
+            // Relative time in seconds or milliseconds, without TTL item lives until evicted
+            bool seconds = Equals(_args[i], "ex");
+            int64_t time;
+            if (!ParseInteger(_args[++i], time) || time <= 0 ||
+                (seconds && time > std::numeric_limits<int64_t>::max() / 1000)) {
+                Reply(response, Error("invalid expire time in 'set' command"));
+                return;
+            }
+            attributes.deadline = Storage::Now() + uint64_t(time) * (seconds ? 1000 : 1);
+            expire = true;
+        } else if (Equals(_args[i], "keepttl") && !expire) {
+            attributes.deadline = Storage::Attributes::KeepDeadline;
+            expire = true;
+        } else {
+            Reply(response, Error("syntax error"));
+            return;
+        }
+    }
+
+    const std::string &key = _args[1], &value = _args[2];
+    uint64_t hash = KeyHash(key);
+    if (nx) {
+        Reply(response, storage.PutIfAbsent(key, hash, value, attributes) ? "+OK\r\n" : Nil);
+    } else if (xx) {
+        Reply(response, storage.Set(key, hash, value, attributes) ? "+OK\r\n" : Nil);
+    } else if (storage.Put(key, hash, value, attributes)) {
+        Reply(response, "+OK\r\n");
+    } else {
+        Reply(response, Error("value doesn't fit into the storage"));
+    }
+}
+
+// See RespCommand.h
+void RespCommand::_mget(Storage &storage, Execute::Response &response) {
+    std::vector<std::string> keys(std::make_move_iterator(_args.begin() + 1), std::make_move_iterator(_args.end()));
+    std::vector<uint64_t> hashes;
+    hashes.reserve(keys.size());
+    for (auto &key : keys) {
+        hashes.push_back(KeyHash(key));
+    }
+
+    std::vector<std::string> values;
+    std::vector<std::shared_ptr<const ChunkedValue>> chunks;
+    std::vector<uint64_t> versions;
+    std::vector<Storage::Attributes> attributes;
+    std::vector<bool> found;
+    storage.GetMany(keys, hashes, values, chunks, versions, attributes, found);
+
+    std::string out = "*" + std::to_string(keys.size()) + "\r\n";
+    uint64_t hits = std::count(found.begin(), found.end(), true);
+    Execute::Metrics::Add(Execute::Metrics::Counter::GetHits, hits);
+    Execute::Metrics::Add(Execute::Metrics::Counter::GetMisses, keys.size() - hits);
+    for (std::size_t i = 0; i < keys.size(); i++) {
+        if (found[i]) {
+            Bulk(out, values[i], chunks[i], response);
+        } else {
+            out += Nil;
+        }
+    }
+    Reply(response, out);
+}
+
+// See RespCommand.h
+void RespCommand::_mset(Storage &storage, Execute::Response &response) {
+    std::size_t pairs = (_args.size() - 1) / 2;
+    std::vector<std::string> keys, values;
+    std::vector<uint64_t> hashes;
+    keys.reserve(pairs);
+    values.reserve(pairs);
+    hashes.reserve(pairs);
+    for (std::size_t i = 1; i + 1 < _args.size(); i += 2) {
+        hashes.push_back(KeyHash(_args[i]));
+        keys.push_back(std::move(_args[i]));
+        values.push_back(std::move(_args[i + 1]));
+    }
+
+    if (storage.PutMany(keys, hashes, values) == pairs) {
+        Reply(response, "+OK\r\n");
+    } else {
+        Reply(response, Error("value doesn't fit into the storage"));
+    }
+}
+
+// See RespCommand.h
+void RespCommand::_incr(Storage &storage, Execute::Response &response) {
+    const std::string &key = _args[1];
+    uint64_t hash = KeyHash(key);
+    bool numeric = true, overflow = false;
+    int64_t result = 0;
+    auto modify = [&numeric, &overflow, &result](std::string &value) {
+        int64_t current;
+        if (!ParseInteger(value, current)) {
+            numeric = false;
+            return false;
+        }
+        if (current == INT64_MAX) {
+            overflow = true;
+            return false;
+        }
+        result = current + 1;
+        value = std::to_string(result);
+        return true;
+    };
+
+    // Missing key is taken as 0. Key created concurrently is updated on the second attempt
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (Execute::Command::Update(storage, key, hash, modify)) {
+            Reply(response, Integer(result));
+            return;
+        }
+        if (!numeric) {
+            Reply(response, Error("value is not an integer or out of range"));
+            return;
+        }
+        if (overflow) {
+            Reply(response, Error("increment or decrement would overflow"));
+            return;
+        }
+        if (storage.PutIfAbsent(key, hash, "1")) {
+            Reply(response, Integer(1));
+            return;
+        }
+    }
+    Reply(response, Error("value doesn't fit into the storage"));
+}
+
+// See RespCommand.h
+void RespCommand::_append(Storage &storage, Execute::Response &response) {
+    const std::string &key = _args[1], &suffix = _args[2];
+    uint64_t hash = KeyHash(key);
+    std::size_t length = 0;
+    auto modify = [&suffix, &length](std::string &value) {
+        value.append(suffix);
+        length = value.size();
+        return true;
+    };
+
+    // Missing key is taken as empty string, see INCR
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (Execute::Command::Update(storage, key, hash, modify)) {
+            Reply(response, Integer(int64_t(length)));
+            return;
+        }
+        if (storage.PutIfAbsent(key, hash, suffix)) {
+            Reply(response, Integer(int64_t(suffix.size())));
+            return;
+        }
+    }
+    Reply(response, Error("value doesn't fit into the storage"));
+}
+
+} // namespace Protocol
+} // namespace Afina
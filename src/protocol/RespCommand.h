@@ -0,0 +1,75 @@
+#ifndef AFINA_PROTOCOL_RESP_COMMAND_H
+#define AFINA_PROTOCOL_RESP_COMMAND_H
+
+#include <string>
+#include <vector>
+
+#include <afina/execute/Command.h>
+
+namespace Afina {
+namespace Protocol {
+
+/**
+ * # Redis command
+ * Subset of Redis commands over the same storage memcached clients use:
+ * - GET key
+ * - SET key value [NX|XX] [EX seconds|PX milliseconds|KEEPTTL]
+ * - DEL key [key ...]
+ * - MGET key [key ...]
+ * - MSET key value [key value ...]
+ * - INCR key
+ * - APPEND key value
+ * - PING [message]
+ *
+ * MGET and MSET go to the storage as one batch, see Storage::GetMany. INCR and APPEND create missing keys
+ * the way Redis does and never lose concurrent updates, see Execute::Command::Update, TTL of the item is kept.
+ * SET with EX or PX gives the item a deadline (see Storage::Attributes), SET without them drops the one item
+ * had unless KEEPTTL is given.
+ *
+ * Responses are RESP2: simple strings (+OK), errors (-ERR ...), integers (:1), bulk strings ($3\r\nval)
+ * and arrays of them (*2...), missing values are null bulk strings ($-1)
+ */
+class RespCommand : public Execute::Command {
+public:
+    /**
+     * @param name command name in lower case
+     * @param args request arguments, the first one is the name as client sent it
+     */
+    RespCommand(std::string name, std::vector<std::string> args);
+    ~RespCommand() {}
+
+    inline const std::string &name() const { return _name; }
+    inline const std::vector<std::string> &args() const { return _args; }
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+    // Chunks of large values are referenced rather than copied, see Command.h
+    void Execute(Storage &storage, const std::string &args, Execute::Response &response) override;
+
+    // GET only, MGET batches its keys itself. See Command.h
+    bool Reads(Prefetch &batch) const override;
+    void Prefetched(std::shared_ptr<const Prefetch> batch, std::size_t offset) override;
+
+    // Each supported command is accounted on its own (RespGet, RespMset, ...), see Command.h
+    const char *Metric() const override;
+
+private:
+    void _get(Storage &storage, Execute::Response &response);
+    void _set(Storage &storage, Execute::Response &response);
+    void _mget(Storage &storage, Execute::Response &response);
+    void _mset(Storage &storage, Execute::Response &response);
+    void _incr(Storage &storage, Execute::Response &response);
+    void _append(Storage &storage, Execute::Response &response);
+
+    const std::string _name;
+    std::vector<std::string> _args;
+
+    // Key looked up already and its position there, see Command::Reads
+    std::shared_ptr<const Prefetch> _prefetch;
+    std::size_t _offset;
+};
+
+} // namespace Protocol
+} // namespace Afina
+
+#endif // AFINA_PROTOCOL_RESP_COMMAND_H
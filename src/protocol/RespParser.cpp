@@ -0,0 +1,150 @@
+#include "RespParser.h"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <utility>
+
+#include <afina/execute/Command.h>
+
+#include "RespCommand.h"
+#include "Scan.h"
+
+namespace Afina {
+namespace Protocol {
+
+const std::size_t RespParser::MaxArguments;
+const std::size_t RespParser::MaxBulkLength;
+
+namespace {
+
+// Longest header line: prefix and decimal length
+const std::size_t MaxLine = 21;
+
+// Arguments are not preallocated beyond that, client might never send them
+const std::size_t MaxReserve = 64 * 1024;
+
+} // namespace
+
+// See RespParser.h
+bool RespParser::Parse(const char *input, const size_t size, size_t &parsed) {
+    size_t pos = 0;
+    parsed = 0;
+
+    while (pos < size && !_complete) {
+        switch (_state) {
+        case State::sArray:
+            if (_read_line(input, size, pos)) {
+                _count = _line_number('*', MaxArguments);
+                if (_count == 0) {
+                    throw std::runtime_error("Empty RESP request");
+                }
+                _args.reserve(std::min<std::size_t>(_count, 64));
+                _state = State::sBulk;
+            }
+            break;
+
+        case State::sBulk:
+            if (_read_line(input, size, pos)) {
+                _length = _line_number('$', MaxBulkLength);
+                _args.emplace_back();
+                _args.back().reserve(std::min(_length, MaxReserve));
+                _state = State::sData;
+            }
+            break;
+
+        case State::sData: {
+            std::string &arg = _args.back();
+            std::size_t take = std::min(size - pos, _length - arg.size());
+            arg.append(input + pos, take);
+            pos += take;
+            if (arg.size() == _length) {
+                _data_end = 0;
+                _state = State::sDataEnd;
+            }
+            break;
+        }
+
+        case State::sDataEnd: {
+            char c = input[pos++];
+            if (c != (_data_end == 0 ? '\r' : '\n')) {
+                throw std::runtime_error("RESP argument must end with \\r\\n");
+            }
+            if (++_data_end < 2) {
+                break;
+            }
+            if (_args.size() < _count) {
+                _state = State::sBulk;
+                break;
+            }
+
+            _complete = true;
+            _name = _args[0];
+            std::transform(_name.begin(), _name.end(), _name.begin(), [](char c) { return std::tolower(c); });
+            break;
+        }
+
+        default:
+            throw std::runtime_error("Unknown state");
+        }
+    }
+
+    parsed = pos;
+    return _complete;
+}
+
+// See RespParser.h
+std::unique_ptr<Execute::Command> RespParser::Build(size_t &body_size) const {
+    if (!_complete) {
+        return std::unique_ptr<Execute::Command>(nullptr);
+    }
+
+    // Arguments are moved, not copied: values could be large and parser is reset right after Build anyway
+    body_size = 0;
+    return std::unique_ptr<Execute::Command>(new RespCommand(_name, std::move(_args)));
+}
+
+// See RespParser.h
+void RespParser::Reset() {
+    _state = State::sArray;
+    _line.clear();
+    _count = 0;
+    _length = 0;
+    _data_end = 0;
+    _args.clear();
+    _name.clear();
+    _complete = false;
+}
+
+// See RespParser.h
+bool RespParser::_read_line(const char *input, std::size_t size, std::size_t &pos) {
+    std::size_t end = FindDelimiter(input, pos, size, '\n', '\n');
+    _line.append(input + pos, end - pos);
+    if (_line.size() > MaxLine + 1) {
+        throw std::runtime_error("Invalid RESP header line");
+    }
+    if (end == size) {
+        pos = size;
+        return false;
+    }
+
+    pos = end + 1;
+    if (_line.empty() || _line.back() != '\r') {
+        throw std::runtime_error("RESP header line must end with \\r\\n");
+    }
+    _line.pop_back();
+    return true;
+}
+
+// See RespParser.h
+std::size_t RespParser::_line_number(char prefix, std::size_t max) {
+    uint64_t value;
+    if (_line.empty() || _line[0] != prefix || !ParseDecimal(_line.data() + 1, _line.size() - 1, max, value)) {
+        throw std::runtime_error("Invalid RESP header line: " + _line);
+    }
+    _line.clear();
+    return std::size_t(value);
+}
+
+} // namespace Protocol
+} // namespace Afina
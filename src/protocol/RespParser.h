@@ -0,0 +1,89 @@
+#ifndef AFINA_PROTOCOL_RESP_PARSER_H
+#define AFINA_PROTOCOL_RESP_PARSER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Codec.h"
+
+namespace Afina {
+namespace Protocol {
+
+/**
+ * # Redis protocol (RESP2) parser
+ * Every request is an array of bulk strings, the first one is the command name:
+ *
+ * *<number of arguments>\r\n
+ * $<length of argument>\r\n
+ * <argument>\r\n
+ * ...
+ *
+ * Values are arguments as well, so that parser collects the whole request and commands have no data block.
+ * Inline commands (plain text lines) are not supported, they can't be told from memcached ones. See
+ * RespCommand for commands and responses
+ */
+class RespParser : public Codec {
+public:
+    RespParser() { Reset(); }
+    ~RespParser() {}
+
+    // See Codec.h, throws std::runtime_error if request is malformed
+    bool Parse(const char *input, const size_t size, size_t &parsed) override;
+
+    // See Codec.h
+    std::unique_ptr<Execute::Command> Build(size_t &body_size) const override;
+
+    // See Codec.h
+    void Reset() override;
+
+    // See Codec.h
+    const std::string &Name() const override { return _name; }
+
+    // Arguments are parsed out along with their \r\n
+    std::size_t BodyTrailer() const override { return 0; }
+
+    // Commands write complete responses
+    void EndResponse(Execute::Response &out) const override {}
+
+    // Limits which protect the server from the requests that would take all the memory before they complete
+    static const std::size_t MaxArguments = 1024 * 1024;
+    static const std::size_t MaxBulkLength = 512 * 1024 * 1024;
+
+private:
+    enum State : uint8_t { sArray, sBulk, sData, sDataEnd };
+
+    State _state;
+
+    // Header line ("*<n>" or "$<n>") collected so far, without \r\n
+    std::string _line;
+
+    // Number of arguments in the array and length of the argument being read
+    std::size_t _count;
+    std::size_t _length;
+
+    // \r\n bytes after the argument which are already read
+    std::size_t _data_end;
+
+    // Arguments read so far, the first one is command name. Build moves them into the command
+    mutable std::vector<std::string> _args;
+
+    // Name of the command in lower case
+    std::string _name;
+
+    bool _complete;
+
+    // Collects header line, returns true once it is complete
+    bool _read_line(const char *input, std::size_t size, std::size_t &pos);
+
+    // Parses number out of "<prefix><n>" header line and clears it
+    std::size_t _line_number(char prefix, std::size_t max);
+};
+
+} // namespace Protocol
+} // namespace Afina
+
+#endif // AFINA_PROTOCOL_RESP_PARSER_H
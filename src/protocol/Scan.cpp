@@ -0,0 +1,159 @@
+#include "Scan.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AFINA_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace Afina {
+namespace Protocol {
+
+namespace {
+
+typedef std::size_t (*find_function)(const char *, std::size_t, std::size_t, char, char);
+
+std::size_t FindScalar(const char *data, std::size_t pos, std::size_t size, char a, char b) {
+    for (; pos < size; pos++) {
+        if (data[pos] == a || data[pos] == b) {
+            return pos;
+        }
+    }
+    return size;
+}
+
+#ifdef AFINA_SCAN_X86
+__attribute__((target("sse2"))) std::size_t FindSse2(const char *data, std::size_t pos, std::size_t size, char a,
+                                                      char b) {
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    for (; pos + 16 <= size; pos += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+        unsigned mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb)));
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+    return FindScalar(data, pos, size, a, b);
+}
+
+__attribute__((target("avx2"))) std::size_t FindAvx2(const char *data, std::size_t pos, std::size_t size, char a,
+                                                      char b) {
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    for (; pos + 32 <= size; pos += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+        unsigned mask =
+            _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, va), _mm256_cmpeq_epi8(chunk, vb)));
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+    return FindSse2(data, pos, size, a, b);
+}
+#endif // AFINA_SCAN_X86
+
+find_function Implementation(ScanLevel level) {
+    switch (level) {
+#ifdef AFINA_SCAN_X86
+    case ScanLevel::Avx2:
+        return FindAvx2;
+    case ScanLevel::Sse2:
+        return FindSse2;
+#endif
+    default:
+        return FindScalar;
+    }
+}
+
+std::atomic<find_function> active_find(Implementation(ScanSupported()));
+std::atomic<ScanLevel> active_level(ScanSupported());
+
+} // namespace
+
+// See Scan.h
+ScanLevel ScanSupported() {
+#ifdef AFINA_SCAN_X86
+    // Might be called by static initializers, before CPU features are detected
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return ScanLevel::Avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return ScanLevel::Sse2;
+    }
+#endif
+    return ScanLevel::Scalar;
+}
+
+// See Scan.h
+ScanLevel ScanActive() { return active_level.load(std::memory_order_relaxed); }
+
+// See Scan.h
+void ScanForce(ScanLevel level) {
+    if (level > ScanSupported()) {
+        throw std::runtime_error(std::string("CPU doesn't support ") + ScanName(level));
+    }
+    active_find.store(Implementation(level), std::memory_order_relaxed);
+    active_level.store(level, std::memory_order_relaxed);
+}
+
+// See Scan.h
+const char *ScanName(ScanLevel level) {
+    switch (level) {
+    case ScanLevel::Avx2:
+        return "avx2";
+    case ScanLevel::Sse2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+// See Scan.h
+std::size_t FindDelimiter(const char *data, std::size_t pos, std::size_t size, char a, char b) {
+    return active_find.load(std::memory_order_relaxed)(data, pos, size, a, b);
+}
+
+// See Scan.h
+bool ParseDecimal(const char *data, std::size_t size, uint64_t max, uint64_t &value) {
+    // Leading zeros matter only for the length limit below
+    while (size > 20 && *data == '0') {
+        data++;
+        size--;
+    }
+
+    // 19 digits always fit into 64 bits, so that only the 20th one needs overflow check
+    if (size == 0 || size > 20) {
+        return false;
+    }
+
+    std::size_t head = size < 19 ? size : 19;
+    uint64_t result = 0;
+    unsigned bad = 0;
+    for (std::size_t i = 0; i < head; i++) {
+        unsigned digit = unsigned(static_cast<unsigned char>(data[i])) - '0';
+        bad |= digit > 9;
+        result = result * 10 + digit;
+    }
+
+    if (size == 20) {
+        unsigned digit = unsigned(static_cast<unsigned char>(data[19])) - '0';
+        bad |= digit > 9;
+        if (__builtin_mul_overflow(result, 10, &result) || __builtin_add_overflow(result, digit, &result)) {
+            return false;
+        }
+    }
+
+    if (bad != 0 || result > max) {
+        return false;
+    }
+    value = result;
+    return true;
+}
+
+} // namespace Protocol
+} // namespace Afina
@@ -0,0 +1,53 @@
+#ifndef AFINA_PROTOCOL_SCAN_H
+#define AFINA_PROTOCOL_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Afina {
+namespace Protocol {
+
+/**
+ * # Delimiter scanning
+ * Search for the field and line delimiters in the network input, the hottest loop of the parser. Input is
+ * compared 32 (AVX2) or 16 (SSE2) bytes at a time, the rest is done byte by byte. Implementation is picked
+ * once at startup by the CPU the server runs on, so that binary built for the generic x86-64 still uses AVX2
+ * where it is available, on other architectures plain scalar loop is used
+ */
+enum class ScanLevel { Scalar, Sse2, Avx2 };
+
+/**
+ * Best implementation supported by the CPU
+ */
+ScanLevel ScanSupported();
+
+/**
+ * Implementation in use
+ */
+ScanLevel ScanActive();
+
+/**
+ * Switches implementation for tests and benchmarks, throws std::runtime_error if CPU doesn't support it. Not
+ * thread safe, must not be called while anyone parses
+ */
+void ScanForce(ScanLevel level);
+
+const char *ScanName(ScanLevel level);
+
+/**
+ * @return position of the first a or b in data[pos, size), size if there is none
+ */
+std::size_t FindDelimiter(const char *data, std::size_t pos, std::size_t size, char a, char b);
+
+/**
+ * Parses decimal number out of data[0, size) without per digit branches. Fails if there are no digits,
+ * there is something else or number doesn't fit into max
+ *
+ * @return true if value has been parsed
+ */
+bool ParseDecimal(const char *data, std::size_t size, uint64_t max, uint64_t &value);
+
+} // namespace Protocol
+} // namespace Afina
+
+#endif // AFINA_PROTOCOL_SCAN_H
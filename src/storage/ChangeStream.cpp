@@ -0,0 +1,167 @@
+#include <afina/ChangeStream.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace Afina {
+
+constexpr std::size_t ChangeStream::KeyCapacity;
+constexpr std::size_t ChangeStream::KeyWords;
+
+namespace {
+
+// Slot meta layout: type in the low byte, then 16 bits of key size, then value size
+inline uint64_t pack_meta(ChangeStream::Type type, std::size_t key_size, std::size_t value_size) {
+    return uint64_t(type) | (uint64_t(std::min<std::size_t>(key_size, 0xffff)) << 8) | (uint64_t(value_size) << 24);
+}
+
+} // namespace
+
+ChangeStream::ring::ring(std::size_t capacity) : slots(new slot[capacity]), head(0) {
+    for (std::size_t i = 0; i < capacity; ++i) {
+        slots[i].sequence.store(0, std::memory_order_relaxed);
+    }
+}
+
+// See ChangeStream.h
+ChangeStream::ChangeStream(std::size_t capacity) : _capacity([capacity]() {
+    std::size_t result = 1;
+    while (result < capacity) {
+        result <<= 1;
+    }
+    return result;
+}()) {}
+
+// See ChangeStream.h
+ChangeStream::~ChangeStream() {}
+
+// See ChangeStream.h
+std::size_t ChangeStream::AddShard() {
+    _rings.emplace_back(new ring(_capacity));
+    return _rings.size() - 1;
+}
+
+// See ChangeStream.h
+void ChangeStream::Publish(std::size_t shard, Type type, const std::string &key, std::size_t value_size) {
+    ring &r = *_rings[shard];
+    uint64_t position = r.head.load(std::memory_order_relaxed);
+    slot &s = r.slots[position & (_capacity - 1)];
+
+    s.sequence.store(2 * position + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint64_t words[KeyWords];
+    std::size_t size = std::min(key.size(), KeyCapacity);
+    std::size_t used = (size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    if (used > 0) {
+        words[used - 1] = 0;
+        std::memcpy(words, key.data(), size);
+    }
+    for (std::size_t i = 0; i < used; ++i) {
+        s.key[i].store(words[i], std::memory_order_relaxed);
+    }
+    s.meta.store(pack_meta(type, key.size(), value_size), std::memory_order_relaxed);
+
+    s.sequence.store(2 * position + 2, std::memory_order_release);
+    r.head.store(position + 1, std::memory_order_release);
+}
+
+// See ChangeStream.h
+uint64_t ChangeStream::Published() const {
+    uint64_t result = 0;
+    for (auto &r : _rings) {
+        result += r->head.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+// See ChangeStream.h
+const char *ChangeStream::TypeName(Type type) {
+    switch (type) {
+    case Type::Put:
+        return "PUT";
+    case Type::Delete:
+        return "DELETE";
+    case Type::Evict:
+        return "EVICT";
+    }
+    return "UNKNOWN";
+}
+
+bool ChangeStream::_read(std::size_t shard, uint64_t &position, uint64_t &dropped, Event &event) const {
+    const ring &r = *_rings[shard];
+    while (true) {
+        const slot &s = r.slots[position & (_capacity - 1)];
+        uint64_t expected = 2 * position + 2;
+        uint64_t before = s.sequence.load(std::memory_order_acquire);
+        if (before < expected) {
+            // Not published yet, or being written right now
+            return false;
+        }
+
+        if (before == expected) {
+            uint64_t meta = s.meta.load(std::memory_order_relaxed);
+            std::size_t key_size = (meta >> 8) & 0xffff;
+            std::size_t size = std::min(key_size, KeyCapacity);
+            std::size_t used = (size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+            uint64_t words[KeyWords];
+            for (std::size_t i = 0; i < used; ++i) {
+                words[i] = s.key[i].load(std::memory_order_relaxed);
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.sequence.load(std::memory_order_relaxed) == expected) {
+                event.type = Type(meta & 0xff);
+                event.shard = shard;
+                event.sequence = position;
+                event.key.assign(reinterpret_cast<const char *>(words), size);
+                event.truncated = key_size > KeyCapacity;
+                event.value_size = meta >> 24;
+                position++;
+                return true;
+            }
+        }
+
+        // Writer has lapped the reader: jump to the oldest event still in the ring
+        uint64_t head = r.head.load(std::memory_order_acquire);
+        uint64_t oldest = std::max(position + 1, head > _capacity ? head - _capacity : 0);
+        dropped += oldest - position;
+        position = oldest;
+    }
+}
+
+// See ChangeStream.h
+ChangeStream::Subscriber::Subscriber(std::shared_ptr<ChangeStream> stream)
+    : _stream(std::move(stream)), _next_shard(0), _dropped(0) {
+    for (auto &r : _stream->_rings) {
+        _cursors.push_back(r->head.load(std::memory_order_acquire));
+    }
+}
+
+// See ChangeStream.h
+std::size_t ChangeStream::Subscriber::Poll(std::vector<Event> &events, std::size_t max) {
+    std::size_t result = 0;
+    std::size_t idle = 0;
+    Event event;
+    while (result < max && idle < _cursors.size()) {
+        std::size_t shard = _next_shard;
+        _next_shard = (_next_shard + 1) % _cursors.size();
+        if (_stream->_read(shard, _cursors[shard], _dropped, event)) {
+            events.push_back(event);
+            result++;
+            idle = 0;
+        } else {
+            idle++;
+        }
+    }
+    return result;
+}
+
+// See ChangeStream.h
+uint64_t ChangeStream::Subscriber::TakeDropped() {
+    uint64_t result = _dropped;
+    _dropped = 0;
+    return result;
+}
+
+} // namespace Afina
@@ -0,0 +1,261 @@
+#include "DumpLoader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <afina/Hash.h>
+
+namespace Afina {
+namespace Backend {
+
+// See DumpLoader.h
+DumpLoader::DumpLoader(std::shared_ptr<Afina::Storage> storage, std::size_t threads)
+    : _storage(std::move(storage)), _threads(threads ? threads : 1) {}
+
+// See DumpLoader.h
+const std::string &DumpLoader::Magic() {
+    static const std::string magic("AFDUMP01", 8);
+    return magic;
+}
+
+// See DumpLoader.h
+void DumpLoader::AppendRecord(std::string &dump, const std::string &key, const std::string &value) {
+    uint32_t sizes[2] = {uint32_t(key.size()), uint32_t(value.size())};
+    dump.append(reinterpret_cast<const char *>(sizes), sizeof(sizes));
+    dump.append(key).append(value);
+}
+
+// See DumpLoader.h
+DumpLoader::Result DumpLoader::Load(const std::string &path, Format format) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open dump " + path + ": " + std::strerror(errno));
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        throw std::runtime_error("Failed to stat dump " + path + ": " + std::strerror(err));
+    }
+
+    std::size_t size = st.st_size;
+    if (size == 0) {
+        close(fd);
+        return Load(nullptr, 0, format);
+    }
+
+    void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int err = errno;
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Failed to map dump " + path + ": " + std::strerror(err));
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    // Mapping goes away whatever happens with the load
+    std::unique_ptr<void, std::function<void(void *)>> mapping(data, [size](void *p) { munmap(p, size); });
+    return Load(static_cast<const char *>(data), size, format);
+}
+
+// See DumpLoader.h
+DumpLoader::Result DumpLoader::Load(const char *data, std::size_t size, Format format) {
+    const char *begin = data;
+    const char *end = data + size;
+
+    const std::string &magic = Magic();
+    bool has_magic = size >= magic.size() && std::memcmp(data, magic.data(), magic.size()) == 0;
+    if (format == Format::Auto) {
+        format = has_magic ? Format::Binary : Format::Text;
+    }
+    if (format == Format::Binary) {
+        if (!has_magic) {
+            throw std::runtime_error("Binary dump header expected");
+        }
+        begin += magic.size();
+    }
+
+    Result result;
+    result.bytes = size;
+    std::vector<range> ranges = _split(begin, end, data, format, result.records);
+
+    std::vector<std::size_t> stored(ranges.size(), 0);
+    std::vector<std::exception_ptr> errors(ranges.size());
+    std::vector<std::thread> workers;
+    for (std::size_t i = 1; i < ranges.size(); ++i) {
+        workers.emplace_back([this, &ranges, &stored, &errors, data, format, i]() {
+            try {
+                stored[i] = _load(ranges[i], data, format);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+
+    // Calling thread takes the first range
+    if (!ranges.empty()) {
+        try {
+            stored[0] = _load(ranges[0], data, format);
+        } catch (...) {
+            errors[0] = std::current_exception();
+        }
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    for (std::size_t i = 0; i < ranges.size(); ++i) {
+        if (errors[i]) {
+            std::rethrow_exception(errors[i]);
+        }
+        result.stored += stored[i];
+    }
+    return result;
+}
+
+void DumpLoader::_next(const char *&pos, const char *end, const char *data, Format format, record &out) {
+    if (format == Format::Binary) {
+        uint32_t sizes[2];
+        if (std::size_t(end - pos) < sizeof(sizes)) {
+            throw std::runtime_error("Truncated record header at offset " + std::to_string(pos - data));
+        }
+        std::memcpy(sizes, pos, sizeof(sizes));
+        if (std::size_t(end - pos) - sizeof(sizes) < std::size_t(sizes[0]) + sizes[1]) {
+            throw std::runtime_error("Truncated record at offset " + std::to_string(pos - data));
+        }
+
+        out.key = pos + sizeof(sizes);
+        out.key_size = sizes[0];
+        out.value = out.key + out.key_size;
+        out.value_size = sizes[1];
+        out.only_absent = false;
+        pos = out.value + out.value_size;
+        return;
+    }
+
+    // Text: command line first
+    const char *eol = static_cast<const char *>(std::memchr(pos, '\n', end - pos));
+    if (eol == nullptr) {
+        throw std::runtime_error("Truncated command at offset " + std::to_string(pos - data));
+    }
+    const char *line_end = (eol > pos && eol[-1] == '\r') ? eol - 1 : eol;
+
+    // Splits line into space separated fields: name, key, flags, exptime, bytes
+    const char *fields[5];
+    std::size_t sizes[5];
+    std::size_t count = 0;
+    for (const char *p = pos; p < line_end && count < 5;) {
+        while (p < line_end && *p == ' ') {
+            p++;
+        }
+        if (p == line_end) {
+            break;
+        }
+        const char *field_end = static_cast<const char *>(std::memchr(p, ' ', line_end - p));
+        if (field_end == nullptr) {
+            field_end = line_end;
+        }
+        fields[count] = p;
+        sizes[count] = field_end - p;
+        count++;
+        p = field_end;
+    }
+
+    if (count < 5) {
+        throw std::runtime_error("Storage command expected at offset " + std::to_string(pos - data));
+    }
+    if (sizes[0] == 3 && std::memcmp(fields[0], "set", 3) == 0) {
+        out.only_absent = false;
+    } else if (sizes[0] == 3 && std::memcmp(fields[0], "add", 3) == 0) {
+        out.only_absent = true;
+    } else {
+        throw std::runtime_error("Unsupported command " + std::string(fields[0], sizes[0]) + " at offset " +
+                                 std::to_string(pos - data));
+    }
+
+    std::size_t bytes = 0;
+    for (std::size_t i = 0; i < sizes[4]; ++i) {
+        char c = fields[4][i];
+        if (c < '0' || c > '9' || bytes > (std::size_t(1) << 40)) {
+            throw std::runtime_error("Invalid bytes field at offset " + std::to_string(pos - data));
+        }
+        bytes = bytes * 10 + (c - '0');
+    }
+
+    // Then data block followed by \r\n or \n
+    const char *value = eol + 1;
+    if (std::size_t(end - value) < bytes) {
+        throw std::runtime_error("Truncated data block at offset " + std::to_string(value - data));
+    }
+    const char *next = value + bytes;
+    if (next < end && *next == '\r') {
+        next++;
+    }
+    if (next >= end || *next != '\n') {
+        throw std::runtime_error("Data block terminator expected at offset " + std::to_string(next - data));
+    }
+
+    out.key = fields[1];
+    out.key_size = sizes[1];
+    out.value = value;
+    out.value_size = bytes;
+    pos = next + 1;
+}
+
+std::vector<DumpLoader::range> DumpLoader::_split(const char *begin, const char *end, const char *data,
+                                                  Format format, std::size_t &records) const {
+    std::vector<range> result;
+    if (begin == end) {
+        return result;
+    }
+
+    // Records are walked over by their headers only, ranges are cut at the first boundary past each share
+    std::size_t share = std::max<std::size_t>(1, (end - begin) / _threads);
+    const char *start = begin;
+    const char *pos = begin;
+    record r;
+    while (pos < end) {
+        _next(pos, end, data, format, r);
+        records++;
+        if (std::size_t(pos - start) >= share && result.size() + 1 < _threads) {
+            result.push_back(range{start, pos});
+            start = pos;
+        }
+    }
+    if (start < end) {
+        result.push_back(range{start, end});
+    }
+    return result;
+}
+
+std::size_t DumpLoader::_load(const range &r, const char *data, Format format) const {
+    // Buffers are reused between records, so that most of the inserts don't allocate for them
+    std::string key, value;
+    std::size_t stored = 0;
+    for (const char *pos = r.begin; pos < r.end;) {
+        record rec;
+        _next(pos, r.end, data, format, rec);
+
+        key.assign(rec.key, rec.key_size);
+        value.assign(rec.value, rec.value_size);
+        uint64_t hash = KeyHash(key);
+        bool ok = rec.only_absent ? _storage->PutIfAbsent(key, hash, value) : _storage->Put(key, hash, value);
+        if (ok) {
+            stored++;
+        }
+    }
+    return stored;
+}
+
+} // namespace Backend
+} // namespace Afina
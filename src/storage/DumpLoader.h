@@ -0,0 +1,115 @@
+#ifndef AFINA_STORAGE_DUMP_LOADER_H
+#define AFINA_STORAGE_DUMP_LOADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <afina/Storage.h>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Bulk load of key/value dump into the storage
+ * Warms cache up at startup much faster than replaying sets over the network: file gets mmapped, split into
+ * ranges of whole records and each range is parsed and inserted by its own thread. Key hash is computed once
+ * by the loader and passed down, so that every insert goes directly into its shard.
+ *
+ * Two formats are supported:
+ * - binary: Magic() followed by records, each is <key length: uint32><value length: uint32><key><value>,
+ *   lengths are in host (little endian) byte order
+ * - text: memcached storage commands, "set <key> <flags> <exptime> <bytes> [noreply]\r\n<data>\r\n",
+ *   "add" is accepted as well. Flags and expiration time are ignored
+ *
+ * Whole file gets validated before anything is inserted, so that malformed dump is rejected as a whole.
+ * Ranges are loaded concurrently, so if the same key appears more than once the winner is undefined unless
+ * single thread is used
+ */
+class DumpLoader {
+public:
+    enum class Format {
+        // Binary if file starts with Magic(), text otherwise
+        Auto,
+        Binary,
+        Text
+    };
+
+    /**
+     * What has been loaded
+     */
+    struct Result {
+        Result() : records(0), stored(0), bytes(0) {}
+
+        // Records parsed out of the dump
+        std::size_t records;
+
+        // Records accepted by the storage
+        std::size_t stored;
+
+        // Size of the dump
+        std::size_t bytes;
+    };
+
+    /**
+     * @param storage to load into, must be thread safe if more than one thread is used
+     * @param threads number of threads parsing and inserting in parallel
+     */
+    DumpLoader(std::shared_ptr<Afina::Storage> storage, std::size_t threads);
+
+    /**
+     * Loads dump file, throws std::runtime_error if file couldn't be read or is malformed
+     */
+    Result Load(const std::string &path, Format format = Format::Auto);
+
+    /**
+     * Loads dump from the memory buffer, see Load above
+     */
+    Result Load(const char *data, std::size_t size, Format format = Format::Auto);
+
+    /**
+     * Header of the binary dump
+     */
+    static const std::string &Magic();
+
+    /**
+     * Appends record in binary format to the given dump
+     */
+    static void AppendRecord(std::string &dump, const std::string &key, const std::string &value);
+
+private:
+    // Record found in the dump, points into the dump itself
+    struct record {
+        const char *key;
+        std::size_t key_size;
+        const char *value;
+        std::size_t value_size;
+        bool only_absent;
+    };
+
+    // Part of the dump loaded by one thread
+    struct range {
+        const char *begin;
+        const char *end;
+    };
+
+    // Reads record at pos and moves pos to the next one. Throws if record is malformed
+    static void _next(const char *&pos, const char *end, const char *data, Format format, record &out);
+
+    // Splits dump body into at most _threads ranges of whole records, validating and counting them on the way
+    std::vector<range> _split(const char *begin, const char *end, const char *data, Format format,
+                              std::size_t &records) const;
+
+    // Inserts all records of the range, returns number of records stored
+    std::size_t _load(const range &r, const char *data, Format format) const;
+
+    std::shared_ptr<Afina::Storage> _storage;
+    std::size_t _threads;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_DUMP_LOADER_H
@@ -0,0 +1,190 @@
+#ifndef AFINA_STORAGE_HASH_INDEX_H
+#define AFINA_STORAGE_HASH_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Intrusive hash index with incremental resize
+ * Chained hash table over nodes owned by someone else (i.e by LRU list). Node type must have members:
+ * - uint64_t hash: hash of the node key, see afina/Hash.h
+ * - Node *hash_next: link to the next node in the same bucket, owned by index
+ *
+ * Table never rehashes all at once: when load factor exceeds 1, new table twice as big is allocated
+ * and lives side by side with the old one. Every following operation moves a bounded number of old
+ * buckets into the new table, until old one is drained and released. Meanwhile lookups check both
+ * tables. That way each operation costs O(step) extra at most, regardless of the table size, and
+ * growth at 50M entries doesn't stall the storage.
+ *
+ * Tables are allocated with calloc, so that big tables come as lazily zeroed pages from the kernel
+ * instead of being cleared in one go.
+ *
+ * Bucket is selected by low bits of the hash, high bits are left for shard selection.
+ */
+template <typename Node> class HashIndex {
+public:
+    /**
+     * @param initial_buckets initial table size, rounded up to the power of two
+     * @param migrate_step number of old buckets moved on each operation while resize is in progress
+     */
+    HashIndex(std::size_t initial_buckets = 16, std::size_t migrate_step = 8)
+        : _old(nullptr), _old_mask(0), _migrate_pos(0), _size(0), _migrate_step(migrate_step) {
+        std::size_t buckets = 1;
+        while (buckets < initial_buckets) {
+            buckets <<= 1;
+        }
+        _table = allocate(buckets);
+        _mask = buckets - 1;
+    }
+
+    ~HashIndex() {
+        std::free(_table);
+        std::free(_old);
+    }
+
+    /**
+     * Finds node with the given hash for which predicate returns true, nullptr if there is no such node
+     */
+    template <typename Eq> Node *Find(uint64_t hash, Eq &&eq) {
+        migrate();
+        for (Node *node = _table[hash & _mask]; node != nullptr; node = node->hash_next) {
+            if (node->hash == hash && eq(*node)) {
+                return node;
+            }
+        }
+        if (_old != nullptr) {
+            for (Node *node = _old[hash & _old_mask]; node != nullptr; node = node->hash_next) {
+                if (node->hash == hash && eq(*node)) {
+                    return node;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * Adds node into the index, node->hash must be set already. Index doesn't check for duplicates
+     */
+    void Insert(Node *node) {
+        migrate();
+        if (_old == nullptr && _size >= _mask + 1) {
+            grow();
+        }
+
+        Node *&bucket = _table[node->hash & _mask];
+        node->hash_next = bucket;
+        bucket = node;
+        _size++;
+    }
+
+    /**
+     * Removes given node from the index
+     */
+    void Erase(Node *node) {
+        migrate();
+        if (unlink(_table, _mask, node) || (_old != nullptr && unlink(_old, _old_mask, node))) {
+            _size--;
+        }
+    }
+
+    // Number of nodes in the index
+    inline std::size_t Size() const { return _size; }
+
+    // True if there are two tables at the moment and data migrates from the old one
+    inline bool Resizing() const { return _old != nullptr; }
+
+    // Bytes taken by bucket tables
+    inline std::size_t Memory() const {
+        return (_mask + 1 + (_old != nullptr ? _old_mask + 1 : 0)) * sizeof(Node *);
+    }
+
+private:
+    HashIndex(const HashIndex &) = delete;
+    HashIndex &operator=(const HashIndex &) = delete;
+
+    static Node **allocate(std::size_t buckets) {
+        Node **result = static_cast<Node **>(std::calloc(buckets, sizeof(Node *)));
+        if (result == nullptr) {
+            throw std::bad_alloc();
+        }
+        return result;
+    }
+
+    static bool unlink(Node **table, std::size_t mask, Node *node) {
+        for (Node **link = &table[node->hash & mask]; *link != nullptr; link = &(*link)->hash_next) {
+            if (*link == node) {
+                *link = node->hash_next;
+                node->hash_next = nullptr;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Starts resize: current table becomes the old one
+    void grow() {
+        std::size_t buckets = (_mask + 1) * 2;
+        Node **table = allocate(buckets);
+        _old = _table;
+        _old_mask = _mask;
+        _table = table;
+        _mask = buckets - 1;
+        _migrate_pos = 0;
+    }
+
+    // Moves next portion of old buckets into the new table
+    void migrate() {
+        if (_old == nullptr) {
+            return;
+        }
+
+        std::size_t end = _migrate_pos + _migrate_step;
+        if (end > _old_mask + 1) {
+            end = _old_mask + 1;
+        }
+        for (; _migrate_pos < end; _migrate_pos++) {
+            Node *node = _old[_migrate_pos];
+            while (node != nullptr) {
+                Node *next = node->hash_next;
+                Node *&bucket = _table[node->hash & _mask];
+                node->hash_next = bucket;
+                bucket = node;
+                node = next;
+            }
+            _old[_migrate_pos] = nullptr;
+        }
+
+        if (_migrate_pos > _old_mask) {
+            std::free(_old);
+            _old = nullptr;
+            _old_mask = 0;
+        }
+    }
+
+    // Main table, all new nodes go there
+    Node **_table;
+    std::size_t _mask;
+
+    // Table being drained during resize, nullptr otherwise
+    Node **_old;
+    std::size_t _old_mask;
+
+    // Next old bucket to migrate
+    std::size_t _migrate_pos;
+
+    // Number of nodes in both tables
+    std::size_t _size;
+
+    // Number of old buckets to migrate per operation
+    const std::size_t _migrate_step;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_HASH_INDEX_H
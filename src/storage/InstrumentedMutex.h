@@ -0,0 +1,121 @@
+#ifndef AFINA_STORAGE_INSTRUMENTED_MUTEX_H
+#define AFINA_STORAGE_INSTRUMENTED_MUTEX_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include <afina/concurrency/PerThread.h>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Mutex which tracks contention
+ * Drop-in replacement for std::mutex that counts how many times lock was taken, how many of those
+ * had to wait for another owner and how long they waited.
+ *
+ * Uncontended path costs one try_lock and one relaxed increment on a thread private cache line, clock
+ * is read only if lock is already taken by someone else.
+ */
+class InstrumentedMutex {
+public:
+    // Aggregated lock statistic
+    struct Counters {
+        Counters() : acquisitions(0), contended(0), wait_ns(0), max_wait_ns(0) {}
+
+        // Total number of lock() calls
+        uint64_t acquisitions;
+
+        // Number of lock() calls that found mutex owned by other thread
+        uint64_t contended;
+
+        // Total and maximal time spent waiting for the mutex, in nanoseconds
+        uint64_t wait_ns;
+        uint64_t max_wait_ns;
+
+        Counters &operator+=(const Counters &other) {
+            acquisitions += other.acquisitions;
+            contended += other.contended;
+            wait_ns += other.wait_ns;
+            max_wait_ns = std::max(max_wait_ns, other.max_wait_ns);
+            return *this;
+        }
+    };
+
+    InstrumentedMutex() {}
+
+    void lock() {
+        slot &s = _counters.local();
+        if (_mutex.try_lock()) {
+            s.acquisitions.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        _mutex.lock();
+        uint64_t wait =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+        s.acquisitions.fetch_add(1, std::memory_order_relaxed);
+        s.contended.fetch_add(1, std::memory_order_relaxed);
+        s.wait_ns.fetch_add(wait, std::memory_order_relaxed);
+
+        uint64_t max_wait = s.max_wait_ns.load(std::memory_order_relaxed);
+        while (max_wait < wait && !s.max_wait_ns.compare_exchange_weak(max_wait, wait, std::memory_order_relaxed)) {
+        }
+    }
+
+    bool try_lock() {
+        if (_mutex.try_lock()) {
+            _counters.local().acquisitions.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    void unlock() { _mutex.unlock(); }
+
+    /**
+     * Sums up counters of all threads. Result is not an atomic snapshot, but each counter is exact
+     */
+    Counters Collect() const {
+        Counters result;
+        _counters.for_each([&result](const slot &s) {
+            Counters c;
+            c.acquisitions = s.acquisitions.load(std::memory_order_relaxed);
+            c.contended = s.contended.load(std::memory_order_relaxed);
+            c.wait_ns = s.wait_ns.load(std::memory_order_relaxed);
+            c.max_wait_ns = s.max_wait_ns.load(std::memory_order_relaxed);
+            result += c;
+        });
+        return result;
+    }
+
+private:
+    InstrumentedMutex(const InstrumentedMutex &) = delete;
+    InstrumentedMutex &operator=(const InstrumentedMutex &) = delete;
+
+    // Counters of a single thread
+    struct slot {
+        slot() : acquisitions(0), contended(0), wait_ns(0), max_wait_ns(0) {}
+        std::atomic<uint64_t> acquisitions;
+        std::atomic<uint64_t> contended;
+        std::atomic<uint64_t> wait_ns;
+        std::atomic<uint64_t> max_wait_ns;
+    };
+
+    std::mutex _mutex;
+    Concurrency::PerThread<slot, 16> _counters;
+};
+
+// Storages holding the mutex are created by plain new, see Concurrency::PerThread
+static_assert(alignof(InstrumentedMutex) <= alignof(std::max_align_t), "InstrumentedMutex must not be over-aligned");
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_INSTRUMENTED_MUTEX_H
@@ -0,0 +1,244 @@
+#include "LeasedStorage.h"
+
+#include <algorithm>
+
+namespace Afina {
+namespace Backend {
+
+// See LeasedStorage.h
+bool LeasedStorage::Put(const std::string &key, uint64_t hash, const std::string &value,
+                        const Attributes &attributes) {
+    shard &s = _shard(hash);
+    std::unique_lock<std::mutex> lock(s.mutex);
+    std::string buffer;
+    _invalidate(s, _entry(key, buffer));
+    return _storage->Put(key, hash, value, attributes);
+}
+
+// See LeasedStorage.h
+bool LeasedStorage::PutChunked(const std::string &key, uint64_t hash, std::shared_ptr<const ChunkedValue> value,
+                               const Attributes &attributes) {
+    shard &s = _shard(hash);
+    std::unique_lock<std::mutex> lock(s.mutex);
+    std::string buffer;
+    _invalidate(s, _entry(key, buffer));
+    return _storage->PutChunked(key, hash, std::move(value), attributes);
+}
+
+// See LeasedStorage.h
+bool LeasedStorage::PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value,
+                                const Attributes &attributes) {
+    shard &s = _shard(hash);
+    std::unique_lock<std::mutex> lock(s.mutex);
+    if (!_storage->PutIfAbsent(key, hash, value, attributes)) {
+        return false;
+    }
+    std::string buffer;
+    _invalidate(s, _entry(key, buffer));
+    return true;
+}
+
+// See LeasedStorage.h
+bool LeasedStorage::Set(const std::string &key, uint64_t hash, const std::string &value,
+                        const Attributes &attributes) {
+    shard &s = _shard(hash);
+    std::unique_lock<std::mutex> lock(s.mutex);
+    if (!_storage->Set(key, hash, value, attributes)) {
+        return false;
+    }
+    std::string buffer;
+    _invalidate(s, _entry(key, buffer));
+    return true;
+}
+
+// See LeasedStorage.h
+bool LeasedStorage::Delete(const std::string &key, uint64_t hash) {
+    shard &s = _shard(hash);
+    std::unique_lock<std::mutex> lock(s.mutex);
+
+    // Large values come as chunks and are kept as they are, only small ones get copied
+    std::string value;
+    std::shared_ptr<const ChunkedValue> chunks;
+    if (!_storage->Get(key, hash, value, chunks) || !_storage->Delete(key, hash)) {
+        return false;
+    }
+
+    // Deleted value is served as stale one to those who wait for the lease, any lease is void now
+    auto now = clock::now();
+    std::string buffer;
+    const std::string &entry_key = _entry(key, buffer);
+    lease &entry = s.leases[entry_key];
+    entry.token = 0;
+    _drop_stale(entry);
+    if (!_table->keep_stale(chunks ? chunks->size() : value.size())) {
+        _table->stale_skipped.fetch_add(1, std::memory_order_relaxed);
+        s.leases.erase(entry_key);
+        return true;
+    }
+    entry.stale = chunks ? std::move(chunks) : std::make_shared<ChunkedValue>(value);
+    entry.stale_deadline = now + _lease_time;
+    _purge(s, now);
+    return true;
+}
+
+// See LeasedStorage.h
+Storage::CasResult LeasedStorage::CompareAndSet(const std::string &key, uint64_t hash, const std::string &value,
+                                                uint64_t version, const Attributes &attributes) {
+    shard &s = _shard(hash);
+    std::unique_lock<std::mutex> lock(s.mutex);
+    CasResult result = _storage->CompareAndSet(key, hash, value, version, attributes);
+    if (result == CasResult::Stored) {
+        std::string buffer;
+        _invalidate(s, _entry(key, buffer));
+    }
+    return result;
+}
+
+// See LeasedStorage.h
+bool LeasedStorage::Flush() {
+    if (!_storage->Flush()) {
+        return false;
+    }
+    for (auto &s : _table->shards) {
+        std::unique_lock<std::mutex> lock(s.mutex);
+        for (auto &entry : s.leases) {
+            _drop_stale(entry.second);
+        }
+        s.leases.clear();
+    }
+    return true;
+}
+
+// See LeasedStorage.h
+std::shared_ptr<Afina::Storage> LeasedStorage::Namespace(const std::string &name) {
+    auto wrapped = _storage->Namespace(name);
+    if (!wrapped) {
+        return nullptr;
+    }
+    // Names can't contain zero byte, so that scopes never clash
+    return std::shared_ptr<Afina::Storage>(new LeasedStorage(std::move(wrapped), _lease_time, _table, name + '\0'));
+}
+
+// See LeasedStorage.h
+Storage::Lease LeasedStorage::GetLease(const std::string &key, uint64_t hash, std::string &value, uint64_t &token) {
+    // Hits don't touch the lease table at all, misses are confirmed under the shard lock
+    if (_storage->Get(key, hash, value)) {
+        return Lease::Hit;
+    }
+
+    shard &s = _shard(hash);
+    std::unique_lock<std::mutex> lock(s.mutex);
+
+    // Writers store under the same lock, so a value stored since the miss above is seen here and no lease is
+    // granted over fresh data
+    if (_storage->Get(key, hash, value)) {
+        return Lease::Hit;
+    }
+
+    auto now = clock::now();
+    std::string buffer;
+    lease &entry = s.leases[_entry(key, buffer)];
+    if (entry.stale && entry.stale_deadline <= now) {
+        _drop_stale(entry);
+    }
+
+    if (entry.token != 0 && entry.lease_deadline > now) {
+        if (entry.stale) {
+            // Value is copied out once the lock is released, pointer keeps it alive meanwhile
+            std::shared_ptr<const ChunkedValue> stale = entry.stale;
+            lock.unlock();
+            stale->CopyTo(value);
+            _table->stale.fetch_add(1, std::memory_order_relaxed);
+            return Lease::Stale;
+        }
+        _table->hot_misses.fetch_add(1, std::memory_order_relaxed);
+        return Lease::HotMiss;
+    }
+
+    entry.token = _table->next_token.fetch_add(1, std::memory_order_relaxed) + 1;
+    entry.lease_deadline = now + _lease_time;
+    token = entry.token;
+    _table->granted.fetch_add(1, std::memory_order_relaxed);
+    _purge(s, now);
+    return Lease::Granted;
+}
+
+// See LeasedStorage.h
+bool LeasedStorage::PutLeased(const std::string &key, uint64_t hash, const std::string &value, uint64_t token,
+                              const Attributes &attributes) {
+    shard &s = _shard(hash);
+    std::unique_lock<std::mutex> lock(s.mutex);
+
+    std::string buffer;
+    auto it = s.leases.find(_entry(key, buffer));
+    if (token == 0 || it == s.leases.end() || it->second.token != token ||
+        it->second.lease_deadline <= clock::now()) {
+        _table->rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    _drop_stale(it->second);
+    s.leases.erase(it);
+    return _storage->Put(key, hash, value, attributes);
+}
+
+// See LeasedStorage.h
+void LeasedStorage::Stats(std::vector<std::pair<std::string, std::string>> &stats) {
+    _storage->Stats(stats);
+    stats.emplace_back("lease_granted", std::to_string(_table->granted.load(std::memory_order_relaxed)));
+    stats.emplace_back("lease_hot_misses", std::to_string(_table->hot_misses.load(std::memory_order_relaxed)));
+    stats.emplace_back("lease_stale", std::to_string(_table->stale.load(std::memory_order_relaxed)));
+    stats.emplace_back("lease_rejected", std::to_string(_table->rejected.load(std::memory_order_relaxed)));
+    stats.emplace_back("lease_pending", std::to_string(PendingLeases()));
+    stats.emplace_back("lease_stale_bytes", std::to_string(_table->stale_bytes.load(std::memory_order_relaxed)));
+    stats.emplace_back("lease_stale_skipped", std::to_string(_table->stale_skipped.load(std::memory_order_relaxed)));
+}
+
+// See LeasedStorage.h
+std::size_t LeasedStorage::PendingLeases() const {
+    std::size_t result = 0;
+    for (auto &s : _table->shards) {
+        std::unique_lock<std::mutex> lock(s.mutex);
+        result += s.leases.size();
+    }
+    return result;
+}
+
+void LeasedStorage::_invalidate(shard &s, const std::string &key) {
+    if (s.leases.empty()) {
+        return;
+    }
+    auto it = s.leases.find(key);
+    if (it != s.leases.end()) {
+        _drop_stale(it->second);
+        s.leases.erase(it);
+    }
+}
+
+void LeasedStorage::_drop_stale(lease &entry) {
+    if (entry.stale) {
+        _table->stale_bytes.fetch_sub(entry.stale->size(), std::memory_order_relaxed);
+        entry.stale.reset();
+    }
+}
+
+void LeasedStorage::_purge(shard &s, clock::time_point now) {
+    if (s.leases.size() < s.purge_threshold) {
+        return;
+    }
+
+    for (auto it = s.leases.begin(); it != s.leases.end();) {
+        if (it->second.expired(now)) {
+            _drop_stale(it->second);
+            it = s.leases.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // Next purge once table doubles, so that cost of purge is amortized over insertions
+    s.purge_threshold = std::max(std::size_t(64), 2 * s.leases.size());
+}
+
+} // namespace Backend
+} // namespace Afina
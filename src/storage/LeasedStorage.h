@@ -0,0 +1,232 @@
+#ifndef AFINA_STORAGE_LEASED_STORAGE_H
+#define AFINA_STORAGE_LEASED_STORAGE_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <afina/ChunkedValue.h>
+#include <afina/Hash.h>
+#include <afina/Storage.h>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Storage with leases
+ * Wraps any storage with a table of pending leases, see Storage::GetLease. Entry appears in the table when
+ * some client misses the key and gets the lease, or when the key gets deleted: deleted value is kept for a
+ * lease time as the stale one, so that clients waiting for the lease holder could use it meanwhile. Only deletes
+ * through this storage leave stale values: items evicted or expired by the wrapped storage are just gone.
+ *
+ * Stale values are kept by shared pointer, large ones share chunks with the deleted item rather than being
+ * copied. Their total size is capped by stale_limit, deletes beyond it keep nothing.
+ *
+ * Any write of the key through this storage (put, set, cas, delete) invalidates pending lease, so that lease
+ * holder which computed value from the old data can't overwrite newer one.
+ *
+ * Table is split into shards by key hash, each guarded by its own lock. Writes take shard lock for the time
+ * of write into the wrapped storage, lease checks and writes must be atomic relative to each other. Plain
+ * gets go straight to the wrapped storage.
+ *
+ * Namespaces of the wrapped storage are wrapped as well and share the table, entries of each namespace are
+ * kept apart by its name.
+ */
+class LeasedStorage : public Afina::Storage {
+public:
+    LeasedStorage(std::shared_ptr<Afina::Storage> storage,
+                  std::chrono::milliseconds lease_time = std::chrono::milliseconds(10000),
+                  std::size_t stale_limit = 64 * 1024 * 1024)
+        : LeasedStorage(std::move(storage), lease_time, std::make_shared<table>(stale_limit), std::string()) {}
+    ~LeasedStorage() {}
+
+    // Implements Afina::Storage interface
+    void Start() override { _storage->Start(); }
+
+    // Implements Afina::Storage interface
+    void Stop() override { _storage->Stop(); }
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value) override { return Put(key, KeyHash(key), value); }
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value) override {
+        return PutIfAbsent(key, KeyHash(key), value);
+    }
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value) override { return Set(key, KeyHash(key), value); }
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key) override { return Delete(key, KeyHash(key)); }
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) override { return _storage->Get(key, KeyHash(key), value); }
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, uint64_t hash, const std::string &value,
+             const Attributes &attributes = Attributes()) override;
+    bool PutChunked(const std::string &key, uint64_t hash, std::shared_ptr<const ChunkedValue> value,
+                    const Attributes &attributes = Attributes()) override;
+    bool PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value,
+                     const Attributes &attributes = Attributes()) override;
+    bool Set(const std::string &key, uint64_t hash, const std::string &value,
+             const Attributes &attributes = Attributes()) override;
+    bool Delete(const std::string &key, uint64_t hash) override;
+    bool Get(const std::string &key, uint64_t hash, std::string &value) override {
+        return _storage->Get(key, hash, value);
+    }
+    bool Get(const std::string &key, uint64_t hash, std::string &value,
+             std::shared_ptr<const ChunkedValue> &chunks) override {
+        return _storage->Get(key, hash, value, chunks);
+    }
+    bool Get(const std::string &key, uint64_t hash, std::string &value, std::shared_ptr<const ChunkedValue> &chunks,
+             uint64_t &version, Attributes &attributes) override {
+        return _storage->Get(key, hash, value, chunks, version, attributes);
+    }
+
+    // Implements Afina::Storage interface
+    CasResult CompareAndSet(const std::string &key, uint64_t hash, const std::string &value, uint64_t version,
+                            const Attributes &attributes = Attributes()) override;
+
+    // Implements Afina::Storage interface, value stays the same so that leases are left as they are
+    bool Touch(const std::string &key, uint64_t hash, uint64_t deadline) override {
+        return _storage->Touch(key, hash, deadline);
+    }
+
+    // Implements Afina::Storage interface, drops all leases and stale values as well
+    bool Flush() override;
+
+    // Implements Afina::Storage interface
+    Lease GetLease(const std::string &key, uint64_t hash, std::string &value, uint64_t &token) override;
+    bool PutLeased(const std::string &key, uint64_t hash, const std::string &value, uint64_t token,
+                   const Attributes &attributes = Attributes()) override;
+
+    // Implements Afina::Storage interface
+    void Stats(std::vector<std::pair<std::string, std::string>> &stats) override;
+
+    // Implements Afina::Storage interface
+    bool Publish(std::shared_ptr<ChangeStream> changes) override { return _storage->Publish(std::move(changes)); }
+
+    // Implements Afina::Storage interface
+    std::shared_ptr<ChangeStream> Changes() override { return _storage->Changes(); }
+
+    // Implements Afina::Storage interface
+    std::size_t MaxItemSize() override { return _storage->MaxItemSize(); }
+
+    // Implements Afina::Storage interface, namespace shares the lease table
+    std::shared_ptr<Afina::Storage> Namespace(const std::string &name) override;
+
+    /**
+     * Number of entries in the lease table, including expired ones not purged yet
+     */
+    std::size_t PendingLeases() const;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    // Lease table entry
+    struct lease {
+        lease() : token(0) {}
+
+        // Token of the lease granted, 0 if there is no lease
+        uint64_t token;
+        clock::time_point lease_deadline;
+
+        // Value deleted from the storage, nullptr if there is none
+        std::shared_ptr<const ChunkedValue> stale;
+        clock::time_point stale_deadline;
+
+        inline bool expired(clock::time_point now) const {
+            return (token == 0 || lease_deadline <= now) && (!stale || stale_deadline <= now);
+        }
+    };
+
+    struct shard {
+        shard() : purge_threshold(64) {}
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, lease> leases;
+
+        // Table gets cleaned of expired entries once it grows to this size
+        std::size_t purge_threshold;
+    };
+
+    // Lease table, shared with namespaces
+    struct table {
+        explicit table(std::size_t limit)
+            : next_token(0), granted(0), hot_misses(0), stale(0), rejected(0), stale_limit(limit), stale_bytes(0),
+              stale_skipped(0) {}
+
+        // Accounts stale value of the given size, false if it doesn't fit into the limit
+        bool keep_stale(std::size_t size) {
+            std::size_t used = stale_bytes.load(std::memory_order_relaxed);
+            do {
+                if (size > stale_limit - std::min(used, stale_limit)) {
+                    return false;
+                }
+            } while (!stale_bytes.compare_exchange_weak(used, used + size, std::memory_order_relaxed));
+            return true;
+        }
+
+        std::array<shard, 64> shards;
+
+        // Last lease token issued
+        std::atomic<uint64_t> next_token;
+
+        // Outcomes of GetLease misses and rejected PutLeased calls
+        std::atomic<uint64_t> granted;
+        std::atomic<uint64_t> hot_misses;
+        std::atomic<uint64_t> stale;
+        std::atomic<uint64_t> rejected;
+
+        // Total size of stale values kept and its limit, deletes which didn't fit
+        const std::size_t stale_limit;
+        std::atomic<std::size_t> stale_bytes;
+        std::atomic<uint64_t> stale_skipped;
+    };
+
+    LeasedStorage(std::shared_ptr<Afina::Storage> storage, clock::duration lease_time, std::shared_ptr<table> leases,
+                  std::string scope)
+        : _storage(std::move(storage)), _lease_time(lease_time), _table(std::move(leases)),
+          _scope(std::move(scope)) {}
+
+    inline shard &_shard(uint64_t hash) { return _table->shards[HashRange(hash, _table->shards.size())]; }
+
+    // Key of the table entry: key itself, or key prefixed by the scope of namespace
+    inline const std::string &_entry(const std::string &key, std::string &buffer) const {
+        if (_scope.empty()) {
+            return key;
+        }
+        buffer.assign(_scope).append(key);
+        return buffer;
+    }
+
+    // Drops pending lease of the key, must be called under shard lock
+    void _invalidate(shard &s, const std::string &key);
+
+    // Drops stale value of the entry, must be called under shard lock
+    void _drop_stale(lease &entry);
+
+    // Removes expired entries, must be called under shard lock
+    void _purge(shard &s, clock::time_point now);
+
+    std::shared_ptr<Afina::Storage> _storage;
+
+    // How long lease and stale value stay valid
+    const clock::duration _lease_time;
+
+    std::shared_ptr<table> _table;
+
+    // Namespace name followed by zero byte, empty for the storage itself
+    const std::string _scope;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_LEASED_STORAGE_H
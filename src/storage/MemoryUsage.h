@@ -0,0 +1,38 @@
+#ifndef AFINA_STORAGE_MEMORY_USAGE_H
+#define AFINA_STORAGE_MEMORY_USAGE_H
+
+#include <cstddef>
+#include <string>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * How many bytes of the heap malloc takes to serve request for the given size. Follows glibc
+ * ptmalloc rules: each chunk has 8 bytes header, chunks are 16 bytes aligned and at least 32 bytes long
+ */
+inline std::size_t AllocSize(std::size_t size) {
+    std::size_t chunk = (size + sizeof(std::size_t) + 15) & ~std::size_t(15);
+    return chunk < 32 ? 32 : chunk;
+}
+
+/**
+ * Heap memory owned by the string, short strings are stored inline and take no heap at all
+ */
+inline std::size_t StringHeapSize(const std::string &s) {
+    static const std::size_t inline_capacity = std::string().capacity();
+    return s.capacity() > inline_capacity ? AllocSize(s.capacity() + 1) : 0;
+}
+
+/**
+ * Same as above for a string of the given length, created as a copy of another one
+ */
+inline std::size_t StringHeapSize(std::size_t length) {
+    static const std::size_t inline_capacity = std::string().capacity();
+    return length > inline_capacity ? AllocSize(length + 1) : 0;
+}
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_MEMORY_USAGE_H
@@ -0,0 +1,408 @@
+#include "NamespacedStorage.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Afina {
+namespace Backend {
+
+constexpr uint64_t NamespacedStorage::RebalanceInterval;
+
+/**
+ * Storage bound to one namespace, given out by NamespacedStorage::Namespace. Keys are used as is,
+ * without looking at the prefix
+ */
+class NamespacedStorage::view : public Afina::Storage {
+public:
+    view(std::shared_ptr<directory> dir, space &ns) : _directory(std::move(dir)), _space(ns) {}
+    ~view() {}
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value) override { return Put(key, KeyHash(key), value); }
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value) override {
+        return PutIfAbsent(key, KeyHash(key), value);
+    }
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value) override { return Set(key, KeyHash(key), value); }
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key) override { return Delete(key, KeyHash(key)); }
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) override { return Get(key, KeyHash(key), value); }
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, uint64_t hash, const std::string &value,
+             const Attributes &attributes = Attributes()) override {
+        return _directory->writing(_space, key, value.size()).storage.Put(key, hash, value, attributes);
+    }
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value,
+                     const Attributes &attributes = Attributes()) override {
+        return _directory->writing(_space, key, value.size()).storage.PutIfAbsent(key, hash, value, attributes);
+    }
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, uint64_t hash, const std::string &value,
+             const Attributes &attributes = Attributes()) override {
+        return _directory->writing(_space, key, value.size()).storage.Set(key, hash, value, attributes);
+    }
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key, uint64_t hash) override {
+        _directory->tick();
+        return _space.storage.Delete(key, hash);
+    }
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, uint64_t hash, std::string &value) override {
+        _directory->tick();
+        return _space.hit(_space.storage.Get(key, hash, value));
+    }
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, uint64_t hash, std::string &value,
+             std::shared_ptr<const ChunkedValue> &chunks) override {
+        _directory->tick();
+        return _space.hit(_space.storage.Get(key, hash, value, chunks));
+    }
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, uint64_t hash, std::string &value, std::shared_ptr<const ChunkedValue> &chunks,
+             uint64_t &version, Attributes &attributes) override {
+        _directory->tick();
+        return _space.hit(_space.storage.Get(key, hash, value, chunks, version, attributes));
+    }
+
+    // Implements Afina::Storage interface
+    CasResult CompareAndSet(const std::string &key, uint64_t hash, const std::string &value, uint64_t version,
+                            const Attributes &attributes = Attributes()) override {
+        auto &storage = _directory->writing(_space, key, value.size()).storage;
+        return storage.CompareAndSet(key, hash, value, version, attributes);
+    }
+
+    // Implements Afina::Storage interface
+    bool Touch(const std::string &key, uint64_t hash, uint64_t deadline) override {
+        _directory->tick();
+        return _space.storage.Touch(key, hash, deadline);
+    }
+
+    // Implements Afina::Storage interface, flushes this namespace only
+    bool Flush() override { return _space.storage.Flush(); }
+
+    // Implements Afina::Storage interface
+    std::size_t MaxItemSize() override { return _space.config.hard ? _space.config.quota : _directory->max_size; }
+
+    // Implements Afina::Storage interface
+    std::shared_ptr<Afina::Storage> Namespace(const std::string &name) override {
+        auto it = _directory->by_name.find(name);
+        if (it == _directory->by_name.end()) {
+            return nullptr;
+        }
+        return std::make_shared<view>(_directory, *it->second);
+    }
+
+    // Implements Afina::Storage interface
+    std::shared_ptr<ChangeStream> Changes() override { return _space.storage.Changes(); }
+
+    // Implements Afina::Storage interface
+    void Stats(std::vector<std::pair<std::string, std::string>> &stats) override { _space.storage.Stats(stats); }
+
+private:
+    // Keeps namespaces alive as long as connection uses them
+    std::shared_ptr<directory> _directory;
+    space &_space;
+};
+
+// See NamespacedStorage.h
+std::vector<NamespacedStorage::Config> NamespacedStorage::ParseConfig(const std::string &config) {
+    std::vector<Config> result;
+    std::size_t begin = 0;
+    while (begin < config.size()) {
+        std::size_t end = config.find(',', begin);
+        if (end == std::string::npos) {
+            end = config.size();
+        }
+
+        std::string entry = config.substr(begin, end - begin);
+        std::size_t eq = entry.find('=');
+        if (eq == std::string::npos || eq == 0) {
+            throw std::runtime_error("Namespace expected in form name=quota[:hard]: " + entry);
+        }
+
+        Config ns;
+        ns.name = entry.substr(0, eq);
+        std::string quota = entry.substr(eq + 1);
+        std::size_t colon = quota.find(':');
+        if (colon != std::string::npos) {
+            std::string mode = quota.substr(colon + 1);
+            if (mode == "hard") {
+                ns.hard = true;
+            } else if (mode != "soft") {
+                throw std::runtime_error("Unknown namespace quota mode: " + mode);
+            }
+            quota.resize(colon);
+        }
+        if (quota.empty() || quota.find_first_not_of("0123456789") != std::string::npos) {
+            throw std::runtime_error("Invalid namespace quota: " + entry);
+        }
+        ns.quota = std::stoull(quota);
+
+        result.push_back(ns);
+        begin = end + 1;
+    }
+    return result;
+}
+
+// See NamespacedStorage.h
+NamespacedStorage::NamespacedStorage(std::size_t max_size, const std::vector<Config> &namespaces,
+                                     SimpleLRU::Accounting accounting, std::shared_ptr<RssMonitor> rss_monitor,
+                                     SimpleLRU::Policy policy, char separator)
+    : _directory(std::make_shared<directory>(max_size, accounting, separator)) {
+    std::size_t total = 0;
+    bool has_default = false;
+    for (auto &ns : namespaces) {
+        if (ns.name.find(separator) != std::string::npos) {
+            throw std::runtime_error("Namespace name must not contain separator: " + ns.name);
+        }
+        has_default = has_default || ns.name == "default";
+        total += ns.quota;
+    }
+    if (total > max_size) {
+        throw std::runtime_error("Namespace quotas exceed storage size");
+    }
+
+    std::vector<Config> all(namespaces);
+    if (!has_default) {
+        all.emplace_back("default", max_size - total, false);
+    }
+
+    for (auto &ns : all) {
+        std::unique_ptr<space> s(new space(ns, accounting, rss_monitor, policy));
+        uint64_t prefix_hash = KeyHash(ns.name.data(), ns.name.size());
+        if (!_directory->by_name.emplace(ns.name, s.get()).second ||
+            !_directory->by_prefix.emplace(prefix_hash, s.get()).second) {
+            throw std::runtime_error("Duplicate namespace: " + ns.name);
+        }
+        _directory->spaces.push_back(std::move(s));
+    }
+
+    // Default namespace might get no quota, then it lives on memory others don't use
+    _directory->fallback = _directory->by_name["default"];
+    _directory->rebalance();
+}
+
+NamespacedStorage::space &NamespacedStorage::directory::select(const std::string &key) {
+    std::size_t end = key.find(separator);
+    if (end == std::string::npos) {
+        return *fallback;
+    }
+
+    // Prefix is looked up by its hash, so that no string gets built for it
+    auto it = by_prefix.find(KeyHash(key.data(), end));
+    if (it == by_prefix.end() || it->second->config.name.compare(0, std::string::npos, key, 0, end) != 0) {
+        return *fallback;
+    }
+    return *it->second;
+}
+
+void NamespacedStorage::directory::rebalance(space *owner) {
+    // One periodic rebalance at a time is enough, others skip it. Owner taking its quota back waits
+    std::unique_lock<std::mutex> lock(rebalance_mutex, std::defer_lock);
+    if (owner != nullptr) {
+        lock.lock();
+    } else if (!lock.try_lock()) {
+        return;
+    }
+
+    // Hard namespaces and the owner claim whole quota, soft ones claim only memory they use
+    std::vector<std::size_t> claims(spaces.size());
+    std::size_t claimed = 0;
+    std::size_t soft = 0;
+    for (std::size_t i = 0; i < spaces.size(); i++) {
+        space &s = *spaces[i];
+        std::size_t usage = used(s.storage.MemoryUsage());
+        claims[i] = s.config.hard || &s == owner ? std::max(usage, s.config.quota) : usage;
+        claimed += claims[i];
+        if (!s.config.hard) {
+            soft++;
+        }
+    }
+
+    // Borrowers give memory back, down to their own quotas, until all claims fit
+    for (std::size_t i = 0; i < spaces.size() && claimed > max_size; i++) {
+        space &s = *spaces[i];
+        if (s.config.hard || &s == owner || claims[i] <= s.config.quota) {
+            continue;
+        }
+        std::size_t cut = std::min(claims[i] - s.config.quota, claimed - max_size);
+        claims[i] -= cut;
+        claimed -= cut;
+    }
+
+    // Only memory nobody claims is lent, so that limits never sum up to more than max_size
+    std::size_t lendable = claimed < max_size ? max_size - claimed : 0;
+    for (std::size_t i = 0; i < spaces.size(); i++) {
+        if (!spaces[i]->config.hard) {
+            // Shrinking limit evicts borrowed memory, and so owners get it back
+            spaces[i]->storage.Resize(claims[i] + lendable / soft);
+        }
+    }
+}
+
+void NamespacedStorage::directory::reclaim(space &owner) {
+    // Namespace above its quota is a borrower itself, it evicts own items
+    if (used(owner.storage.MemoryUsage()) < owner.config.quota) {
+        rebalance(&owner);
+    }
+}
+
+// See NamespacedStorage.h
+bool NamespacedStorage::Put(const std::string &key, uint64_t hash, const std::string &value,
+                            const Attributes &attributes) {
+    space &s = _directory->writing(_directory->select(key), key, value.size());
+    return s.storage.Put(key, hash, value, attributes);
+}
+
+// See NamespacedStorage.h
+bool NamespacedStorage::PutChunked(const std::string &key, uint64_t hash, std::shared_ptr<const ChunkedValue> value,
+                                   const Attributes &attributes) {
+    space &s = _directory->writing(_directory->select(key), key, value->size());
+    return s.storage.PutChunked(key, hash, std::move(value), attributes);
+}
+
+// See NamespacedStorage.h
+bool NamespacedStorage::PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value,
+                                    const Attributes &attributes) {
+    space &s = _directory->writing(_directory->select(key), key, value.size());
+    return s.storage.PutIfAbsent(key, hash, value, attributes);
+}
+
+// See NamespacedStorage.h
+bool NamespacedStorage::Set(const std::string &key, uint64_t hash, const std::string &value,
+                            const Attributes &attributes) {
+    space &s = _directory->writing(_directory->select(key), key, value.size());
+    return s.storage.Set(key, hash, value, attributes);
+}
+
+// See NamespacedStorage.h
+bool NamespacedStorage::Delete(const std::string &key, uint64_t hash) {
+    _directory->tick();
+    return _directory->select(key).storage.Delete(key, hash);
+}
+
+// See NamespacedStorage.h
+bool NamespacedStorage::Get(const std::string &key, uint64_t hash, std::string &value) {
+    _directory->tick();
+    space &s = _directory->select(key);
+    return s.hit(s.storage.Get(key, hash, value));
+}
+
+// See NamespacedStorage.h
+bool NamespacedStorage::Get(const std::string &key, uint64_t hash, std::string &value,
+                            std::shared_ptr<const ChunkedValue> &chunks) {
+    _directory->tick();
+    space &s = _directory->select(key);
+    return s.hit(s.storage.Get(key, hash, value, chunks));
+}
+
+// See NamespacedStorage.h
+bool NamespacedStorage::Get(const std::string &key, uint64_t hash, std::string &value,
+                            std::shared_ptr<const ChunkedValue> &chunks, uint64_t &version,
+                            Attributes &attributes) {
+    _directory->tick();
+    space &s = _directory->select(key);
+    return s.hit(s.storage.Get(key, hash, value, chunks, version, attributes));
+}
+
+// See NamespacedStorage.h
+Storage::CasResult NamespacedStorage::CompareAndSet(const std::string &key, uint64_t hash, const std::string &value,
+                                                    uint64_t version, const Attributes &attributes) {
+    space &s = _directory->writing(_directory->select(key), key, value.size());
+    return s.storage.CompareAndSet(key, hash, value, version, attributes);
+}
+
+// See NamespacedStorage.h
+bool NamespacedStorage::Touch(const std::string &key, uint64_t hash, uint64_t deadline) {
+    _directory->tick();
+    return _directory->select(key).storage.Touch(key, hash, deadline);
+}
+
+// See NamespacedStorage.h
+bool NamespacedStorage::Flush() {
+    for (auto &s : _directory->spaces) {
+        s->storage.Flush();
+    }
+    return true;
+}
+
+// See NamespacedStorage.h
+std::shared_ptr<Afina::Storage> NamespacedStorage::Namespace(const std::string &name) {
+    auto it = _directory->by_name.find(name);
+    if (it == _directory->by_name.end()) {
+        return nullptr;
+    }
+    return std::make_shared<view>(_directory, *it->second);
+}
+
+// See NamespacedStorage.h
+bool NamespacedStorage::Publish(std::shared_ptr<ChangeStream> changes) {
+    for (auto &s : _directory->spaces) {
+        s->storage.Publish(changes);
+    }
+    return true;
+}
+
+// See NamespacedStorage.h
+void NamespacedStorage::Stats(std::vector<std::pair<std::string, std::string>> &stats) {
+    SimpleLRU::Usage total;
+    uint64_t hits = 0, misses = 0;
+    for (auto &s : _directory->spaces) {
+        auto usage = s->storage.MemoryUsage();
+        uint64_t ns_hits = s->hits.load(std::memory_order_relaxed);
+        uint64_t ns_misses = s->misses.load(std::memory_order_relaxed);
+
+        std::string prefix = "ns_" + s->config.name + "_";
+        stats.emplace_back(prefix + "quota", std::to_string(s->config.quota));
+        stats.emplace_back(prefix + "hard", s->config.hard ? "1" : "0");
+        stats.emplace_back(prefix + "limit", std::to_string(usage.limit));
+        stats.emplace_back(prefix + "items", std::to_string(usage.items));
+        stats.emplace_back(prefix + "bytes", std::to_string(usage.payload));
+        stats.emplace_back(prefix + "memory_footprint", std::to_string(usage.footprint));
+        stats.emplace_back(prefix + "evictions", std::to_string(usage.evictions));
+        stats.emplace_back(prefix + "get_hits", std::to_string(ns_hits));
+        stats.emplace_back(prefix + "get_misses", std::to_string(ns_misses));
+
+        total += usage;
+        hits += ns_hits;
+        misses += ns_misses;
+    }
+
+    stats.emplace_back("namespaces", std::to_string(_directory->spaces.size()));
+    stats.emplace_back("curr_items", std::to_string(total.items));
+    stats.emplace_back("bytes", std::to_string(total.payload));
+    stats.emplace_back("memory_footprint", std::to_string(total.footprint));
+    stats.emplace_back("limit_maxbytes", std::to_string(_directory->max_size));
+    stats.emplace_back("evictions", std::to_string(total.evictions));
+    stats.emplace_back("storage_get_hits", std::to_string(hits));
+    stats.emplace_back("storage_get_misses", std::to_string(misses));
+}
+
+// See NamespacedStorage.h
+void NamespacedStorage::Rebalance() { _directory->rebalance(); }
+
+// See NamespacedStorage.h
+SimpleLRU::Usage NamespacedStorage::NamespaceUsage(const std::string &name) const {
+    auto it = _directory->by_name.find(name);
+    if (it == _directory->by_name.end()) {
+        throw std::runtime_error("Unknown namespace: " + name);
+    }
+    return it->second->storage.MemoryUsage();
+}
+
+} // namespace Backend
+} // namespace Afina
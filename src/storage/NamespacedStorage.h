@@ -0,0 +1,222 @@
+#ifndef AFINA_STORAGE_NAMESPACED_STORAGE_H
+#define AFINA_STORAGE_NAMESPACED_STORAGE_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <afina/Hash.h>
+#include <afina/Storage.h>
+
+#include "ThreadSafeSimpleLRU.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Storage split into namespaces
+ * Each namespace is a separate eviction domain with its own memory quota, so that one tenant filling the
+ * cache evicts only its own items:
+ * - hard quota is never exceeded
+ * - soft quota is guaranteed, but namespace could also borrow memory other namespaces don't use at the
+ *   moment. Borrowed memory is given back, by evicting, as soon as owners start to use it
+ *
+ * Namespace is selected either by the key prefix, up to the first separator ("app:key" goes to "app"), or
+ * by the connection: see Storage::Namespace, then all keys go to that namespace as is. Keys that don't match
+ * any namespace go to the "default" one, which takes the memory not given to others and has soft quota.
+ *
+ * Selection costs one extra hash probe of the namespaces table, key hash is passed down unchanged.
+ *
+ * Thread safe, each namespace has its own lock.
+ */
+class NamespacedStorage : public Afina::Storage {
+public:
+    /**
+     * Namespace configuration
+     */
+    struct Config {
+        Config() : quota(0), hard(false) {}
+        Config(const std::string &name, std::size_t quota, bool hard) : name(name), quota(quota), hard(hard) {}
+
+        std::string name;
+
+        // Memory limit, in units of the accounting mode
+        std::size_t quota;
+
+        // If false namespace could borrow unused memory of others
+        bool hard;
+    };
+
+    /**
+     * Parses list of namespaces in form "name=quota[:hard],...", i.e "app1=1048576:hard,app2=2097152"
+     */
+    static std::vector<Config> ParseConfig(const std::string &config);
+
+    /**
+     * @param max_size total memory limit, whatever is left after all namespaces goes to the default one
+     * @param namespaces list of namespaces, without the default one
+     * @param separator ends namespace name in the key
+     */
+    NamespacedStorage(std::size_t max_size, const std::vector<Config> &namespaces,
+                      SimpleLRU::Accounting accounting = SimpleLRU::Accounting::Payload,
+                      std::shared_ptr<RssMonitor> rss_monitor = nullptr,
+                      SimpleLRU::Policy policy = SimpleLRU::Policy::Lru, char separator = ':');
+    ~NamespacedStorage() {}
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value) override { return Put(key, KeyHash(key), value); }
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value) override {
+        return PutIfAbsent(key, KeyHash(key), value);
+    }
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value) override { return Set(key, KeyHash(key), value); }
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key) override { return Delete(key, KeyHash(key)); }
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) override { return Get(key, KeyHash(key), value); }
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, uint64_t hash, const std::string &value,
+             const Attributes &attributes = Attributes()) override;
+    bool PutChunked(const std::string &key, uint64_t hash, std::shared_ptr<const ChunkedValue> value,
+                    const Attributes &attributes = Attributes()) override;
+    bool PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value,
+                     const Attributes &attributes = Attributes()) override;
+    bool Set(const std::string &key, uint64_t hash, const std::string &value,
+             const Attributes &attributes = Attributes()) override;
+    bool Delete(const std::string &key, uint64_t hash) override;
+    bool Get(const std::string &key, uint64_t hash, std::string &value) override;
+    bool Get(const std::string &key, uint64_t hash, std::string &value,
+             std::shared_ptr<const ChunkedValue> &chunks) override;
+    bool Get(const std::string &key, uint64_t hash, std::string &value, std::shared_ptr<const ChunkedValue> &chunks,
+             uint64_t &version, Attributes &attributes) override;
+
+    // Implements Afina::Storage interface
+    CasResult CompareAndSet(const std::string &key, uint64_t hash, const std::string &value, uint64_t version,
+                            const Attributes &attributes = Attributes()) override;
+
+    // Implements Afina::Storage interface
+    bool Touch(const std::string &key, uint64_t hash, uint64_t deadline) override;
+
+    // Implements Afina::Storage interface, flushes all namespaces
+    bool Flush() override;
+
+    // Implements Afina::Storage interface
+    std::shared_ptr<Afina::Storage> Namespace(const std::string &name) override;
+
+    // Implements Afina::Storage interface
+    bool Publish(std::shared_ptr<ChangeStream> changes) override;
+
+    // Implements Afina::Storage interface
+    std::shared_ptr<ChangeStream> Changes() override { return _directory->fallback->storage.Changes(); }
+
+    // Implements Afina::Storage interface, namespace with soft quota could borrow all the memory
+    std::size_t MaxItemSize() override { return _directory->max_size; }
+
+    // Implements Afina::Storage interface
+    void Stats(std::vector<std::pair<std::string, std::string>> &stats) override;
+
+    /**
+     * Recomputes limits of namespaces with soft quota. Gets called automatically every RebalanceInterval
+     * operations
+     */
+    void Rebalance();
+
+    /**
+     * Memory usage of the namespace with given name
+     */
+    SimpleLRU::Usage NamespaceUsage(const std::string &name) const;
+
+    // Number of operations between automatic rebalances
+    static constexpr uint64_t RebalanceInterval = 1024;
+
+private:
+    class view;
+
+    // Namespace: eviction domain with its stats
+    struct space {
+        space(const Config &config, SimpleLRU::Accounting accounting, std::shared_ptr<RssMonitor> rss_monitor,
+              SimpleLRU::Policy policy)
+            : config(config), storage(config.quota, accounting, std::move(rss_monitor), policy), hits(0),
+              misses(0) {}
+
+        const Config config;
+        ThreadSafeSimplLRU storage;
+        std::atomic<uint64_t> hits;
+        std::atomic<uint64_t> misses;
+
+        // Counts get result
+        inline bool hit(bool found) {
+            (found ? hits : misses).fetch_add(1, std::memory_order_relaxed);
+            return found;
+        }
+    };
+
+    // Namespaces table, shared with connection bound views
+    struct directory {
+        directory(std::size_t max_size, SimpleLRU::Accounting accounting, char separator)
+            : max_size(max_size), accounting(accounting), separator(separator), fallback(nullptr), ops(0) {}
+
+        // Namespace the key belongs to
+        space &select(const std::string &key);
+
+        // Counts operation and rebalances quotas when it is time to
+        inline void tick() {
+            if (ops.fetch_add(1, std::memory_order_relaxed) % RebalanceInterval == RebalanceInterval - 1) {
+                rebalance();
+            }
+        }
+
+        // Same as tick, but also makes sure owner doesn't evict its items while others borrow its quota
+        inline space &writing(space &s, const std::string &key, std::size_t value_size) {
+            tick();
+            if (!s.config.hard && !s.storage.Fits(key.size(), value_size)) {
+                reclaim(s);
+            }
+            return s;
+        }
+
+        /**
+         * Sets limits of soft namespaces: each keeps what it uses, memory nobody uses is split between them.
+         * Owner, if given, gets its whole quota back from borrowers right away
+         */
+        void rebalance(space *owner = nullptr);
+
+        // Rebalances for the namespace if it is below its quota
+        void reclaim(space &owner);
+
+        // Memory used by namespace, in units of the accounting mode
+        inline std::size_t used(const SimpleLRU::Usage &usage) const {
+            return accounting == SimpleLRU::Accounting::Payload ? usage.payload : usage.footprint;
+        }
+
+        const std::size_t max_size;
+        const SimpleLRU::Accounting accounting;
+        const char separator;
+
+        std::vector<std::unique_ptr<space>> spaces;
+        std::unordered_map<std::string, space *> by_name;
+
+        // Namespaces by KeyHash of the name, probed with the key prefix
+        std::unordered_map<uint64_t, space *> by_prefix;
+        space *fallback;
+
+        std::atomic<uint64_t> ops;
+        std::mutex rebalance_mutex;
+    };
+
+    std::shared_ptr<directory> _directory;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_NAMESPACED_STORAGE_H
@@ -0,0 +1,88 @@
+#include "RssMonitor.h"
+
+#include <cstdio>
+
+#include <fcntl.h>
+#include <malloc.h>
+#include <unistd.h>
+
+namespace Afina {
+namespace Backend {
+
+// See RssMonitor.h
+RssMonitor::RssMonitor(std::size_t limit, std::chrono::milliseconds period)
+    : _limit(limit), _period(period), _rss(0), _generation(0), _running(false) {}
+
+// See RssMonitor.h
+RssMonitor::~RssMonitor() { Stop(); }
+
+// See RssMonitor.h
+void RssMonitor::Start() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_running) {
+        return;
+    }
+    _running = true;
+    _thread = std::thread(&RssMonitor::OnRun, this);
+}
+
+// See RssMonitor.h
+void RssMonitor::Stop() {
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _running = false;
+        _stop_condition.notify_all();
+    }
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+// See RssMonitor.h
+void RssMonitor::Sample() {
+    std::size_t rss = ReadRss();
+    if (rss > _limit) {
+        // Freed chunks stay in malloc arenas, so evictions alone doesn't decrease RSS
+        malloc_trim(0);
+        rss = ReadRss();
+    }
+    _rss.store(rss, std::memory_order_relaxed);
+    _generation.fetch_add(1, std::memory_order_release);
+}
+
+// See RssMonitor.h
+std::size_t RssMonitor::ReadRss() {
+    int fd = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return 0;
+    }
+
+    char buf[128];
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) {
+        return 0;
+    }
+    buf[n] = '\0';
+
+    // statm: size resident shared text lib data dt, in pages
+    unsigned long size = 0, resident = 0;
+    if (sscanf(buf, "%lu %lu", &size, &resident) != 2) {
+        return 0;
+    }
+    return std::size_t(resident) * std::size_t(sysconf(_SC_PAGESIZE));
+}
+
+// See RssMonitor.h
+void RssMonitor::OnRun() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (_running) {
+        lock.unlock();
+        Sample();
+        lock.lock();
+        _stop_condition.wait_for(lock, _period, [this] { return !_running; });
+    }
+}
+
+} // namespace Backend
+} // namespace Afina
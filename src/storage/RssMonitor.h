@@ -0,0 +1,81 @@
+#ifndef AFINA_STORAGE_RSS_MONITOR_H
+#define AFINA_STORAGE_RSS_MONITOR_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Process memory footprint watcher
+ * Periodically samples resident set size of the whole process and publishes it for storages
+ * working in RSS bounded mode (see SimpleLRU::Accounting::Rss). Storages compare published
+ * value with the limit and shrink/grow their own budgets accordingly.
+ *
+ * Each sample increments generation counter so that storage could cheaply check whether there
+ * is new data to react on.
+ */
+class RssMonitor {
+public:
+    RssMonitor(std::size_t limit, std::chrono::milliseconds period = std::chrono::milliseconds(100));
+    ~RssMonitor();
+
+    /**
+     * Starts background thread which samples RSS every period
+     */
+    void Start();
+
+    /**
+     * Stops background thread, last sample remains available
+     */
+    void Stop();
+
+    /**
+     * Takes new sample right now. If process is above the limit then asks allocator to
+     * return free memory back to the OS, so that evictions become visible in RSS
+     */
+    void Sample();
+
+    // Memory limit for the whole process
+    inline std::size_t Limit() const { return _limit; }
+
+    // RSS observed by the last sample, in bytes
+    inline std::size_t Rss() const { return _rss.load(std::memory_order_relaxed); }
+
+    // Number of samples taken so far
+    inline uint64_t Generation() const { return _generation.load(std::memory_order_acquire); }
+
+    /**
+     * Reads current RSS of the process from /proc, returns 0 if it is not available
+     */
+    static std::size_t ReadRss();
+
+private:
+    RssMonitor(const RssMonitor &) = delete;
+    RssMonitor &operator=(const RssMonitor &) = delete;
+
+    void OnRun();
+
+    const std::size_t _limit;
+    const std::chrono::milliseconds _period;
+
+    std::atomic<std::size_t> _rss;
+    std::atomic<uint64_t> _generation;
+
+    // Background sampling thread and means to stop it
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _stop_condition;
+    bool _running;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_RSS_MONITOR_H
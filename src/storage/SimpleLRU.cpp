@@ -1,109 +1,537 @@
 #include "SimpleLRU.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
 #include <memory>
 
+#include <afina/Hash.h>
+
+#include "MemoryUsage.h"
+
 namespace Afina {
 namespace Backend {
 
+namespace {
+
+// Item versions are unique in the whole process, so that item which moves between storages (i.e size classes)
+// never gets the version it once had back
+std::atomic<uint64_t> last_version(0);
+
+inline uint64_t NextVersion() { return last_version.fetch_add(1, std::memory_order_relaxed) + 1; }
+
+} // namespace
+
 // See MapBasedGlobalLockImpl.h
 bool SimpleLRU::Put(const std::string &key, const std::string &value) {
-    auto it = _lru_index.find(key);
-    return _put(key, value, it);
+    return SimpleLRU::Put(key, KeyHash(key), value);
 }
 
 // See MapBasedGlobalLockImpl.h
 bool SimpleLRU::PutIfAbsent(const std::string &key, const std::string &value) {
-    auto it = _lru_index.find(key);
-    if (it != _lru_index.end()) {
-        return false;
+    return SimpleLRU::PutIfAbsent(key, KeyHash(key), value);
+}
+
+SimpleLRU::lru_node *SimpleLRU::_find(const std::string &key, uint64_t hash) {
+    lru_node *node = _lru_index.Find(hash, [&key](const lru_node &node) { return node.key == key; });
+    if (node != nullptr && node->deadline != 0 && node->deadline <= Now()) {
+        // Storage drops expired item on its own, same as evicted one
+        _publish(ChangeStream::Type::Evict, node->key, node->value_size());
+        _erase(node);
+        return nullptr;
     }
-    return _put(key, value, it);
+    return node;
 }
 
-bool SimpleLRU::_put(const std::string &key, const std::string &value, node_map::iterator it) {
-    std::size_t put_size = key.length() + value.length();
-    if (put_size > _max_size) {
+bool SimpleLRU::_put(const std::string &key, uint64_t hash, const std::string &value, lru_node *node,
+                     const Attributes &attributes, const std::shared_ptr<const ChunkedValue> &chunks) {
+    _follow_rss();
+
+    std::size_t value_size = chunks ? chunks->size() : value.size();
+    std::size_t put_size = _charge(key.length(), value_size);
+    if (put_size > _limit) {
         return false; // need log?
     }
     std::size_t match_key_size = 0;
     //если мы заменяем ключ значение, то общий размер считаем за вычетом заменяемого
-    if (it != _lru_index.end()) {
-        match_key_size = it->second.get().key.length() + it->second.get().value.length();
+    if (node != nullptr) {
+        match_key_size = _charge(*node);
     }
-    while (current_size - match_key_size + put_size > _max_size) {
-        if (_lru_head->key == key) {
+    while (_lru_head && _used() - match_key_size + put_size > _limit) {
+        if (_victim() == node) {
+            // Replaced element itself is going to be evicted, so that is an insert now
             match_key_size = 0;
+            node = nullptr;
         }
-        current_size -= _lru_head->key.length() + _lru_head->value.length();
-        lru_node *new_head = _lru_head->next.get();
-        new_head->prev = _lru_head->prev;
-        _lru_head->next.release();
-        _lru_index.erase(_lru_head->key);
-        _lru_head.reset(new_head);
+        _evict();
     }
     //Добавляем ключ
-    if (_lru_head) {
-        if (it != _lru_index.end()) {
-            auto &old_value = it->second.get().value;
-            current_size -= key.length() + old_value.length();
-            old_value = value;
-        } else {
-            auto freshest = _lru_head->prev; // regular ptr;
-            freshest->next.reset(new lru_node(key, value));
-            freshest->next->prev = freshest;
-            _lru_head->prev = freshest->next.get();
-            _lru_index.emplace(_lru_head->prev->key, *_lru_head->prev);
+    if (node != nullptr) {
+        current_size -= node->value_size();
+        _footprint -= node->footprint;
+
+        _assign(*node, value, chunks);
+        node->version = NextVersion();
+        node->flags = attributes.flags;
+        if (attributes.deadline != Attributes::KeepDeadline) {
+            node->deadline = attributes.deadline;
+        }
+        node->footprint = _footprint_of(*node);
+        current_size += node->value_size();
+        _footprint += node->footprint;
+        _touch(node);
+
+        // Value buffer might be reused and so be bigger than estimated, make room for it
+        while (_used() > _limit && _victim() != node) {
+            _evict();
         }
     } else {
-        _lru_head.reset(new lru_node(key, value));
-        _lru_head->prev = _lru_head.get();
-        _lru_index.emplace(_lru_head->prev->key, *_lru_head->prev);
+        node = new lru_node(key, hash);
+        _assign(*node, value, chunks);
+        node->version = NextVersion();
+        node->flags = attributes.flags;
+        node->deadline = attributes.deadline != Attributes::KeepDeadline ? attributes.deadline : 0;
+        _append(std::unique_ptr<lru_node>(node));
+        _lru_index.Insert(node);
+
+        node->footprint = _footprint_of(*node);
+        current_size += key.length() + value_size;
+        _footprint += node->footprint;
+        _items++;
+        if (_policy == Policy::Gdsf) {
+            _heap_push(node);
+        }
+
+        // Index table might have grown, make room for it
+        while (_used() > _limit && _victim() != node) {
+            _evict();
+        }
     }
-    current_size += key.length() + value.length();
+    _publish(ChangeStream::Type::Put, key, value_size);
     return true;
 }
-// See MapBasedGlobalLockImpl.h
-bool SimpleLRU::Set(const std::string &key, const std::string &value) {
-    auto it = _lru_index.find(key);
-    if (it == _lru_index.end()) {
-        return false;
+
+void SimpleLRU::_evict() {
+    lru_node *victim = _victim();
+    if (_policy == Policy::Gdsf) {
+        // Aging: items inserted or hit from now on start from the priority of the evicted one
+        _clock = _heap.front().priority;
     }
-    return _put(key, value, it);
+    _publish(ChangeStream::Type::Evict, victim->key, victim->value_size());
+    _erase(victim);
+    _evictions++;
 }
 
-// See MapBasedGlobalLockImpl.h
-bool SimpleLRU::Delete(const std::string &key) {
-    auto it = _lru_index.find(key);
-    if (it == _lru_index.end()) {
-        return false;
+void SimpleLRU::_erase(lru_node *node) {
+    current_size -= node->key.length() + node->value_size();
+    _footprint -= node->footprint;
+    _items--;
+    _lru_index.Erase(node);
+    if (_policy == Policy::Gdsf) {
+        _heap_erase(node);
     }
-    auto &lru_node = it->second.get();
-    _lru_index.erase(key);
-    current_size -= key.length() + lru_node.value.length();
-    auto prev = lru_node.prev;
-    auto next = lru_node.next.get();
+
+    _unlink(node);
+}
+
+std::unique_ptr<SimpleLRU::lru_node> SimpleLRU::_unlink(lru_node *node) {
+    auto prev = node->prev;
+    std::unique_ptr<lru_node> next(std::move(node->next));
+    std::unique_ptr<lru_node> self;
     if (next) {
         next->prev = prev;
     } else {
         _lru_head->prev = prev;
     }
-    if (_lru_head->key == key) {
-        _lru_head->next.release();
-        _lru_head.reset(next);
+    if (_lru_head.get() == node) {
+        self = std::move(_lru_head);
+        _lru_head = std::move(next);
     } else {
-        prev->next.reset(next);
+        self = std::move(prev->next);
+        prev->next = std::move(next);
     }
-    return true;
+    return self;
+}
+
+void SimpleLRU::_append(std::unique_ptr<lru_node> node) {
+    lru_node *freshest = node.get();
+    if (_lru_head) {
+        freshest->prev = _lru_head->prev;
+        _lru_head->prev->next = std::move(node);
+        _lru_head->prev = freshest;
+    } else {
+        _lru_head = std::move(node);
+        _lru_head->prev = freshest;
+    }
+}
+
+void SimpleLRU::_touch(lru_node *node) {
+    if (_policy != Policy::Gdsf) {
+        if (_lru_head->prev != node) {
+            _append(_unlink(node));
+        }
+        return;
+    }
+    if (node->frequency < std::numeric_limits<uint32_t>::max()) {
+        node->frequency++;
+    }
+    // Update might change size as well, so priority could move either way
+    _heap[node->heap_index].priority = _priority(*node);
+    _sift_up(node->heap_index);
+    _sift_down(node->heap_index);
+}
+
+double SimpleLRU::_priority(const lru_node &node) const {
+    // GDSF with uniform cost: priority = L + frequency / size, where L is the aging clock
+    std::size_t size = std::max<std::size_t>(1, _charge(node));
+    return _clock + double(node.frequency) / double(size);
+}
+
+void SimpleLRU::_heap_push(lru_node *node) {
+    node->frequency = 1;
+    node->heap_index = _heap.size();
+    _heap.push_back(heap_entry{_priority(*node), node});
+    _sift_up(node->heap_index);
+}
+
+void SimpleLRU::_heap_erase(lru_node *node) {
+    std::size_t index = node->heap_index;
+    std::size_t last = _heap.size() - 1;
+    if (index != last) {
+        _heap[index] = _heap[last];
+        _heap[index].node->heap_index = index;
+    }
+    _heap.pop_back();
+    if (index < _heap.size()) {
+        _sift_up(index);
+        _sift_down(index);
+    }
+}
+
+void SimpleLRU::_sift_up(std::size_t index) {
+    heap_entry entry = _heap[index];
+    while (index > 0) {
+        std::size_t parent = (index - 1) / HeapArity;
+        if (_heap[parent].priority <= entry.priority) {
+            break;
+        }
+        _heap[index] = _heap[parent];
+        _heap[index].node->heap_index = index;
+        index = parent;
+    }
+    _heap[index] = entry;
+    entry.node->heap_index = index;
+}
+
+void SimpleLRU::_sift_down(std::size_t index) {
+    heap_entry entry = _heap[index];
+    std::size_t size = _heap.size();
+    while (true) {
+        std::size_t first = index * HeapArity + 1;
+        if (first >= size) {
+            break;
+        }
+
+        std::size_t last = std::min(first + HeapArity, size);
+        std::size_t min = first;
+        for (std::size_t child = first + 1; child < last; ++child) {
+            if (_heap[child].priority < _heap[min].priority) {
+                min = child;
+            }
+        }
+        if (entry.priority <= _heap[min].priority) {
+            break;
+        }
+        _heap[index] = _heap[min];
+        _heap[index].node->heap_index = index;
+        index = min;
+    }
+    _heap[index] = entry;
+    entry.node->heap_index = index;
+}
+
+std::size_t SimpleLRU::_charge(std::size_t key_size, std::size_t value_size) const {
+    if (_accounting == Accounting::Payload) {
+        return key_size + value_size;
+    }
+    // Fresh copy of a string takes exactly as much as the source length
+    return _node_overhead() + StringHeapSize(key_size) + _value_heap_size(value_size);
+}
+
+std::size_t SimpleLRU::_value_heap_size(std::size_t size) {
+    if (size <= ChunkedValue::ChunkSize) {
+        return StringHeapSize(size);
+    }
+
+    // make_shared places value and reference counters into a single allocation
+    std::size_t result = AllocSize(sizeof(ChunkedValue) + 2 * sizeof(long) + sizeof(void *));
+    result += (size / ChunkedValue::ChunkSize) * AllocSize(ChunkedValue::ChunkAllocSize(ChunkedValue::ChunkSize));
+    if (size % ChunkedValue::ChunkSize != 0) {
+        result += AllocSize(ChunkedValue::ChunkAllocSize(size % ChunkedValue::ChunkSize));
+    }
+    return result;
+}
+
+void SimpleLRU::_assign(lru_node &node, const std::string &value, const std::shared_ptr<const ChunkedValue> &chunks) {
+    if (chunks && chunks->size() > ChunkedValue::ChunkSize) {
+        // Value built outside is adopted as is
+        std::string().swap(node.value);
+        node.chunks = chunks;
+    } else if (chunks) {
+        node.chunks.reset();
+        chunks->CopyTo(node.value);
+    } else if (value.size() <= ChunkedValue::ChunkSize) {
+        node.chunks.reset();
+        node.value = value;
+    } else {
+        // Readers might still hold the previous chain, it is never modified in place
+        std::string().swap(node.value);
+        node.chunks = std::make_shared<const ChunkedValue>(value);
+    }
+}
+
+std::size_t SimpleLRU::_node_overhead() { return AllocSize(sizeof(lru_node)); }
+
+std::size_t SimpleLRU::_footprint_of(const lru_node &node) {
+    std::size_t value = node.chunks ? _value_heap_size(node.chunks->size()) : StringHeapSize(node.value);
+    return _node_overhead() + StringHeapSize(node.key) + value;
+}
+
+void SimpleLRU::_follow_rss() {
+    if (_accounting != Accounting::Rss) {
+        return;
+    }
+
+    uint64_t generation = _rss_monitor->Generation();
+    if (generation == _rss_generation) {
+        return;
+    }
+    _rss_generation = generation;
+
+    std::size_t rss = _rss_monitor->Rss();
+    std::size_t rss_limit = _rss_monitor->Limit();
+    if (rss == 0) {
+        return;
+    }
+
+    if (rss > rss_limit) {
+        // Whole process is over the limit: shrink proportionally to the overshoot, starting from what
+        // is actually used, so that next put evicts enough to get back under the limit
+        double scale = double(rss_limit) / double(rss);
+        _limit = std::max(_max_size / 64, std::size_t(std::min(_limit, _used()) * scale));
+    } else if (rss < rss_limit - rss_limit / 10 && _limit < _max_size) {
+        // There is a room, grow back slowly to avoid oscillation
+        _limit = std::min(_max_size, _limit + _max_size / 16);
+    }
+}
+
+// See MapBasedGlobalLockImpl.h
+bool SimpleLRU::Set(const std::string &key, const std::string &value) {
+    return SimpleLRU::Set(key, KeyHash(key), value);
 }
 
 // See MapBasedGlobalLockImpl.h
-bool SimpleLRU::Get(const std::string &key, std::string &value) {
-    auto it = _lru_index.find(key);
-    if (it == _lru_index.end()) {
+bool SimpleLRU::Delete(const std::string &key) { return SimpleLRU::Delete(key, KeyHash(key)); }
+
+// See MapBasedGlobalLockImpl.h
+bool SimpleLRU::Get(const std::string &key, std::string &value) { return SimpleLRU::Get(key, KeyHash(key), value); }
+
+// See SimpleLRU.h
+bool SimpleLRU::Put(const std::string &key, uint64_t hash, const std::string &value,
+                    const Attributes &attributes) {
+    return _put(key, hash, value, _find(key, hash), attributes);
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::PutChunked(const std::string &key, uint64_t hash, std::shared_ptr<const ChunkedValue> value,
+                           const Attributes &attributes) {
+    return _put(key, hash, std::string(), _find(key, hash), attributes, value);
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value,
+                            const Attributes &attributes) {
+    if (_find(key, hash) != nullptr) {
+        return false;
+    }
+    return _put(key, hash, value, nullptr, attributes);
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::Set(const std::string &key, uint64_t hash, const std::string &value,
+                    const Attributes &attributes) {
+    lru_node *node = _find(key, hash);
+    if (node == nullptr) {
+        return false;
+    }
+    return _put(key, hash, value, node, attributes);
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::Delete(const std::string &key, uint64_t hash) {
+    lru_node *node = _find(key, hash);
+    if (node == nullptr) {
+        return false;
+    }
+    _erase(node);
+    _publish(ChangeStream::Type::Delete, key, 0);
+    return true;
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::Get(const std::string &key, uint64_t hash, std::string &value) {
+    lru_node *node = _find(key, hash);
+    if (node == nullptr) {
+        return false;
+    }
+    _touch(node);
+    if (node->chunks) {
+        node->chunks->CopyTo(value);
+    } else {
+        value = node->value;
+    }
+    return true;
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::Get(const std::string &key, uint64_t hash, std::string &value,
+                    std::shared_ptr<const ChunkedValue> &chunks) {
+    lru_node *node = _find(key, hash);
+    if (node == nullptr) {
         return false;
     }
-    value = it->second.get().value;
+    _touch(node);
+    chunks = node->chunks;
+    if (!chunks) {
+        value = node->value;
+    }
     return true;
 }
 
+// See SimpleLRU.h
+bool SimpleLRU::Get(const std::string &key, uint64_t hash, std::string &value,
+                    std::shared_ptr<const ChunkedValue> &chunks, uint64_t &version, Attributes &attributes) {
+    lru_node *node = _find(key, hash);
+    if (node == nullptr) {
+        return false;
+    }
+    _touch(node);
+    chunks = node->chunks;
+    if (!chunks) {
+        value = node->value;
+    }
+    version = node->version;
+    attributes.flags = node->flags;
+    attributes.deadline = node->deadline;
+    return true;
+}
+
+// See SimpleLRU.h
+Storage::CasResult SimpleLRU::CompareAndSet(const std::string &key, uint64_t hash, const std::string &value,
+                                            uint64_t version, const Attributes &attributes) {
+    lru_node *node = _find(key, hash);
+    if (node == nullptr) {
+        return CasResult::NotFound;
+    }
+    if (node->version != version) {
+        return CasResult::Exists;
+    }
+    return _put(key, hash, value, node, attributes) ? CasResult::Stored : CasResult::NotStored;
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::Touch(const std::string &key, uint64_t hash, uint64_t deadline) {
+    lru_node *node = _find(key, hash);
+    if (node == nullptr) {
+        return false;
+    }
+    _touch(node);
+    node->deadline = deadline;
+    return true;
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::Peek(const std::string &key, uint64_t hash, Attributes &attributes) {
+    lru_node *node = _find(key, hash);
+    if (node == nullptr) {
+        return false;
+    }
+    attributes.flags = node->flags;
+    attributes.deadline = node->deadline;
+    return true;
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::Erase(const std::string &key, uint64_t hash) {
+    lru_node *node = _find(key, hash);
+    if (node == nullptr) {
+        return false;
+    }
+    _erase(node);
+    return true;
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::Flush() {
+    while (_lru_head) {
+        _publish(ChangeStream::Type::Delete, _lru_head->key, 0);
+        _erase(_lru_head.get());
+    }
+    return true;
+}
+
+// See SimpleLRU.h
+void SimpleLRU::Stats(std::vector<std::pair<std::string, std::string>> &stats) {
+    auto usage = MemoryUsage();
+    stats.emplace_back("curr_items", std::to_string(usage.items));
+    stats.emplace_back("bytes", std::to_string(usage.payload));
+    stats.emplace_back("memory_footprint", std::to_string(usage.footprint));
+    stats.emplace_back("limit_maxbytes", std::to_string(usage.limit));
+    stats.emplace_back("evictions", std::to_string(usage.evictions));
+    if (_rss_monitor) {
+        stats.emplace_back("rss", std::to_string(_rss_monitor->Rss()));
+        stats.emplace_back("rss_limit", std::to_string(_rss_monitor->Limit()));
+    }
+    if (_changes) {
+        stats.emplace_back("changes_published", std::to_string(_changes->Published()));
+    }
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::Publish(std::shared_ptr<ChangeStream> changes) {
+    std::size_t shard = changes->AddShard();
+    Publish(std::move(changes), shard);
+    return true;
+}
+
+// See SimpleLRU.h
+void SimpleLRU::Publish(std::shared_ptr<ChangeStream> changes, std::size_t shard) {
+    _changes = std::move(changes);
+    _changes_shard = shard;
+}
+
+// See SimpleLRU.h
+SimpleLRU::Usage SimpleLRU::MemoryUsage() const {
+    Usage result;
+    result.items = _items;
+    result.payload = current_size;
+    result.index = _index_memory();
+    result.footprint = _footprint + result.index;
+    result.limit = _limit;
+    result.evictions = _evictions;
+    return result;
+}
+
+// See SimpleLRU.h
+void SimpleLRU::Resize(std::size_t max_size) {
+    _max_size = max_size;
+    if (_accounting != Accounting::Rss || _limit > max_size) {
+        _limit = max_size;
+    }
+    while (_lru_head && _used() > _limit) {
+        _evict();
+    }
+}
+
 } // namespace Backend
 } // namespace Afina
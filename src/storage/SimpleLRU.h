@@ -1,26 +1,103 @@
 #ifndef AFINA_STORAGE_SIMPLE_LRU_H
 #define AFINA_STORAGE_SIMPLE_LRU_H
 
-#include <map>
 #include <memory>
 #include <mutex>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
+#include <afina/ChangeStream.h>
+#include <afina/ChunkedValue.h>
 #include <afina/Storage.h>
 
+#include "HashIndex.h"
+#include "RssMonitor.h"
+
 namespace Afina {
 namespace Backend {
 
 /**
- * # Map based implementation
+ * # Hash based implementation
  * That is NOT thread safe implementaiton!!
  */
 class SimpleLRU : public Afina::Storage {
 public:
-    SimpleLRU(size_t max_size = 1024) : _max_size(max_size), current_size(0) {}
+    /**
+     * What gets counted against the storage size limit
+     */
+    enum class Accounting {
+        // Only bytes of keys and values
+        Payload,
+
+        // Everything storage allocates for an item: list node, index entry and heap buffers of key/value
+        // strings, each rounded up the same way malloc does
+        Footprint,
+
+        // Same as Footprint, but limit is shrunk or grown depending on the RSS of the whole process
+        // reported by RssMonitor, so that process stays under monitor's limit
+        Rss
+    };
+
+    /**
+     * Which item gets evicted when there is no room
+     */
+    enum class Policy {
+        // Least recently used one: hits and updates move item to the fresh end of the list
+        Lru,
+
+        // Greedy-Dual-Size-Frequency: item with the lowest priority L + frequency / size, where frequency
+        // counts hits and updates of the item, size is what the item is charged for and L is the aging clock,
+        // priority of the last evicted item. Maximizes number of hits per byte when item sizes vary a lot
+        Gdsf
+    };
+
+    /**
+     * Memory used by the storage
+     */
+    struct Usage {
+        Usage() : items(0), payload(0), footprint(0), index(0), limit(0), evictions(0) {}
+
+        // Number of items stored
+        std::size_t items;
+
+        // Bytes of keys and values
+        std::size_t payload;
+
+        // Bytes allocated for items and index tables, see Accounting::Footprint
+        std::size_t footprint;
+
+        // Bytes of index tables, part of the footprint
+        std::size_t index;
+
+        // Current limit, in units of the accounting mode
+        std::size_t limit;
+
+        // Number of items evicted to make room for others since storage creation
+        std::size_t evictions;
+
+        Usage &operator+=(const Usage &other) {
+            items += other.items;
+            payload += other.payload;
+            footprint += other.footprint;
+            index += other.index;
+            limit += other.limit;
+            evictions += other.evictions;
+            return *this;
+        }
+    };
+
+    SimpleLRU(size_t max_size = 1024, Accounting accounting = Accounting::Payload,
+              std::shared_ptr<RssMonitor> rss_monitor = nullptr, Policy policy = Policy::Lru)
+        : _max_size(max_size), _limit(max_size), _accounting(accounting), _policy(policy), current_size(0),
+          _footprint(0), _items(0), _evictions(0), _rss_monitor(std::move(rss_monitor)), _rss_generation(0),
+          _clock(0), _changes_shard(0) {
+        if (_accounting == Accounting::Rss && !_rss_monitor) {
+            throw std::runtime_error("RSS accounting requires RSS monitor");
+        }
+    }
 
     ~SimpleLRU() {
-        _lru_index.clear();
         auto del = _lru_head ? _lru_head->prev : nullptr;
         while (del != _lru_head.get()) {
             auto prev = del->prev;
@@ -45,34 +122,252 @@ public:
     // Implements Afina::Storage interface
     bool Get(const std::string &key, std::string &value) override;
 
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, uint64_t hash, const std::string &value,
+             const Attributes &attributes = Attributes()) override;
+    bool PutChunked(const std::string &key, uint64_t hash, std::shared_ptr<const ChunkedValue> value,
+                    const Attributes &attributes = Attributes()) override;
+    bool PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value,
+                     const Attributes &attributes = Attributes()) override;
+    bool Set(const std::string &key, uint64_t hash, const std::string &value,
+             const Attributes &attributes = Attributes()) override;
+    bool Delete(const std::string &key, uint64_t hash) override;
+    bool Get(const std::string &key, uint64_t hash, std::string &value) override;
+    bool Get(const std::string &key, uint64_t hash, std::string &value,
+             std::shared_ptr<const ChunkedValue> &chunks) override;
+    bool Get(const std::string &key, uint64_t hash, std::string &value, std::shared_ptr<const ChunkedValue> &chunks,
+             uint64_t &version, Attributes &attributes) override;
+
+    // Implements Afina::Storage interface
+    CasResult CompareAndSet(const std::string &key, uint64_t hash, const std::string &value, uint64_t version,
+                            const Attributes &attributes = Attributes()) override;
+
+    // Implements Afina::Storage interface
+    bool Touch(const std::string &key, uint64_t hash, uint64_t deadline) override;
+
+    // Implements Afina::Storage interface
+    bool Flush() override;
+
+    // Implements Afina::Storage interface
+    void Stats(std::vector<std::pair<std::string, std::string>> &stats) override;
+
+    // Implements Afina::Storage interface
+    bool Publish(std::shared_ptr<ChangeStream> changes) override;
+
+    /**
+     * Same as above, but reports into the existing ring of the stream. Storages writing into the same ring
+     * must be guarded by the same lock
+     */
+    void Publish(std::shared_ptr<ChangeStream> changes, std::size_t shard);
+
+    // Implements Afina::Storage interface
+    std::shared_ptr<ChangeStream> Changes() override { return _changes; }
+
+    // Implements Afina::Storage interface
+    std::size_t MaxItemSize() override { return _max_size; }
+
+    /**
+     * Current memory usage of the storage
+     */
+    Usage MemoryUsage() const;
+
+    /**
+     * True if the key is there. Unlike Get copies nothing and doesn't count as an access
+     */
+    inline bool Contains(const std::string &key, uint64_t hash) { return _find(key, hash) != nullptr; }
+
+    /**
+     * Same as Contains, but also reports attributes of the item
+     */
+    bool Peek(const std::string &key, uint64_t hash, Attributes &attributes);
+
+    /**
+     * Same as Delete, but reports nothing into the change stream: item has moved into another storage sharing
+     * the stream (i.e size class), which reports it as put
+     */
+    bool Erase(const std::string &key, uint64_t hash);
+
+    /**
+     * True if item of the given size could be put right now without evicting anything
+     */
+    inline bool Fits(std::size_t key_size, std::size_t value_size) const {
+        return _used() + _charge(key_size, value_size) <= _limit;
+    }
+
+    /**
+     * Changes storage size limit, evicting least recently used items if they don't fit anymore. In RSS mode
+     * given limit is the upper bound, actual one still follows process RSS
+     */
+    void Resize(std::size_t max_size);
+
 private:
     struct lru_node;
-    using node_map =
-        std::map<std::reference_wrapper<const std::string>, std::reference_wrapper<lru_node>, std::less<std::string>>;
 
-    bool _put(const std::string &key, const std::string &value, node_map::iterator it);
+    // Node with the given key or nullptr. Expired node is removed on the way and not returned
+    lru_node *_find(const std::string &key, uint64_t hash);
+
+    bool _put(const std::string &key, uint64_t hash, const std::string &value, lru_node *node,
+              const Attributes &attributes, const std::shared_ptr<const ChunkedValue> &chunks = nullptr);
+
+    // Removes element chosen by eviction policy
+    void _evict();
+
+    // Element to be evicted next
+    inline lru_node *_victim() const {
+        if (_policy == Policy::Gdsf) {
+            return _heap.empty() ? nullptr : _heap.front().node;
+        }
+        return _lru_head.get();
+    }
+
+    // Records hit or update of the node for eviction policy
+    void _touch(lru_node *node);
+
+    // GDSF priority queue maintenance, see Policy::Gdsf
+    double _priority(const lru_node &node) const;
+    void _heap_push(lru_node *node);
+    void _heap_erase(lru_node *node);
+    void _sift_up(std::size_t index);
+    void _sift_down(std::size_t index);
+
+    // Removes given node from the list and the index and frees it
+    void _erase(lru_node *node);
+
+    // Takes given node out of the list, index is left as is
+    std::unique_ptr<lru_node> _unlink(lru_node *node);
+
+    // Places node at the fresh end of the list
+    void _append(std::unique_ptr<lru_node> node);
+
+    // Size which item with given key/value sizes would be charged for, according to accounting mode
+    std::size_t _charge(std::size_t key_size, std::size_t value_size) const;
+
+    // Size node is charged for according to accounting mode
+    inline std::size_t _charge(const lru_node &node) const {
+        return _accounting == Accounting::Payload ? node.key.size() + node.value_size() : node.footprint;
+    }
+
+    // Bytes charged against the limit, according to accounting mode
+    inline std::size_t _used() const {
+        return _accounting == Accounting::Payload ? current_size : _footprint + _index_memory();
+    }
+
+    // Bytes of index tables and eviction policy structures
+    inline std::size_t _index_memory() const { return _lru_index.Memory() + _heap.capacity() * sizeof(heap_entry); }
+
+    // Memory allocated for the given node, see Accounting::Footprint
+    static std::size_t _footprint_of(const lru_node &node);
+
+    // Heap memory taken by a fresh copy of the value of the given size, either string or chunks
+    static std::size_t _value_heap_size(std::size_t size);
+
+    // Stores copy of the value into node, large values are split into chunks. Chunks, if given, are taken instead
+    static void _assign(lru_node &node, const std::string &value, const std::shared_ptr<const ChunkedValue> &chunks);
+
+    // Memory allocated for each item besides key and value buffers. Index has no per item allocations,
+    // its tables are accounted separately
+    static std::size_t _node_overhead();
+
+    // In RSS mode adjusts _limit to the last process RSS sample, if there is a new one
+    void _follow_rss();
+
+    // Reports change of the item into the change stream, if there is one
+    inline void _publish(ChangeStream::Type type, const std::string &key, std::size_t value_size) {
+        if (_changes) {
+            _changes->Publish(_changes_shard, type, key, value_size);
+        }
+    }
 
     // LRU cache node
     struct lru_node {
-        lru_node(const std::string &key, const std::string &value) : key(key), value(value), prev(nullptr) {}
+        lru_node(const std::string &key, uint64_t hash)
+            : key(key), prev(nullptr), hash(hash), hash_next(nullptr), frequency(0), heap_index(0), footprint(0),
+              version(0), flags(0), deadline(0) {}
         const std::string key;
+
+        // Value is kept either in the string or, if it is larger than a single chunk, in the chain of chunks
         std::string value;
+        std::shared_ptr<const ChunkedValue> chunks;
+        inline std::size_t value_size() const { return chunks ? chunks->size() : value.size(); }
+
         lru_node *prev;
         std::unique_ptr<lru_node> next;
+
+        // Key hash and next node in the same index bucket, see HashIndex
+        uint64_t hash;
+        lru_node *hash_next;
+
+        // Number of hits and updates, and position in the priority heap, for Policy::Gdsf only
+        uint32_t frequency;
+        std::size_t heap_index;
+
+        // Memory allocated for the node, see _footprint_of
+        std::size_t footprint;
+
+        // Changes on every write, see Storage::CompareAndSet
+        uint64_t version;
+
+        // See Storage::Attributes
+        uint32_t flags;
+        uint64_t deadline;
     };
 
     // Maximum number of bytes could be stored in this cache.
     // i.e all (keys+values) must be less the _max_size
     std::size_t _max_size;
+
+    // Limit in effect right now: same as _max_size unless storage follows process RSS
+    std::size_t _limit;
+
+    // What counts against the limit
+    const Accounting _accounting;
+
+    // What gets evicted
+    const Policy _policy;
+
+    // Bytes of all keys and values stored
     std::size_t current_size;
 
+    // Bytes allocated for all stored items, except for the index tables, see Accounting::Footprint
+    std::size_t _footprint;
+
+    // Number of items stored
+    std::size_t _items;
+
+    // Number of items evicted, see Usage::evictions
+    std::size_t _evictions;
+
+    // Source of the process RSS for Accounting::Rss
+    std::shared_ptr<RssMonitor> _rss_monitor;
+
+    // Last RSS sample storage has reacted on
+    uint64_t _rss_generation;
+
     // Main storage of lru_nodes, elements in this list ordered descending by "freshness": in the head
     // element that wasn't used for longest time. head->prev - the freshest element
     //
     // List owns all nodes
     std::unique_ptr<lru_node> _lru_head;
     // Index of nodes from list above, allows fast random access to elements by lru_node#key
-    node_map _lru_index;
+    HashIndex<lru_node> _lru_index;
+
+    // Entry of the GDSF priority queue, priority is cached next to the pointer so that sifting
+    // doesn't touch nodes
+    struct heap_entry {
+        double priority;
+        lru_node *node;
+    };
+
+    // Four-ary min heap of all nodes by priority, shallower than binary one and siblings share cache line
+    static constexpr std::size_t HeapArity = 4;
+    std::vector<heap_entry> _heap;
+
+    // GDSF aging clock: priority of the last evicted item
+    double _clock;
+
+    // Where changes are reported to and ring of this storage there
+    std::shared_ptr<ChangeStream> _changes;
+    std::size_t _changes_shard;
 };
 
 } // namespace Backend
@@ -0,0 +1,348 @@
+#include "SizeClassLRU.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace Afina {
+namespace Backend {
+
+// See SizeClassLRU.h
+std::vector<std::size_t> SizeClassLRU::DefaultClasses() {
+    return {128, 1024, 16 * 1024, 256 * 1024, std::numeric_limits<std::size_t>::max()};
+}
+
+// See SizeClassLRU.h
+SizeClassLRU::SizeClassLRU(std::size_t max_size, SimpleLRU::Accounting accounting,
+                           std::shared_ptr<RssMonitor> rss_monitor, std::vector<std::size_t> classes)
+    : _max_size(max_size), _min_budget(classes.empty() ? 0 : max_size / (4 * classes.size())), _ops(0), _misses(0),
+      _rebalances(0) {
+    if (classes.empty()) {
+        throw std::runtime_error("At least one size class is required");
+    }
+    for (std::size_t i = 1; i < classes.size(); ++i) {
+        if (classes[i] <= classes[i - 1]) {
+            throw std::runtime_error("Size classes must be ascending");
+        }
+    }
+
+    std::size_t budget = max_size / classes.size();
+    for (std::size_t i = 0; i < classes.size(); ++i) {
+        // The last class takes everything bigger than previous ones
+        std::size_t max_item = i + 1 == classes.size() ? std::numeric_limits<std::size_t>::max() : classes[i];
+        _pools.emplace_back(new pool(max_item, budget, accounting, rss_monitor));
+    }
+}
+
+// See SizeClassLRU.h
+bool SizeClassLRU::Put(const std::string &key, uint64_t hash, const std::string &value,
+                       const Attributes &attributes) {
+    std::unique_lock<InstrumentedMutex> lock(_mutex);
+    _tick();
+
+    // Value of another size might be in another pool, it goes away once the new one is stored
+    int current = _find(key, hash);
+    std::size_t target = _class_of(key.size() + value.size());
+    bool stored = _pools[target]->storage.Put(key, hash, value, _carried(key, hash, current, target, attributes));
+    return _moved(key, hash, current, target, stored);
+}
+
+// See SizeClassLRU.h
+bool SizeClassLRU::PutChunked(const std::string &key, uint64_t hash, std::shared_ptr<const ChunkedValue> value,
+                              const Attributes &attributes) {
+    std::unique_lock<InstrumentedMutex> lock(_mutex);
+    _tick();
+
+    int current = _find(key, hash);
+    std::size_t target = _class_of(key.size() + value->size());
+    Attributes carried = _carried(key, hash, current, target, attributes);
+    bool stored = _pools[target]->storage.PutChunked(key, hash, std::move(value), carried);
+    return _moved(key, hash, current, target, stored);
+}
+
+// See SizeClassLRU.h
+bool SizeClassLRU::PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value,
+                               const Attributes &attributes) {
+    std::unique_lock<InstrumentedMutex> lock(_mutex);
+    _tick();
+
+    if (_find(key, hash) >= 0) {
+        return false;
+    }
+    return _pools[_class_of(key.size() + value.size())]->storage.PutIfAbsent(key, hash, value, attributes);
+}
+
+// See SizeClassLRU.h
+bool SizeClassLRU::Set(const std::string &key, uint64_t hash, const std::string &value,
+                       const Attributes &attributes) {
+    std::unique_lock<InstrumentedMutex> lock(_mutex);
+    _tick();
+
+    int current = _find(key, hash);
+    if (current < 0) {
+        return false;
+    }
+
+    std::size_t target = _class_of(key.size() + value.size());
+    bool stored = _pools[target]->storage.Put(key, hash, value, _carried(key, hash, current, target, attributes));
+    return _moved(key, hash, current, target, stored);
+}
+
+// See SizeClassLRU.h
+bool SizeClassLRU::Delete(const std::string &key, uint64_t hash) {
+    std::unique_lock<InstrumentedMutex> lock(_mutex);
+    _tick();
+
+    int current = _find(key, hash);
+    if (current < 0) {
+        return false;
+    }
+    return _pools[current]->storage.Delete(key, hash);
+}
+
+// See SizeClassLRU.h
+bool SizeClassLRU::Get(const std::string &key, uint64_t hash, std::string &value) {
+    std::unique_lock<InstrumentedMutex> lock(_mutex);
+    _tick();
+
+    for (auto &p : _pools) {
+        if (p->storage.Get(key, hash, value)) {
+            p->hits++;
+            p->total_hits++;
+            return true;
+        }
+    }
+    _misses++;
+    return false;
+}
+
+// See SizeClassLRU.h
+bool SizeClassLRU::Get(const std::string &key, uint64_t hash, std::string &value,
+                       std::shared_ptr<const ChunkedValue> &chunks) {
+    std::unique_lock<InstrumentedMutex> lock(_mutex);
+    _tick();
+
+    for (auto &p : _pools) {
+        if (p->storage.Get(key, hash, value, chunks)) {
+            p->hits++;
+            p->total_hits++;
+            return true;
+        }
+    }
+    _misses++;
+    return false;
+}
+
+// See SizeClassLRU.h
+bool SizeClassLRU::Get(const std::string &key, uint64_t hash, std::string &value,
+                       std::shared_ptr<const ChunkedValue> &chunks, uint64_t &version, Attributes &attributes) {
+    std::unique_lock<InstrumentedMutex> lock(_mutex);
+    _tick();
+
+    for (auto &p : _pools) {
+        if (p->storage.Get(key, hash, value, chunks, version, attributes)) {
+            p->hits++;
+            p->total_hits++;
+            return true;
+        }
+    }
+    _misses++;
+    return false;
+}
+
+// See SizeClassLRU.h
+Storage::CasResult SizeClassLRU::CompareAndSet(const std::string &key, uint64_t hash, const std::string &value,
+                                               uint64_t version, const Attributes &attributes) {
+    std::unique_lock<InstrumentedMutex> lock(_mutex);
+    _tick();
+
+    // Chunked get copies nothing for large values
+    std::string current_value;
+    std::shared_ptr<const ChunkedValue> chunks;
+    uint64_t current_version = 0;
+    Attributes current_attributes;
+    std::size_t current = 0;
+    while (current < _pools.size() &&
+           !_pools[current]->storage.Get(key, hash, current_value, chunks, current_version, current_attributes)) {
+        current++;
+    }
+    if (current == _pools.size()) {
+        return CasResult::NotFound;
+    }
+    if (current_version != version) {
+        return CasResult::Exists;
+    }
+
+    std::size_t target = _class_of(key.size() + value.size());
+    Attributes carried = attributes;
+    if (attributes.deadline == Attributes::KeepDeadline) {
+        carried.deadline = current_attributes.deadline;
+    }
+    bool stored = _moved(key, hash, int(current), target, _pools[target]->storage.Put(key, hash, value, carried));
+    return stored ? CasResult::Stored : CasResult::NotStored;
+}
+
+// See SizeClassLRU.h
+bool SizeClassLRU::Touch(const std::string &key, uint64_t hash, uint64_t deadline) {
+    std::unique_lock<InstrumentedMutex> lock(_mutex);
+    _tick();
+
+    int current = _find(key, hash);
+    return current >= 0 && _pools[current]->storage.Touch(key, hash, deadline);
+}
+
+// See SizeClassLRU.h
+bool SizeClassLRU::Flush() {
+    std::unique_lock<InstrumentedMutex> lock(_mutex);
+    for (auto &p : _pools) {
+        p->storage.Flush();
+    }
+    return true;
+}
+
+// See SizeClassLRU.h
+bool SizeClassLRU::Publish(std::shared_ptr<ChangeStream> changes) {
+    std::size_t shard = changes->AddShard();
+    for (auto &p : _pools) {
+        p->storage.Publish(changes, shard);
+    }
+    return true;
+}
+
+// See SizeClassLRU.h
+void SizeClassLRU::Stats(std::vector<std::pair<std::string, std::string>> &stats) {
+    auto counters = _mutex.Collect();
+    stats.emplace_back("lock_acquisitions", std::to_string(counters.acquisitions));
+    stats.emplace_back("lock_contended", std::to_string(counters.contended));
+    stats.emplace_back("lock_wait_ns", std::to_string(counters.wait_ns));
+    stats.emplace_back("lock_max_wait_ns", std::to_string(counters.max_wait_ns));
+
+    std::unique_lock<InstrumentedMutex> lock(_mutex);
+    SimpleLRU::Usage total;
+    std::size_t hits = 0;
+    for (std::size_t i = 0; i < _pools.size(); ++i) {
+        auto &p = *_pools[i];
+        auto usage = p.storage.MemoryUsage();
+        std::string prefix = "class_" + std::to_string(i) + "_";
+        if (i + 1 < _pools.size()) {
+            stats.emplace_back(prefix + "max_item", std::to_string(p.max_item));
+        }
+        stats.emplace_back(prefix + "budget", std::to_string(p.budget));
+        stats.emplace_back(prefix + "items", std::to_string(usage.items));
+        stats.emplace_back(prefix + "bytes", std::to_string(usage.payload));
+        stats.emplace_back(prefix + "hits", std::to_string(p.total_hits));
+        stats.emplace_back(prefix + "evictions", std::to_string(usage.evictions));
+        total += usage;
+        hits += p.total_hits;
+    }
+
+    stats.emplace_back("storage_get_hits", std::to_string(hits));
+    stats.emplace_back("storage_get_misses", std::to_string(_misses));
+    stats.emplace_back("class_rebalances", std::to_string(_rebalances));
+    stats.emplace_back("curr_items", std::to_string(total.items));
+    stats.emplace_back("bytes", std::to_string(total.payload));
+    stats.emplace_back("memory_footprint", std::to_string(total.footprint));
+    stats.emplace_back("limit_maxbytes", std::to_string(total.limit));
+    stats.emplace_back("evictions", std::to_string(total.evictions));
+}
+
+// See SizeClassLRU.h
+void SizeClassLRU::Rebalance() {
+    std::unique_lock<InstrumentedMutex> lock(_mutex);
+    _rebalance();
+}
+
+// See SizeClassLRU.h
+std::vector<SimpleLRU::Usage> SizeClassLRU::ClassUsage() const {
+    std::unique_lock<InstrumentedMutex> lock(_mutex);
+    std::vector<SimpleLRU::Usage> result;
+    for (auto &p : _pools) {
+        result.push_back(p->storage.MemoryUsage());
+    }
+    return result;
+}
+
+std::size_t SizeClassLRU::_class_of(std::size_t item_size) const {
+    std::size_t result = 0;
+    while (item_size > _pools[result]->max_item) {
+        result++;
+    }
+    return result;
+}
+
+int SizeClassLRU::_find(const std::string &key, uint64_t hash) {
+    for (std::size_t i = 0; i < _pools.size(); ++i) {
+        if (_pools[i]->storage.Contains(key, hash)) {
+            return int(i);
+        }
+    }
+    return -1;
+}
+
+bool SizeClassLRU::_moved(const std::string &key, uint64_t hash, int current, std::size_t target, bool stored) {
+    if (stored && current >= 0 && std::size_t(current) != target) {
+        _pools[current]->storage.Erase(key, hash);
+    }
+    return stored;
+}
+
+Storage::Attributes SizeClassLRU::_carried(const std::string &key, uint64_t hash, int current, std::size_t target,
+                                           const Attributes &attributes) {
+    Attributes result = attributes;
+    Attributes old;
+    if (attributes.deadline == Attributes::KeepDeadline && current >= 0 && std::size_t(current) != target &&
+        _pools[current]->storage.Peek(key, hash, old)) {
+        result.deadline = old.deadline;
+    }
+    return result;
+}
+
+void SizeClassLRU::_tick() {
+    if (++_ops >= RebalanceInterval) {
+        _rebalance();
+    }
+}
+
+void SizeClassLRU::_rebalance() {
+    _ops = 0;
+
+    // Hits per byte of budget. Only pools which had to evict something are short of budget, others
+    // would gain nothing from growing
+    int receiver = -1, donor = -1;
+    double receiver_density = 0, donor_density = 0;
+    for (std::size_t i = 0; i < _pools.size(); ++i) {
+        auto &p = *_pools[i];
+        double density = p.budget > 0 ? double(p.hits) / double(p.budget) : 0;
+        bool evicted = p.storage.MemoryUsage().evictions > p.evictions;
+
+        if (evicted && (receiver < 0 || density > receiver_density)) {
+            receiver = int(i);
+            receiver_density = density;
+        }
+        if (p.budget > _min_budget && (donor < 0 || density < donor_density)) {
+            donor = int(i);
+            donor_density = density;
+        }
+    }
+
+    if (receiver >= 0 && donor >= 0 && receiver != donor && receiver_density > donor_density) {
+        auto &from = *_pools[donor];
+        auto &to = *_pools[receiver];
+        std::size_t step = std::min(_max_size / 64, from.budget - _min_budget);
+
+        from.budget -= step;
+        from.storage.Resize(from.budget);
+        to.budget += step;
+        to.storage.Resize(to.budget);
+        _rebalances++;
+    }
+
+    // Old observations fade out so that shares follow workload changes
+    for (auto &p : _pools) {
+        p->hits /= 2;
+        p->evictions = p->storage.MemoryUsage().evictions;
+    }
+}
+
+} // namespace Backend
+} // namespace Afina
@@ -0,0 +1,184 @@
+#ifndef AFINA_STORAGE_SIZE_CLASS_LRU_H
+#define AFINA_STORAGE_SIZE_CLASS_LRU_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <afina/Hash.h>
+#include <afina/Storage.h>
+
+#include "InstrumentedMutex.h"
+#include "SimpleLRU.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # LRU segregated by item size
+ * Items are routed into separate SimpleLRU pools by the size of key and value, so that one big insert
+ * evicts only other big items and never sweeps thousands of small hot ones out of the shared list.
+ *
+ * Each pool gets its own share of the total budget. Shares are rebalanced periodically from observed
+ * hits: budget moves from the pool with the lowest hits per byte to the full pool (one which had to
+ * evict) with the highest hits per byte. Small items get much more hits per byte than large ones with
+ * the same access rate, so under pressure budget naturally flows towards small items. Each pool keeps
+ * at least a minimal share, so that no class is starved completely.
+ *
+ * Item changes pool when updated with value of another size class. Lookups probe pools from the
+ * smallest class up.
+ *
+ * Thread safe, all pools are guarded by a single lock
+ */
+class SizeClassLRU : public Afina::Storage {
+public:
+    // Default upper bounds of the item size (key + value) for each class
+    static std::vector<std::size_t> DefaultClasses();
+
+    /**
+     * @param max_size total storage size limit, split equally between classes at start
+     * @param classes ascending upper bounds of item size for each class, the last class takes everything bigger
+     */
+    SizeClassLRU(std::size_t max_size, SimpleLRU::Accounting accounting = SimpleLRU::Accounting::Payload,
+                 std::shared_ptr<RssMonitor> rss_monitor = nullptr,
+                 std::vector<std::size_t> classes = DefaultClasses());
+    ~SizeClassLRU() {}
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value) override { return Put(key, KeyHash(key), value); }
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value) override {
+        return PutIfAbsent(key, KeyHash(key), value);
+    }
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value) override { return Set(key, KeyHash(key), value); }
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key) override { return Delete(key, KeyHash(key)); }
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) override { return Get(key, KeyHash(key), value); }
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, uint64_t hash, const std::string &value,
+             const Attributes &attributes = Attributes()) override;
+    bool PutChunked(const std::string &key, uint64_t hash, std::shared_ptr<const ChunkedValue> value,
+                    const Attributes &attributes = Attributes()) override;
+    bool PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value,
+                     const Attributes &attributes = Attributes()) override;
+    bool Set(const std::string &key, uint64_t hash, const std::string &value,
+             const Attributes &attributes = Attributes()) override;
+    bool Delete(const std::string &key, uint64_t hash) override;
+    bool Get(const std::string &key, uint64_t hash, std::string &value) override;
+    bool Get(const std::string &key, uint64_t hash, std::string &value,
+             std::shared_ptr<const ChunkedValue> &chunks) override;
+    bool Get(const std::string &key, uint64_t hash, std::string &value, std::shared_ptr<const ChunkedValue> &chunks,
+             uint64_t &version, Attributes &attributes) override;
+
+    // Implements Afina::Storage interface. Value of another size moves the item into another pool
+    CasResult CompareAndSet(const std::string &key, uint64_t hash, const std::string &value, uint64_t version,
+                            const Attributes &attributes = Attributes()) override;
+
+    // Implements Afina::Storage interface
+    bool Touch(const std::string &key, uint64_t hash, uint64_t deadline) override;
+
+    // Implements Afina::Storage interface
+    bool Flush() override;
+
+    // Implements Afina::Storage interface
+    void Stats(std::vector<std::pair<std::string, std::string>> &stats) override;
+
+    // Implements Afina::Storage interface. Items move between pools, so that all of them share one ring
+    bool Publish(std::shared_ptr<ChangeStream> changes) override;
+
+    // Implements Afina::Storage interface
+    std::shared_ptr<ChangeStream> Changes() override { return _pools[0]->storage.Changes(); }
+
+    // Implements Afina::Storage interface. Rebalance grows the last pool until every other one is left with
+    // its minimal share, so that is the largest item storage could ever take
+    std::size_t MaxItemSize() override {
+        return _max_size / _pools.size() * _pools.size() - (_pools.size() - 1) * _min_budget;
+    }
+
+    /**
+     * Moves budget between pools according to hits observed since previous call. Gets called
+     * automatically every RebalanceInterval operations
+     */
+    void Rebalance();
+
+    /**
+     * Memory usage of each pool
+     */
+    std::vector<SimpleLRU::Usage> ClassUsage() const;
+
+    // Number of operations between automatic rebalances
+    static constexpr std::size_t RebalanceInterval = 4096;
+
+private:
+    // Pool the item of given size belongs to
+    std::size_t _class_of(std::size_t item_size) const;
+
+    // Pool which holds the key or -1
+    int _find(const std::string &key, uint64_t hash);
+
+    /**
+     * Drops the old copy of the key from the pool it was in once the new value is stored into target pool of
+     * another class. Old value stays if the put has failed. Returns stored
+     */
+    bool _moved(const std::string &key, uint64_t hash, int current, std::size_t target, bool stored);
+
+    // Attributes to put into the target pool: deadline to keep is taken from the copy in another pool, if any
+    Attributes _carried(const std::string &key, uint64_t hash, int current, std::size_t target,
+                        const Attributes &attributes);
+
+    // Counts operation and rebalances pools when it is time to
+    void _tick();
+
+    void _rebalance();
+
+    struct pool {
+        pool(std::size_t max_item, std::size_t budget, SimpleLRU::Accounting accounting,
+             std::shared_ptr<RssMonitor> rss_monitor)
+            : max_item(max_item), budget(budget), storage(budget, accounting, std::move(rss_monitor)), hits(0),
+              total_hits(0), evictions(0) {}
+
+        // Upper bound of item size
+        const std::size_t max_item;
+
+        // Share of the total limit
+        std::size_t budget;
+
+        SimpleLRU storage;
+
+        // Hits since the previous rebalance and in total
+        std::size_t hits;
+        std::size_t total_hits;
+
+        // Storage evictions counter at the previous rebalance
+        std::size_t evictions;
+    };
+
+    // Total limit of all pools
+    const std::size_t _max_size;
+
+    // Minimal share of each pool
+    const std::size_t _min_budget;
+
+    std::vector<std::unique_ptr<pool>> _pools;
+
+    // Operations since the previous rebalance
+    std::size_t _ops;
+
+    std::size_t _misses;
+    std::size_t _rebalances;
+
+    mutable InstrumentedMutex _mutex;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_SIZE_CLASS_LRU_H
@@ -9,6 +9,7 @@
 #include <vector>
 
 #include "ThreadSafeSimpleLRU.h"
+#include <afina/Hash.h>
 #include <afina/Storage.h>
 
 namespace Afina {
@@ -20,13 +21,16 @@ namespace Backend {
  *
  */
 class StripedLRU : public Afina::Storage {
-    friend StripedLRU* buildStripeStorage(std::size_t stripe_count, size_t max_size);
+    friend StripedLRU *buildStripeStorage(std::size_t stripe_count, size_t max_size,
+                                          SimpleLRU::Accounting accounting, std::shared_ptr<RssMonitor> rss_monitor,
+                                          SimpleLRU::Policy policy);
 
-    StripedLRU(std::size_t stripe_count, size_t striped_max_size)
-        : stripe_count(stripe_count) // 1024 байт?
+    StripedLRU(std::size_t stripe_count, size_t striped_max_size, SimpleLRU::Accounting accounting,
+               std::shared_ptr<RssMonitor> rss_monitor, SimpleLRU::Policy policy)
+        : stripe_count(stripe_count), _rss_monitor(rss_monitor) // 1024 байт?
     {
         for (std::size_t i = 0; i < stripe_count; ++i) {
-            shards.emplace_back(new ThreadSafeSimplLRU(striped_max_size));
+            shards.emplace_back(new ThreadSafeSimplLRU(striped_max_size, accounting, rss_monitor, policy));
         }
     }
 
@@ -34,36 +38,224 @@ public:
     ~StripedLRU() {}
 
     // see SimpleLRU.h
-    bool Put(const std::string &key, const std::string &value) override {
-        return shards[hash(key) % stripe_count]->Put(key, value);
-    }
+    bool Put(const std::string &key, const std::string &value) override { return Put(key, KeyHash(key), value); }
 
     // see SimpleLRU.h
     bool PutIfAbsent(const std::string &key, const std::string &value) override {
-        return shards[hash(key) % stripe_count]->PutIfAbsent(key, value);
+        return PutIfAbsent(key, KeyHash(key), value);
+    }
+
+    // see SimpleLRU.h
+    bool Set(const std::string &key, const std::string &value) override { return Set(key, KeyHash(key), value); }
+
+    // see SimpleLRU.h
+    bool Delete(const std::string &key) override { return Delete(key, KeyHash(key)); }
+
+    // see SimpleLRU.h
+    bool Get(const std::string &key, std::string &value) override { return Get(key, KeyHash(key), value); }
+
+    // see SimpleLRU.h
+    bool Put(const std::string &key, uint64_t hash, const std::string &value,
+             const Attributes &attributes = Attributes()) override {
+        return shard(hash).Put(key, hash, value, attributes);
+    }
+
+    // see SimpleLRU.h
+    bool PutChunked(const std::string &key, uint64_t hash, std::shared_ptr<const ChunkedValue> value,
+                    const Attributes &attributes = Attributes()) override {
+        return shard(hash).PutChunked(key, hash, std::move(value), attributes);
+    }
+
+    // see SimpleLRU.h
+    bool PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value,
+                     const Attributes &attributes = Attributes()) override {
+        return shard(hash).PutIfAbsent(key, hash, value, attributes);
+    }
+
+    // see SimpleLRU.h
+    bool Set(const std::string &key, uint64_t hash, const std::string &value,
+             const Attributes &attributes = Attributes()) override {
+        return shard(hash).Set(key, hash, value, attributes);
+    }
+
+    // see SimpleLRU.h
+    bool Delete(const std::string &key, uint64_t hash) override { return shard(hash).Delete(key, hash); }
+
+    // see SimpleLRU.h
+    bool Get(const std::string &key, uint64_t hash, std::string &value) override {
+        return shard(hash).Get(key, hash, value);
+    }
+
+    // see SimpleLRU.h
+    bool Get(const std::string &key, uint64_t hash, std::string &value,
+             std::shared_ptr<const ChunkedValue> &chunks) override {
+        return shard(hash).Get(key, hash, value, chunks);
+    }
+
+    // see SimpleLRU.h
+    bool Get(const std::string &key, uint64_t hash, std::string &value, std::shared_ptr<const ChunkedValue> &chunks,
+             uint64_t &version, Attributes &attributes) override {
+        return shard(hash).Get(key, hash, value, chunks, version, attributes);
+    }
+
+    // Implements Afina::Storage interface, each shard gets its share of keys under a single lock
+    void GetMany(const std::vector<std::string> &keys, const std::vector<uint64_t> &hashes,
+                 std::vector<std::string> &values, std::vector<std::shared_ptr<const ChunkedValue>> &chunks,
+                 std::vector<uint64_t> &versions, std::vector<Attributes> &attributes,
+                 std::vector<bool> &found) override {
+        GrowResults(keys.size(), values, chunks, versions, attributes, found);
+        auto &groups = group(hashes);
+        for (std::size_t i = 0; i < stripe_count; ++i) {
+            if (!groups[i].empty()) {
+                shards[i]->GetSome(groups[i], keys, hashes, values, chunks, versions, attributes, found);
+            }
+        }
+    }
+
+    // Implements Afina::Storage interface, see GetMany
+    std::size_t PutMany(const std::vector<std::string> &keys, const std::vector<uint64_t> &hashes,
+                        const std::vector<std::string> &values) override {
+        std::size_t stored = 0;
+        auto &groups = group(hashes);
+        for (std::size_t i = 0; i < stripe_count; ++i) {
+            if (!groups[i].empty()) {
+                stored += shards[i]->PutSome(groups[i], keys, hashes, values);
+            }
+        }
+        return stored;
     }
 
     // see SimpleLRU.h
-    bool Set(const std::string &key, const std::string &value) override {
-        return shards[hash(key) % stripe_count]->Set(key, value);
+    CasResult CompareAndSet(const std::string &key, uint64_t hash, const std::string &value, uint64_t version,
+                            const Attributes &attributes = Attributes()) override {
+        return shard(hash).CompareAndSet(key, hash, value, version, attributes);
     }
 
     // see SimpleLRU.h
-    bool Delete(const std::string &key) override { return shards[hash(key) % stripe_count]->Delete(key); }
+    bool Touch(const std::string &key, uint64_t hash, uint64_t deadline) override {
+        return shard(hash).Touch(key, hash, deadline);
+    }
 
     // see SimpleLRU.h
-    bool Get(const std::string &key, std::string &value) override {
-        return shards[hash(key) % stripe_count]->Get(key, value);
+    bool Flush() override {
+        for (auto &shard : shards) {
+            shard->Flush();
+        }
+        return true;
+    }
+
+    // Implements Afina::Storage interface
+    void Stats(std::vector<std::pair<std::string, std::string>> &stats) override {
+        // Lock counters go first, collecting memory usage takes locks itself
+        InstrumentedMutex::Counters total;
+        for (std::size_t i = 0; i < stripe_count; ++i) {
+            auto counters = shards[i]->LockCounters();
+            std::string prefix = "shard_" + std::to_string(i) + "_lock_";
+            stats.emplace_back(prefix + "acquisitions", std::to_string(counters.acquisitions));
+            stats.emplace_back(prefix + "contended", std::to_string(counters.contended));
+            stats.emplace_back(prefix + "wait_ns", std::to_string(counters.wait_ns));
+            stats.emplace_back(prefix + "max_wait_ns", std::to_string(counters.max_wait_ns));
+            total += counters;
+        }
+
+        stats.emplace_back("lock_acquisitions", std::to_string(total.acquisitions));
+        stats.emplace_back("lock_contended", std::to_string(total.contended));
+        stats.emplace_back("lock_wait_ns", std::to_string(total.wait_ns));
+        stats.emplace_back("lock_max_wait_ns", std::to_string(total.max_wait_ns));
+        stats.emplace_back("stripe_count", std::to_string(stripe_count));
+        stats.emplace_back("stripe_recommended", std::to_string(RecommendedStripeCount()));
+
+        SimpleLRU::Usage usage;
+        for (auto &shard : shards) {
+            usage += shard->MemoryUsage();
+        }
+        stats.emplace_back("curr_items", std::to_string(usage.items));
+        stats.emplace_back("bytes", std::to_string(usage.payload));
+        stats.emplace_back("memory_footprint", std::to_string(usage.footprint));
+        stats.emplace_back("limit_maxbytes", std::to_string(usage.limit));
+        stats.emplace_back("evictions", std::to_string(usage.evictions));
+        if (_rss_monitor) {
+            stats.emplace_back("rss", std::to_string(_rss_monitor->Rss()));
+            stats.emplace_back("rss_limit", std::to_string(_rss_monitor->Limit()));
+        }
+        if (auto changes = Changes()) {
+            stats.emplace_back("changes_published", std::to_string(changes->Published()));
+        }
+    }
+
+    // Implements Afina::Storage interface
+    bool Publish(std::shared_ptr<ChangeStream> changes) override {
+        for (auto &shard : shards) {
+            shard->Publish(changes);
+        }
+        return true;
+    }
+
+    // Implements Afina::Storage interface
+    std::shared_ptr<ChangeStream> Changes() override { return shards[0]->Changes(); }
+
+    // Implements Afina::Storage interface, all stripes have the same limit
+    std::size_t MaxItemSize() override { return shards[0]->MaxItemSize(); }
+
+    /**
+     * Number of stripes that observed lock contention suggests. Storage aims to keep share of contended
+     * acquisitions between 1% and 5%: above that threshold stripes count is scaled up proportionally, if
+     * locks are almost never contended then half of stripes is enough.
+     *
+     * Until there is enough data (at least 1000 acquisitions) current count is returned
+     */
+    std::size_t RecommendedStripeCount() const {
+        InstrumentedMutex::Counters total;
+        for (auto &shard : shards) {
+            total += shard->LockCounters();
+        }
+        if (total.acquisitions < 1000) {
+            return stripe_count;
+        }
+
+        double contended = double(total.contended) / double(total.acquisitions);
+        std::size_t result = stripe_count;
+        if (contended > 0.05) {
+            while (result < 1024 && contended * stripe_count / result > 0.05) {
+                result *= 2;
+            }
+        } else if (contended < 0.01 && stripe_count > 1) {
+            result = stripe_count / 2;
+        }
+        return result;
     }
 
 private:
+    // Stripe responsible for the key with the given hash
+    inline ThreadSafeSimplLRU &shard(uint64_t hash) { return *shards[HashRange(hash, stripe_count)]; }
+
+    // Indices of the keys each stripe is responsible for, in the original order
+    std::vector<std::vector<std::size_t>> &group(const std::vector<uint64_t> &hashes) const {
+        // Index lists are kept by the thread between batches, so that their memory is reused
+        static thread_local std::vector<std::vector<std::size_t>> groups;
+        if (groups.size() < stripe_count) {
+            groups.resize(stripe_count);
+        }
+        for (std::size_t i = 0; i < stripe_count; ++i) {
+            groups[i].clear();
+        }
+        for (std::size_t i = 0; i < hashes.size(); ++i) {
+            groups[HashRange(hashes[i], stripe_count)].push_back(i);
+        }
+        return groups;
+    }
+
     std::size_t stripe_count;
     std::vector<std::unique_ptr<ThreadSafeSimplLRU>> shards;
-    std::hash<std::string> hash;
+
+    // Process RSS source shared by all stripes, if storage follows RSS
+    std::shared_ptr<RssMonitor> _rss_monitor;
 };
 
-StripedLRU* buildStripeStorage(std::size_t stripe_count, size_t max_size = 2*1024*1024)
-{
+inline StripedLRU *buildStripeStorage(std::size_t stripe_count, size_t max_size = 2 * 1024 * 1024,
+                                      SimpleLRU::Accounting accounting = SimpleLRU::Accounting::Payload,
+                                      std::shared_ptr<RssMonitor> rss_monitor = nullptr,
+                                      SimpleLRU::Policy policy = SimpleLRU::Policy::Lru) {
    // calculations
         std::size_t stripe_limit = max_size / stripe_count;
         if (stripe_limit < 2*1024*1024)
@@ -71,7 +263,7 @@ StripedLRU* buildStripeStorage(std::size_t stripe_count, size_t max_size = 2*102
             throw std::runtime_error("Small storage size for one stripe: " + std::to_string(stripe_limit));
         }
 
-   return new StripedLRU(stripe_count, stripe_limit);
+   return new StripedLRU(stripe_count, stripe_limit, accounting, std::move(rss_monitor), policy);
 }
 } // namespace Backend
 } // namespace Afina
@@ -4,8 +4,10 @@
 #include <map>
 #include <mutex>
 #include <string>
+#include <vector>
 #include <unistd.h>
 
+#include "InstrumentedMutex.h"
 #include "SimpleLRU.h"
 
 namespace Afina {
@@ -18,41 +20,205 @@ namespace Backend {
  */
 class ThreadSafeSimplLRU : public SimpleLRU {
 public:
-    ThreadSafeSimplLRU(size_t max_size = 1024) : SimpleLRU(max_size) {}
+    ThreadSafeSimplLRU(size_t max_size = 1024, Accounting accounting = Accounting::Payload,
+                       std::shared_ptr<RssMonitor> rss_monitor = nullptr, Policy policy = Policy::Lru)
+        : SimpleLRU(max_size, accounting, std::move(rss_monitor), policy) {}
     ~ThreadSafeSimplLRU() {}
 
     // see SimpleLRU.h
     bool Put(const std::string &key, const std::string &value) override {
-        std::unique_lock<std::mutex> lock(mutex);
+        std::unique_lock<InstrumentedMutex> lock(mutex);
         return SimpleLRU::Put(key, value);
     }
 
     // see SimpleLRU.h
     bool PutIfAbsent(const std::string &key, const std::string &value) override {
-        std::unique_lock<std::mutex> lock(mutex);
+        std::unique_lock<InstrumentedMutex> lock(mutex);
         return SimpleLRU::PutIfAbsent(key, value);
     }
 
     // see SimpleLRU.h
     bool Set(const std::string &key, const std::string &value) override {
-        std::unique_lock<std::mutex> lock(mutex);
+        std::unique_lock<InstrumentedMutex> lock(mutex);
         return SimpleLRU::Set(key, value);
     }
 
     // see SimpleLRU.h
     bool Delete(const std::string &key) override {
-        std::unique_lock<std::mutex> lock(mutex);
+        std::unique_lock<InstrumentedMutex> lock(mutex);
         return SimpleLRU::Delete(key);
     }
 
     // see SimpleLRU.h
     bool Get(const std::string &key, std::string &value) override {
-        std::unique_lock<std::mutex> lock(mutex);
+        std::unique_lock<InstrumentedMutex> lock(mutex);
         return SimpleLRU::Get(key, value);
     }
 
+    // see SimpleLRU.h
+    bool Put(const std::string &key, uint64_t hash, const std::string &value,
+             const Attributes &attributes = Attributes()) override {
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+        return SimpleLRU::Put(key, hash, value, attributes);
+    }
+
+    // see SimpleLRU.h
+    bool PutChunked(const std::string &key, uint64_t hash, std::shared_ptr<const ChunkedValue> value,
+                    const Attributes &attributes = Attributes()) override {
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+        return SimpleLRU::PutChunked(key, hash, std::move(value), attributes);
+    }
+
+    // see SimpleLRU.h
+    bool PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value,
+                     const Attributes &attributes = Attributes()) override {
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+        return SimpleLRU::PutIfAbsent(key, hash, value, attributes);
+    }
+
+    // see SimpleLRU.h
+    bool Set(const std::string &key, uint64_t hash, const std::string &value,
+             const Attributes &attributes = Attributes()) override {
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+        return SimpleLRU::Set(key, hash, value, attributes);
+    }
+
+    // see SimpleLRU.h
+    bool Delete(const std::string &key, uint64_t hash) override {
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+        return SimpleLRU::Delete(key, hash);
+    }
+
+    // see SimpleLRU.h
+    bool Get(const std::string &key, uint64_t hash, std::string &value) override {
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+        return SimpleLRU::Get(key, hash, value);
+    }
+
+    // see SimpleLRU.h
+    bool Get(const std::string &key, uint64_t hash, std::string &value,
+             std::shared_ptr<const ChunkedValue> &chunks) override {
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+        return SimpleLRU::Get(key, hash, value, chunks);
+    }
+
+    // see SimpleLRU.h
+    bool Get(const std::string &key, uint64_t hash, std::string &value, std::shared_ptr<const ChunkedValue> &chunks,
+             uint64_t &version, Attributes &attributes) override {
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+        return SimpleLRU::Get(key, hash, value, chunks, version, attributes);
+    }
+
+    // Implements Afina::Storage interface, whole batch under one lock
+    void GetMany(const std::vector<std::string> &keys, const std::vector<uint64_t> &hashes,
+                 std::vector<std::string> &values, std::vector<std::shared_ptr<const ChunkedValue>> &chunks,
+                 std::vector<uint64_t> &versions, std::vector<Attributes> &attributes,
+                 std::vector<bool> &found) override {
+        GrowResults(keys.size(), values, chunks, versions, attributes, found);
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            found[i] = SimpleLRU::Get(keys[i], hashes[i], values[i], chunks[i], versions[i], attributes[i]);
+        }
+    }
+
+    // Implements Afina::Storage interface, whole batch under one lock
+    std::size_t PutMany(const std::vector<std::string> &keys, const std::vector<uint64_t> &hashes,
+                        const std::vector<std::string> &values) override {
+        std::size_t stored = 0;
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            stored += SimpleLRU::Put(keys[i], hashes[i], values[i]);
+        }
+        return stored;
+    }
+
+    /**
+     * Part of the batch which belongs to this storage, see StripedLRU. Only keys listed in indices are
+     * touched, under one lock
+     */
+    void GetSome(const std::vector<std::size_t> &indices, const std::vector<std::string> &keys,
+                 const std::vector<uint64_t> &hashes, std::vector<std::string> &values,
+                 std::vector<std::shared_ptr<const ChunkedValue>> &chunks, std::vector<uint64_t> &versions,
+                 std::vector<Attributes> &attributes, std::vector<bool> &found) {
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+        for (std::size_t i : indices) {
+            found[i] = SimpleLRU::Get(keys[i], hashes[i], values[i], chunks[i], versions[i], attributes[i]);
+        }
+    }
+
+    // Same as above for PutMany
+    std::size_t PutSome(const std::vector<std::size_t> &indices, const std::vector<std::string> &keys,
+                        const std::vector<uint64_t> &hashes, const std::vector<std::string> &values) {
+        std::size_t stored = 0;
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+        for (std::size_t i : indices) {
+            stored += SimpleLRU::Put(keys[i], hashes[i], values[i]);
+        }
+        return stored;
+    }
+
+    // see SimpleLRU.h
+    CasResult CompareAndSet(const std::string &key, uint64_t hash, const std::string &value, uint64_t version,
+                            const Attributes &attributes = Attributes()) override {
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+        return SimpleLRU::CompareAndSet(key, hash, value, version, attributes);
+    }
+
+    // see SimpleLRU.h
+    bool Touch(const std::string &key, uint64_t hash, uint64_t deadline) override {
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+        return SimpleLRU::Touch(key, hash, deadline);
+    }
+
+    // see SimpleLRU.h
+    bool Flush() override {
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+        return SimpleLRU::Flush();
+    }
+
+    // Implements Afina::Storage interface
+    void Stats(std::vector<std::pair<std::string, std::string>> &stats) override {
+        auto counters = LockCounters();
+        stats.emplace_back("lock_acquisitions", std::to_string(counters.acquisitions));
+        stats.emplace_back("lock_contended", std::to_string(counters.contended));
+        stats.emplace_back("lock_wait_ns", std::to_string(counters.wait_ns));
+        stats.emplace_back("lock_max_wait_ns", std::to_string(counters.max_wait_ns));
+
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+        SimpleLRU::Stats(stats);
+    }
+
+    /**
+     * Contention statistic of the lock guarding this storage
+     */
+    InstrumentedMutex::Counters LockCounters() const { return mutex.Collect(); }
+
+    // see SimpleLRU.h
+    Usage MemoryUsage() const {
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+        return SimpleLRU::MemoryUsage();
+    }
+
+    // see SimpleLRU.h
+    std::size_t MaxItemSize() override {
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+        return SimpleLRU::MaxItemSize();
+    }
+
+    // see SimpleLRU.h
+    bool Fits(std::size_t key_size, std::size_t value_size) const {
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+        return SimpleLRU::Fits(key_size, value_size);
+    }
+
+    // see SimpleLRU.h
+    void Resize(std::size_t max_size) {
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+        SimpleLRU::Resize(max_size);
+    }
+
 private:
-    std::mutex mutex;
+    mutable InstrumentedMutex mutex;
 };
 
 } // namespace Backend
@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+#include <afina/Hash.h>
+#include <afina/execute/LeaseGet.h>
+#include <afina/execute/LeaseSet.h>
+
+#include "storage/LeasedStorage.h"
+#include "storage/SimpleLRU.h"
+#include "storage/ThreadSafeSimpleLRU.h"
+
+using namespace Afina;
+using namespace Afina::Backend;
+using namespace Afina::Execute;
+
+TEST(ExecuteTest, LeaseCommands) {
+    LeasedStorage storage(std::make_shared<ThreadSafeSimplLRU>(1024 * 1024));
+    std::string out;
+
+    LeaseGet get({"key"}, {KeyHash("key")});
+    get.Execute(storage, "", out);
+    ASSERT_EQ(0, out.find("LEASE key "));
+    uint64_t token = std::stoull(out.substr(10));
+
+    get.Execute(storage, "", out);
+    EXPECT_EQ("HOT_MISS key\r\nEND", out);
+
+    LeaseSet(("key"), 0, 0, KeyHash("key"), token + 1).Execute(storage, "val", out);
+    EXPECT_EQ("NOT_STORED", out);
+    LeaseSet(("key"), 0, 0, KeyHash("key"), token).Execute(storage, "val", out);
+    EXPECT_EQ("STORED", out);
+
+    get.Execute(storage, "", out);
+    EXPECT_EQ("VALUE key 0 3\r\nval\r\nEND", out);
+
+    // Storage without lease table grants every miss
+    SimpleLRU plain;
+    LeaseGet({"other"}, {KeyHash("other")}).Execute(plain, "", out);
+    EXPECT_EQ("LEASE other 0\r\nEND", out);
+}
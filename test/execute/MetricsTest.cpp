@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <afina/execute/Get.h>
+#include <afina/execute/Metrics.h>
+
+using namespace Afina;
+using namespace Afina::Execute;
+
+namespace {
+
+// Command type nobody else records
+struct Probe {};
+
+const Metrics::Latency *Find(const Metrics::Snapshot &snapshot, const std::string &name) {
+    for (auto &command : snapshot.commands) {
+        if (command.first == name) {
+            return &command.second;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+TEST(ExecuteTest, MetricsBuckets) {
+    using Latency = Metrics::Latency;
+    EXPECT_EQ(0, Latency::Bucket(0));
+    EXPECT_EQ(7, Latency::Bucket(7));
+    EXPECT_EQ(Latency::Buckets - 1, Latency::Bucket(UINT64_MAX));
+
+    // Buckets follow each other without gaps, each is at most 1/8 of its values wide
+    for (std::size_t b = 0; b + 1 < Latency::Buckets; b++) {
+        EXPECT_EQ(b, Latency::Bucket(Latency::Lower(b))) << b;
+        EXPECT_EQ(b, Latency::Bucket(Latency::Upper(b))) << b;
+        EXPECT_EQ(Latency::Upper(b) + 1, Latency::Lower(b + 1)) << b;
+        EXPECT_LE((Latency::Upper(b) - Latency::Lower(b)) * 8, Latency::Lower(b)) << b;
+    }
+}
+
+TEST(ExecuteTest, MetricsPercentiles) {
+    std::mt19937_64 rnd(42);
+    std::vector<uint64_t> samples;
+    Metrics::Latency latency;
+    for (int i = 0; i < 10000; i++) {
+        uint64_t ns = 100 + rnd() % (rnd() % 8 == 0 ? 1000000 : 10000);
+        samples.push_back(ns);
+        latency.count++;
+        latency.sum_ns += ns;
+        latency.max_ns = std::max(latency.max_ns, ns);
+        latency.buckets[Metrics::Latency::Bucket(ns)]++;
+    }
+    std::sort(samples.begin(), samples.end());
+
+    for (double share : {0.5, 0.9, 0.99, 0.999}) {
+        uint64_t exact = samples[std::size_t(share * samples.size()) - 1];
+        uint64_t estimate = latency.Percentile(share);
+        EXPECT_LE(exact, estimate) << share;
+        EXPECT_LE(estimate, exact + exact / 8) << share;
+    }
+    EXPECT_EQ(samples.back(), latency.Percentile(1.0));
+    EXPECT_EQ(0, Metrics::Latency().Percentile(0.99));
+}
+
+// Threads record into own slots, collected sums are exact
+TEST(ExecuteTest, MetricsThreads) {
+    Metrics::Snapshot before;
+    Metrics::Collect(before);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 20; t++) {
+        threads.emplace_back([t]() {
+            for (int i = 0; i < 1000; i++) {
+                Metrics::Record(typeid(Probe), 10 * (t + 1));
+                Metrics::Add(Metrics::Counter::BytesRead, 2);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    Metrics::Snapshot after;
+    Metrics::Collect(after);
+    EXPECT_EQ(before.Get(Metrics::Counter::BytesRead) + 40000, after.Get(Metrics::Counter::BytesRead));
+    const Metrics::Latency *probe = Find(after, "Probe");
+    ASSERT_NE(nullptr, probe);
+    EXPECT_EQ(20000, probe->count);
+    EXPECT_EQ(1000 * 10 * (20 * 21 / 2), probe->sum_ns);
+    EXPECT_EQ(200, probe->max_ns);
+    EXPECT_EQ(1000, probe->buckets[Metrics::Latency::Bucket(10)]);
+
+    EXPECT_EQ("Get", Metrics::Name(typeid(Get)));
+}
+
+// Named commands get their own histograms, equal names share one
+TEST(ExecuteTest, MetricsNamed) {
+    Metrics::Snapshot before;
+    Metrics::Collect(before);
+
+    std::string copy = "ProbeNamed";
+    Metrics::Record("ProbeNamed", 10);
+    Metrics::Record(copy.c_str(), 30);
+    Metrics::Record("ProbeOther", 20);
+
+    Metrics::Snapshot after;
+    Metrics::Collect(after);
+    const Metrics::Latency *named = Find(after, "ProbeNamed");
+    ASSERT_NE(nullptr, named);
+    EXPECT_EQ(2, named->count);
+    EXPECT_EQ(40, named->sum_ns);
+    const Metrics::Latency *other = Find(after, "ProbeOther");
+    ASSERT_NE(nullptr, other);
+    EXPECT_EQ(1, other->count);
+    EXPECT_EQ(before.commands.size() + 2, after.commands.size());
+}
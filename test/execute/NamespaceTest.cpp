@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+#include <afina/Hash.h>
+#include <afina/execute/Get.h>
+#include <afina/execute/Namespace.h>
+#include <afina/execute/Set.h>
+
+#include "storage/NamespacedStorage.h"
+#include "storage/SimpleLRU.h"
+
+using namespace Afina;
+using namespace Afina::Backend;
+using namespace Afina::Execute;
+
+TEST(ExecuteTest, NamespaceCommand) {
+    NamespacedStorage storage(1024 * 1024, {NamespacedStorage::Config("app", 4096, true)});
+    std::string out;
+
+    Namespace missing("other");
+    missing.Execute(storage, "", out);
+    EXPECT_EQ("NOT_FOUND", out);
+    EXPECT_TRUE(missing.Selected() == nullptr);
+
+    Namespace app("app");
+    app.Execute(storage, "", out);
+    EXPECT_EQ("OK", out);
+    std::shared_ptr<Storage> selected = app.Selected();
+    ASSERT_TRUE(selected != nullptr);
+
+    Set("key", 0, 0, KeyHash("key")).Execute(*selected, "val", out);
+    EXPECT_EQ("STORED", out);
+    Get({"key"}, {KeyHash("key")}).Execute(*selected, "", out);
+    EXPECT_EQ("VALUE key 0 3\r\nval\r\nEND", out);
+    Get({"key"}, {KeyHash("key")}).Execute(storage, "", out);
+    EXPECT_EQ("END", out);
+    EXPECT_EQ(1, storage.NamespaceUsage("app").items);
+
+    // Switch back from inside of the namespace
+    Namespace back("default");
+    back.Execute(*selected, "", out);
+    EXPECT_EQ("OK", out);
+    ASSERT_TRUE(back.Selected() != nullptr);
+    Get({"key"}, {KeyHash("key")}).Execute(*back.Selected(), "", out);
+    EXPECT_EQ("END", out);
+
+    // Storage without namespaces
+    SimpleLRU plain;
+    app.Execute(plain, "", out);
+    EXPECT_EQ("NOT_FOUND", out);
+}
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <afina/ChunkedValue.h>
+#include <afina/Hash.h>
+#include <afina/execute/Command.h>
+#include <afina/execute/Get.h>
+#include <afina/execute/Response.h>
+
+#include "storage/ThreadSafeSimpleLRU.h"
+
+using namespace Afina;
+using namespace Afina::Backend;
+using namespace Afina::Execute;
+
+namespace {
+
+std::string Text(const Response &response) {
+    std::string out;
+    response.CopyTo(out);
+    return out;
+}
+
+} // namespace
+
+TEST(ExecuteTest, ResponseDecimal) {
+    std::vector<uint64_t> numbers = {0, 9, 10, 99, 100, 101, 4294967295ull, 18446744073709551615ull};
+    std::mt19937_64 rnd(42);
+    for (int i = 0; i < 1000; i++) {
+        numbers.push_back(rnd() >> (rnd() % 64));
+    }
+
+    Response response;
+    std::string expected;
+    for (uint64_t number : numbers) {
+        response.AppendDecimal(number);
+        response.Append(' ');
+        expected += std::to_string(number) + " ";
+    }
+    EXPECT_EQ(expected, Text(response));
+
+    // Copied pieces join together
+    EXPECT_EQ(1, response.Pieces());
+}
+
+TEST(ExecuteTest, ResponseReference) {
+    auto big = std::make_shared<std::string>(Response::CopyLimit, 'b');
+    auto small = std::make_shared<std::string>("small");
+    std::weak_ptr<std::string> alive = big;
+
+    Response response;
+    response.Append("head ");
+    response.Reference(big->data(), big->size(), big);
+    response.Reference(small->data(), small->size(), small);
+    response.Append(" tail");
+    EXPECT_EQ("head " + *big + "small tail", Text(response));
+    EXPECT_EQ(3, response.Pieces());
+    EXPECT_EQ(10 + big->size() + small->size(), response.size());
+
+    // Referenced data is kept alive by the response, copied one is not needed
+    big.reset();
+    small.reset();
+    EXPECT_FALSE(alive.expired());
+    response.Clear();
+    EXPECT_TRUE(alive.expired());
+    EXPECT_TRUE(response.empty());
+    EXPECT_EQ(0, response.Pieces());
+}
+
+TEST(ExecuteTest, ResponseTruncate) {
+    auto big = std::make_shared<std::string>(1000, 'b');
+    std::vector<std::string> sent;
+    Response response([&sent](Response &response) {
+        sent.push_back(Text(response));
+        response.Clear();
+    });
+
+    response.Append("kept");
+    Response::Mark mark = response.Position();
+    response.Append(" dropped");
+    response.Reference(big->data(), big->size(), big);
+    response.Truncate(mark);
+    response.Append(" too");
+    EXPECT_EQ("kept too", Text(response));
+    EXPECT_EQ(1, response.Pieces());
+
+    // Whatever is written after flush is dropped along with the mark
+    mark = response.Position();
+    response.Append(" and flushed");
+    response.Flush();
+    response.Append(" dropped");
+    response.Truncate(mark);
+    EXPECT_TRUE(response.empty());
+    ASSERT_EQ(1, sent.size());
+    EXPECT_EQ("kept too and flushed", sent[0]);
+}
+
+// Get formats headers in place and references looked up values
+TEST(ExecuteTest, ResponseGet) {
+    ThreadSafeSimplLRU storage(16 * 1024 * 1024);
+    std::string large(3 * ChunkedValue::ChunkSize + 7, 'L');
+    std::string medium(Response::CopyLimit * 2, 'm');
+    storage.Put("large", large);
+    storage.Put("medium", medium);
+    storage.Put("small", "s");
+
+    std::vector<std::string> keys = {"small", "missing", "medium", "large"};
+    std::string expected = "VALUE small 0 1\r\ns\r\nVALUE medium 0 " + std::to_string(medium.size()) + "\r\n" +
+                           medium + "\r\nVALUE large 0 " + std::to_string(large.size()) + "\r\n" + large + "\r\nEND";
+
+    // Straight from the storage
+    Get get(keys);
+    Response response;
+    get.Execute(storage, "", response);
+    EXPECT_EQ(expected, Text(response));
+    EXPECT_LT(4, response.Pieces());
+
+    // From the batch looked up beforehand
+    auto batch = std::make_shared<Command::Prefetch>();
+    ASSERT_TRUE(get.Reads(*batch));
+    storage.GetMany(batch->keys, batch->hashes, batch->values, batch->chunks, batch->versions, batch->attributes,
+                    batch->found);
+    get.Prefetched(batch, 0);
+    std::string out;
+    get.Execute(storage, "", out);
+    EXPECT_EQ(expected, out);
+
+    response.Clear();
+    get.Execute(storage, "", response);
+    EXPECT_EQ(expected, Text(response));
+
+    // Response keeps the batch alive once command is done
+    get.Prefetched(nullptr, 0);
+    EXPECT_EQ(2, batch.use_count());
+    response.Clear();
+    EXPECT_EQ(1, batch.use_count());
+}
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <afina/ChangeStream.h>
+#include <afina/execute/Subscribe.h>
+
+#include "storage/SimpleLRU.h"
+#include "storage/ThreadSafeSimpleLRU.h"
+
+using namespace Afina;
+using namespace Afina::Backend;
+using namespace Afina::Execute;
+
+TEST(ExecuteTest, SubscribeCommand) {
+    ThreadSafeSimplLRU storage(1024 * 1024);
+    std::string out;
+
+    // Storage doesn't publish changes yet
+    Response error;
+    Subscribe().Execute(storage, "", error);
+    error.CopyTo(out);
+    EXPECT_EQ(0, out.find("SERVER_ERROR"));
+
+    storage.Publish(std::make_shared<ChangeStream>(4));
+    out.clear();
+    int flushes = 0;
+    Response response([&](Response &response) {
+        std::string sent;
+        response.CopyTo(sent);
+        response.Clear();
+        out += sent;
+
+        // Changes happen while subscription is running, then connection goes away
+        flushes++;
+        if (flushes == 1) {
+            storage.Put("key", "value");
+            storage.Delete("key");
+        } else if (flushes == 3) {
+            for (long i = 0; i < 10; ++i) {
+                storage.Put("key" + std::to_string(i), "v");
+            }
+        } else if (flushes == 5) {
+            throw std::runtime_error("Connection closed");
+        }
+    });
+    EXPECT_THROW(Subscribe().Execute(storage, "", response), std::runtime_error);
+    EXPECT_EQ("SUBSCRIBED\r\n"
+              "PUT key 5 0 0\r\n"
+              "DELETE key 0 0 1\r\n"
+              "DROPPED 6\r\n"
+              "PUT key6 1 0 8\r\n"
+              "PUT key7 1 0 9\r\n"
+              "PUT key8 1 0 10\r\n"
+              "PUT key9 1 0 11\r\n",
+              out);
+}
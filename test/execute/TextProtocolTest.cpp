@@ -0,0 +1,177 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <afina/ChunkedValue.h>
+#include <afina/Hash.h>
+#include <afina/execute/Add.h>
+#include <afina/execute/Append.h>
+#include <afina/execute/Arithmetic.h>
+#include <afina/execute/Cas.h>
+#include <afina/execute/Delete.h>
+#include <afina/execute/FlushAll.h>
+#include <afina/execute/Gets.h>
+#include <afina/execute/Prepend.h>
+#include <afina/execute/Replace.h>
+#include <afina/execute/Set.h>
+#include <afina/execute/Touch.h>
+
+#include "storage/SimpleLRU.h"
+#include "storage/StripedLRU.h"
+#include "storage/ThreadSafeSimpleLRU.h"
+
+using namespace Afina;
+using namespace Afina::Backend;
+using namespace Afina::Execute;
+
+TEST(ExecuteTest, CheckAndSet) {
+    ThreadSafeSimplLRU storage;
+    std::string out;
+
+    Cas("key", 0, 0, 1).Execute(storage, "val", out);
+    EXPECT_EQ("NOT_FOUND", out);
+
+    storage.Put("key", "val");
+    Gets gets({"key", "missing"}, {KeyHash("key"), KeyHash("missing")});
+    gets.Execute(storage, "", out);
+    ASSERT_EQ(0, out.find("VALUE key 0 3 "));
+    uint64_t version = std::stoull(out.substr(14));
+    EXPECT_EQ("VALUE key 0 3 " + std::to_string(version) + "\r\nval\r\nEND", out);
+
+    Cas("key", 0, 0, version).Execute(storage, "new", out);
+    EXPECT_EQ("STORED", out);
+    Cas("key", 0, 0, version).Execute(storage, "old", out);
+    EXPECT_EQ("EXISTS", out);
+
+    Replace("key", 9, 0).Execute(storage, "replaced", out);
+    EXPECT_EQ("STORED", out);
+    Replace("missing", 0, 0).Execute(storage, "replaced", out);
+    EXPECT_EQ("NOT_STORED", out);
+
+    // Flags of append are ignored, the ones item has are kept
+    Append("key", 3, 0).Execute(storage, ">", out);
+    EXPECT_EQ("STORED", out);
+    Prepend("key", 0, 0).Execute(storage, "<", out);
+    EXPECT_EQ("STORED", out);
+    Prepend("missing", 0, 0).Execute(storage, "<", out);
+    EXPECT_EQ("NOT_STORED", out);
+    std::string value;
+    ASSERT_TRUE(storage.Get("key", value));
+    EXPECT_EQ("<replaced>", value);
+    Get({"key"}).Execute(storage, "", out);
+    EXPECT_EQ("VALUE key 9 10\r\n<replaced>\r\nEND", out);
+
+    Touch("key", 100).Execute(storage, "", out);
+    EXPECT_EQ("TOUCHED", out);
+    Delete("key").Execute(storage, "", out);
+    EXPECT_EQ("DELETED", out);
+    Delete("key").Execute(storage, "", out);
+    EXPECT_EQ("NOT_FOUND", out);
+    Touch("key", 100).Execute(storage, "", out);
+    EXPECT_EQ("NOT_FOUND", out);
+}
+
+TEST(ExecuteTest, Expiration) {
+    ThreadSafeSimplLRU storage;
+    std::string out;
+
+    // Negative time and unix time in the past, expired item is as good as missing
+    Set("past", 0, -1).Execute(storage, "v", out);
+    EXPECT_EQ("STORED", out);
+    Get({"past"}).Execute(storage, "", out);
+    EXPECT_EQ("END", out);
+    Add("past", 0, 1000000000).Execute(storage, "v", out);
+    EXPECT_EQ("STORED", out);
+    Get({"past"}).Execute(storage, "", out);
+    EXPECT_EQ("END", out);
+
+    // Read-modify-write keeps the deadline
+    Set("key", 1, 100).Execute(storage, "1", out);
+    Arithmetic(Arithmetic::Operation::Incr, "key", 1).Execute(storage, "", out);
+    EXPECT_EQ("2", out);
+    std::string value;
+    std::shared_ptr<const ChunkedValue> chunks;
+    uint64_t version;
+    Storage::Attributes attributes;
+    ASSERT_TRUE(storage.Get("key", KeyHash("key"), value, chunks, version, attributes));
+    EXPECT_EQ(1, attributes.flags);
+    EXPECT_LT(Storage::Now(), attributes.deadline);
+    EXPECT_GE(Storage::Now() + 100 * 1000, attributes.deadline);
+
+    // Touch moves deadline either way
+    Touch("key", 0).Execute(storage, "", out);
+    EXPECT_EQ("TOUCHED", out);
+    ASSERT_TRUE(storage.Get("key", KeyHash("key"), value, chunks, version, attributes));
+    EXPECT_EQ(0, attributes.deadline);
+    Touch("key", -1).Execute(storage, "", out);
+    EXPECT_EQ("TOUCHED", out);
+    Get({"key"}).Execute(storage, "", out);
+    EXPECT_EQ("END", out);
+    Touch("key", 100).Execute(storage, "", out);
+    EXPECT_EQ("NOT_FOUND", out);
+}
+
+TEST(ExecuteTest, Arithmetic) {
+    ThreadSafeSimplLRU storage;
+    std::string out;
+
+    Arithmetic(Arithmetic::Operation::Incr, "n", 1).Execute(storage, "", out);
+    EXPECT_EQ("NOT_FOUND", out);
+
+    storage.Put("n", "18446744073709551614");
+    Arithmetic(Arithmetic::Operation::Incr, "n", 1).Execute(storage, "", out);
+    EXPECT_EQ("18446744073709551615", out);
+    Arithmetic(Arithmetic::Operation::Incr, "n", 3).Execute(storage, "", out);
+    EXPECT_EQ("2", out);
+    Arithmetic(Arithmetic::Operation::Decr, "n", 5).Execute(storage, "", out);
+    EXPECT_EQ("0", out);
+
+    storage.Put("n", "12a");
+    Arithmetic(Arithmetic::Operation::Decr, "n", 1).Execute(storage, "", out);
+    EXPECT_EQ("CLIENT_ERROR cannot increment or decrement non-numeric value", out);
+
+    FlushAll(10).Execute(storage, "", out);
+    EXPECT_EQ(0, out.find("CLIENT_ERROR"));
+    FlushAll(0).Execute(storage, "", out);
+    EXPECT_EQ("OK", out);
+    std::string value;
+    EXPECT_FALSE(storage.Get("n", value));
+
+    // Storage without flush support
+    struct Fixed : SimpleLRU {
+        bool Flush() override { return false; }
+    } fixed;
+    FlushAll(0).Execute(fixed, "", out);
+    EXPECT_EQ(0, out.find("SERVER_ERROR"));
+}
+
+// Concurrent read-modify-write commands never lose updates
+TEST(ExecuteTest, ConcurrentUpdates) {
+    std::unique_ptr<StripedLRU> storage(buildStripeStorage(4, 4 * 2 * 1024 * 1024));
+    storage->Put("counter", "0");
+    storage->Put("log", "");
+
+    const int threads = 4, rounds = 500;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&storage, t]() {
+            std::string out;
+            for (int i = 0; i < rounds; i++) {
+                Arithmetic(Arithmetic::Operation::Incr, "counter", 1).Execute(*storage, "", out);
+                Append("log", 0, 0).Execute(*storage, std::to_string(t), out);
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    std::string value;
+    ASSERT_TRUE(storage->Get("counter", value));
+    EXPECT_EQ(std::to_string(threads * rounds), value);
+    ASSERT_TRUE(storage->Get("log", value));
+    EXPECT_EQ(threads * rounds, value.size());
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include <spdlog/sinks/ostream_sink.h>
+
+#include <afina/execute/Delete.h>
+#include <afina/execute/Get.h>
+#include <afina/logging/Trace.h>
+
+#include "storage/SimpleLRU.h"
+
+using namespace Afina;
+using namespace Afina::Backend;
+using namespace Afina::Execute;
+
+namespace {
+
+std::size_t Lines(const std::ostringstream &out) {
+    std::string text = out.str();
+    return std::count(text.begin(), text.end(), '\n');
+}
+
+} // namespace
+
+TEST(ExecuteTest, TraceSampled) {
+    if (AFINA_TRACE_LEVEL > AFINA_TRACE_LEVEL_DEBUG) {
+        // Commands trace nothing, see AFINA_TRACE_LEVEL
+        return;
+    }
+
+    std::ostringstream out;
+    auto logger = std::make_shared<spdlog::logger>("trace", std::make_shared<spdlog::sinks::ostream_sink_st>(out));
+    logger->set_pattern("%v");
+    SimpleLRU storage;
+    std::string result;
+
+    // Nothing is written until logger is installed
+    Delete del("key");
+    del.Execute(storage, "", result);
+
+    // Every third message gets through
+    logger->set_level(spdlog::level::debug);
+    Logging::Trace::Install(logger, 3);
+    for (int i = 0; i < 6; i++) {
+        del.Execute(storage, "", result);
+    }
+    Get({"a", "b"}).Execute(storage, "", result);
+    Get({"c", "d"}).Execute(storage, "", result);
+    Get({"e", "f"}).Execute(storage, "", result);
+    EXPECT_EQ(3, Lines(out));
+    EXPECT_NE(std::string::npos, out.str().find("Delete(key)\n"));
+    EXPECT_EQ(std::string::npos, out.str().find("Get(a b)"));
+    EXPECT_NE(std::string::npos, out.str().find("Get(e f)\n"));
+
+    // Arguments are evaluated only if message is written
+    int evaluated = 0;
+    auto argument = [&evaluated]() { return ++evaluated; };
+    Logging::Trace::Install(logger, 2);
+    for (int i = 0; i < 4; i++) {
+        AFINA_TRACE_DEBUG("{}", argument());
+    }
+    EXPECT_EQ(2, evaluated);
+    EXPECT_EQ(5, Lines(out));
+
+    // Logger level filters messages before sampling
+    logger->set_level(spdlog::level::info);
+    for (int i = 0; i < 4; i++) {
+        AFINA_TRACE_DEBUG("{}", argument());
+    }
+    EXPECT_EQ(2, evaluated);
+
+    Logging::Trace::Install(nullptr);
+    logger->set_level(spdlog::level::trace);
+    del.Execute(storage, "", result);
+    EXPECT_EQ(5, Lines(out));
+}
@@ -0,0 +1,144 @@
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * # Standalone fuzz driver
+ * Runs fuzz target without libFuzzer: every input given on the command line (files or directories of them) and
+ * then the given number of random mutations of each one. Without arguments the single input is read from stdin,
+ * which is what AFL expects. Mutations are seeded, so that a failing run could be repeated. Input the target
+ * aborts on is saved into ./crash-input, as libFuzzer does
+ *
+ * Usage: <target> [--mutations N] [--seed S] [input...]
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, std::size_t size);
+
+namespace {
+
+void Collect(const std::string &path, std::vector<std::string> &inputs) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        std::cerr << "Failed to open " << path << std::endl;
+        std::exit(1);
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        std::ifstream file(path, std::ios::binary);
+        inputs.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return;
+    }
+
+    DIR *dir = opendir(path.c_str());
+    while (struct dirent *entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') {
+            Collect(path + "/" + entry->d_name, inputs);
+        }
+    }
+    closedir(dir);
+}
+
+// Input being tested, saved by the abort handler
+const std::string *current = nullptr;
+
+void SaveCrash(int) {
+    int fd = open("crash-input", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0 && current != nullptr) {
+        ssize_t written = write(fd, current->data(), current->size());
+        (void)written;
+        close(fd);
+    }
+    std::signal(SIGABRT, SIG_DFL);
+}
+
+void Test(const std::string &input) {
+    // Copy of the exact size, so that reads past the end are caught by the address sanitizer
+    std::vector<uint8_t> data(input.begin(), input.end());
+    current = &input;
+    LLVMFuzzerTestOneInput(data.data(), data.size());
+    current = nullptr;
+}
+
+// Random byte edits, copies of ranges within the input and splices with other inputs
+std::string Mutate(std::mt19937 &rnd, const std::string &input, const std::vector<std::string> &inputs) {
+    std::string out = input;
+    for (std::size_t edits = 1 + rnd() % 4; edits > 0; edits--) {
+        std::size_t pos = out.empty() ? 0 : rnd() % out.size();
+        std::size_t len = 1 + rnd() % 16;
+        switch (rnd() % 6) {
+        case 0:
+            if (!out.empty()) {
+                out[pos] = char(rnd());
+            }
+            break;
+        case 1:
+            out.insert(pos, 1, char(rnd()));
+            break;
+        case 2:
+            out.erase(pos, len);
+            break;
+        case 3:
+            if (!out.empty()) {
+                out.insert(rnd() % out.size(), out.substr(pos, len));
+            }
+            break;
+        case 4: {
+            const std::string &other = inputs[rnd() % inputs.size()];
+            std::size_t from = other.empty() ? 0 : rnd() % other.size();
+            out.insert(pos, other.substr(from, len * 4));
+            break;
+        }
+        default:
+            if (!out.empty()) {
+                // Interesting digits
+                static const char *numbers[] = {"0", "9", "4294967295", "4294967296", "10000000000", "2147483648",
+                                                "-2147483648", "-2147483649", "18446744073709551615",
+                                                "18446744073709551616"};
+                out.insert(pos, numbers[rnd() % (sizeof(numbers) / sizeof(numbers[0]))]);
+            }
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::size_t mutations = 0;
+    uint32_t seed = 42;
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--mutations") == 0 && i + 1 < argc) {
+            mutations = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            Collect(argv[i], inputs);
+        }
+    }
+    if (inputs.empty()) {
+        inputs.emplace_back(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+    }
+
+    std::signal(SIGABRT, SaveCrash);
+    std::mt19937 rnd(seed);
+    for (auto &input : inputs) {
+        Test(input);
+        for (std::size_t i = 0; i < mutations; i++) {
+            Test(Mutate(rnd, input, inputs));
+        }
+    }
+    std::cout << "Ran " << inputs.size() * (mutations + 1) << " inputs" << std::endl;
+    return 0;
+}
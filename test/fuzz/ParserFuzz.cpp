@@ -0,0 +1,468 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include <afina/Hash.h>
+#include <afina/execute/Add.h>
+#include <afina/execute/Append.h>
+#include <afina/execute/Arithmetic.h>
+#include <afina/execute/Cas.h>
+#include <afina/execute/Delete.h>
+#include <afina/execute/FlushAll.h>
+#include <afina/execute/Get.h>
+#include <afina/execute/Gets.h>
+#include <afina/execute/LeaseGet.h>
+#include <afina/execute/LeaseSet.h>
+#include <afina/execute/Namespace.h>
+#include <afina/execute/Prepend.h>
+#include <afina/execute/Replace.h>
+#include <afina/execute/Set.h>
+#include <afina/execute/Stats.h>
+#include <afina/execute/Subscribe.h>
+#include <afina/execute/Touch.h>
+
+#include <protocol/Parser.h>
+
+/**
+ * # Fuzz target of the memcached text parser
+ * Input is a 4-byte seed followed by the stream. The stream is parsed three times: as a whole, byte by byte
+ * and in pieces which sizes are drawn from the seed. Every piece is a separate heap copy released right after
+ * the Parse call, so that keys referring to the input past its lifetime are caught by the address sanitizer.
+ * All three runs must give the same commands at the same stream offsets.
+ *
+ * The whole stream run is also checked against the reference parser below. Reference is written straight
+ * from the protocol description and knows nothing about the states and fast paths of Protocol::Parser.
+ * Protocol::Parser tolerates some garbage between the fields of storage commands, so commands are compared up
+ * to the first line reference finds malformed. Well formed lines reference rejects (unknown command, wrong
+ * arguments, numbers out of range) must be rejected by Protocol::Parser too.
+ *
+ * Entry point is libFuzzer's LLVMFuzzerTestOneInput, AFL and plain runs go through Driver.cpp
+ */
+
+using namespace Afina;
+
+namespace {
+
+// Command as text, the same for both parsers
+std::string Escape(const std::string &s) {
+    std::string out;
+    for (unsigned char c : s) {
+        if (c < 0x20 || c >= 0x7f || c == '\\' || c == ' ') {
+            char hex[5];
+            std::snprintf(hex, sizeof(hex), "\\x%02x", c);
+            out += hex;
+        } else {
+            out += char(c);
+        }
+    }
+    return out;
+}
+
+// Command parsed out of the stream along with where it ends, or an error
+struct Event {
+    std::string command;
+    std::size_t end;
+
+    bool operator==(const Event &other) const { return command == other.command && end == other.end; }
+    bool operator!=(const Event &other) const { return !(*this == other); }
+};
+
+[[noreturn]] void Fail(const std::string &what, const std::vector<Event> &expected, const std::vector<Event> &got) {
+    std::fprintf(stderr, "%s\n", what.c_str());
+    for (std::size_t i = 0; i < std::max(expected.size(), got.size()); i++) {
+        std::fprintf(stderr, "#%zu expected: %s @%zu\n", i, i < expected.size() ? expected[i].command.c_str() : "-",
+                     i < expected.size() ? expected[i].end : 0);
+        std::fprintf(stderr, "#%zu got:      %s @%zu\n", i, i < got.size() ? got[i].command.c_str() : "-",
+                     i < got.size() ? got[i].end : 0);
+    }
+    std::abort();
+}
+
+std::string StorageLine(const char *name, const std::string &key, uint32_t flags, int32_t expire, uint64_t bytes,
+                        uint64_t token, bool noreply) {
+    return std::string(name) + " " + Escape(key) + " flags=" + std::to_string(flags) +
+           " expire=" + std::to_string(expire) + " bytes=" + std::to_string(bytes) +
+           " token=" + std::to_string(token) + (noreply ? " noreply" : "");
+}
+
+std::string Keys(const char *name, const std::vector<std::string> &keys) {
+    std::string out = name;
+    for (auto &key : keys) {
+        out += " " + Escape(key);
+    }
+    return out;
+}
+
+// Describes command built by Protocol::Parser
+std::string Describe(const Execute::Command &command, std::size_t body) {
+    const std::type_info &type = typeid(command);
+    bool noreply = command.NoReply();
+    auto insert = [&](const char *name, uint64_t token) {
+        auto &c = static_cast<const Execute::InsertCommand &>(command);
+        if (c.hash() != KeyHash(c.key())) {
+            return std::string("wrong hash");
+        }
+        return StorageLine(name, c.key(), c.flags(), c.expire(), body, token, noreply);
+    };
+    auto keys = [&](const char *name) {
+        auto &c = static_cast<const Execute::Get &>(command);
+        if (c.hashes().size() != c.keys().size()) {
+            return std::string("wrong hashes");
+        }
+        for (std::size_t i = 0; i < c.keys().size(); i++) {
+            if (c.hashes()[i] != KeyHash(c.keys()[i])) {
+                return std::string("wrong hash");
+            }
+        }
+        return Keys(name, c.keys()) + (noreply ? " noreply" : "");
+    };
+
+    if (type == typeid(Execute::Set)) {
+        return insert("set", 0);
+    } else if (type == typeid(Execute::Add)) {
+        return insert("add", 0);
+    } else if (type == typeid(Execute::Replace)) {
+        return insert("replace", 0);
+    } else if (type == typeid(Execute::Append)) {
+        return insert("append", 0);
+    } else if (type == typeid(Execute::Prepend)) {
+        return insert("prepend", 0);
+    } else if (type == typeid(Execute::Cas)) {
+        return insert("cas", static_cast<const Execute::Cas &>(command).version());
+    } else if (type == typeid(Execute::LeaseSet)) {
+        return insert("lset", static_cast<const Execute::LeaseSet &>(command).token());
+    } else if (type == typeid(Execute::Get)) {
+        return keys("get");
+    } else if (type == typeid(Execute::Gets)) {
+        return keys("gets");
+    } else if (type == typeid(Execute::LeaseGet)) {
+        return Keys("lget", static_cast<const Execute::LeaseGet &>(command).keys()) + (noreply ? " noreply" : "");
+    } else if (type == typeid(Execute::Delete)) {
+        return "delete " + Escape(static_cast<const Execute::Delete &>(command).key()) + (noreply ? " noreply" : "");
+    } else if (type == typeid(Execute::Arithmetic)) {
+        auto &c = static_cast<const Execute::Arithmetic &>(command);
+        return std::string(c.operation() == Execute::Arithmetic::Operation::Incr ? "incr " : "decr ") +
+               Escape(c.key()) + " " + std::to_string(c.delta()) + (noreply ? " noreply" : "");
+    } else if (type == typeid(Execute::Touch)) {
+        auto &c = static_cast<const Execute::Touch &>(command);
+        return "touch " + Escape(c.key()) + " " + std::to_string(c.expire()) + (noreply ? " noreply" : "");
+    } else if (type == typeid(Execute::FlushAll)) {
+        auto &c = static_cast<const Execute::FlushAll &>(command);
+        return "flush_all " + std::to_string(c.delay()) + (noreply ? " noreply" : "");
+    } else if (type == typeid(Execute::Namespace)) {
+        return "namespace " + Escape(static_cast<const Execute::Namespace &>(command).name()) +
+               (noreply ? " noreply" : "");
+    } else if (type == typeid(Execute::Stats)) {
+        auto &c = static_cast<const Execute::Stats &>(command);
+        return "stats" + (c.group().empty() ? std::string() : " " + c.group()) + (noreply ? " noreply" : "");
+    } else if (type == typeid(Execute::Subscribe)) {
+        return std::string("subscribe") + (noreply ? " noreply" : "");
+    }
+    return std::string("unknown command ") + type.name();
+}
+
+/**
+ * Parses the stream fed in pieces of the given sizes (the last one is repeated) the way network layer does:
+ * data block of storage commands is skipped, commands go back to the parser once built. Parse error ends the
+ * stream, so does an incomplete command
+ */
+std::vector<Event> Feed(const uint8_t *stream, std::size_t size, const std::vector<std::size_t> &pieces) {
+    std::vector<Event> events;
+    Protocol::Parser parser;
+    std::size_t pos = 0, body = 0;
+    for (std::size_t piece = 0; pos < size; piece++) {
+        std::size_t len = std::min(pieces[std::min(piece, pieces.size() - 1)], size - pos);
+        std::unique_ptr<char[]> copy(new char[len]);
+        std::memcpy(copy.get(), stream + pos, len);
+
+        const char *data = copy.get();
+        std::size_t left = len;
+        while (left > 0) {
+            if (body > 0) {
+                std::size_t skip = std::min<std::size_t>(body, left);
+                body -= skip;
+                data += skip;
+                left -= skip;
+                continue;
+            }
+
+            std::size_t parsed = 0;
+            bool complete;
+            std::unique_ptr<Execute::Command> command;
+            std::size_t body_size = 0;
+            try {
+                complete = parser.Parse(data, left, parsed);
+                if (complete) {
+                    command = parser.Build(body_size);
+                }
+            } catch (std::runtime_error &) {
+                events.push_back(Event{"error", 0});
+                return events;
+            }
+            if (parsed == 0 && !complete) {
+                break;
+            }
+            data += parsed;
+            left -= parsed;
+            if (!complete) {
+                continue;
+            }
+            if (!command) {
+                Fail("Command is not built", {}, events);
+            }
+
+            std::size_t end = pos + (data - copy.get());
+            events.push_back(Event{Describe(*command, body_size), end});
+            body = body_size > 0 ? body_size + 2 : 0;
+            parser.Reset();
+            parser.Recycle(std::move(command));
+        }
+        pos += len;
+    }
+    return events;
+}
+
+/**
+ * # Reference parser
+ * Whole line at a time, as the protocol describes it: command name and arguments separated by single spaces,
+ * line ends with \r\n. Keys are non-empty and have neither spaces nor control characters
+ */
+class Reference {
+public:
+    Reference(const uint8_t *data, std::size_t size) : _data(reinterpret_cast<const char *>(data)), _size(size) {}
+
+    /**
+     * Commands up to the first malformed line, rejected line or the end of the stream. Rejected line gives an
+     * error and ends the stream
+     *
+     * @param complete set if there is nothing left to compare in the stream
+     */
+    std::vector<Event> Parse(bool &complete) {
+        std::vector<Event> events;
+        std::size_t pos = 0;
+        complete = false;
+        while (pos < _size) {
+            const char *start = _data + pos;
+            const void *cr = std::memchr(start, '\r', _size - pos);
+            if (cr == nullptr) {
+                return events;
+            }
+            std::size_t line_end = static_cast<const char *>(cr) - _data;
+            if (line_end + 1 >= _size) {
+                return events;
+            }
+            if (_data[line_end + 1] != '\n') {
+                return events;
+            }
+
+            std::string command;
+            uint64_t body = 0;
+            Line line = _line(std::string(start, line_end - pos), command, body);
+            if (line == Line::Malformed) {
+                return events;
+            }
+            if (line == Line::Rejected) {
+                events.push_back(Event{"error", 0});
+                complete = true;
+                return events;
+            }
+            pos = line_end + 2;
+            events.push_back(Event{command, pos});
+
+            if (body > 0) {
+                if (body + 2 > _size - pos) {
+                    return events;
+                }
+                pos += body + 2;
+            }
+        }
+        complete = true;
+        return events;
+    }
+
+private:
+    enum class Line { Valid, Rejected, Malformed };
+
+    static bool _number(const std::string &s, uint64_t max, uint64_t &value) {
+        if (s.empty()) {
+            return false;
+        }
+        value = 0;
+        for (char c : s) {
+            if (c < '0' || c > '9') {
+                return false;
+            }
+            uint64_t digit = c - '0';
+            if (value > (max - digit) / 10) {
+                return false;
+            }
+            value = value * 10 + digit;
+        }
+        return true;
+    }
+
+    static bool _digits(const std::string &s) {
+        return !s.empty() && s.find_first_not_of("0123456789") == std::string::npos;
+    }
+
+    static bool _time(const std::string &s, int32_t &value) {
+        uint64_t v;
+        if (!s.empty() && s[0] == '-') {
+            if (!_number(s.substr(1), uint64_t(INT32_MAX) + 1, v)) {
+                return false;
+            }
+            value = int32_t(-int64_t(v));
+            return true;
+        }
+        if (!_number(s, INT32_MAX, v)) {
+            return false;
+        }
+        value = int32_t(v);
+        return true;
+    }
+
+    static Line _line(const std::string &line, std::string &command, uint64_t &body) {
+        std::vector<std::string> words;
+        std::size_t from = 0;
+        for (;;) {
+            std::size_t to = line.find(' ', from);
+            words.push_back(line.substr(from, to == std::string::npos ? std::string::npos : to - from));
+            if (to == std::string::npos) {
+                break;
+            }
+            from = to + 1;
+        }
+        for (auto &word : words) {
+            if (word.empty()) {
+                return Line::Malformed;
+            }
+            for (unsigned char c : word) {
+                if (c <= 0x20 || c == 0x7f) {
+                    return Line::Malformed;
+                }
+            }
+        }
+
+        const std::string &name = words[0];
+        std::vector<std::string> args(words.begin() + 1, words.end());
+        body = 0;
+
+        // Storage commands: <key> <flags> <exptime> <bytes> [<token>] [noreply]
+        const char *storage[] = {"set", "add", "replace", "append", "prepend", "cas", "lset"};
+        for (const char *s : storage) {
+            if (name != s) {
+                continue;
+            }
+            bool tokened = name == "cas" || name == "lset";
+            bool noreply = !args.empty() && args.back() == "noreply";
+            std::size_t count = args.size() - noreply;
+            uint64_t flags, bytes, token = 0;
+            int32_t expire;
+            if (count != (tokened ? 5u : 4u)) {
+                return Line::Malformed;
+            }
+
+            // Numbers which are too large are rejected, anything else is left to the leniency of the parser
+            bool digits = _digits(args[1]) && _digits(args[2][0] == '-' ? args[2].substr(1) : args[2]) &&
+                          _digits(args[3]) && (!tokened || _digits(args[4]));
+            if (!digits) {
+                return Line::Malformed;
+            }
+            if (!_number(args[1], UINT32_MAX, flags) || !_time(args[2], expire) ||
+                !_number(args[3], UINT32_MAX, bytes) || (tokened && !_number(args[4], UINT64_MAX, token))) {
+                return Line::Rejected;
+            }
+            command = StorageLine(s, args[0], uint32_t(flags), expire, bytes, token, noreply);
+            body = bytes;
+            return Line::Valid;
+        }
+
+        if (name == "get" || name == "gets" || name == "lget") {
+            if (args.empty()) {
+                return Line::Rejected;
+            }
+            command = Keys(name.c_str(), args);
+            return Line::Valid;
+        }
+
+        // Other commands take noreply as the last argument, but not in place of the key
+        bool keyed = name == "delete" || name == "incr" || name == "decr" || name == "touch";
+        bool noreply = (keyed ? args.size() > 1 : name == "flush_all" && !args.empty()) && args.back() == "noreply";
+        if (noreply) {
+            args.pop_back();
+        }
+        std::string quiet = noreply ? " noreply" : "";
+
+        uint64_t number;
+        int32_t time;
+        if (name == "delete" && args.size() == 1) {
+            command = "delete " + Escape(args[0]) + quiet;
+        } else if ((name == "incr" || name == "decr") && args.size() == 2 && _number(args[1], UINT64_MAX, number)) {
+            command = name + " " + Escape(args[0]) + " " + std::to_string(number) + quiet;
+        } else if (name == "touch" && args.size() == 2 && _time(args[1], time)) {
+            command = "touch " + Escape(args[0]) + " " + std::to_string(time) + quiet;
+        } else if (name == "flush_all" && args.empty()) {
+            command = "flush_all 0" + quiet;
+        } else if (name == "flush_all" && args.size() == 1 && _number(args[0], UINT32_MAX, number)) {
+            command = "flush_all " + std::to_string(number) + quiet;
+        } else if (name == "namespace" && args.size() == 1) {
+            command = "namespace " + Escape(args[0]);
+        } else if ((name == "stats" || name == "subscribe") && args.empty()) {
+            command = name;
+        } else if (name == "stats" && args.size() == 1 && (args[0] == "commands" || args[0] == "latency")) {
+            command = "stats " + args[0];
+        } else {
+            return Line::Rejected;
+        }
+        return Line::Valid;
+    }
+
+    const char *_data;
+    const std::size_t _size;
+};
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, std::size_t size) {
+    if (size < 4) {
+        return 0;
+    }
+    uint32_t seed;
+    std::memcpy(&seed, data, sizeof(seed));
+    data += sizeof(seed);
+    size -= sizeof(seed);
+
+    // Piece sizes from 1 to 64 bytes drawn from the seed
+    std::vector<std::size_t> pieces;
+    for (std::size_t total = 0; total < size;) {
+        seed = seed * 1103515245 + 12345;
+        pieces.push_back(1 + (seed >> 16) % 64);
+        total += pieces.back();
+    }
+
+    std::vector<Event> whole = Feed(data, size, {size});
+    std::vector<Event> bytes = Feed(data, size, {1});
+    std::vector<Event> split = Feed(data, size, pieces);
+    if (bytes != whole) {
+        Fail("Stream fed byte by byte differs from the whole one", whole, bytes);
+    }
+    if (split != whole) {
+        Fail("Stream fed in pieces differs from the whole one", whole, split);
+    }
+
+    bool complete = false;
+    std::vector<Event> expected = Reference(data, size).Parse(complete);
+    if (whole.size() < expected.size() || (complete && whole.size() != expected.size()) ||
+        !std::equal(expected.begin(), expected.end(), whole.begin())) {
+        Fail("Parser differs from the reference", expected, whole);
+    }
+    return 0;
+}
@@ -0,0 +1,296 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <spdlog/logger.h>
+#include <spdlog/sinks/null_sink.h>
+
+#include <afina/ChangeStream.h>
+#include <afina/ChunkedValue.h>
+#include <afina/Hash.h>
+#include <afina/execute/Stats.h>
+
+#include <network/Pipeline.h>
+#include <storage/ThreadSafeSimpleLRU.h>
+
+using namespace Afina;
+using namespace Afina::Backend;
+using namespace Afina::Network;
+
+namespace {
+
+// Counts batched lookups
+class CountingStorage : public ThreadSafeSimplLRU {
+public:
+    CountingStorage() : ThreadSafeSimplLRU(1024 * 1024), batches(0), batched_keys(0) {}
+
+    void GetMany(const std::vector<std::string> &keys, const std::vector<uint64_t> &hashes,
+                 std::vector<std::string> &values, std::vector<std::shared_ptr<const ChunkedValue>> &chunks,
+                 std::vector<uint64_t> &versions, std::vector<Attributes> &attributes,
+                 std::vector<bool> &found) override {
+        batches++;
+        batched_keys += keys.size();
+        ThreadSafeSimplLRU::GetMany(keys, hashes, values, chunks, versions, attributes, found);
+    }
+
+    std::size_t batches;
+    std::size_t batched_keys;
+};
+
+// Pipeline writing into one end of the socket pair, responses are read from the other
+class Connection {
+public:
+    Connection(std::shared_ptr<Storage> storage) : running(true) {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+            throw std::runtime_error("Failed to create socket pair");
+        }
+        fcntl(sockets[1], F_SETFL, O_NONBLOCK);
+        auto logger = std::make_shared<spdlog::logger>("pipeline", std::make_shared<spdlog::sinks::null_sink_mt>());
+        pipeline.reset(new Pipeline(sockets[0], storage, logger, running));
+    }
+    ~Connection() {
+        close(sockets[0]);
+        close(sockets[1]);
+    }
+
+    // Everything sent so far
+    std::string Responses() {
+        std::string out;
+        char buffer[4096];
+        ssize_t got;
+        while ((got = read(sockets[1], buffer, sizeof(buffer))) > 0) {
+            out.append(buffer, got);
+        }
+        return out;
+    }
+
+    std::atomic<bool> running;
+    int sockets[2];
+    std::unique_ptr<Pipeline> pipeline;
+};
+
+} // namespace
+
+TEST(PipelineTest, TextBatch) {
+    auto storage = std::make_shared<CountingStorage>();
+    Connection connection(storage);
+
+    std::string input = "set a 0 0 1\r\n1\r\n"
+                        "get a\r\n"
+                        "get a b\r\n"
+                        "gets missing\r\n"
+                        "set b 0 0 1 noreply\r\n2\r\n"
+                        "get b\r\n"
+                        "get a b\r\n"
+                        "set c 0 0";
+    connection.pipeline->Process(input.data(), input.size());
+    EXPECT_EQ("STORED\r\n"
+              "VALUE a 0 1\r\n1\r\nEND\r\n"
+              "VALUE a 0 1\r\n1\r\nEND\r\n"
+              "END\r\n"
+              "VALUE b 0 1\r\n2\r\nEND\r\n"
+              "VALUE a 0 1\r\n1\r\nVALUE b 0 1\r\n2\r\nEND\r\n",
+              connection.Responses());
+
+    // Reads between the sets went as one lookup, as did the last two gets
+    EXPECT_EQ(2, storage->batches);
+    EXPECT_EQ(7, storage->batched_keys);
+
+    // The tail completes with the next block
+    std::string tail = " 1\r\n3\r\nget c\r\n";
+    connection.pipeline->Process(tail.data(), tail.size());
+    EXPECT_EQ("STORED\r\nVALUE c 0 1\r\n3\r\nEND\r\n", connection.Responses());
+}
+
+// Responses do not depend on how the stream is split into blocks
+TEST(PipelineTest, SplitBlocks) {
+    std::string input;
+    for (int i = 0; i < 50; i++) {
+        std::string key = "key" + std::to_string(i % 7);
+        input += i % 3 == 0 ? "set " + key + " 0 0 3\r\nv" + std::to_string(i % 10) + "v\r\n" : "get " + key + "\r\n";
+    }
+
+    std::string expected;
+    for (std::size_t block : {input.size(), std::size_t(1), std::size_t(7), std::size_t(64)}) {
+        Connection connection(std::make_shared<CountingStorage>());
+        for (std::size_t pos = 0; pos < input.size(); pos += block) {
+            connection.pipeline->Process(input.data() + pos, std::min(block, input.size() - pos));
+        }
+        std::string responses = connection.Responses();
+        if (expected.empty()) {
+            expected = responses;
+        }
+        EXPECT_EQ(expected, responses) << block;
+    }
+}
+
+TEST(PipelineTest, RespBatch) {
+    auto storage = std::make_shared<CountingStorage>();
+    storage->Put("a", "1");
+    Connection connection(storage);
+
+    std::string input = "*2\r\n$3\r\nGET\r\n$1\r\na\r\n"
+                        "*2\r\n$3\r\nGET\r\n$1\r\nb\r\n"
+                        "*3\r\n$3\r\nSET\r\n$1\r\nb\r\n$1\r\n2\r\n"
+                        "*2\r\n$3\r\nGET\r\n$1\r\nb\r\n";
+    connection.pipeline->Process(input.data(), input.size());
+    EXPECT_EQ("$1\r\n1\r\n$-1\r\n+OK\r\n$1\r\n2\r\n", connection.Responses());
+    EXPECT_EQ(1, storage->batches);
+}
+
+// Data block of a large value goes right into the buffer reserved for it, whichever way it is read
+TEST(PipelineTest, ReservedBody) {
+    const std::size_t size = 2 * ChunkedValue::ChunkSize + 100;
+    std::string value(size, 'v');
+    for (std::size_t i = 0; i < size; i += 1000) {
+        value[i] = char('a' + (i / 1000) % 26);
+    }
+    std::string input = "set big 0 0 " + std::to_string(size) + "\r\n" + value + "\r\nget big\r\n";
+
+    auto storage = std::make_shared<CountingStorage>();
+    Connection connection(storage);
+
+    // Reads the way servers do: up to 4096 bytes, unless pipeline asks for its own buffer
+    char buffer[4096];
+    std::size_t pos = 0, in_place = 0;
+    std::string responses;
+    while (pos < input.size()) {
+        auto target = connection.pipeline->ReadBuffer(buffer, sizeof(buffer));
+        std::size_t len = std::min(target.second, input.size() - pos);
+        std::memcpy(target.first, input.data() + pos, len);
+        in_place += target.first == buffer ? 0 : len;
+        connection.pipeline->Process(target.first, len);
+        pos += len;
+        responses += connection.Responses();
+    }
+    EXPECT_LT(size - 4096, in_place);
+    EXPECT_EQ("STORED\r\nVALUE big 0 " + std::to_string(size) + "\r\n" + value + "\r\nEND\r\n", responses);
+
+    std::string stored;
+    std::shared_ptr<const ChunkedValue> chunks;
+    EXPECT_TRUE(storage->Get("big", KeyHash("big"), stored, chunks));
+    ASSERT_NE(nullptr, chunks);
+    chunks->CopyTo(stored);
+    EXPECT_EQ(value, stored);
+}
+
+// Data block larger than the storage could keep is skipped without being buffered
+TEST(PipelineTest, OversizedBody) {
+    auto storage = std::make_shared<CountingStorage>();
+    Connection connection(storage);
+
+    const std::size_t size = 2 * storage->MaxItemSize();
+    std::string header = "set huge 0 0 " + std::to_string(size) + "\r\n";
+    connection.pipeline->Process(header.data(), header.size());
+
+    char buffer[4096];
+    std::string block(4096, 'h');
+    for (std::size_t pos = 0; pos < size; pos += block.size()) {
+        EXPECT_EQ(buffer, connection.pipeline->ReadBuffer(buffer, sizeof(buffer)).first);
+        connection.pipeline->Process(block.data(), std::min(block.size(), size - pos));
+    }
+    std::string tail = "\r\nget huge\r\nset a 0 0 1\r\n1\r\n";
+    connection.pipeline->Process(tail.data(), tail.size());
+    EXPECT_EQ("SERVER_ERROR object too large for cache\r\nEND\r\nSTORED\r\n", connection.Responses());
+
+    // Block which is read but still doesn't fit together with the key
+    std::string fitting = "set big 0 0 " + std::to_string(storage->MaxItemSize()) + "\r\n" +
+                          std::string(storage->MaxItemSize(), 'b') + "\r\n";
+    connection.pipeline->Process(fitting.data(), fitting.size());
+    EXPECT_EQ("SERVER_ERROR object too large for cache\r\n", connection.Responses());
+
+    // Flags come back with the value and survive read-modify-write
+    std::string flagged = "set f 5 0 1\r\nx\r\nappend f 0 0 1\r\ny\r\nget f\r\n";
+    connection.pipeline->Process(flagged.data(), flagged.size());
+    EXPECT_EQ("STORED\r\nSTORED\r\nVALUE f 5 2\r\nxy\r\nEND\r\n", connection.Responses());
+}
+
+// Commands, bytes and connections are accounted, stats report them
+TEST(PipelineTest, Stats) {
+    auto storage = std::make_shared<CountingStorage>();
+    auto stats = [&storage](const std::string &group) {
+        std::vector<std::pair<std::string, std::string>> records;
+        Execute::Stats::Collect(*storage, group, records);
+        std::map<std::string, uint64_t> result;
+        for (auto &record : records) {
+            result[record.first] = std::stoull(record.second);
+        }
+        return result;
+    };
+
+    auto before = stats("");
+    auto commands = stats("commands");
+    std::string input = "set a 0 0 1\r\n1\r\nget a\r\nget a b\r\nget c\r\n";
+    std::string responses;
+    {
+        Connection connection(storage);
+        EXPECT_EQ(before["curr_connections"] + 1, stats("")["curr_connections"]);
+        connection.pipeline->Process(input.data(), input.size());
+        responses = connection.Responses();
+    }
+
+    auto after = stats("");
+    EXPECT_EQ(before["curr_connections"], after["curr_connections"]);
+    EXPECT_EQ(before["total_connections"] + 1, after["total_connections"]);
+    EXPECT_EQ(before["get_hits"] + 2, after["get_hits"]);
+    EXPECT_EQ(before["get_misses"] + 2, after["get_misses"]);
+    EXPECT_EQ(before["bytes_read"] + input.size(), after["bytes_read"]);
+    EXPECT_EQ(before["bytes_written"] + responses.size(), after["bytes_written"]);
+    EXPECT_EQ(commands["Get:count"] + 3, stats("commands")["Get:count"]);
+    EXPECT_EQ(commands["Set:count"] + 1, stats("commands")["Set:count"]);
+
+    // Groups by protocol
+    Connection connection(storage);
+    std::string request = "stats latency\r\nstats commands\r\nstats\r\n";
+    connection.pipeline->Process(request.data(), request.size());
+    responses = connection.Responses();
+    EXPECT_NE(std::string::npos, responses.find("STAT Get:p99_ns "));
+    EXPECT_NE(std::string::npos, responses.find("STAT Set:count "));
+    EXPECT_NE(std::string::npos, responses.find("STAT get_hits "));
+
+    // RESP commands are accounted each on its own rather than as one class
+    {
+        Connection resp(storage);
+        std::string input = "*2\r\n$3\r\nGET\r\n$1\r\na\r\n*3\r\n$3\r\nDEL\r\n$1\r\nx\r\n$1\r\ny\r\n";
+        resp.pipeline->Process(input.data(), input.size());
+        EXPECT_EQ("$1\r\n1\r\n:0\r\n", resp.Responses());
+    }
+    auto resp = stats("commands");
+    EXPECT_EQ(commands["RespGet:count"] + 1, resp["RespGet:count"]);
+    EXPECT_EQ(commands["RespDel:count"] + 1, resp["RespDel:count"]);
+    EXPECT_EQ(0, resp.count("RespCommand:count"));
+
+    request = "stats other\r\n";
+    EXPECT_THROW(connection.pipeline->Process(request.data(), request.size()), std::runtime_error);
+}
+
+// Idle subscription ends once the client goes away
+TEST(PipelineTest, SubscriberGone) {
+    auto storage = std::make_shared<ThreadSafeSimplLRU>(1024 * 1024);
+    storage->Publish(std::make_shared<ChangeStream>(16));
+    Connection connection(storage);
+
+    int client = connection.sockets[1];
+    std::thread hang_up([client]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        shutdown(client, SHUT_RDWR);
+    });
+    std::string input = "subscribe\r\n";
+    EXPECT_THROW(connection.pipeline->Process(input.data(), input.size()), std::runtime_error);
+    hang_up.join();
+    EXPECT_TRUE(connection.running);
+}
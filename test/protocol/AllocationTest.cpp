@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <spdlog/logger.h>
+#include <spdlog/sinks/null_sink.h>
+
+#include <afina/execute/Command.h>
+
+#include <network/Pipeline.h>
+#include <protocol/Parser.h>
+#include <storage/StripedLRU.h>
+
+using namespace Afina;
+
+namespace {
+
+// Allocations made by the whole test binary
+std::atomic<std::size_t> allocations(0);
+
+// Allocations made while the counter is alive
+class CountAllocations {
+public:
+    CountAllocations() : _start(allocations.load()) {}
+    std::size_t Count() const { return allocations.load() - _start; }
+
+private:
+    const std::size_t _start;
+};
+
+// Parses, builds and gives the command back the way network layer does
+void Dispatch(Protocol::Parser &parser, const std::string &line) {
+    size_t consumed = 0, body_size = 0;
+    ASSERT_TRUE(parser.Parse(line.data(), line.size(), consumed));
+    std::unique_ptr<Execute::Command> command = parser.Build(body_size);
+    ASSERT_TRUE(bool(command));
+    parser.Reset();
+    parser.Recycle(std::move(command));
+}
+
+// Feeds the pipeline and drains responses it writes into the other end of the socket pair
+std::size_t Exchange(Network::Pipeline &pipeline, int peer, const std::string &input) {
+    pipeline.Process(input.data(), input.size());
+    char buffer[4096];
+    std::size_t total = 0;
+    ssize_t got;
+    while ((got = read(peer, buffer, sizeof(buffer))) > 0) {
+        total += got;
+    }
+    return total;
+}
+
+} // namespace
+
+void *operator new(std::size_t size) {
+    allocations++;
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+// Once buffers of the parser and the pooled commands are grown, dispatch allocates nothing
+TEST(AllocationTest, SteadyDispatch) {
+    const std::string lines[] = {"get some_pretty_long_key:0000000001\r\n",
+                                 "gets some_pretty_long_key:0000000002\r\n",
+                                 "set some_pretty_long_key:0000000003 0 0 5\r\n",
+                                 "get some_pretty_long_key:0000000004 another_pretty_long_key:0000000005\r\n",
+                                 "get some_pretty_long_key:0000000006\r\n"};
+
+    Protocol::Parser parser;
+    for (int round = 0; round < 2; round++) {
+        for (auto &line : lines) {
+            Dispatch(parser, line);
+        }
+    }
+
+    CountAllocations counter;
+    for (int round = 0; round < 1000; round++) {
+        for (auto &line : lines) {
+            Dispatch(parser, line);
+        }
+    }
+    EXPECT_EQ(0, counter.Count());
+}
+
+// Gets served by a pipeline over a real storage allocate nothing either: keys and values are looked up into
+// buffers kept from the previous batch and referenced from the response
+TEST(AllocationTest, SteadyPipeline) {
+    std::shared_ptr<Storage> storage(Backend::buildStripeStorage(4, 16 * 1024 * 1024));
+    int sockets[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+    fcntl(sockets[1], F_SETFL, O_NONBLOCK);
+    std::atomic<bool> running(true);
+    auto logger = std::make_shared<spdlog::logger>("pipeline", std::make_shared<spdlog::sinks::null_sink_mt>());
+    Network::Pipeline pipeline(sockets[0], storage, logger, running);
+
+    std::string value(100, 'v');
+    std::string sets;
+    for (int i = 0; i < 4; i++) {
+        sets += "set some_pretty_long_key:000000000" + std::to_string(i) + " 0 0 100\r\n" + value + "\r\n";
+    }
+    Exchange(pipeline, sockets[1], sets);
+
+    // Batched, single unbatched and multi key unbatched gets
+    const std::string batch = "get some_pretty_long_key:0000000000\r\n"
+                              "gets some_pretty_long_key:0000000001 some_pretty_long_key:0000000002\r\n"
+                              "get some_pretty_long_key:0000000003 some_pretty_long_key:0000000009\r\n";
+    const std::string single = "get some_pretty_long_key:0000000001\r\n";
+    const std::string multi = "get some_pretty_long_key:0000000002 some_pretty_long_key:0000000003\r\n";
+    std::size_t sizes[3];
+    for (int round = 0; round < 10; round++) {
+        sizes[0] = Exchange(pipeline, sockets[1], batch);
+        sizes[1] = Exchange(pipeline, sockets[1], single);
+        sizes[2] = Exchange(pipeline, sockets[1], multi);
+    }
+    EXPECT_LT(4 * value.size(), sizes[0]);
+    EXPECT_LT(value.size(), sizes[1]);
+    EXPECT_LT(2 * value.size(), sizes[2]);
+
+    CountAllocations counter;
+    for (int round = 0; round < 1000; round++) {
+        Exchange(pipeline, sockets[1], batch);
+        Exchange(pipeline, sockets[1], single);
+        Exchange(pipeline, sockets[1], multi);
+    }
+    EXPECT_EQ(0, counter.Count());
+
+    close(sockets[0]);
+    close(sockets[1]);
+}
+
+// Other commands still allocate, which shows counting works
+TEST(AllocationTest, Counted) {
+    Protocol::Parser parser;
+    CountAllocations counter;
+    Dispatch(parser, "delete some_pretty_long_key:0000000001\r\n");
+    EXPECT_LT(0, counter.Count());
+}
@@ -0,0 +1,279 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <afina/execute/Command.h>
+
+#include <protocol/BinaryCommand.h>
+#include <protocol/BinaryParser.h>
+#include <protocol/Codec.h>
+#include <protocol/Parser.h>
+#include <storage/ThreadSafeSimpleLRU.h>
+
+using namespace Afina;
+using namespace Afina::Protocol;
+
+namespace {
+
+typedef BinaryCommand::Opcode Opcode;
+typedef BinaryCommand::Status Status;
+
+void PutBig(std::string &out, uint64_t value, std::size_t size) {
+    for (std::size_t i = size; i > 0; i--) {
+        out.push_back(char((value >> (8 * (i - 1))) & 0xff));
+    }
+}
+
+uint64_t GetBig(const std::string &data, std::size_t pos, std::size_t size) {
+    uint64_t value = 0;
+    for (std::size_t i = 0; i < size; i++) {
+        value = (value << 8) | uint8_t(data[pos + i]);
+    }
+    return value;
+}
+
+std::string Request(Opcode opcode, const std::string &key, const std::string &extras = "",
+                    const std::string &value = "", uint32_t opaque = 0, uint64_t cas = 0) {
+    std::string out;
+    out.push_back(char(0x80));
+    out.push_back(char(opcode));
+    PutBig(out, key.size(), 2);
+    out.push_back(char(extras.size()));
+    out.push_back(0);
+    PutBig(out, 0, 2);
+    PutBig(out, extras.size() + key.size() + value.size(), 4);
+    PutBig(out, opaque, 4);
+    PutBig(out, cas, 8);
+    return out + extras + key + value;
+}
+
+// Extras of set, add and replace: flags and expiration
+std::string StoreExtras() { return std::string(8, '\0'); }
+
+struct Response {
+    Opcode opcode;
+    Status status;
+    uint32_t opaque;
+    uint64_t cas;
+    std::string extras, key, value;
+};
+
+// Splits output of commands into responses
+std::vector<Response> Responses(const std::string &out) {
+    std::vector<Response> result;
+    for (std::size_t pos = 0; pos < out.size();) {
+        EXPECT_EQ(0x81, uint8_t(out[pos]));
+        Response r;
+        r.opcode = Opcode(out[pos + 1]);
+        std::size_t key = GetBig(out, pos + 2, 2), extras = uint8_t(out[pos + 4]), body = GetBig(out, pos + 8, 4);
+        r.status = Status(GetBig(out, pos + 6, 2));
+        r.opaque = uint32_t(GetBig(out, pos + 12, 4));
+        r.cas = GetBig(out, pos + 16, 8);
+        r.extras = out.substr(pos + 24, extras);
+        r.key = out.substr(pos + 24 + extras, key);
+        r.value = out.substr(pos + 24 + extras + key, body - extras - key);
+        result.push_back(r);
+        pos += 24 + body;
+    }
+    return result;
+}
+
+// Runs the stream of requests the way network layer does and collects all the responses
+std::string Serve(Storage &storage, const std::string &stream) {
+    BinaryParser parser;
+    std::string out;
+    std::size_t pos = 0;
+    while (pos < stream.size()) {
+        std::size_t parsed = 0;
+        EXPECT_TRUE(parser.Parse(stream.data() + pos, stream.size() - pos, parsed));
+        pos += parsed;
+
+        std::size_t body = 0;
+        std::unique_ptr<Execute::Command> cmd = parser.Build(body);
+        std::string args = stream.substr(pos, body);
+        pos += body;
+
+        std::string response;
+        cmd->Execute(storage, args, response);
+        out += response;
+        parser.Reset();
+    }
+    return out;
+}
+
+} // namespace
+
+TEST(BinaryParserTest, Detect) {
+    std::unique_ptr<Codec> binary = Codec::Detect(char(0x80));
+    ASSERT_FALSE(dynamic_cast<BinaryParser *>(binary.get()) == nullptr);
+    EXPECT_EQ(0, binary->BodyTrailer());
+
+    std::unique_ptr<Codec> text = Codec::Detect('g');
+    ASSERT_FALSE(dynamic_cast<Parser *>(text.get()) == nullptr);
+    EXPECT_EQ(2, text->BodyTrailer());
+}
+
+// Request split at every position is parsed the same
+TEST(BinaryParserTest, SplitRequest) {
+    std::string request = Request(Opcode::SetQ, "some_key", StoreExtras(), "value", 0xdeadbeef, 42);
+    std::size_t head_size = request.size() - 5;
+    for (std::size_t cut = 0; cut <= head_size; cut++) {
+        BinaryParser parser;
+        std::size_t parsed = 0, total = 0;
+        if (cut > 0) {
+            ASSERT_EQ(cut == head_size, parser.Parse(request.data(), cut, parsed)) << cut;
+            total += parsed;
+        }
+        if (cut < head_size) {
+            ASSERT_TRUE(parser.Parse(request.data() + cut, request.size() - cut, parsed)) << cut;
+            total += parsed;
+        }
+        ASSERT_EQ(head_size, total) << cut;
+        ASSERT_EQ("setq", parser.Name());
+
+        std::size_t body = 0;
+        std::unique_ptr<Execute::Command> cmd = parser.Build(body);
+        ASSERT_EQ(5, body);
+        BinaryCommand *binary = dynamic_cast<BinaryCommand *>(cmd.get());
+        ASSERT_FALSE(binary == nullptr);
+        ASSERT_EQ("some_key", binary->key());
+        ASSERT_EQ(8, binary->extras().size());
+        ASSERT_EQ(0xdeadbeef, binary->opaque());
+        ASSERT_EQ(42, binary->cas());
+    }
+
+    BinaryParser parser;
+    std::size_t parsed = 0;
+    std::string bad = Request(Opcode::Get, "key");
+    bad[0] = 'g';
+    ASSERT_THROW(parser.Parse(bad.data(), bad.size(), parsed), std::runtime_error);
+
+    // Key longer than the body
+    parser.Reset();
+    bad = Request(Opcode::Get, "key");
+    bad[11] = 2;
+    ASSERT_THROW(parser.Parse(bad.data(), bad.size(), parsed), std::runtime_error);
+}
+
+TEST(BinaryParserTest, Commands) {
+    Backend::ThreadSafeSimplLRU storage(1024 * 1024);
+    std::string stream = Request(Opcode::Set, "a", StoreExtras(), "1", 1) + Request(Opcode::Get, "a", "", "", 2) +
+                         Request(Opcode::Add, "a", StoreExtras(), "2", 3) +
+                         Request(Opcode::Append, "a", "", "0", 4) + Request(Opcode::GetK, "a", "", "", 5) +
+                         Request(Opcode::Delete, "b", "", "", 6) + Request(Opcode::Replace, "b", StoreExtras(), "", 7);
+    std::vector<Response> responses = Responses(Serve(storage, stream));
+    ASSERT_EQ(7, responses.size());
+    for (std::size_t i = 0; i < responses.size(); i++) {
+        EXPECT_EQ(i + 1, responses[i].opaque);
+    }
+    EXPECT_EQ(Status::Success, responses[0].status);
+    EXPECT_EQ(Status::Success, responses[1].status);
+    EXPECT_EQ(std::string(4, '\0'), responses[1].extras);
+    EXPECT_EQ("1", responses[1].value);
+    EXPECT_EQ(Status::KeyExists, responses[2].status);
+    EXPECT_EQ(Status::Success, responses[3].status);
+    EXPECT_EQ(Opcode::GetK, responses[4].opcode);
+    EXPECT_EQ("a", responses[4].key);
+    EXPECT_EQ("10", responses[4].value);
+    EXPECT_EQ(Status::KeyNotFound, responses[5].status);
+    EXPECT_EQ(Status::KeyNotFound, responses[6].status);
+
+    // Version from get guards the set
+    uint64_t cas = responses[4].cas;
+    ASSERT_NE(0, cas);
+    responses = Responses(Serve(storage, Request(Opcode::Set, "a", StoreExtras(), "x", 0, cas + 1) +
+                                             Request(Opcode::Set, "a", StoreExtras(), "y", 0, cas) +
+                                             Request(Opcode::Get, "a")));
+    ASSERT_EQ(3, responses.size());
+    EXPECT_EQ(Status::KeyExists, responses[0].status);
+    EXPECT_EQ(Status::Success, responses[1].status);
+    EXPECT_EQ("y", responses[2].value);
+
+    // Missing counter gets the initial value, then it is incremented
+    std::string extras;
+    PutBig(extras, 5, 8);
+    PutBig(extras, 100, 8);
+    PutBig(extras, 0, 4);
+    std::string no_create = extras.substr(0, 16) + std::string(4, '\xff');
+    responses = Responses(Serve(storage, Request(Opcode::Increment, "n", extras) +
+                                             Request(Opcode::Increment, "n", extras) +
+                                             Request(Opcode::Decrement, "m", no_create) +
+                                             Request(Opcode::Increment, "a", extras)));
+    ASSERT_EQ(4, responses.size());
+    EXPECT_EQ(100, GetBig(responses[0].value, 0, 8));
+    EXPECT_EQ(105, GetBig(responses[1].value, 0, 8));
+    EXPECT_EQ(Status::KeyNotFound, responses[2].status);
+    EXPECT_EQ(Status::NonNumeric, responses[3].status);
+
+    responses = Responses(Serve(storage, Request(Opcode::Flush, "") + Request(Opcode::Get, "a") +
+                                             Request(Opcode(0x30), "") + Request(Opcode::Set, "a", "", "x")));
+    ASSERT_EQ(4, responses.size());
+    EXPECT_EQ(Status::Success, responses[0].status);
+    EXPECT_EQ(Status::KeyNotFound, responses[1].status);
+    EXPECT_EQ("Not found", responses[1].value);
+    EXPECT_EQ(Status::UnknownCommand, responses[2].status);
+    EXPECT_EQ(Status::InvalidArguments, responses[3].status);
+
+    // Flags come back in extras of get, append keeps them
+    std::string flagged;
+    PutBig(flagged, 7, 4);
+    PutBig(flagged, 0, 4);
+    responses = Responses(Serve(storage, Request(Opcode::Set, "a", flagged, "x") +
+                                             Request(Opcode::Append, "a", "", "y") + Request(Opcode::Get, "a")));
+    ASSERT_EQ(3, responses.size());
+    EXPECT_EQ(Status::Success, responses[0].status);
+    EXPECT_EQ(Status::Success, responses[1].status);
+    EXPECT_EQ(Status::Success, responses[2].status);
+    EXPECT_EQ(7, GetBig(responses[2].extras, 0, 4));
+    EXPECT_EQ("xy", responses[2].value);
+
+    // Expiration is kept too, touch to unix time in the past expires the item
+    std::string expiring, past;
+    PutBig(expiring, 0, 4);
+    PutBig(expiring, 100, 4);
+    PutBig(past, 1000000000, 4);
+    responses = Responses(Serve(storage, Request(Opcode::Set, "e", expiring, "x") + Request(Opcode::Get, "e") +
+                                             Request(Opcode::Touch, "e", past) + Request(Opcode::Get, "e") +
+                                             Request(Opcode::Touch, "e", past)));
+    ASSERT_EQ(5, responses.size());
+    EXPECT_EQ(Status::Success, responses[0].status);
+    EXPECT_EQ(Status::Success, responses[1].status);
+    EXPECT_EQ(Status::Success, responses[2].status);
+    EXPECT_EQ(Status::KeyNotFound, responses[3].status);
+    EXPECT_EQ(Status::KeyNotFound, responses[4].status);
+}
+
+// Quiet commands respond only to what client can't guess, noop ends the batch
+TEST(BinaryParserTest, QuietPipeline) {
+    Backend::ThreadSafeSimplLRU storage(1024 * 1024);
+    std::string stream;
+    for (int i = 0; i < 10; i++) {
+        stream += Request(Opcode::SetQ, "key" + std::to_string(i), StoreExtras(), std::to_string(i), i);
+    }
+    stream += Request(Opcode::AddQ, "key0", StoreExtras(), "x", 100);
+    for (int i = 0; i < 20; i += 3) {
+        stream += Request(Opcode::GetKQ, "key" + std::to_string(i), "", "", 200 + i);
+    }
+    stream += Request(Opcode::Noop, "", "", "", 300);
+
+    std::vector<Response> responses = Responses(Serve(storage, stream));
+    ASSERT_EQ(6, responses.size());
+    EXPECT_EQ(100, responses[0].opaque);
+    EXPECT_EQ(Status::KeyExists, responses[0].status);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(Opcode::GetKQ, responses[1 + i].opcode);
+        EXPECT_EQ(200 + 3 * i, responses[1 + i].opaque);
+        EXPECT_EQ("key" + std::to_string(3 * i), responses[1 + i].key);
+        EXPECT_EQ(std::to_string(3 * i), responses[1 + i].value);
+    }
+    EXPECT_EQ(Opcode::Noop, responses[5].opcode);
+    EXPECT_EQ(300, responses[5].opaque);
+
+    // Stats end with an empty record
+    responses = Responses(Serve(storage, Request(Opcode::Stat, "")));
+    ASSERT_LT(1, responses.size());
+    EXPECT_TRUE(responses.back().key.empty());
+    EXPECT_FALSE(responses.front().key.empty());
+}
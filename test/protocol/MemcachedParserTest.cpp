@@ -2,11 +2,22 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <afina/execute/Add.h>
+#include <afina/execute/Arithmetic.h>
+#include <afina/execute/Cas.h>
+#include <afina/execute/Delete.h>
+#include <afina/execute/FlushAll.h>
 #include <afina/execute/Get.h>
+#include <afina/execute/Gets.h>
+#include <afina/execute/LeaseGet.h>
+#include <afina/execute/LeaseSet.h>
+#include <afina/execute/Namespace.h>
 #include <afina/execute/Set.h>
 #include <afina/execute/Stats.h>
+#include <afina/execute/Subscribe.h>
+#include <afina/execute/Touch.h>
 
 #include <protocol/Parser.h>
 
@@ -97,4 +108,305 @@ TEST(MemcachedParserTest, Stats) {
 
     Execute::Stats *tmp = reinterpret_cast<Execute::Stats *>(cmd.get());
     ASSERT_FALSE(tmp == nullptr);
+    EXPECT_EQ("", tmp->group());
+
+    // Group of records to report
+    std::string latency = "stats latency\r\n";
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse(latency, consumed));
+    cmd = parser.Build(value_size);
+    EXPECT_EQ("latency", dynamic_cast<Execute::Stats &>(*cmd).group());
+
+    for (std::string line : {"stats other\r\n", "stats latency commands\r\n"}) {
+        parser.Reset();
+        ASSERT_TRUE(parser.Parse(line, consumed));
+        EXPECT_THROW(parser.Build(value_size), std::runtime_error) << line;
+    }
+}
+
+// Verify key hashes are computed by parser and passed along with keys
+TEST(MemcachedParserTest, KeyHashes) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    ASSERT_TRUE(parser.Parse("get ke key2\r\n", consumed));
+
+    size_t value_size;
+    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+    Execute::Get *get = reinterpret_cast<Execute::Get *>(cmd.get());
+    ASSERT_EQ(2, get->hashes().size());
+    ASSERT_EQ(KeyHash("ke"), get->hashes()[0]);
+    ASSERT_EQ(KeyHash("key2"), get->hashes()[1]);
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("set foo 0 0 6\r\n", consumed));
+    cmd = parser.Build(value_size);
+    Execute::Set *set = reinterpret_cast<Execute::Set *>(cmd.get());
+    ASSERT_EQ(KeyHash("foo"), set->hash());
+}
+
+// Verify lease commands
+TEST(MemcachedParserTest, Leases) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    ASSERT_TRUE(parser.Parse("lget foo bar\r\n", consumed));
+    ASSERT_EQ(14, consumed);
+    ASSERT_EQ("lget", parser.Name());
+
+    size_t value_size;
+    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+    ASSERT_FALSE(cmd == nullptr);
+    ASSERT_EQ(0, value_size);
+    Execute::LeaseGet *get = reinterpret_cast<Execute::LeaseGet *>(cmd.get());
+    ASSERT_EQ(2, get->keys().size());
+    ASSERT_EQ("bar", get->keys()[1]);
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("lset foo 0 0 6 18446744073709551615\r\nfooval\r\n", consumed));
+    ASSERT_EQ(37, consumed);
+    cmd = parser.Build(value_size);
+    ASSERT_FALSE(cmd == nullptr);
+    ASSERT_EQ(6, value_size);
+    Execute::LeaseSet *set = reinterpret_cast<Execute::LeaseSet *>(cmd.get());
+    ASSERT_EQ("foo", set->key());
+    ASSERT_EQ(18446744073709551615ull, set->token());
+
+    parser.Reset();
+    ASSERT_THROW(parser.Parse("lset foo 0 0 6 18446744073709551616\r\n", consumed), std::runtime_error);
+}
+
+TEST(MemcachedParserTest, Namespace) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    ASSERT_TRUE(parser.Parse("namespace app\r\n", consumed));
+    ASSERT_EQ(15, consumed);
+
+    size_t value_size;
+    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+    ASSERT_FALSE(cmd == nullptr);
+    ASSERT_EQ(0, value_size);
+    Execute::Namespace *ns = reinterpret_cast<Execute::Namespace *>(cmd.get());
+    ASSERT_EQ("app", ns->name());
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("namespace a b\r\n", consumed));
+    ASSERT_THROW(parser.Build(value_size), std::runtime_error);
+}
+
+TEST(MemcachedParserTest, Subscribe) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    ASSERT_TRUE(parser.Parse("subscribe\r\nget foo\r\n", consumed));
+    ASSERT_EQ(11, consumed);
+
+    size_t value_size;
+    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+    ASSERT_FALSE(cmd == nullptr);
+    ASSERT_EQ(0, value_size);
+    ASSERT_FALSE(dynamic_cast<Execute::Subscribe *>(cmd.get()) == nullptr);
+}
+
+// Verify keys are copied only when command line is split across reads
+TEST(MemcachedParserTest, SplitLine) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    std::string line = "get first_long_key second_long_key\r\n";
+    ASSERT_TRUE(parser.Parse(line, consumed));
+    ASSERT_EQ(0, parser.Spilled());
+
+    size_t value_size;
+    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+    Execute::Get *get = reinterpret_cast<Execute::Get *>(cmd.get());
+    ASSERT_EQ(2, get->keys().size());
+    ASSERT_EQ("second_long_key", get->keys()[1]);
+
+    // Feed the same line in every possible pair of pieces, releasing the first one before the second is parsed
+    for (size_t cut = 1; cut < line.size(); cut++) {
+        parser.Reset();
+        std::unique_ptr<std::string> head(new std::string(line.substr(0, cut)));
+        ASSERT_FALSE(parser.Parse(*head, consumed));
+        ASSERT_EQ(cut, consumed);
+        head.reset();
+
+        std::string tail = line.substr(cut);
+        ASSERT_TRUE(parser.Parse(tail, consumed));
+        ASSERT_EQ(tail.size(), consumed);
+
+        // Only keys started before the cut are copied, each one as a whole
+        ASSERT_EQ((cut > 4 ? 14 : 0) + (cut > 19 ? 15 : 0), parser.Spilled()) << cut;
+
+        cmd = parser.Build(value_size);
+        get = reinterpret_cast<Execute::Get *>(cmd.get());
+        ASSERT_EQ(2, get->keys().size()) << cut;
+        ASSERT_EQ("first_long_key", get->keys()[0]) << cut;
+        ASSERT_EQ("second_long_key", get->keys()[1]) << cut;
+        ASSERT_EQ(KeyHash("first_long_key"), get->hashes()[0]) << cut;
+        ASSERT_EQ(KeyHash("second_long_key"), get->hashes()[1]) << cut;
+    }
+
+    // Key of the storage command cut in the middle
+    parser.Reset();
+    std::string head = "set some_", tail = "key 0 0 6\r\n";
+    ASSERT_FALSE(parser.Parse(head, consumed));
+    ASSERT_TRUE(parser.Parse(tail, consumed));
+    cmd = parser.Build(value_size);
+    Execute::Set *set = reinterpret_cast<Execute::Set *>(cmd.get());
+    ASSERT_EQ("some_key", set->key());
+    ASSERT_EQ(KeyHash("some_key"), set->hash());
+    ASSERT_EQ(6, value_size);
+}
+
+TEST(MemcachedParserTest, TextProtocolCommands) {
+    Protocol::Parser parser;
+    size_t consumed = 0, value_size = 0;
+    std::unique_ptr<Execute::Command> cmd;
+
+    ASSERT_TRUE(parser.Parse("cas foo 1 0 6 12345\r\n", consumed));
+    cmd = parser.Build(value_size);
+    Execute::Cas *cas = dynamic_cast<Execute::Cas *>(cmd.get());
+    ASSERT_FALSE(cas == nullptr);
+    ASSERT_EQ("foo", cas->key());
+    ASSERT_EQ(12345, cas->version());
+    ASSERT_EQ(6, value_size);
+    ASSERT_FALSE(cmd->NoReply());
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("incr counter 18446744073709551615 noreply\r\n", consumed));
+    cmd = parser.Build(value_size);
+    Execute::Arithmetic *incr = dynamic_cast<Execute::Arithmetic *>(cmd.get());
+    ASSERT_FALSE(incr == nullptr);
+    ASSERT_EQ(Execute::Arithmetic::Operation::Incr, incr->operation());
+    ASSERT_EQ("counter", incr->key());
+    ASSERT_EQ(UINT64_MAX, incr->delta());
+    ASSERT_EQ(0, value_size);
+    ASSERT_TRUE(cmd->NoReply());
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("touch foo -1\r\n", consumed));
+    cmd = parser.Build(value_size);
+    ASSERT_EQ(-1, dynamic_cast<Execute::Touch &>(*cmd).expire());
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("flush_all\r\n", consumed));
+    cmd = parser.Build(value_size);
+    ASSERT_EQ(0, dynamic_cast<Execute::FlushAll &>(*cmd).delay());
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("gets a b\r\n", consumed));
+    cmd = parser.Build(value_size);
+    ASSERT_EQ(2, dynamic_cast<Execute::Gets &>(*cmd).keys().size());
+
+    // Arguments are checked
+    for (std::string line : {"delete\r\n", "delete a b\r\n", "incr a\r\n", "decr a -1\r\n", "flush_all 1 2\r\n",
+                             "touch a b\r\n"}) {
+        parser.Reset();
+        ASSERT_TRUE(parser.Parse(line, consumed)) << line;
+        ASSERT_THROW(parser.Build(value_size), std::runtime_error) << line;
+    }
+    parser.Reset();
+    ASSERT_THROW(parser.Parse("set foo 0 0 6 noreplx\r\n", consumed), std::runtime_error);
+
+    // Storage commands take exactly as many numbers as they need, whichever way the line comes
+    for (std::string line : {"cas foo 0 0 6\r\n", "cas foo 0 0 6 noreply\r\n", "lset foo 0 0 6 \r\n",
+                             "set foo 0 0 6 42\r\n", "add foo 0 0 6 42 noreply\r\n", "cas foo 0 0 6 1 2\r\n"}) {
+        for (size_t cut = 1; cut <= line.size(); cut++) {
+            parser.Reset();
+            std::string head = line.substr(0, cut), tail = line.substr(cut);
+            ASSERT_THROW(parser.Parse(head, consumed) || parser.Parse(tail, consumed), std::runtime_error)
+                << line << cut;
+        }
+    }
+}
+
+// noreply is recognized both in one piece and split at every position
+TEST(MemcachedParserTest, NoReply) {
+    std::vector<std::string> lines = {"set foo 0 0 6 noreply\r\n", "cas foo 0 0 6 42 noreply\r\n",
+                                      "delete foo noreply\r\n", "decr foo 5 noreply\r\n", "flush_all noreply\r\n",
+                                      "flush_all 0 noreply\r\n"};
+    for (auto &line : lines) {
+        for (size_t cut = 1; cut <= line.size(); cut++) {
+            Protocol::Parser parser;
+            size_t consumed = 0, value_size = 0;
+            std::string head = line.substr(0, cut), tail = line.substr(cut);
+            if (!parser.Parse(head, consumed)) {
+                ASSERT_TRUE(parser.Parse(tail, consumed)) << line << cut;
+            }
+            std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+            ASSERT_TRUE(cmd->NoReply()) << line << cut;
+        }
+    }
+
+    Protocol::Parser parser;
+    size_t consumed = 0, value_size = 0;
+    ASSERT_TRUE(parser.Parse("delete noreply\r\n", consumed));
+    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+    ASSERT_FALSE(cmd->NoReply());
+    ASSERT_EQ("noreply", dynamic_cast<Execute::Delete &>(*cmd).key());
+}
+
+// Every command name is found, anything close to them is not
+TEST(MemcachedParserTest, CommandNames) {
+    for (const char *name : {"set", "add", "replace", "append", "prepend", "cas", "lset", "get", "gets", "lget",
+                             "namespace", "delete", "incr", "decr", "touch", "flush_all", "stats", "subscribe"}) {
+        Protocol::Parser parser;
+        size_t consumed = 0;
+        std::string line = std::string(name) + "\r\n";
+        EXPECT_NO_THROW(parser.Parse(line, consumed)) << name;
+        EXPECT_EQ(name, parser.Name());
+    }
+
+    for (const char *name : {"", "s", "se", "sett", "Set", "gest", "lgets", "namespaces", "flush", "tset", "decr_"}) {
+        Protocol::Parser parser;
+        size_t consumed = 0;
+        std::string line = std::string(name) + " key\r\n";
+        EXPECT_THROW(parser.Parse(line, consumed), std::runtime_error) << name;
+    }
+}
+
+// Recycled commands come back filled with the next request
+TEST(MemcachedParserTest, Recycle) {
+    Protocol::Parser parser;
+    size_t consumed = 0, value_size = 0;
+    ASSERT_TRUE(parser.Parse("get first_long_key_name other\r\n", consumed));
+    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+    Execute::Command *first = cmd.get();
+    parser.Recycle(std::move(cmd));
+    parser.Reset();
+
+    ASSERT_TRUE(parser.Parse("get key\r\n", consumed));
+    cmd = parser.Build(value_size);
+    ASSERT_EQ(first, cmd.get());
+    Execute::Get &get = dynamic_cast<Execute::Get &>(*cmd);
+    ASSERT_EQ(1, get.keys().size());
+    EXPECT_EQ("key", get.keys()[0]);
+    EXPECT_EQ(KeyHash("key"), get.hashes()[0]);
+    parser.Recycle(std::move(cmd));
+    parser.Reset();
+
+    // Kinds are not mixed up
+    ASSERT_TRUE(parser.Parse("gets key\r\n", consumed));
+    cmd = parser.Build(value_size);
+    EXPECT_NE(first, cmd.get());
+    ASSERT_FALSE(dynamic_cast<Execute::Gets *>(cmd.get()) == nullptr);
+    parser.Reset();
+
+    ASSERT_TRUE(parser.Parse("set some_key 5 0 3 noreply\r\n", consumed));
+    cmd = parser.Build(value_size);
+    Execute::Command *set = cmd.get();
+    EXPECT_TRUE(cmd->NoReply());
+    parser.Recycle(std::move(cmd));
+    parser.Reset();
+
+    ASSERT_TRUE(parser.Parse("set key 7 0 3\r\n", consumed));
+    cmd = parser.Build(value_size);
+    ASSERT_EQ(set, cmd.get());
+    EXPECT_FALSE(cmd->NoReply());
+    Execute::Set &again = dynamic_cast<Execute::Set &>(*cmd);
+    EXPECT_EQ("key", again.key());
+    EXPECT_EQ(7, again.flags());
+    EXPECT_EQ(KeyHash("key"), again.hash());
 }
@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <afina/ChunkedValue.h>
+#include <afina/Hash.h>
+#include <afina/execute/Command.h>
+
+#include <protocol/Codec.h>
+#include <protocol/RespCommand.h>
+#include <protocol/RespParser.h>
+#include <storage/StripedLRU.h>
+
+using namespace Afina;
+using namespace Afina::Protocol;
+
+namespace {
+
+std::string Request(const std::vector<std::string> &args) {
+    std::string out = "*" + std::to_string(args.size()) + "\r\n";
+    for (auto &arg : args) {
+        out += "$" + std::to_string(arg.size()) + "\r\n" + arg + "\r\n";
+    }
+    return out;
+}
+
+// Runs the stream of requests the way network layer does and collects all the responses
+std::string Serve(Storage &storage, const std::string &stream) {
+    RespParser parser;
+    std::string out;
+    std::size_t pos = 0;
+    while (pos < stream.size()) {
+        std::size_t parsed = 0;
+        EXPECT_TRUE(parser.Parse(stream.data() + pos, stream.size() - pos, parsed));
+        pos += parsed;
+
+        std::size_t body = 1;
+        std::unique_ptr<Execute::Command> cmd = parser.Build(body);
+        EXPECT_EQ(0, body);
+
+        std::string response;
+        cmd->Execute(storage, "", response);
+        out += response;
+        parser.Reset();
+    }
+    return out;
+}
+
+} // namespace
+
+// Request split at every position is parsed the same
+TEST(RespParserTest, SplitRequest) {
+    std::string request = Request({"SET", "some_key", "some\r\nvalue", "EX", "10"});
+    for (std::size_t cut = 1; cut < request.size(); cut++) {
+        RespParser parser;
+        std::size_t parsed = 0;
+        ASSERT_FALSE(parser.Parse(request.data(), cut, parsed)) << cut;
+        ASSERT_EQ(cut, parsed);
+        std::string tail = request.substr(cut);
+        ASSERT_TRUE(parser.Parse(tail.data(), tail.size(), parsed)) << cut;
+        ASSERT_EQ(tail.size(), parsed);
+        ASSERT_EQ("set", parser.Name());
+
+        std::size_t body = 0;
+        std::unique_ptr<Execute::Command> cmd = parser.Build(body);
+        RespCommand *resp = dynamic_cast<RespCommand *>(cmd.get());
+        ASSERT_FALSE(resp == nullptr);
+        ASSERT_EQ(5, resp->args().size());
+        ASSERT_EQ("some\r\nvalue", resp->args()[2]);
+    }
+
+    std::unique_ptr<Codec> codec = Codec::Detect('*');
+    ASSERT_FALSE(dynamic_cast<RespParser *>(codec.get()) == nullptr);
+
+    for (std::string bad : {"*0\r\n", "*1\r\n$3\r\nGETX\r\n", "*1\r\n$-1\r\n", "*x\r\n", "*1\n", "get foo\r\n",
+                            "*1\r\n$99999999999999999999\r\n"}) {
+        RespParser parser;
+        std::size_t parsed = 0;
+        ASSERT_THROW(parser.Parse(bad.data(), bad.size(), parsed), std::runtime_error) << bad;
+    }
+}
+
+TEST(RespParserTest, Commands) {
+    std::unique_ptr<Backend::StripedLRU> storage(Backend::buildStripeStorage(4, 4 * 2 * 1024 * 1024));
+    EXPECT_EQ("+PONG\r\n", Serve(*storage, Request({"PING"})));
+    EXPECT_EQ("$-1\r\n", Serve(*storage, Request({"get", "a"})));
+    EXPECT_EQ("+OK\r\n$1\r\n1\r\n", Serve(*storage, Request({"set", "a", "1"}) + Request({"GET", "a"})));
+
+    EXPECT_EQ("$-1\r\n+OK\r\n$-1\r\n+OK\r\n",
+              Serve(*storage, Request({"set", "a", "2", "nx"}) + Request({"set", "a", "2", "XX", "KEEPTTL"}) +
+                                  Request({"set", "b", "2", "xx"}) + Request({"set", "b", "3", "NX"})));
+    EXPECT_EQ("-ERR syntax error\r\n", Serve(*storage, Request({"set", "a", "2", "nx", "xx"})));
+    EXPECT_EQ("-ERR invalid expire time in 'set' command\r\n", Serve(*storage, Request({"set", "a", "2", "ex", "0"})));
+
+    // TTL is kept by KEEPTTL and INCR, dropped by plain SET
+    auto deadline = [&storage](const std::string &key) {
+        std::string value;
+        std::shared_ptr<const ChunkedValue> chunks;
+        uint64_t version;
+        Storage::Attributes attributes;
+        EXPECT_TRUE(storage->Get(key, KeyHash(key), value, chunks, version, attributes));
+        return attributes.deadline;
+    };
+    uint64_t now = Storage::Now();
+    EXPECT_EQ("+OK\r\n+OK\r\n:4\r\n$1\r\n4\r\n",
+              Serve(*storage, Request({"set", "a", "3", "EX", "10"}) + Request({"set", "a", "3", "KEEPTTL"}) +
+                                  Request({"incr", "a"}) + Request({"get", "a"})));
+    EXPECT_LE(now + 10 * 1000, deadline("a"));
+    EXPECT_GE(Storage::Now() + 10 * 1000, deadline("a"));
+    EXPECT_EQ("+OK\r\n", Serve(*storage, Request({"set", "a", "2"})));
+    EXPECT_EQ(0, deadline("a"));
+
+    // Expired item is gone
+    EXPECT_EQ("+OK\r\n", Serve(*storage, Request({"set", "e", "1", "nx", "px", "1"})));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    EXPECT_EQ("$-1\r\n+OK\r\n", Serve(*storage, Request({"get", "e"}) + Request({"set", "e", "1", "nx"})));
+
+    EXPECT_EQ("+OK\r\n*4\r\n$1\r\nx\r\n$-1\r\n$1\r\nz\r\n$1\r\n3\r\n",
+              Serve(*storage, Request({"mset", "x", "x", "z", "z"}) + Request({"mget", "x", "y", "z", "b"})));
+    EXPECT_EQ(":2\r\n:0\r\n", Serve(*storage, Request({"del", "x", "y", "z"}) + Request({"del", "x"})));
+
+    EXPECT_EQ(":3\r\n:1\r\n+OK\r\n:-9\r\n",
+              Serve(*storage, Request({"incr", "a"}) + Request({"incr", "n"}) + Request({"set", "m", "-10"}) +
+                                  Request({"incr", "m"})));
+    EXPECT_EQ("-ERR value is not an integer or out of range\r\n",
+              Serve(*storage, Request({"set", "s", "1x"}) + Request({"incr", "s"})).substr(5));
+    EXPECT_EQ("-ERR increment or decrement would overflow\r\n",
+              Serve(*storage, Request({"set", "s", "9223372036854775807"}) + Request({"incr", "s"})).substr(5));
+
+    EXPECT_EQ(":2\r\n:4\r\n", Serve(*storage, Request({"append", "c", "ab"}) + Request({"append", "c", "cd"})));
+    EXPECT_EQ("$4\r\nabcd\r\n", Serve(*storage, Request({"get", "c"})));
+
+    EXPECT_EQ("-ERR wrong number of arguments for 'mset' command\r\n",
+              Serve(*storage, Request({"mset", "a", "1", "b"})));
+    EXPECT_EQ("-ERR unknown command 'FOO'\r\n", Serve(*storage, Request({"FOO", "bar"})));
+}
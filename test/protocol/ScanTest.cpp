@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <afina/execute/Get.h>
+#include <afina/execute/LeaseSet.h>
+#include <afina/execute/Set.h>
+
+#include <protocol/Parser.h>
+#include <protocol/Scan.h>
+
+using namespace Afina;
+using namespace Afina::Protocol;
+
+namespace {
+
+// All implementations CPU could run
+std::vector<ScanLevel> Levels() {
+    std::vector<ScanLevel> levels = {ScanLevel::Scalar};
+    if (ScanSupported() >= ScanLevel::Sse2) {
+        levels.push_back(ScanLevel::Sse2);
+    }
+    if (ScanSupported() >= ScanLevel::Avx2) {
+        levels.push_back(ScanLevel::Avx2);
+    }
+    return levels;
+}
+
+// Restores best implementation once test is over
+struct ForceScan {
+    explicit ForceScan(ScanLevel level) { ScanForce(level); }
+    ~ForceScan() { ScanForce(ScanSupported()); }
+};
+
+} // namespace
+
+TEST(ScanTest, FindDelimiter) {
+    std::mt19937 rnd(7);
+    for (auto level : Levels()) {
+        ForceScan force(level);
+        ASSERT_EQ(level, ScanActive());
+
+        for (int round = 0; round < 2000; round++) {
+            // Sparse delimiters at random positions, including the very last byte and none at all
+            std::string data(rnd() % 100, 'x');
+            for (std::size_t i = 0; i < data.size(); i++) {
+                if (rnd() % 40 == 0) {
+                    data[i] = rnd() % 2 ? ' ' : '\r';
+                }
+            }
+
+            std::size_t pos = data.empty() ? 0 : rnd() % data.size();
+            std::size_t expected = data.find_first_of(" \r", pos);
+            if (expected == std::string::npos) {
+                expected = data.size();
+            }
+            ASSERT_EQ(expected, FindDelimiter(data.data(), pos, data.size(), ' ', '\r'))
+                << ScanName(level) << " '" << data << "' from " << pos;
+        }
+    }
+}
+
+TEST(ScanTest, ParseDecimal) {
+    uint64_t value = 0;
+    EXPECT_TRUE(ParseDecimal("0", 1, UINT64_MAX, value));
+    EXPECT_EQ(0, value);
+    EXPECT_TRUE(ParseDecimal("4294967295", 10, UINT32_MAX, value));
+    EXPECT_EQ(4294967295ull, value);
+    EXPECT_TRUE(ParseDecimal("18446744073709551615", 20, UINT64_MAX, value));
+    EXPECT_EQ(18446744073709551615ull, value);
+    EXPECT_TRUE(ParseDecimal("00018446744073709551615", 23, UINT64_MAX, value));
+    EXPECT_EQ(18446744073709551615ull, value);
+
+    EXPECT_FALSE(ParseDecimal("", 0, UINT64_MAX, value));
+    EXPECT_FALSE(ParseDecimal("4294967296", 10, UINT32_MAX, value));
+    EXPECT_FALSE(ParseDecimal("18446744073709551616", 20, UINT64_MAX, value));
+    EXPECT_FALSE(ParseDecimal("99999999999999999999", 20, UINT64_MAX, value));
+    EXPECT_FALSE(ParseDecimal("100000000000000000000", 21, UINT64_MAX, value));
+    EXPECT_FALSE(ParseDecimal("12a", 3, UINT64_MAX, value));
+    EXPECT_FALSE(ParseDecimal("-1", 2, UINT64_MAX, value));
+    EXPECT_FALSE(ParseDecimal("1/", 2, UINT64_MAX, value));
+}
+
+// Fast path of numeric fields agrees with byte by byte parsing, which is used when line is split
+TEST(ScanTest, NumericFields) {
+    for (auto level : Levels()) {
+        ForceScan force(level);
+
+        std::string line = "lset some_key 4294967295 -2147483648 1048576 18446744073709551615\r\n";
+        for (std::size_t cut = 1; cut <= line.size(); cut++) {
+            Parser parser;
+            size_t consumed = 0;
+            std::string head = line.substr(0, cut), tail = line.substr(cut);
+            if (!parser.Parse(head, consumed)) {
+                ASSERT_TRUE(parser.Parse(tail, consumed)) << cut;
+            }
+
+            size_t value_size;
+            std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+            Execute::LeaseSet *set = reinterpret_cast<Execute::LeaseSet *>(cmd.get());
+            ASSERT_EQ("some_key", set->key());
+            ASSERT_EQ(4294967295u, set->flags()) << cut;
+            ASSERT_EQ(INT32_MIN, set->expire()) << cut;
+            ASSERT_EQ(1048576, value_size) << cut;
+            ASSERT_EQ(18446744073709551615ull, set->token()) << cut;
+        }
+
+        // Malformed fields still fail the way they did before
+        Parser parser;
+        size_t consumed = 0;
+        ASSERT_THROW(parser.Parse("set foo 0 2147483648 6\r\n", consumed), std::runtime_error);
+        parser.Reset();
+        ASSERT_THROW(parser.Parse("set foo 4294967296 0 6\r\n", consumed), std::runtime_error);
+    }
+}
+
+// Same stream gives the same commands whatever implementation parses it
+TEST(ScanTest, MixedStream) {
+    std::string stream;
+    std::vector<std::string> keys;
+    for (int i = 0; i < 200; i++) {
+        std::string key = "key:" + std::to_string(i * 7919) + std::string(i % 50, 'k');
+        keys.push_back(key);
+        if (i % 3 == 0) {
+            stream += "set " + key + " " + std::to_string(i) + " 0 5\r\nvalue\r\n";
+        } else {
+            stream += "get " + key + " " + keys[i / 2] + "\r\n";
+        }
+    }
+
+    for (auto level : Levels()) {
+        ForceScan force(level);
+
+        Parser parser;
+        std::size_t pos = 0;
+        for (int i = 0; i < 200; i++) {
+            size_t consumed = 0;
+            ASSERT_TRUE(parser.Parse(stream.data() + pos, stream.size() - pos, consumed)) << ScanName(level) << i;
+            pos += consumed;
+
+            size_t value_size;
+            std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+            if (i % 3 == 0) {
+                Execute::Set *set = reinterpret_cast<Execute::Set *>(cmd.get());
+                ASSERT_EQ(keys[i], set->key());
+                ASSERT_EQ(i, set->flags());
+                ASSERT_EQ(5, value_size);
+                pos += value_size + 2;
+            } else {
+                Execute::Get *get = reinterpret_cast<Execute::Get *>(cmd.get());
+                ASSERT_EQ(2, get->keys().size());
+                ASSERT_EQ(keys[i], get->keys()[0]);
+                ASSERT_EQ(keys[i / 2], get->keys()[1]);
+            }
+            parser.Reset();
+        }
+        ASSERT_EQ(stream.size(), pos);
+    }
+}
@@ -1,17 +1,36 @@
 #include "gtest/gtest.h"
+#include <cstring>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <random>
 #include <set>
+#include <thread>
 #include <vector>
 
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <afina/ChangeStream.h>
+#include <afina/ChunkedValue.h>
+#include <afina/Hash.h>
 #include <afina/execute/Add.h>
 #include <afina/execute/Append.h>
 #include <afina/execute/Delete.h>
 #include <afina/execute/Get.h>
 #include <afina/execute/Set.h>
 
+#include "storage/DumpLoader.h"
+#include "storage/HashIndex.h"
+#include "storage/LeasedStorage.h"
+#include "storage/NamespacedStorage.h"
 #include "storage/SimpleLRU.h"
+#include "storage/SizeClassLRU.h"
+#include "storage/StripedLRU.h"
+#include "storage/ThreadSafeSimpleLRU.h"
 
+using namespace Afina;
 using namespace Afina::Backend;
 using namespace Afina::Execute;
 using namespace std;
@@ -195,3 +214,1082 @@ TEST(StorageTest, MaxTest) {
         EXPECT_FALSE(storage.Get(key, res));
     }
 }
+
+TEST(StorageTest, LockCounters) {
+    ThreadSafeSimplLRU storage;
+
+    EXPECT_TRUE(storage.Put("KEY1", "val1"));
+    EXPECT_TRUE(storage.Put("KEY2", "val2"));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_FALSE(storage.Get("KEY3", value));
+
+    auto counters = storage.LockCounters();
+    EXPECT_EQ(4, counters.acquisitions);
+    EXPECT_EQ(0, counters.contended);
+    EXPECT_EQ(0, counters.wait_ns);
+}
+
+TEST(StorageTest, StripedStats) {
+    std::unique_ptr<StripedLRU> storage(buildStripeStorage(4, 4 * 2 * 1024 * 1024));
+
+    for (long i = 0; i < 100; ++i) {
+        EXPECT_TRUE(storage->Put("Key " + std::to_string(i), "Val " + std::to_string(i)));
+    }
+
+    std::vector<std::pair<std::string, std::string>> stats;
+    storage->Stats(stats);
+
+    std::map<std::string, std::string> by_name(stats.begin(), stats.end());
+    EXPECT_EQ("4", by_name["stripe_count"]);
+    EXPECT_EQ("100", by_name["lock_acquisitions"]);
+    EXPECT_EQ("0", by_name["lock_contended"]);
+
+    long shards_total = 0;
+    for (int i = 0; i < 4; ++i) {
+        shards_total += std::stol(by_name["shard_" + std::to_string(i) + "_lock_acquisitions"]);
+    }
+    EXPECT_EQ(100, shards_total);
+
+    // Not enough data to make any advice
+    EXPECT_EQ(4, storage->RecommendedStripeCount());
+}
+
+TEST(StorageTest, KeyHash) {
+    EXPECT_EQ(KeyHash("KEY1"), KeyHash(std::string("KEY1")));
+    EXPECT_NE(KeyHash("KEY1"), KeyHash("KEY2"));
+    EXPECT_NE(KeyHash(""), KeyHash(std::string(1, '\0')));
+
+    // Keys of all lengths must hash whole content
+    std::string key(100, 'k');
+    std::set<uint64_t> hashes;
+    for (std::size_t len = 0; len <= key.size(); len++) {
+        hashes.insert(KeyHash(key.data(), len));
+    }
+    EXPECT_EQ(key.size() + 1, hashes.size());
+
+    for (std::size_t n : {1, 3, 4, 7}) {
+        std::vector<int> hits(n, 0);
+        for (long i = 0; i < 10000; ++i) {
+            auto idx = HashRange(KeyHash("Key " + std::to_string(i)), n);
+            ASSERT_LT(idx, n);
+            hits[idx]++;
+        }
+        for (auto h : hits) {
+            EXPECT_GT(h, 10000 / n / 2);
+        }
+    }
+}
+
+TEST(StorageTest, StripedHashed) {
+    std::unique_ptr<StripedLRU> storage(buildStripeStorage(4, 4 * 2 * 1024 * 1024));
+
+    EXPECT_TRUE(storage->Put("KEY1", KeyHash("KEY1"), "val1"));
+    EXPECT_FALSE(storage->PutIfAbsent("KEY1", "val2"));
+    EXPECT_TRUE(storage->Set("KEY1", KeyHash("KEY1"), "val3"));
+
+    std::string value;
+    EXPECT_TRUE(storage->Get("KEY1", value));
+    EXPECT_EQ("val3", value);
+    EXPECT_TRUE(storage->Delete("KEY1", KeyHash("KEY1")));
+    EXPECT_FALSE(storage->Get("KEY1", KeyHash("KEY1"), value));
+}
+
+TEST(StorageTest, EvictLastItem) {
+    SimpleLRU storage(10);
+
+    EXPECT_TRUE(storage.Put("a", "123456789"));
+    EXPECT_TRUE(storage.Put("b", "123456789"));
+    EXPECT_TRUE(storage.Put("b", "12345678"));
+
+    std::string value;
+    EXPECT_FALSE(storage.Get("a", value));
+    EXPECT_TRUE(storage.Get("b", value));
+    EXPECT_EQ("12345678", value);
+}
+
+TEST(StorageTest, EvictLeastRecentlyUsed) {
+    SimpleLRU storage(30);
+
+    EXPECT_TRUE(storage.Put("a", "123456789"));
+    EXPECT_TRUE(storage.Put("b", "123456789"));
+    EXPECT_TRUE(storage.Put("c", "123456789"));
+
+    // Hit on the oldest item and update of the next one save them both
+    std::string value;
+    EXPECT_TRUE(storage.Get("a", value));
+    EXPECT_TRUE(storage.Put("b", "12345678"));
+    EXPECT_TRUE(storage.Put("d", "123456789"));
+
+    EXPECT_FALSE(storage.Get("c", value));
+    EXPECT_TRUE(storage.Get("a", value));
+    EXPECT_TRUE(storage.Get("b", value));
+    EXPECT_TRUE(storage.Get("d", value));
+}
+
+TEST(StorageTest, FootprintAccounting) {
+    const size_t length = 20;
+    SimpleLRU payload(2 * 1000 * length);
+    SimpleLRU footprint(2 * 1000 * length, SimpleLRU::Accounting::Footprint);
+
+    for (long i = 0; i < 1000; ++i) {
+        auto key = pad_space("Key " + std::to_string(i), length);
+        auto val = pad_space("Val " + std::to_string(i), length);
+        EXPECT_TRUE(payload.Put(key, val));
+        EXPECT_TRUE(footprint.Put(key, val));
+    }
+
+    // Payload accounting fits everything, while real memory usage is much higher
+    auto usage = payload.MemoryUsage();
+    EXPECT_EQ(1000, usage.items);
+    EXPECT_EQ(2 * 1000 * length, usage.payload);
+    EXPECT_GT(usage.footprint, 2 * usage.payload);
+
+    // Footprint accounting keeps real usage under the limit
+    usage = footprint.MemoryUsage();
+    EXPECT_LT(usage.items, 1000);
+    EXPECT_LE(usage.footprint, 2 * 1000 * length);
+    EXPECT_EQ(2 * usage.items * length, usage.payload);
+
+    // Accounting must be consistent after updates and deletes
+    std::string value;
+    EXPECT_TRUE(footprint.Put(pad_space("Key 999", length), std::string(100, 'v')));
+    for (long i = 0; i < 1000; ++i) {
+        footprint.Delete(pad_space("Key " + std::to_string(i), length));
+    }
+    usage = footprint.MemoryUsage();
+    EXPECT_EQ(0, usage.items);
+    EXPECT_EQ(0, usage.payload);
+    EXPECT_GT(usage.index, 0);
+    EXPECT_EQ(usage.index, usage.footprint);
+}
+
+TEST(StorageTest, RssAccounting) {
+    EXPECT_GT(RssMonitor::ReadRss(), 0);
+
+    // Any process is above 1 byte limit
+    auto monitor = std::make_shared<RssMonitor>(1);
+    SimpleLRU storage(1024 * 1024, SimpleLRU::Accounting::Rss, monitor);
+
+    for (long i = 0; i < 1000; ++i) {
+        EXPECT_TRUE(storage.Put("Key " + std::to_string(i), std::string(100, 'v')));
+    }
+    EXPECT_EQ(1000, storage.MemoryUsage().items);
+
+    // Storage reacts on the new sample by shrinking its limit
+    monitor->Sample();
+    EXPECT_GT(monitor->Rss(), 0);
+    EXPECT_TRUE(storage.Put("Key", "val"));
+
+    auto usage = storage.MemoryUsage();
+    EXPECT_EQ(1024 * 1024 / 64, usage.limit);
+    EXPECT_LE(usage.footprint, usage.limit);
+    EXPECT_LT(usage.items, 1000);
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("Key", value));
+}
+
+namespace {
+struct IndexNode {
+    IndexNode(uint64_t hash, int value) : hash(hash), hash_next(nullptr), value(value) {}
+    uint64_t hash;
+    IndexNode *hash_next;
+    int value;
+};
+} // namespace
+
+TEST(StorageTest, HashIndexIncrementalResize) {
+    const int count = 100000;
+    std::vector<std::unique_ptr<IndexNode>> nodes;
+    // Migrates one bucket per operation, so that resize spans many operations
+    HashIndex<IndexNode> index(4, 1);
+
+    bool seen_resize = false;
+    for (int i = 0; i < count; ++i) {
+        // Few hash collisions on purpose, nodes must be told apart by predicate
+        nodes.emplace_back(new IndexNode(KeyHash(std::to_string(i / 2)), i));
+        index.Insert(nodes.back().get());
+        seen_resize = seen_resize || index.Resizing();
+
+        // Everything inserted so far must be reachable in the middle of resize
+        if (i % 97 == 0) {
+            for (int j = 0; j <= i; j += 13) {
+                auto node = index.Find(nodes[j]->hash, [j](const IndexNode &n) { return n.value == j; });
+                ASSERT_EQ(nodes[j].get(), node);
+            }
+        }
+    }
+    EXPECT_TRUE(seen_resize);
+    EXPECT_EQ(count, index.Size());
+    EXPECT_GE(index.Memory(), count * sizeof(void *));
+
+    // Delete half of the nodes, starting from ones which are in the old table yet
+    index.Insert(new IndexNode(0, -1));
+    for (int i = 0; i < count; i += 2) {
+        index.Erase(nodes[i].get());
+    }
+    EXPECT_EQ(count / 2 + 1, index.Size());
+    for (int i = 0; i < count; ++i) {
+        auto node = index.Find(nodes[i]->hash, [i](const IndexNode &n) { return n.value == i; });
+        EXPECT_EQ(i % 2 == 0 ? nullptr : nodes[i].get(), node);
+    }
+
+    auto extra = index.Find(0, [](const IndexNode &n) { return n.value == -1; });
+    ASSERT_NE(nullptr, extra);
+    index.Erase(extra);
+    delete extra;
+}
+
+TEST(StorageTest, GrowAcrossResizes) {
+    SimpleLRU storage(1024 * 1024 * 1024);
+    std::set<long> deleted;
+    for (long i = 0; i < 200000; ++i) {
+        EXPECT_TRUE(storage.Put("Key " + std::to_string(i), std::to_string(i)));
+        if (i % 3 == 0) {
+            EXPECT_TRUE(storage.Delete("Key " + std::to_string(i / 2)));
+            deleted.insert(i / 2);
+        }
+    }
+
+    std::string value;
+    for (long i = 0; i < 200000; ++i) {
+        bool found = storage.Get("Key " + std::to_string(i), value);
+        EXPECT_EQ(deleted.count(i) == 0, found);
+        if (found) {
+            EXPECT_EQ(std::to_string(i), value);
+        }
+    }
+}
+
+TEST(StorageTest, LargeValue) {
+    const std::size_t size = 5 * 1024 * 1024 + 123;
+    std::string big(size, 'x');
+    for (std::size_t i = 0; i < size; i += 4096) {
+        big[i] = char('a' + (i / 4096) % 26);
+    }
+
+    SimpleLRU storage(64 * 1024 * 1024, SimpleLRU::Accounting::Footprint);
+    EXPECT_TRUE(storage.Put("big", big));
+    EXPECT_TRUE(storage.Put("small", "val"));
+
+    // Plain get copies value out
+    std::string value;
+    EXPECT_TRUE(storage.Get("big", value));
+    EXPECT_EQ(big, value);
+
+    // Chunked get passes chain as is
+    std::string untouched = "untouched";
+    std::shared_ptr<const ChunkedValue> chunks;
+    EXPECT_TRUE(storage.Get("big", KeyHash("big"), untouched, chunks));
+    ASSERT_NE(nullptr, chunks);
+    EXPECT_EQ("untouched", untouched);
+    EXPECT_EQ(size, chunks->size());
+    const std::size_t chunk_size = ChunkedValue::ChunkSize;
+    EXPECT_EQ((size + chunk_size - 1) / chunk_size, chunks->chunks());
+
+    std::string streamed;
+    chunks->ForEachChunk([&streamed, chunk_size](const char *data, std::size_t len) {
+        EXPECT_LE(len, chunk_size);
+        streamed.append(data, len);
+    });
+    EXPECT_EQ(big, streamed);
+
+    // Small values are copied
+    EXPECT_TRUE(storage.Get("small", KeyHash("small"), value, chunks));
+    EXPECT_EQ(nullptr, chunks);
+    EXPECT_EQ("val", value);
+
+    // Chain outlives the item
+    EXPECT_TRUE(storage.Get("big", KeyHash("big"), value, chunks));
+    EXPECT_TRUE(storage.Put("big", "now small"));
+    EXPECT_EQ(size, chunks->size());
+    EXPECT_TRUE(storage.Get("big", value));
+    EXPECT_EQ("now small", value);
+
+    auto usage = storage.MemoryUsage();
+    EXPECT_EQ(2, usage.items);
+    EXPECT_EQ(3 + 9 + 5 + 3, usage.payload);
+    EXPECT_LT(usage.footprint, 4096);
+}
+
+TEST(StorageTest, LargeValueEviction) {
+    const std::size_t size = 3 * 1024 * 1024;
+    ThreadSafeSimplLRU storage(8 * 1024 * 1024, SimpleLRU::Accounting::Footprint);
+
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_TRUE(storage.Put("Key " + std::to_string(i), std::string(size, char('0' + i))));
+        auto usage = storage.MemoryUsage();
+        EXPECT_LE(usage.footprint, usage.limit);
+    }
+
+    // Only two items of 3MB fit into 8MB
+    std::string value;
+    EXPECT_FALSE(storage.Get("Key 2", value));
+    EXPECT_TRUE(storage.Get("Key 3", value));
+    EXPECT_EQ(std::string(size, '3'), value);
+    EXPECT_TRUE(storage.Get("Key 4", value));
+
+    // Value larger than the whole storage is still rejected
+    EXPECT_FALSE(storage.Put("huge", std::string(9 * 1024 * 1024, 'h')));
+}
+
+// Value filled in place is adopted by storage as is
+TEST(StorageTest, ReservedValue) {
+    const std::size_t size = 3 * ChunkedValue::ChunkSize + 10;
+    auto reserved = std::make_shared<ChunkedValue>(size);
+    EXPECT_EQ(0, reserved->chunks());
+    std::string expected;
+    for (std::size_t i = 0; !reserved->Full(); i++) {
+        // Both in place and copied writes
+        std::string piece(i % 2 ? 1000 : 30000, char('a' + i % 26));
+        if (i % 3) {
+            std::size_t len = std::min(piece.size(), reserved->RoomSize());
+            std::memcpy(reserved->Room(), piece.data(), len);
+            reserved->Filled(len);
+            expected.append(piece, 0, len);
+        } else {
+            expected.append(piece, 0, reserved->Fill(piece.data(), piece.size()));
+        }
+    }
+    EXPECT_EQ(size, expected.size());
+    EXPECT_EQ(0, reserved->RoomSize());
+    EXPECT_EQ(4, reserved->chunks());
+
+    // Announced size costs nothing until data arrives
+    ChunkedValue announced(std::size_t(4) << 30);
+    EXPECT_EQ(0, announced.chunks());
+    EXPECT_EQ(std::size_t(ChunkedValue::ChunkSize), announced.RoomSize());
+    EXPECT_NE(nullptr, announced.Room());
+    EXPECT_EQ(1, announced.chunks());
+
+    std::shared_ptr<Storage> storages[] = {
+        std::make_shared<ThreadSafeSimplLRU>(8 * 1024 * 1024, SimpleLRU::Accounting::Footprint),
+        std::make_shared<SizeClassLRU>(8 * 1024 * 1024, SimpleLRU::Accounting::Footprint, nullptr,
+                                       std::vector<std::size_t>{100, 1024 * 1024}),
+        std::make_shared<NamespacedStorage>(8 * 1024 * 1024, std::vector<NamespacedStorage::Config>{}),
+        std::make_shared<LeasedStorage>(std::make_shared<ThreadSafeSimplLRU>(8 * 1024 * 1024))};
+    for (auto &storage : storages) {
+        EXPECT_TRUE(storage->Put("big", "small"));
+        EXPECT_TRUE(storage->PutChunked("big", KeyHash("big"), reserved));
+
+        std::string value;
+        std::shared_ptr<const ChunkedValue> chunks;
+        EXPECT_TRUE(storage->Get("big", KeyHash("big"), value, chunks));
+        EXPECT_EQ(reserved, chunks);
+        EXPECT_TRUE(storage->Get("big", value));
+        EXPECT_EQ(expected, value);
+    }
+
+    // Value larger than the whole storage is still rejected
+    SimpleLRU small(size / 2);
+    EXPECT_FALSE(small.PutChunked("big", KeyHash("big"), reserved));
+}
+
+TEST(StorageTest, SizeClassIsolation) {
+    SizeClassLRU storage(4 * 1024 * 1024, SimpleLRU::Accounting::Payload, nullptr, {100, 1024 * 1024});
+
+    for (long i = 0; i < 1000; ++i) {
+        EXPECT_TRUE(storage.Put("Key " + std::to_string(i), std::to_string(i)));
+    }
+
+    // Large items evict each other, but not small ones
+    for (long i = 0; i < 10; ++i) {
+        EXPECT_TRUE(storage.Put("Big " + std::to_string(i), std::string(512 * 1024, 'b')));
+    }
+    std::string value;
+    for (long i = 0; i < 1000; ++i) {
+        EXPECT_TRUE(storage.Get("Key " + std::to_string(i), value));
+        EXPECT_EQ(std::to_string(i), value);
+    }
+    EXPECT_FALSE(storage.Get("Big 0", value));
+    EXPECT_TRUE(storage.Get("Big 9", value));
+
+    // Item moves between classes as its size changes
+    EXPECT_TRUE(storage.Put("Key 0", std::string(1000, 'x')));
+    EXPECT_TRUE(storage.Get("Key 0", value));
+    EXPECT_EQ(1000, value.size());
+    EXPECT_TRUE(storage.Set("Key 0", "0"));
+    EXPECT_TRUE(storage.Get("Key 0", value));
+    EXPECT_EQ("0", value);
+    EXPECT_FALSE(storage.PutIfAbsent("Key 0", std::string(1000, 'x')));
+
+    auto usage = storage.ClassUsage();
+    ASSERT_EQ(2, usage.size());
+    EXPECT_EQ(1000, usage[0].items);
+    EXPECT_EQ(0, usage[0].evictions);
+
+    // Large pool grows at most until the small one is left with its minimal quarter share
+    EXPECT_EQ(4 * 1024 * 1024 - 512 * 1024, storage.MaxItemSize());
+
+    // Put which fails in the new class leaves the old value where it was
+    std::string huge(3 * 1024 * 1024, 'x');
+    EXPECT_FALSE(storage.Put("Key 0", huge));
+    EXPECT_FALSE(storage.PutChunked("Key 0", KeyHash("Key 0"), std::make_shared<ChunkedValue>(huge)));
+    EXPECT_FALSE(storage.Set("Key 0", huge));
+    EXPECT_TRUE(storage.Get("Key 0", value));
+    EXPECT_EQ("0", value);
+
+    EXPECT_TRUE(storage.Delete("Key 0"));
+    EXPECT_FALSE(storage.Get("Key 0", value));
+    EXPECT_FALSE(storage.Delete("Key 0"));
+}
+
+TEST(StorageTest, SizeClassRebalance) {
+    const std::size_t total = 1024 * 1024;
+    SizeClassLRU storage(total, SimpleLRU::Accounting::Payload, nullptr, {100, 64 * 1024});
+
+    // Hot small items don't fit into their initial share
+    std::string value;
+    std::mt19937 rnd(42);
+    for (int round = 0; round < 50; ++round) {
+        for (long i = 0; i < 20000; ++i) {
+            std::string key = "Key " + std::to_string(rnd() % 24000);
+            if (!storage.Get(key, value)) {
+                storage.Put(key, std::string(20, 's'));
+            }
+        }
+        // Large items are rarely read
+        storage.Put("Big " + std::to_string(round), std::string(32 * 1024, 'b'));
+        storage.Rebalance();
+    }
+
+    auto usage = storage.ClassUsage();
+    ASSERT_EQ(2, usage.size());
+    EXPECT_GT(usage[0].limit, total / 2);
+    EXPECT_GE(usage[1].limit, total / 8);
+    EXPECT_LE(usage[0].limit + usage[1].limit, total);
+    EXPECT_LE(usage[0].payload, usage[0].limit);
+    EXPECT_LE(usage[1].payload, usage[1].limit);
+
+    std::vector<std::pair<std::string, std::string>> stats;
+    storage.Stats(stats);
+    std::map<std::string, std::string> named(stats.begin(), stats.end());
+    EXPECT_NE("0", named["class_rebalances"]);
+    EXPECT_NE("0", named["storage_get_hits"]);
+}
+
+TEST(StorageTest, Leases) {
+    LeasedStorage storage(std::make_shared<ThreadSafeSimplLRU>(1024 * 1024));
+    uint64_t hash = KeyHash("key");
+    std::string value;
+    uint64_t token = 0, other = 0;
+
+    // The first miss gets the lease, others have to wait
+    EXPECT_EQ(Storage::Lease::Granted, storage.GetLease("key", hash, value, token));
+    EXPECT_NE(0, token);
+    EXPECT_EQ(Storage::Lease::HotMiss, storage.GetLease("key", hash, value, other));
+
+    // Only the lease holder could fill value in, and just once
+    EXPECT_FALSE(storage.PutLeased("key", hash, "wrong", token + 1));
+    EXPECT_TRUE(storage.PutLeased("key", hash, "val", token));
+    EXPECT_FALSE(storage.PutLeased("key", hash, "again", token));
+    EXPECT_EQ(Storage::Lease::Hit, storage.GetLease("key", hash, value, other));
+    EXPECT_EQ("val", value);
+
+    // Deleted value is served as stale while somebody recomputes it
+    EXPECT_TRUE(storage.Delete("key"));
+    EXPECT_EQ(Storage::Lease::Granted, storage.GetLease("key", hash, value, token));
+    EXPECT_EQ(Storage::Lease::Stale, storage.GetLease("key", hash, value, other));
+    EXPECT_EQ("val", value);
+
+    // Write in between invalidates lease
+    EXPECT_TRUE(storage.Put("key", "newer"));
+    EXPECT_FALSE(storage.PutLeased("key", hash, "older", token));
+    EXPECT_TRUE(storage.Get("key", value));
+    EXPECT_EQ("newer", value);
+    EXPECT_EQ(0, storage.PendingLeases());
+}
+
+// Stale values share chunks of large items, their total size is capped
+TEST(StorageTest, LeaseStaleLimit) {
+    std::size_t large = 3 * ChunkedValue::ChunkSize;
+    LeasedStorage storage(std::make_shared<ThreadSafeSimplLRU>(1024 * 1024), std::chrono::milliseconds(10000),
+                          large + 8);
+    auto stats = [&storage]() {
+        std::vector<std::pair<std::string, std::string>> records;
+        storage.Stats(records);
+        return std::map<std::string, std::string>(records.begin(), records.end());
+    };
+    std::string value;
+    uint64_t token = 0, other = 0;
+
+    std::string data(large, 'x');
+    auto chunks = std::make_shared<ChunkedValue>(data);
+    ASSERT_TRUE(storage.PutChunked("large", KeyHash("large"), chunks));
+    EXPECT_TRUE(storage.Delete("large"));
+    EXPECT_EQ(std::to_string(large), stats()["lease_stale_bytes"]);
+    EXPECT_EQ(2, chunks.use_count());
+
+    EXPECT_EQ(Storage::Lease::Granted, storage.GetLease("large", KeyHash("large"), value, token));
+    EXPECT_EQ(Storage::Lease::Stale, storage.GetLease("large", KeyHash("large"), value, other));
+    EXPECT_EQ(data, value);
+
+    // The second value doesn't fit, delete keeps nothing
+    EXPECT_TRUE(storage.Put("small", "123456789"));
+    EXPECT_TRUE(storage.Delete("small"));
+    EXPECT_EQ("1", stats()["lease_stale_skipped"]);
+    EXPECT_EQ(Storage::Lease::Granted, storage.GetLease("small", KeyHash("small"), value, token));
+    EXPECT_EQ(Storage::Lease::HotMiss, storage.GetLease("small", KeyHash("small"), value, other));
+
+    // Write releases the stale value
+    EXPECT_TRUE(storage.Put("large", "fresh"));
+    EXPECT_EQ("0", stats()["lease_stale_bytes"]);
+    EXPECT_EQ(1, chunks.use_count());
+}
+
+// Namespaces of the wrapped storage keep leases, in the shared table
+TEST(StorageTest, LeaseNamespaces) {
+    LeasedStorage storage(
+        std::make_shared<NamespacedStorage>(1024 * 1024, std::vector<NamespacedStorage::Config>{
+                                                             NamespacedStorage::Config("b", 64 * 1024, false)}));
+    EXPECT_TRUE(storage.Namespace("missing") == nullptr);
+    auto b = storage.Namespace("b");
+    ASSERT_TRUE(b != nullptr);
+
+    uint64_t hash = KeyHash("key");
+    std::string value;
+    uint64_t token = 0, other = 0;
+    EXPECT_EQ(Storage::Lease::Granted, b->GetLease("key", hash, value, token));
+    EXPECT_EQ(Storage::Lease::HotMiss, b->GetLease("key", hash, value, other));
+
+    // The same key outside of the namespace is another item
+    EXPECT_EQ(Storage::Lease::Granted, storage.GetLease("key", hash, value, other));
+    EXPECT_NE(token, other);
+    EXPECT_TRUE(b->PutLeased("key", hash, "val", token));
+    EXPECT_TRUE(b->Get("key", value));
+    EXPECT_EQ("val", value);
+    EXPECT_FALSE(storage.Get("key", value));
+
+    // Writes through the namespace invalidate its leases
+    EXPECT_TRUE(b->Delete("key", hash));
+    EXPECT_EQ(Storage::Lease::Granted, b->GetLease("key", hash, value, token));
+    EXPECT_EQ(Storage::Lease::Stale, b->GetLease("key", hash, value, other));
+    EXPECT_EQ("val", value);
+    EXPECT_TRUE(b->Put("key", hash, "newer"));
+    EXPECT_FALSE(b->PutLeased("key", hash, "older", token));
+
+    std::vector<std::pair<std::string, std::string>> stats;
+    storage.Stats(stats);
+    std::map<std::string, std::string> by_name(stats.begin(), stats.end());
+    EXPECT_EQ("3", by_name["lease_granted"]);
+}
+
+TEST(StorageTest, LeaseExpiration) {
+    LeasedStorage storage(std::make_shared<ThreadSafeSimplLRU>(1024 * 1024), std::chrono::milliseconds(20));
+    uint64_t hash = KeyHash("key");
+    std::string value;
+    uint64_t token = 0, other = 0;
+
+    EXPECT_EQ(Storage::Lease::Granted, storage.GetLease("key", hash, value, token));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    // Lease holder died, next client takes over
+    EXPECT_EQ(Storage::Lease::Granted, storage.GetLease("key", hash, value, other));
+    EXPECT_NE(token, other);
+    EXPECT_FALSE(storage.PutLeased("key", hash, "val", token));
+    EXPECT_TRUE(storage.PutLeased("key", hash, "val", other));
+}
+
+// Runs hook once, right after the first miss
+class RacingStorage : public ThreadSafeSimplLRU {
+public:
+    RacingStorage() : ThreadSafeSimplLRU(1024 * 1024) {}
+
+    using ThreadSafeSimplLRU::Get;
+    bool Get(const std::string &key, uint64_t hash, std::string &value) override {
+        bool found = ThreadSafeSimplLRU::Get(key, hash, value);
+        if (!found && hook) {
+            std::function<void()> run = std::move(hook);
+            hook = nullptr;
+            run();
+        }
+        return found;
+    }
+
+    std::function<void()> hook;
+};
+
+TEST(StorageTest, LeaseRacesPut) {
+    auto racing = std::make_shared<RacingStorage>();
+    LeasedStorage storage(racing);
+    uint64_t hash = KeyHash("key");
+    std::string value;
+    uint64_t token = 0;
+
+    // Writer stores the key between the miss and the lease table lookup
+    racing->hook = [&storage, hash]() { EXPECT_TRUE(storage.Put("key", hash, "fresh")); };
+    EXPECT_EQ(Storage::Lease::Hit, storage.GetLease("key", hash, value, token));
+    EXPECT_EQ("fresh", value);
+    EXPECT_FALSE(storage.PutLeased("key", hash, "stale", token));
+    EXPECT_TRUE(storage.Get("key", hash, value));
+    EXPECT_EQ("fresh", value);
+}
+
+TEST(StorageTest, GdsfPrefersSmallAndFrequent) {
+    SimpleLRU storage(64 * 1024, SimpleLRU::Accounting::Payload, nullptr, SimpleLRU::Policy::Gdsf);
+
+    // Small items read often, a big one read rarely
+    for (long i = 0; i < 100; ++i) {
+        EXPECT_TRUE(storage.Put("Key " + std::to_string(i), std::string(100, 's')));
+    }
+    EXPECT_TRUE(storage.Put("Big", std::string(40 * 1024, 'b')));
+
+    std::string value;
+    for (int round = 0; round < 3; ++round) {
+        for (long i = 0; i < 100; ++i) {
+            EXPECT_TRUE(storage.Get("Key " + std::to_string(i), value));
+        }
+    }
+
+    // Big item goes first, even though it is not the oldest
+    EXPECT_TRUE(storage.Put("Another", std::string(20 * 1024, 'a')));
+    EXPECT_FALSE(storage.Get("Big", value));
+    for (long i = 0; i < 100; ++i) {
+        EXPECT_TRUE(storage.Get("Key " + std::to_string(i), value));
+    }
+    EXPECT_TRUE(storage.Get("Another", value));
+}
+
+TEST(StorageTest, GdsfConsistency) {
+    std::mt19937 rnd(7);
+    SimpleLRU storage(256 * 1024, SimpleLRU::Accounting::Footprint, nullptr, SimpleLRU::Policy::Gdsf);
+
+    // Random mix of operations must keep storage within limits and items reachable
+    std::string value;
+    for (int i = 0; i < 100000; ++i) {
+        std::string key = "Key " + std::to_string(rnd() % 5000);
+        switch (rnd() % 4) {
+        case 0:
+            storage.Delete(key);
+            break;
+        case 1:
+            storage.Get(key, value);
+            break;
+        default:
+            EXPECT_TRUE(storage.Put(key, std::string(rnd() % 2000, 'v')));
+            EXPECT_TRUE(storage.Get(key, value));
+        }
+        auto usage = storage.MemoryUsage();
+        ASSERT_LE(usage.footprint, usage.limit);
+    }
+    EXPECT_GT(storage.MemoryUsage().evictions, 0);
+
+    for (int i = 0; i < 5000; ++i) {
+        storage.Delete("Key " + std::to_string(i));
+    }
+    EXPECT_EQ(0, storage.MemoryUsage().items);
+}
+
+TEST(StorageTest, NamespaceIsolation) {
+    auto config = NamespacedStorage::ParseConfig("a=4096:hard,b=8192");
+    ASSERT_EQ(2, config.size());
+    EXPECT_EQ("a", config[0].name);
+    EXPECT_EQ(4096, config[0].quota);
+    EXPECT_TRUE(config[0].hard);
+    EXPECT_FALSE(config[1].hard);
+    EXPECT_THROW(NamespacedStorage::ParseConfig("a=1x"), std::runtime_error);
+    EXPECT_THROW(NamespacedStorage(1024, config), std::runtime_error);
+
+    NamespacedStorage storage(16384, config);
+    for (long i = 0; i < 100; ++i) {
+        EXPECT_TRUE(storage.Put("b:key" + std::to_string(i), std::string(50, 'b')));
+    }
+
+    // Hard namespace filling up evicts its own items only
+    for (long i = 0; i < 1000; ++i) {
+        EXPECT_TRUE(storage.Put("a:key" + std::to_string(i), std::string(50, 'a')));
+    }
+    std::string value;
+    for (long i = 0; i < 100; ++i) {
+        EXPECT_TRUE(storage.Get("b:key" + std::to_string(i), value));
+    }
+    EXPECT_FALSE(storage.Get("a:key0", value));
+    EXPECT_TRUE(storage.Get("a:key999", value));
+    EXPECT_LE(storage.NamespaceUsage("a").payload, 4096);
+    EXPECT_EQ(100, storage.NamespaceUsage("b").items);
+
+    // Keys without known prefix go to the default one
+    EXPECT_TRUE(storage.Put("c:key", "c"));
+    EXPECT_TRUE(storage.Put("key", "d"));
+    EXPECT_EQ(2, storage.NamespaceUsage("default").items);
+
+    // Connection bound view takes keys as is
+    auto b = storage.Namespace("b");
+    ASSERT_TRUE(b != nullptr);
+    EXPECT_FALSE(b->Get("key0", value));
+    EXPECT_TRUE(b->Get("b:key0", value));
+    EXPECT_TRUE(b->Put("a:key999", "b"));
+    EXPECT_TRUE(storage.Get("a:key999", value));
+    EXPECT_EQ(std::string(50, 'a'), value);
+    EXPECT_TRUE(storage.Namespace("missing") == nullptr);
+
+    std::vector<std::pair<std::string, std::string>> stats;
+    storage.Stats(stats);
+    std::map<std::string, std::string> by_name(stats.begin(), stats.end());
+    EXPECT_EQ("3", by_name["namespaces"]);
+    EXPECT_EQ("1", by_name["ns_a_hard"]);
+    EXPECT_EQ("101", by_name["ns_b_get_hits"]);
+    EXPECT_EQ("1", by_name["ns_b_get_misses"]);
+    EXPECT_NE("0", by_name["ns_a_evictions"]);
+    EXPECT_EQ("0", by_name["ns_b_evictions"]);
+}
+
+TEST(StorageTest, NamespaceSoftQuota) {
+    NamespacedStorage storage(16384, {NamespacedStorage::Config("a", 8192, false)});
+    std::string value;
+
+    // Nobody else uses memory, so soft namespace borrows it
+    for (long i = 0; i < 200; ++i) {
+        EXPECT_TRUE(storage.Put("a:key" + std::to_string(i), std::string(50, 'a')));
+    }
+    storage.Rebalance();
+    for (long i = 0; i < 200; ++i) {
+        EXPECT_TRUE(storage.Put("a:key" + std::to_string(i), std::string(50, 'a')));
+    }
+    EXPECT_GT(storage.NamespaceUsage("a").payload, 8192);
+
+    // Only memory nobody uses is lent
+    EXPECT_LE(storage.NamespaceUsage("a").limit + storage.NamespaceUsage("default").limit, 16384);
+
+    // Owner of the borrowed memory gets it back as soon as it needs it, without waiting for rebalance
+    for (long i = 0; i < 200; ++i) {
+        EXPECT_TRUE(storage.Put("key" + std::to_string(i), std::string(50, 'd')));
+        EXPECT_LE(storage.NamespaceUsage("a").limit + storage.NamespaceUsage("default").limit, 16384);
+    }
+    EXPECT_LE(storage.NamespaceUsage("a").payload, 8192);
+    EXPECT_LE(storage.NamespaceUsage("a").payload + storage.NamespaceUsage("default").payload, 16384);
+    EXPECT_GE(storage.NamespaceUsage("default").payload, 8192 - 64);
+}
+
+TEST(StorageTest, DumpLoadBinary) {
+    std::string dump = DumpLoader::Magic();
+    for (long i = 0; i < 10000; ++i) {
+        DumpLoader::AppendRecord(dump, "Key " + std::to_string(i), std::string(i % 100, 'v') + std::to_string(i));
+    }
+    DumpLoader::AppendRecord(dump, "Big", std::string(200 * 1024, 'b'));
+
+    std::shared_ptr<Storage> storage(buildStripeStorage(4, 64 * 1024 * 1024, SimpleLRU::Accounting::Payload, nullptr));
+    auto result = DumpLoader(storage, 4).Load(dump.data(), dump.size());
+    EXPECT_EQ(10001, result.records);
+    EXPECT_EQ(10001, result.stored);
+    EXPECT_EQ(dump.size(), result.bytes);
+
+    std::string value;
+    for (long i = 0; i < 10000; ++i) {
+        ASSERT_TRUE(storage->Get("Key " + std::to_string(i), value));
+        EXPECT_EQ(std::string(i % 100, 'v') + std::to_string(i), value);
+    }
+    ASSERT_TRUE(storage->Get("Big", value));
+    EXPECT_EQ(200 * 1024, value.size());
+
+    // Malformed dump is rejected before anything gets stored
+    std::string truncated = DumpLoader::Magic();
+    DumpLoader::AppendRecord(truncated, "Other", "value");
+    truncated.resize(truncated.size() - 1);
+    EXPECT_THROW(DumpLoader(storage, 4).Load(truncated.data(), truncated.size()), std::runtime_error);
+    EXPECT_FALSE(storage->Get("Other", value));
+    EXPECT_THROW(DumpLoader(storage, 1).Load("set", 3, DumpLoader::Format::Binary), std::runtime_error);
+}
+
+TEST(StorageTest, DumpLoadText) {
+    std::string dump;
+    for (long i = 0; i < 1000; ++i) {
+        std::string value = "val\r\n" + std::to_string(i);
+        dump += "set Key" + std::to_string(i) + " 0 0 " + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+    }
+    dump += "add Key0 0 0 1 noreply\r\nx\r\n";
+    dump += "add Other 1 2 1\nx\n";
+
+    // Goes through the file, so that mmap path is covered too
+    char path[] = "/tmp/afina_dump_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(dump.size(), write(fd, dump.data(), dump.size()));
+    close(fd);
+
+    auto storage = std::make_shared<ThreadSafeSimplLRU>(1024 * 1024);
+    auto result = DumpLoader(storage, 3).Load(path);
+    unlink(path);
+    EXPECT_EQ(1002, result.records);
+
+    std::string value;
+    for (long i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(storage->Get("Key" + std::to_string(i), value));
+        EXPECT_EQ("val\r\n" + std::to_string(i), value);
+    }
+    EXPECT_TRUE(storage->Get("Other", value));
+    EXPECT_EQ("x", value);
+
+    // Single thread applies records in order
+    auto ordered = std::make_shared<ThreadSafeSimplLRU>(1024 * 1024);
+    result = DumpLoader(ordered, 1).Load(dump.data(), dump.size());
+    EXPECT_EQ(1001, result.stored);
+    ASSERT_TRUE(ordered->Get("Key0", value));
+    EXPECT_EQ("val\r\n0", value);
+
+    std::string bad = "get Key0\r\n";
+    EXPECT_THROW(DumpLoader(storage, 1).Load(bad.data(), bad.size()), std::runtime_error);
+    bad = "set Key0 0 0 10\r\nshort\r\n";
+    EXPECT_THROW(DumpLoader(storage, 1).Load(bad.data(), bad.size()), std::runtime_error);
+    EXPECT_THROW(DumpLoader(storage, 1).Load("/nonexistent/dump"), std::runtime_error);
+}
+
+TEST(StorageTest, ChangeStreamRing) {
+    auto changes = std::make_shared<ChangeStream>(6);
+    EXPECT_EQ(8, changes->Capacity());
+    std::size_t shard = changes->AddShard();
+
+    ChangeStream::Subscriber subscriber(changes);
+    std::vector<ChangeStream::Event> events;
+    EXPECT_EQ(0, subscriber.Poll(events, 100));
+
+    changes->Publish(shard, ChangeStream::Type::Put, "key", 10);
+    changes->Publish(shard, ChangeStream::Type::Delete, std::string(300, 'k'), 0);
+    ASSERT_EQ(2, subscriber.Poll(events, 100));
+    EXPECT_EQ(ChangeStream::Type::Put, events[0].type);
+    EXPECT_EQ("key", events[0].key);
+    EXPECT_FALSE(events[0].truncated);
+    EXPECT_EQ(10, events[0].value_size);
+    EXPECT_EQ(0, events[0].sequence);
+    EXPECT_EQ(ChangeStream::Type::Delete, events[1].type);
+    EXPECT_EQ(std::string(ChangeStream::KeyCapacity, 'k'), events[1].key);
+    EXPECT_TRUE(events[1].truncated);
+    EXPECT_EQ(0, subscriber.TakeDropped());
+
+    // Writer never waits: slow subscriber loses the oldest events
+    for (long i = 0; i < 20; ++i) {
+        changes->Publish(shard, ChangeStream::Type::Put, "key" + std::to_string(i), i);
+    }
+    events.clear();
+    ASSERT_EQ(8, subscriber.Poll(events, 100));
+    EXPECT_EQ(12, subscriber.TakeDropped());
+    EXPECT_EQ("key12", events[0].key);
+    EXPECT_EQ("key19", events[7].key);
+    EXPECT_EQ(22, changes->Published());
+}
+
+TEST(StorageTest, ChangeStreamConcurrent) {
+    auto changes = std::make_shared<ChangeStream>(1024);
+    std::size_t shard = changes->AddShard();
+    ChangeStream::Subscriber subscriber(changes);
+
+    const long count = 200000;
+    std::thread writer([&]() {
+        for (long i = 0; i < count; ++i) {
+            changes->Publish(shard, ChangeStream::Type::Put, "key" + std::to_string(i), i);
+        }
+    });
+
+    // Whatever is read must be consistent and in order, the rest is reported as dropped
+    std::vector<ChangeStream::Event> events;
+    uint64_t read = 0, dropped = 0;
+    long last = -1;
+    while (read + dropped < count) {
+        events.clear();
+        subscriber.Poll(events, 64);
+        dropped += subscriber.TakeDropped();
+        for (auto &event : events) {
+            ASSERT_EQ("key" + std::to_string(event.value_size), event.key);
+            ASSERT_GT(long(event.value_size), last);
+            ASSERT_EQ(event.value_size, event.sequence);
+            last = event.value_size;
+            read++;
+        }
+    }
+    writer.join();
+    EXPECT_EQ(count, read + dropped);
+}
+
+TEST(StorageTest, ChangeStreamEvents) {
+    SimpleLRU storage(16);
+    auto changes = std::make_shared<ChangeStream>();
+    EXPECT_TRUE(storage.Publish(changes));
+    EXPECT_EQ(changes, storage.Changes());
+    ChangeStream::Subscriber subscriber(changes);
+
+    EXPECT_TRUE(storage.Put("k1", "value1"));
+    EXPECT_TRUE(storage.Put("k1", "v1"));
+    EXPECT_TRUE(storage.Put("k2", "value2"));
+    EXPECT_TRUE(storage.Put("k3", "value3"));
+    EXPECT_TRUE(storage.Delete("k3"));
+    EXPECT_FALSE(storage.Delete("k3"));
+    EXPECT_FALSE(storage.Set("k4", "value4"));
+
+    std::vector<ChangeStream::Event> events;
+    ASSERT_EQ(6, subscriber.Poll(events, 100));
+    std::vector<std::string> seen;
+    for (auto &event : events) {
+        seen.push_back(std::string(ChangeStream::TypeName(event.type)) + " " + event.key + " " +
+                       std::to_string(event.value_size));
+    }
+    std::vector<std::string> expected = {"PUT k1 6", "PUT k1 2", "PUT k2 6", "EVICT k1 2", "PUT k3 6", "DELETE k3 0"};
+    EXPECT_EQ(expected, seen);
+
+    // Striped storage reports into a ring per stripe
+    std::unique_ptr<StripedLRU> striped(buildStripeStorage(4, 16 * 1024 * 1024));
+    auto striped_changes = std::make_shared<ChangeStream>();
+    EXPECT_TRUE(striped->Publish(striped_changes));
+    EXPECT_EQ(4, striped_changes->Shards());
+    ChangeStream::Subscriber striped_subscriber(striped_changes);
+    for (long i = 0; i < 100; ++i) {
+        EXPECT_TRUE(striped->Put("Key " + std::to_string(i), "value"));
+    }
+    events.clear();
+    EXPECT_EQ(100, striped_subscriber.Poll(events, 1000));
+    EXPECT_EQ(100, striped_changes->Published());
+
+    // Item moving between size classes is reported as updated, not deleted
+    SizeClassLRU classes(1024 * 1024);
+    auto class_changes = std::make_shared<ChangeStream>();
+    EXPECT_TRUE(classes.Publish(class_changes));
+    ChangeStream::Subscriber class_subscriber(class_changes);
+    EXPECT_TRUE(classes.Put("k", "v"));
+    EXPECT_TRUE(classes.Set("k", std::string(3000, 'x')));
+    events.clear();
+    ASSERT_EQ(2, class_subscriber.Poll(events, 100));
+    EXPECT_EQ(ChangeStream::Type::Put, events[0].type);
+    EXPECT_EQ(ChangeStream::Type::Put, events[1].type);
+    EXPECT_EQ(3000, events[1].value_size);
+    EXPECT_EQ(2, class_changes->Published());
+}
+
+TEST(StorageTest, CompareAndSet) {
+    std::vector<std::shared_ptr<Storage>> storages = {
+        std::make_shared<ThreadSafeSimplLRU>(1024 * 1024),
+        std::shared_ptr<Storage>(buildStripeStorage(4, 4 * 2 * 1024 * 1024)),
+        std::make_shared<SizeClassLRU>(1024 * 1024),
+        std::make_shared<NamespacedStorage>(1024 * 1024, NamespacedStorage::ParseConfig("a=4096")),
+        std::make_shared<LeasedStorage>(std::make_shared<ThreadSafeSimplLRU>(1024 * 1024))};
+    for (auto &storage : storages) {
+        uint64_t hash = KeyHash("key");
+        std::string value;
+        std::shared_ptr<const ChunkedValue> chunks;
+        uint64_t version = 0, other = 0;
+        Storage::Attributes attributes;
+        EXPECT_EQ(Storage::CasResult::NotFound, storage->CompareAndSet("key", hash, "v", 0));
+
+        ASSERT_TRUE(storage->Put("key", hash, "v1", Storage::Attributes(5)));
+        ASSERT_TRUE(storage->Get("key", hash, value, chunks, version, attributes));
+        EXPECT_EQ("v1", value);
+        EXPECT_EQ(5, attributes.flags);
+
+        // Any write changes version, even the one with the same value
+        ASSERT_TRUE(storage->Put("key", "v1"));
+        ASSERT_TRUE(storage->Get("key", hash, value, chunks, other, attributes));
+        EXPECT_NE(version, other);
+        EXPECT_EQ(0, attributes.flags);
+        EXPECT_EQ(Storage::CasResult::Exists, storage->CompareAndSet("key", hash, "v2", version));
+
+        // Value of another size class, attributes move along
+        EXPECT_EQ(Storage::CasResult::Stored,
+                  storage->CompareAndSet("key", hash, std::string(3000, 'x'), other, Storage::Attributes(7)));
+        ASSERT_TRUE(storage->Get("key", hash, value, chunks, version, attributes));
+        EXPECT_EQ(3000, chunks ? chunks->size() : value.size());
+        EXPECT_EQ(7, attributes.flags);
+        EXPECT_EQ(Storage::CasResult::Exists, storage->CompareAndSet("key", hash, "v3", other));
+
+        ASSERT_TRUE(storage->Put("other", "v"));
+        ASSERT_TRUE(storage->Flush());
+        EXPECT_FALSE(storage->Get("key", value));
+        EXPECT_FALSE(storage->Get("other", value));
+        EXPECT_TRUE(storage->Put("key", "v"));
+    }
+
+    // Namespace view flushes its own items only
+    NamespacedStorage storage(16384, NamespacedStorage::ParseConfig("a=4096"));
+    ASSERT_TRUE(storage.Put("a:key", "a"));
+    ASSERT_TRUE(storage.Put("key", "d"));
+    ASSERT_TRUE(storage.Namespace("a")->Flush());
+    std::string value;
+    EXPECT_FALSE(storage.Get("a:key", value));
+    EXPECT_TRUE(storage.Get("key", value));
+}
+
+TEST(StorageTest, Expiration) {
+    std::vector<std::shared_ptr<Storage>> storages = {
+        std::make_shared<ThreadSafeSimplLRU>(1024 * 1024),
+        std::shared_ptr<Storage>(buildStripeStorage(4, 4 * 2 * 1024 * 1024)),
+        std::make_shared<SizeClassLRU>(1024 * 1024),
+        std::make_shared<NamespacedStorage>(1024 * 1024, NamespacedStorage::ParseConfig("a=4096")),
+        std::make_shared<LeasedStorage>(std::make_shared<ThreadSafeSimplLRU>(1024 * 1024))};
+    for (auto &storage : storages) {
+        uint64_t hash = KeyHash("key");
+        uint64_t later = Storage::Now() + 3600 * 1000;
+        std::string value;
+        std::shared_ptr<const ChunkedValue> chunks;
+        uint64_t version = 0;
+        Storage::Attributes attributes;
+
+        // Expired item is gone for reads and writes which need it
+        ASSERT_TRUE(storage->Put("key", hash, "v", Storage::Attributes(0, 1)));
+        EXPECT_FALSE(storage->Get("key", value));
+        EXPECT_FALSE(storage->Set("key", hash, "v"));
+        EXPECT_FALSE(storage->Touch("key", hash, later));
+        EXPECT_TRUE(storage->PutIfAbsent("key", hash, "v", Storage::Attributes(0, later)));
+
+        // Deadline is kept when asked to, even if item moves to another size class
+        ASSERT_TRUE(storage->Get("key", hash, value, chunks, version, attributes));
+        EXPECT_EQ(later, attributes.deadline);
+        Storage::Attributes keep(3, Storage::Attributes::KeepDeadline);
+        EXPECT_EQ(Storage::CasResult::Stored,
+                  storage->CompareAndSet("key", hash, std::string(3000, 'x'), version, keep));
+        ASSERT_TRUE(storage->Get("key", hash, value, chunks, version, attributes));
+        EXPECT_EQ(3, attributes.flags);
+        EXPECT_EQ(later, attributes.deadline);
+        EXPECT_TRUE(storage->Put("key", hash, "v", keep));
+        ASSERT_TRUE(storage->Get("key", hash, value, chunks, version, attributes));
+        EXPECT_EQ(later, attributes.deadline);
+
+        // Plain write drops the deadline, touch sets it
+        EXPECT_TRUE(storage->Put("key", hash, "v"));
+        ASSERT_TRUE(storage->Get("key", hash, value, chunks, version, attributes));
+        EXPECT_EQ(0, attributes.deadline);
+        EXPECT_TRUE(storage->Touch("key", hash, 1));
+        EXPECT_FALSE(storage->Get("key", hash, value));
+        EXPECT_FALSE(storage->Delete("key", hash));
+    }
+}
+
+TEST(StorageTest, BatchedAccess) {
+    std::vector<std::shared_ptr<Storage>> storages = {
+        std::make_shared<ThreadSafeSimplLRU>(1024 * 1024),
+        std::shared_ptr<Storage>(buildStripeStorage(4, 4 * 2 * 1024 * 1024)),
+        std::make_shared<SizeClassLRU>(1024 * 1024)};
+    for (auto &storage : storages) {
+        std::vector<std::string> keys, values;
+        std::vector<uint64_t> hashes;
+        for (int i = 0; i < 100; i++) {
+            keys.push_back("key" + std::to_string(i));
+            hashes.push_back(KeyHash(keys.back()));
+            values.push_back(i == 50 ? std::string(100000, 'v') : std::to_string(i));
+        }
+
+        // Duplicate key: the last pair wins
+        keys.push_back("key0");
+        hashes.push_back(KeyHash("key0"));
+        values.push_back("last");
+        EXPECT_EQ(101, storage->PutMany(keys, hashes, values));
+
+        keys.push_back("missing");
+        hashes.push_back(KeyHash("missing"));
+        std::vector<std::string> got;
+        std::vector<std::shared_ptr<const ChunkedValue>> chunks;
+        std::vector<uint64_t> versions;
+        std::vector<Storage::Attributes> attributes;
+        std::vector<bool> found;
+        storage->GetMany(keys, hashes, got, chunks, versions, attributes, found);
+        ASSERT_EQ(102, found.size());
+        EXPECT_FALSE(found[101]);
+        for (int i = 0; i < 101; i++) {
+            ASSERT_TRUE(found[i]) << i;
+            EXPECT_NE(0, versions[i]) << i;
+            std::string value = got[i];
+            if (chunks[i]) {
+                chunks[i]->CopyTo(value);
+            }
+            EXPECT_EQ(i == 0 || i == 100 ? "last" : values[i], value) << i;
+        }
+    }
+}
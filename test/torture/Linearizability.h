@@ -0,0 +1,251 @@
+#ifndef AFINA_TEST_TORTURE_LINEARIZABILITY_H
+#define AFINA_TEST_TORTURE_LINEARIZABILITY_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <afina/Storage.h>
+
+namespace Afina {
+namespace Torture {
+
+/**
+ * # Operation of the concurrent history
+ * Storage call with its arguments, result and logical timestamps of invocation and response. Timestamps
+ * come from one shared counter, so that if one operation returned before another one was invoked, its
+ * response is less than invocation of the other
+ */
+struct Operation {
+    enum class Type { Put, PutIfAbsent, Set, Delete, Get };
+
+    Type type;
+    std::string key;
+
+    // Value written, or read by Get
+    std::string value;
+
+    // Result returned by the storage, for Get tells whether key was found
+    bool result;
+
+    uint64_t invoked;
+    uint64_t returned;
+};
+
+/**
+ * Calls storage and records the operation
+ */
+class Recorder {
+public:
+    Recorder() : _clock(0) {}
+
+    Operation Call(Storage &storage, Operation::Type type, const std::string &key, const std::string &value) {
+        Operation op;
+        op.type = type;
+        op.key = key;
+        op.value = value;
+        op.invoked = _clock.fetch_add(1);
+        switch (type) {
+        case Operation::Type::Put:
+            op.result = storage.Put(key, value);
+            break;
+        case Operation::Type::PutIfAbsent:
+            op.result = storage.PutIfAbsent(key, value);
+            break;
+        case Operation::Type::Set:
+            op.result = storage.Set(key, value);
+            break;
+        case Operation::Type::Delete:
+            op.result = storage.Delete(key);
+            break;
+        case Operation::Type::Get:
+            op.value.clear();
+            op.result = storage.Get(key, op.value);
+            break;
+        }
+        op.returned = _clock.fetch_add(1);
+        return op;
+    }
+
+private:
+    std::atomic<uint64_t> _clock;
+};
+
+/**
+ * # Linearizability checker
+ * Tells whether history of key/value operations could be explained by some sequential order that respects
+ * real time: each operation takes effect at some point between its invocation and response.
+ *
+ * Keys are independent registers and linearizability is local, so that history is split by key and each
+ * part is checked on its own with Wing & Gong search with memoization of visited (linearized set, state)
+ * pairs, as described by Lowe in "Testing for linearizability". Items must not be evicted during the
+ * history, storage is expected to keep everything written.
+ */
+class Checker {
+public:
+    /**
+     * @return true if history is linearizable, otherwise key of the first violating part is put into bad_key
+     */
+    static bool Check(const std::vector<Operation> &history, std::string &bad_key) {
+        std::map<std::string, std::vector<const Operation *>> by_key;
+        for (auto &op : history) {
+            by_key[op.key].push_back(&op);
+        }
+        for (auto &part : by_key) {
+            if (!_check(part.second)) {
+                bad_key = part.first;
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    // Value of the register, empty if there is no key
+    struct state {
+        bool present;
+        std::string value;
+    };
+
+    // Sequential specification of the storage
+    static bool _step(const state &current, const Operation &op, state &next) {
+        next = current;
+        switch (op.type) {
+        case Operation::Type::Put:
+            next.present = true;
+            next.value = op.value;
+            return op.result;
+        case Operation::Type::PutIfAbsent:
+            if (current.present) {
+                return !op.result;
+            }
+            next.present = true;
+            next.value = op.value;
+            return op.result;
+        case Operation::Type::Set:
+            if (!current.present) {
+                return !op.result;
+            }
+            next.value = op.value;
+            return op.result;
+        case Operation::Type::Delete:
+            next.present = false;
+            next.value.clear();
+            return op.result == current.present;
+        case Operation::Type::Get:
+            return op.result == current.present && (!op.result || op.value == current.value);
+        }
+        return false;
+    }
+
+    // Invocation or response of an operation, linked in order of timestamps
+    struct entry {
+        std::size_t op;
+        bool call;
+
+        // Paired response for call entries
+        std::size_t match;
+        std::size_t prev, next;
+    };
+
+    static bool _check(const std::vector<const Operation *> &ops) {
+        // Entries are laid out in time order, with sentinel head at index 0
+        std::vector<std::pair<uint64_t, std::pair<std::size_t, bool>>> events;
+        for (std::size_t i = 0; i < ops.size(); ++i) {
+            events.push_back({ops[i]->invoked, {i, true}});
+            events.push_back({ops[i]->returned, {i, false}});
+        }
+        std::sort(events.begin(), events.end());
+
+        const std::size_t none = std::size_t(-1);
+        std::vector<entry> entries(events.size() + 1);
+        std::vector<std::size_t> call_of(ops.size()), return_of(ops.size());
+        entries[0].prev = none;
+        for (std::size_t i = 0; i < events.size(); ++i) {
+            entry &e = entries[i + 1];
+            e.op = events[i].second.first;
+            e.call = events[i].second.second;
+            e.prev = i;
+            e.next = i + 2 <= events.size() ? i + 2 : none;
+            entries[i].next = i + 1;
+            (e.call ? call_of : return_of)[e.op] = i + 1;
+        }
+        for (std::size_t i = 0; i < ops.size(); ++i) {
+            entries[call_of[i]].match = return_of[i];
+        }
+
+        auto lift = [&entries, none](std::size_t e) {
+            for (std::size_t x : {e, entries[e].match}) {
+                entries[entries[x].prev].next = entries[x].next;
+                if (entries[x].next != none) {
+                    entries[entries[x].next].prev = entries[x].prev;
+                }
+            }
+        };
+        auto unlift = [&entries, none](std::size_t e) {
+            for (std::size_t x : {entries[e].match, e}) {
+                entries[entries[x].prev].next = x;
+                if (entries[x].next != none) {
+                    entries[entries[x].next].prev = x;
+                }
+            }
+        };
+
+        // Memo of visited configurations: bitset of linearized operations followed by the state
+        std::vector<uint64_t> linearized((ops.size() + 63) / 64, 0);
+        std::unordered_set<std::string> visited;
+        auto memo_key = [&linearized](const state &s) {
+            std::string result(reinterpret_cast<const char *>(linearized.data()), linearized.size() * 8);
+            result.push_back(s.present ? '1' : '0');
+            return result.append(s.value);
+        };
+
+        std::vector<std::pair<std::size_t, state>> stack;
+        state current{false, ""};
+        std::size_t e = entries[0].next;
+        while (entries[0].next != none) {
+            if (e == none) {
+                return false;
+            }
+
+            const entry &en = entries[e];
+            if (en.call) {
+                state next;
+                if (_step(current, *ops[en.op], next)) {
+                    linearized[en.op / 64] |= uint64_t(1) << (en.op % 64);
+                    if (visited.insert(memo_key(next)).second) {
+                        stack.emplace_back(e, current);
+                        current = next;
+                        lift(e);
+                        e = entries[0].next;
+                        continue;
+                    }
+                    linearized[en.op / 64] &= ~(uint64_t(1) << (en.op % 64));
+                }
+                e = en.next;
+            } else {
+                // Some operation has returned but none of pending ones could go before it: backtrack
+                if (stack.empty()) {
+                    return false;
+                }
+                e = stack.back().first;
+                current = stack.back().second;
+                stack.pop_back();
+                linearized[entries[e].op / 64] &= ~(uint64_t(1) << (entries[e].op % 64));
+                unlift(e);
+                e = entries[e].next;
+            }
+        }
+        return true;
+    }
+};
+
+} // namespace Torture
+} // namespace Afina
+
+#endif // AFINA_TEST_TORTURE_LINEARIZABILITY_H
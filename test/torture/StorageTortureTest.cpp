@@ -0,0 +1,237 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <afina/ChangeStream.h>
+
+#include "storage/LeasedStorage.h"
+#include "storage/NamespacedStorage.h"
+#include "storage/SizeClassLRU.h"
+#include "storage/StripedLRU.h"
+#include "storage/ThreadSafeSimpleLRU.h"
+
+#include "Linearizability.h"
+
+using namespace Afina;
+using namespace Afina::Backend;
+using namespace Afina::Torture;
+
+namespace {
+
+// Concurrent storages under test, each big enough to never evict during linearizability runs
+const std::vector<std::pair<std::string, std::function<std::shared_ptr<Storage>(std::size_t)>>> &Engines() {
+    static const std::vector<std::pair<std::string, std::function<std::shared_ptr<Storage>(std::size_t)>>> engines = {
+        {"mt_lru", [](std::size_t size) { return std::make_shared<ThreadSafeSimplLRU>(size); }},
+        {"mt_lru_gdsf",
+         [](std::size_t size) {
+             return std::make_shared<ThreadSafeSimplLRU>(size, SimpleLRU::Accounting::Payload, nullptr,
+                                                         SimpleLRU::Policy::Gdsf);
+         }},
+        {"mt_slru",
+         [](std::size_t size) {
+             return std::shared_ptr<Storage>(buildStripeStorage(4, std::max<std::size_t>(size, 8 * 1024 * 1024)));
+         }},
+        {"mt_sclru", [](std::size_t size) { return std::make_shared<SizeClassLRU>(size); }},
+        {"mt_nslru",
+         [](std::size_t size) {
+             return std::make_shared<NamespacedStorage>(
+                 size, std::vector<NamespacedStorage::Config>{NamespacedStorage::Config("a", size / 4, true),
+                                                              NamespacedStorage::Config("b", size / 4, false)});
+         }},
+        {"leased",
+         [](std::size_t size) { return std::make_shared<LeasedStorage>(std::make_shared<ThreadSafeSimplLRU>(size)); }},
+    };
+    return engines;
+}
+
+// Keys span namespaces of mt_nslru and all size classes of mt_sclru
+std::string KeyOf(std::size_t index) {
+    static const char *prefixes[] = {"", "a:", "b:", "c:"};
+    return prefixes[index % 4] + std::string("key") + std::to_string(index);
+}
+
+std::string ValueOf(std::mt19937 &rnd, std::size_t thread, std::size_t op) {
+    static const std::size_t sizes[] = {1, 200, 2000, 70 * 1024};
+    std::string value = std::to_string(thread) + "-" + std::to_string(op) + "-";
+    value.resize(value.size() + sizes[rnd() % 4] / 4, 'v');
+    return value;
+}
+
+// Runs randomized history of threads * ops operations over given number of keys
+std::vector<Operation> RunHistory(Storage &storage, std::size_t threads, std::size_t ops, std::size_t keys,
+                                  uint32_t seed) {
+    Recorder recorder;
+    std::vector<std::vector<Operation>> logs(threads);
+    std::atomic<std::size_t> ready(0);
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            std::mt19937 rnd(seed * 31 + t);
+            ready++;
+            while (ready.load() < threads) {
+                std::this_thread::yield();
+            }
+
+            for (std::size_t i = 0; i < ops; ++i) {
+                auto type = Operation::Type(rnd() % 5);
+                std::string key = KeyOf(rnd() % keys);
+                logs[t].push_back(recorder.Call(storage, type, key, ValueOf(rnd, t, i)));
+                if (rnd() % 4 == 0) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    std::vector<Operation> history;
+    for (auto &log : logs) {
+        history.insert(history.end(), log.begin(), log.end());
+    }
+    return history;
+}
+
+} // namespace
+
+TEST(TortureTest, CheckerDetectsViolations) {
+    std::string bad_key;
+
+    // Get overlapping with Put may see either value
+    std::vector<Operation> history = {
+        {Operation::Type::Put, "k", "1", true, 0, 3},
+        {Operation::Type::Get, "k", "1", true, 1, 2},
+        {Operation::Type::Get, "k", "", false, 4, 5},
+    };
+    EXPECT_FALSE(Checker::Check(history, bad_key));
+    EXPECT_EQ("k", bad_key);
+
+    history[2].type = Operation::Type::Delete;
+    history[2].result = true;
+    EXPECT_TRUE(Checker::Check(history, bad_key));
+
+    // Stale read after the write has returned
+    history = {
+        {Operation::Type::Put, "k", "1", true, 0, 1},
+        {Operation::Type::Put, "k", "2", true, 2, 3},
+        {Operation::Type::Get, "k", "1", true, 4, 5},
+    };
+    EXPECT_FALSE(Checker::Check(history, bad_key));
+
+    // Concurrent writes could be ordered either way, but both readers must agree
+    history = {
+        {Operation::Type::Put, "k", "1", true, 0, 10},
+        {Operation::Type::Put, "k", "2", true, 1, 11},
+        {Operation::Type::Get, "k", "1", true, 12, 13},
+        {Operation::Type::Get, "k", "1", true, 14, 15},
+        {Operation::Type::Get, "o", "", false, 0, 1},
+    };
+    EXPECT_TRUE(Checker::Check(history, bad_key));
+    history[3].value = "2";
+    EXPECT_FALSE(Checker::Check(history, bad_key));
+
+    // Two successful PutIfAbsent without delete in between
+    history = {
+        {Operation::Type::PutIfAbsent, "k", "1", true, 0, 5},
+        {Operation::Type::PutIfAbsent, "k", "2", true, 1, 6},
+    };
+    EXPECT_FALSE(Checker::Check(history, bad_key));
+}
+
+TEST(TortureTest, Linearizability) {
+    for (auto &engine : Engines()) {
+        for (uint32_t round = 0; round < 20; ++round) {
+            auto storage = engine.second(64 * 1024 * 1024);
+            auto history = RunHistory(*storage, 4, 100, 6, round);
+
+            std::string bad_key;
+            ASSERT_TRUE(Checker::Check(history, bad_key)) << engine.first << " round " << round << " key " << bad_key;
+        }
+    }
+}
+
+// Small storage under heavy eviction: no linearizability here, but everything read must have been written
+// for that key, memory limits hold and change stream keeps up with writers
+TEST(TortureTest, EvictionStorm) {
+    for (auto &engine : Engines()) {
+        auto storage = engine.second(1024 * 1024);
+        auto changes = std::make_shared<ChangeStream>(256);
+        ASSERT_TRUE(storage->Publish(changes)) << engine.first;
+
+        const std::size_t threads = 4;
+        std::atomic<bool> done(false);
+        std::atomic<std::size_t> failures(0);
+
+        // Subscriber reads concurrently with writers
+        std::atomic<uint64_t> seen(0);
+        std::thread subscriber([&]() {
+            ChangeStream::Subscriber reader(changes);
+            std::vector<ChangeStream::Event> events;
+            while (!done.load()) {
+                events.clear();
+                reader.Poll(events, 128);
+                reader.TakeDropped();
+                for (auto &event : events) {
+                    if (event.key.compare(0, 3, "key") != 0 && event.key.find(":key") == std::string::npos) {
+                        failures++;
+                    }
+                }
+                seen += events.size();
+                std::this_thread::yield();
+            }
+        });
+
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                std::mt19937 rnd(t);
+                std::string value;
+                for (std::size_t i = 0; i < 3000; ++i) {
+                    std::string key = KeyOf(rnd() % 1000);
+                    switch (rnd() % 4) {
+                    case 0:
+                    case 1:
+                        storage->Put(key, key + "=" + ValueOf(rnd, t, i));
+                        break;
+                    case 2:
+                        storage->Delete(key);
+                        break;
+                    default:
+                        if (storage->Get(key, value) && value.compare(0, key.size() + 1, key + "=") != 0) {
+                            failures++;
+                        }
+                    }
+                }
+            });
+        }
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        done = true;
+        subscriber.join();
+
+        EXPECT_EQ(0, failures.load()) << engine.first;
+        EXPECT_GT(changes->Published(), 0) << engine.first;
+
+        std::vector<std::pair<std::string, std::string>> stats;
+        storage->Stats(stats);
+        std::size_t bytes = 0, limit = 0;
+        for (auto &stat : stats) {
+            if (stat.first == "bytes") {
+                bytes = std::stoull(stat.second);
+            } else if (stat.first == "limit_maxbytes") {
+                limit = std::stoull(stat.second);
+            }
+        }
+
+        // Soft quotas of namespaces could overshoot a bit until the next rebalance
+        EXPECT_LE(bytes, limit + limit / 8) << engine.first;
+    }
+}